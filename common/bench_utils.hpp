@@ -0,0 +1,46 @@
+#ifndef BENCH_UTILS_HPP
+#define BENCH_UTILS_HPP
+
+#include <vector>
+#include <algorithm>
+
+#include <opencv2/core.hpp>
+
+// Utilidades compartidas por los benchmarks de monedas, segmentacion y
+// taller2c2: mediana de tiempos, cronometrado con calentamiento y comparación
+// píxel a píxel de dos resultados.
+
+// Mediana (el elemento central; 0 si no hay valores)
+inline double medianOf(std::vector<double> values) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+// Mediana en ms de repetitions ejecuciones de run, después de una de calentamiento
+template <typename F>
+inline double timeMs(F run, int repetitions) {
+    std::vector<double> times;
+    run();   // Calentamiento
+    for (int r = 0; r < repetitions; r++) {
+        int64 t0 = cv::getTickCount();
+        run();
+        times.push_back((cv::getTickCount() - t0) * 1000.0 / cv::getTickFrequency());
+    }
+    return medianOf(times);
+}
+
+// Cantidad de elementos distintos (cada canal cuenta aparte); -1 si las
+// matrices no tienen el mismo tamaño y tipo
+inline int countDifferent(const cv::Mat& a, const cv::Mat& b) {
+    if (a.size() != b.size() || a.type() != b.type()) {
+        return -1;
+    }
+    cv::Mat diff;
+    cv::compare(a.reshape(1), b.reshape(1), diff, cv::CMP_NE);
+    return cv::countNonZero(diff);
+}
+
+#endif // BENCH_UTILS_HPP
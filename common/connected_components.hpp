@@ -0,0 +1,278 @@
+#ifndef CONNECTED_COMPONENTS_HPP
+#define CONNECTED_COMPONENTS_HPP
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <climits>
+
+#include "opencv2/core.hpp"
+
+#include "trace.hpp"
+
+// Etiquetado de componentes conexas (8-conexidad) en una sola pasada por
+// bandas de filas, con estadísticas de forma acumuladas durante el recorrido.
+//
+// Cada banda se recorre en paralelo (parallel_for_) y asigna etiquetas
+// provisorias con su propio union-find; en la misma pasada cada píxel suma su
+// área, momentos de primer y segundo orden, caja envolvente y los lados que
+// limitan con el fondo (para estimar el perímetro). Después se unen las
+// etiquetas que se tocan a través del borde entre bandas (solo se comparan la
+// última fila de una banda con la primera de la siguiente), se aplanan los
+// árboles y las estadísticas de cada etiqueta provisoria se suman en su
+// componente final. La raíz de cada conjunto es siempre su etiqueta menor,
+// así que las componentes quedan numeradas en orden de barrido (primer píxel
+// de arriba hacia abajo, de izquierda a derecha).
+//
+// Sin mapa de etiquetas la memoria extra es proporcional al número de
+// etiquetas provisorias; con mapa (CV_32S, fondo 0, componentes 1..N) hace
+// falta una segunda pasada paralela para renumerar.
+
+struct ComponentStats {
+    int64_t area = 0;
+    double sumX = 0, sumY = 0;
+    double sumXX = 0, sumYY = 0, sumXY = 0;
+    int minX = INT_MAX, minY = INT_MAX, maxX = -1, maxY = -1;
+    int64_t boundaryEdges = 0;   // Lados de píxel que limitan con el fondo o el borde
+
+    void add(const ComponentStats& o) {
+        area += o.area;
+        sumX += o.sumX;
+        sumY += o.sumY;
+        sumXX += o.sumXX;
+        sumYY += o.sumYY;
+        sumXY += o.sumXY;
+        minX = std::min(minX, o.minX);
+        minY = std::min(minY, o.minY);
+        maxX = std::max(maxX, o.maxX);
+        maxY = std::max(maxY, o.maxY);
+        boundaryEdges += o.boundaryEdges;
+    }
+
+    cv::Point2d centroid() const {
+        return cv::Point2d(sumX / area, sumY / area);
+    }
+
+    cv::Rect bbox() const {
+        return cv::Rect(minX, minY, maxX - minX + 1, maxY - minY + 1);
+    }
+
+    // Perímetro estimado: la cuenta de lados de píxel sobreestima el de una
+    // curva suave en 4/pi en promedio (Crofton), así que se corrige por pi/4
+    double perimeter() const {
+        return boundaryEdges * (M_PI / 4.0);
+    }
+
+    // 4 pi A / P^2: 1 para un disco, menor para formas alargadas o irregulares
+    double circularity() const {
+        double p = perimeter();
+        return p > 0 ? 4.0 * M_PI * area / (p * p) : 0.0;
+    }
+
+    // Relación entre los ejes de la elipse de igual segundo momento (>= 1)
+    double elongation() const {
+        cv::Point2d c = centroid();
+        double mu20 = sumXX / area - c.x * c.x;
+        double mu02 = sumYY / area - c.y * c.y;
+        double mu11 = sumXY / area - c.x * c.y;
+        double common = std::sqrt(4 * mu11 * mu11 + (mu20 - mu02) * (mu20 - mu02));
+        double l1 = (mu20 + mu02 + common) / 2, l2 = (mu20 + mu02 - common) / 2;
+        return l2 > 0 ? std::sqrt(l1 / l2) : INFINITY;
+    }
+};
+
+class StripConnectedComponents {
+public:
+    explicit StripConnectedComponents(int stripRows = 0) : stripRows_(stripRows) {}
+
+    // binary CV_8UC1 (distinto de cero = primer plano). Devuelve el número de
+    // componentes; stats[i] es la componente i + 1 del mapa de etiquetas
+    int run(const cv::Mat& binary, std::vector<ComponentStats>& stats, cv::Mat* labels = nullptr) const {
+        CV_Assert(binary.type() == CV_8UC1);
+        stats.clear();
+        const int rows = binary.rows, cols = binary.cols;
+        if (labels) {
+            labels->create(binary.size(), CV_32S);
+        }
+        if (binary.empty()) {
+            return 0;
+        }
+        int stripRows = stripRows_ > 0 ? stripRows_
+                                       : std::max(16, (rows + 4 * cv::getNumThreads() - 1) / (4 * cv::getNumThreads()));
+        int numStrips = (rows + stripRows - 1) / stripRows;
+        std::vector<Strip> strips(numStrips);
+
+        // 1. Etiquetas provisorias y estadísticas por banda
+        cv::parallel_for_(cv::Range(0, numStrips), [&](const cv::Range& range) {
+            for (int s = range.start; s < range.end; s++) {
+                TraceZone zone("ccl strip", "strip", s);
+                int y0 = s * stripRows;
+                labelStrip(binary, y0, std::min(rows, y0 + stripRows), strips[s], labels);
+            }
+        });
+
+        // 2. Etiquetas globales: cada banda ocupa un rango contiguo
+        std::vector<int> base(numStrips + 1, 0);
+        for (int s = 0; s < numStrips; s++) {
+            base[s + 1] = base[s] + (int)strips[s].parent.size() - 1;
+        }
+        int total = base[numStrips];
+        std::vector<int> parent(total + 1);
+        parent[0] = 0;
+        for (int s = 0; s < numStrips; s++) {
+            const std::vector<int>& local = strips[s].parent;
+            for (size_t l = 1; l < local.size(); l++) {
+                parent[base[s] + l] = base[s] + local[l];
+            }
+        }
+
+        // 3. Unión a través de los bordes entre bandas (última fila de s - 1
+        //    contra la primera de s, vecinos x - 1, x, x + 1)
+        for (int s = 1; s < numStrips; s++) {
+            const std::vector<int>& above = strips[s - 1].lastRow;
+            const std::vector<int>& below = strips[s].firstRow;
+            for (int x = 0; x < cols; x++) {
+                if (!below[x]) {
+                    continue;
+                }
+                int a = base[s] + below[x];
+                for (int dx = -1; dx <= 1; dx++) {
+                    int xx = x + dx;
+                    if (xx >= 0 && xx < cols && above[xx]) {
+                        unite(parent, a, base[s - 1] + above[xx]);
+                    }
+                }
+            }
+        }
+
+        // 4. Aplanado: la raíz es la etiqueta menor del conjunto, así que ya
+        //    tiene su número final cuando se visita cualquier otra
+        std::vector<int> finalLabel(total + 1, 0);
+        int count = 0;
+        for (int l = 1; l <= total; l++) {
+            if (parent[l] == l) {
+                finalLabel[l] = ++count;
+            } else {
+                finalLabel[l] = finalLabel[find(parent, l)];
+            }
+        }
+        stats.assign(count, ComponentStats());
+        for (int s = 0; s < numStrips; s++) {
+            const std::vector<ComponentStats>& local = strips[s].stats;
+            for (size_t l = 1; l < local.size(); l++) {
+                stats[finalLabel[base[s] + l] - 1].add(local[l]);
+            }
+        }
+
+        // 5. Mapa de etiquetas final (opcional)
+        if (labels) {
+            cv::parallel_for_(cv::Range(0, numStrips), [&](const cv::Range& range) {
+                for (int s = range.start; s < range.end; s++) {
+                    int y0 = s * stripRows, y1 = std::min(rows, y0 + stripRows);
+                    const int* remap = &finalLabel[base[s]];
+                    for (int y = y0; y < y1; y++) {
+                        int* row = labels->ptr<int>(y);
+                        for (int x = 0; x < cols; x++) {
+                            row[x] = remap[row[x]] & -(row[x] != 0);
+                        }
+                    }
+                }
+            });
+        }
+        return count;
+    }
+
+private:
+    struct Strip {
+        std::vector<int> parent;               // Union-find local (índice 0 = fondo)
+        std::vector<ComponentStats> stats;     // Por etiqueta provisoria
+        std::vector<int> firstRow, lastRow;    // Etiquetas locales de las filas de borde
+    };
+
+    static int find(std::vector<int>& parent, int l) {
+        int root = l;
+        while (parent[root] != root) {
+            root = parent[root];
+        }
+        while (parent[l] != root) {
+            int next = parent[l];
+            parent[l] = root;
+            l = next;
+        }
+        return root;
+    }
+
+    static int unite(std::vector<int>& parent, int a, int b) {
+        a = find(parent, a);
+        b = find(parent, b);
+        if (a < b) {
+            parent[b] = a;
+            return a;
+        }
+        parent[a] = b;
+        return b;
+    }
+
+    static void labelStrip(const cv::Mat& binary, int y0, int y1, Strip& strip, cv::Mat* labels) {
+        const int rows = binary.rows, cols = binary.cols;
+        strip.parent.assign(1, 0);
+        strip.stats.assign(1, ComponentStats());
+        std::vector<int> prev(cols + 2, 0), cur(cols + 2, 0);   // Con una columna de margen a cada lado
+        for (int y = y0; y < y1; y++) {
+            const uchar* row = binary.ptr<uchar>(y);
+            const uchar* up = y > 0 ? binary.ptr<uchar>(y - 1) : nullptr;
+            const uchar* down = y + 1 < rows ? binary.ptr<uchar>(y + 1) : nullptr;
+            bool firstRow = (y == y0);
+            for (int x = 0; x < cols; x++) {
+                if (!row[x]) {
+                    cur[x + 1] = 0;
+                    continue;
+                }
+                // Vecinos ya visitados: izquierda, y arriba-izquierda, arriba,
+                // arriba-derecha dentro de la banda
+                int l = cur[x];
+                if (!firstRow) {
+                    int n[3] = {prev[x], prev[x + 1], prev[x + 2]};
+                    for (int k = 0; k < 3; k++) {
+                        if (n[k]) {
+                            l = l ? unite(strip.parent, l, n[k]) : n[k];
+                        }
+                    }
+                }
+                if (!l) {
+                    l = (int)strip.parent.size();
+                    strip.parent.push_back(l);
+                    strip.stats.push_back(ComponentStats());
+                }
+                cur[x + 1] = l;
+
+                ComponentStats& st = strip.stats[l];
+                st.area++;
+                st.sumX += x;
+                st.sumY += y;
+                st.sumXX += (double)x * x;
+                st.sumYY += (double)y * y;
+                st.sumXY += (double)x * y;
+                st.minX = std::min(st.minX, x);
+                st.maxX = std::max(st.maxX, x);
+                st.minY = std::min(st.minY, y);
+                st.maxY = std::max(st.maxY, y);
+                st.boundaryEdges += (x == 0 || !row[x - 1]) + (x + 1 == cols || !row[x + 1]) +
+                                    (!up || !up[x]) + (!down || !down[x]);
+            }
+            if (labels) {
+                std::copy(cur.begin() + 1, cur.end() - 1, labels->ptr<int>(y));
+            }
+            if (firstRow) {
+                strip.firstRow.assign(cur.begin() + 1, cur.end() - 1);
+            }
+            std::swap(prev, cur);
+        }
+        strip.lastRow.assign(prev.begin() + 1, prev.end() - 1);
+    }
+
+    int stripRows_;
+};
+
+#endif // CONNECTED_COMPONENTS_HPP
@@ -0,0 +1,491 @@
+#ifndef IMAGE_SOURCE_HPP
+#define IMAGE_SOURCE_HPP
+
+#include <stdint.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+
+#include <glob.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "opencv2/core.hpp"
+#include "opencv2/imgcodecs.hpp"
+#include "opencv2/imgproc.hpp"
+#include "opencv2/videoio.hpp"
+
+#include "trace.hpp"
+
+// Fuente de imágenes común a todos los programas.
+//
+// Una especificación puede ser:
+//   foto.jpg                 un archivo
+//   carpeta/                 todas las imágenes de la carpeta (orden alfabético)
+//   "datos/*.png"            un glob (entre comillas para que no lo expanda la shell)
+//   video.mp4, cam:0         un video o una cámara (cv::VideoCapture)
+//   raw:640x480:gray:-       cuadros crudos de tamaño fijo desde un archivo, un FIFO
+//                            o la entrada estándar (-); formatos gray, bgr, rgb
+// Varias especificaciones de archivos (archivos, carpetas, globs) se concatenan.
+//
+// La decodificación ocurre en hilos de fondo que llenan una cola acotada de
+// prefetch: mientras el programa procesa la imagen n, los decodificadores ya
+// leen las siguientes, así que la E/S queda solapada con el cómputo. Las
+// listas de archivos se decodifican con varios hilos a la vez; los videos y
+// los flujos crudos son secuenciales y usan un solo lector. read() entrega
+// siempre en el orden de entrada. stats() dice cuánto tiempo esperó el
+// consumidor: si es casi cero, la E/S está completamente oculta.
+
+struct ImageFrame {
+    cv::Mat image;
+    std::string name;       // Ruta, o "video.mp4#12" para cuadros de video/flujos
+    int64_t index = -1;     // Posición en la fuente
+    double decodeMs = 0;
+};
+
+struct ImageSourceParams {
+    int prefetch = 8;                  // Imágenes decodificadas por adelantado
+    int decodeThreads = 2;             // Solo para listas de archivos
+    int imreadFlags = cv::IMREAD_COLOR;
+};
+
+struct ImageSourceStats {
+    int64_t frames = 0;      // Entregadas por read()
+    int64_t failed = 0;      // Archivos que no se pudieron decodificar (se saltan)
+    double decodeMs = 0;     // Suma del tiempo de decodificación de todos los hilos
+    double waitMs = 0;       // Tiempo que read() esperó por una imagen
+};
+
+class ImageSource {
+public:
+    explicit ImageSource(const ImageSourceParams& params = ImageSourceParams())
+        : params_(params) {
+        params_.prefetch = std::max(1, params_.prefetch);
+        params_.decodeThreads = std::max(1, params_.decodeThreads);
+    }
+
+    ~ImageSource() {
+        close();
+    }
+
+    bool open(const std::string& spec) {
+        return open(std::vector<std::string>(1, spec));
+    }
+
+    // Abre una o varias especificaciones y arranca los decodificadores
+    bool open(const std::vector<std::string>& specs) {
+        close();
+        error_.clear();
+        files_.clear();
+        kind_ = FILES;
+        for (size_t i = 0; i < specs.size(); i++) {
+            const std::string& spec = specs[i];
+            if (spec.compare(0, 4, "raw:") == 0 || spec.compare(0, 4, "cam:") == 0 || isVideoPath(spec)) {
+                if (specs.size() != 1) {
+                    error_ = "un video o flujo crudo no se puede combinar con otras fuentes: " + spec;
+                    return false;
+                }
+                return spec.compare(0, 4, "raw:") == 0 ? openRaw(spec) : openVideo(spec);
+            }
+            std::vector<std::string> expanded = expand(spec);
+            if (expanded.empty()) {
+                error_ = "no hay imágenes en " + spec;
+                return false;
+            }
+            files_.insert(files_.end(), expanded.begin(), expanded.end());
+        }
+        if (files_.empty()) {
+            error_ = "no se indicó ninguna imagen";
+            return false;
+        }
+        name_ = specs.size() == 1 ? specs[0] : std::to_string(files_.size()) + " archivos";
+        start((int64_t)files_.size(), std::min(params_.decodeThreads, (int)files_.size()));
+        return true;
+    }
+
+    // Siguiente imagen en orden de entrada; false al terminar
+    bool read(ImageFrame& frame) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            if (!isReady()) {
+                TraceZone waitZone("wait image");
+                std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+                ready_.wait(lock, [this]() { return isReady(); });
+                stats_.waitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            }
+            std::map<int64_t, ImageFrame>::iterator it = decoded_.find(consumed_);
+            if (it == decoded_.end()) {
+                return false;   // Fin de la fuente
+            }
+            frame = it->second;
+            decoded_.erase(it);
+            consumed_++;
+            space_.notify_all();
+            if (frame.image.empty()) {
+                stats_.failed++;
+                fprintf(stderr, "No se pudo decodificar %s\n", frame.name.c_str());
+                continue;
+            }
+            stats_.frames++;
+            return true;
+        }
+    }
+
+    // Detiene los hilos y descarta lo que quedó en la cola
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        space_.notify_all();
+        // Despierta al lector crudo si está bloqueado esperando datos (stdin, FIFO)
+        if (wakeFds_[1] >= 0) {
+            char byte = 0;
+            while (::write(wakeFds_[1], &byte, 1) < 0 && errno == EINTR) {
+            }
+        }
+        for (size_t i = 0; i < threads_.size(); i++) {
+            threads_[i].join();
+        }
+        threads_.clear();
+        capture_.release();
+        int* fds[] = {&rawFd_, &wakeFds_[0], &wakeFds_[1]};
+        for (int* fd : fds) {
+            if (*fd >= 0) {
+                ::close(*fd);
+            }
+            *fd = -1;
+        }
+        decoded_.clear();
+        stopping_ = false;
+        endIndex_ = consumed_;   // read() después de close() devuelve false
+    }
+
+    // Número de imágenes si se conoce (listas de archivos, videos), -1 si no
+    int64_t size() const { return total_; }
+    const std::string& name() const { return name_; }
+    const std::string& error() const { return error_; }
+
+    ImageSourceStats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    // Carga la primera imagen de una especificación (programas de una sola
+    // imagen). Si falla devuelve una Mat vacía y, si error no es nulo, el motivo
+    static cv::Mat loadFirst(const std::string& spec, int imreadFlags = cv::IMREAD_COLOR,
+                             std::string* error = nullptr) {
+        ImageSourceParams params;
+        params.prefetch = 1;
+        params.decodeThreads = 1;
+        params.imreadFlags = imreadFlags;
+        ImageSource source(params);
+        ImageFrame frame;
+        if (!source.open(spec) || !source.read(frame) || frame.image.empty()) {
+            if (error) {
+                *error = source.error().empty() ? "no se pudo leer " + spec : source.error();
+            }
+            return cv::Mat();
+        }
+        return frame.image;
+    }
+
+    // Carpeta o glob -> archivos de imagen ordenados; un archivo se devuelve tal cual
+    static std::vector<std::string> expand(const std::string& spec) {
+        std::vector<std::string> files;
+        struct stat st;
+        if (spec.find_first_of("*?[") != std::string::npos) {
+            glob_t g;
+            if (glob(spec.c_str(), 0, nullptr, &g) == 0) {
+                for (size_t i = 0; i < g.gl_pathc; i++) {
+                    if (isImagePath(g.gl_pathv[i])) {
+                        files.push_back(g.gl_pathv[i]);
+                    }
+                }
+            }
+            globfree(&g);
+        } else if (stat(spec.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+            std::string dir = spec[spec.size() - 1] == '/' ? spec : spec + "/";
+            if (DIR* d = opendir(spec.c_str())) {
+                while (struct dirent* e = readdir(d)) {
+                    if (e->d_name[0] != '.' && isImagePath(e->d_name)) {
+                        files.push_back(dir + e->d_name);
+                    }
+                }
+                closedir(d);
+            }
+        } else if (stat(spec.c_str(), &st) == 0) {
+            files.push_back(spec);
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    static bool isImagePath(const std::string& path) {
+        static const char* exts[] = {"jpg", "jpeg", "png", "bmp", "tif", "tiff", "webp", "pgm", "ppm", "pbm", "pnm", "jp2", "exr", "hdr"};
+        std::string ext = extension(path);
+        for (const char* e : exts) {
+            if (ext == e) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool isVideoPath(const std::string& path) {
+        static const char* exts[] = {"mp4", "avi", "mkv", "mov", "webm", "mpg", "mpeg", "m4v", "wmv", "flv"};
+        std::string ext = extension(path);
+        for (const char* e : exts) {
+            if (ext == e) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    enum Kind { FILES, VIDEO, RAW };
+
+    static std::string extension(const std::string& path) {
+        size_t dot = path.find_last_of('.');
+        size_t slash = path.find_last_of('/');
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+            return "";
+        }
+        std::string ext = path.substr(dot + 1);
+        for (size_t i = 0; i < ext.size(); i++) {
+            ext[i] = (char)tolower((unsigned char)ext[i]);
+        }
+        return ext;
+    }
+
+    bool openVideo(const std::string& spec) {
+        kind_ = VIDEO;
+        name_ = spec;
+        bool ok = spec.compare(0, 4, "cam:") == 0 ? capture_.open(atoi(spec.c_str() + 4)) : capture_.open(spec);
+        if (!ok || !capture_.isOpened()) {
+            error_ = "no se pudo abrir el video " + spec;
+            return false;
+        }
+        double frames = capture_.get(cv::CAP_PROP_FRAME_COUNT);
+        start(frames > 0 ? (int64_t)frames : -1, 1);
+        return true;
+    }
+
+    // raw:<ancho>x<alto>:<gray|bgr|rgb>:<ruta o ->
+    bool openRaw(const std::string& spec) {
+        kind_ = RAW;
+        name_ = spec;
+        int w = 0, h = 0;
+        char format[16] = {0};
+        int consumed = 0;
+        if (sscanf(spec.c_str(), "raw:%dx%d:%15[a-z]:%n", &w, &h, format, &consumed) < 3 || consumed == 0 ||
+            w <= 0 || h <= 0) {
+            error_ = "flujo crudo mal especificado (raw:<ancho>x<alto>:<gray|bgr|rgb>:<ruta>): " + spec;
+            return false;
+        }
+        std::string fmt = format;
+        if (fmt != "gray" && fmt != "bgr" && fmt != "rgb") {
+            error_ = "formato crudo desconocido: " + fmt;
+            return false;
+        }
+        std::string path = spec.substr(consumed);
+        rawFd_ = path == "-" ? dup(0) : ::open(path.c_str(), O_RDONLY);
+        if (rawFd_ < 0) {
+            error_ = "no se pudo abrir " + path + ": " + strerror(errno);
+            return false;
+        }
+        if (pipe(wakeFds_) != 0) {
+            error_ = std::string("no se pudo crear el pipe de aviso: ") + strerror(errno);
+            ::close(rawFd_);
+            rawFd_ = -1;
+            return false;
+        }
+        rawSize_ = cv::Size(w, h);
+        rawFormat_ = fmt;
+        start(-1, 1);
+        return true;
+    }
+
+    void start(int64_t total, int threads) {
+        total_ = total;
+        consumed_ = 0;
+        nextToDecode_ = 0;
+        endIndex_ = kind_ == FILES ? total : -1;
+        stats_ = ImageSourceStats();
+        stopping_ = false;
+        for (int t = 0; t < threads; t++) {
+            threads_.emplace_back([this, t]() {
+                traceSetThreadName("decode #" + std::to_string(t));
+                if (kind_ == FILES) {
+                    decodeFiles();
+                } else {
+                    readSequential();
+                }
+            });
+        }
+    }
+
+    // Hay algo que entregar: la siguiente imagen o el fin de la fuente
+    bool isReady() const {
+        return decoded_.count(consumed_) || (endIndex_ >= 0 && consumed_ >= endIndex_);
+    }
+
+    // Espera lugar en la cola de prefetch; false si hay que terminar
+    bool waitForSpace(std::unique_lock<std::mutex>& lock, int64_t index) {
+        space_.wait(lock, [&]() { return stopping_ || index < consumed_ + params_.prefetch; });
+        return !stopping_;
+    }
+
+    void decodeFiles() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (nextToDecode_ < (int64_t)files_.size()) {
+            int64_t index = nextToDecode_++;
+            if (!waitForSpace(lock, index)) {
+                return;
+            }
+            lock.unlock();
+            ImageFrame frame;
+            frame.index = index;
+            frame.name = files_[index];
+            std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+            try {
+                TraceZone zone("decode", "image", index);
+                frame.image = cv::imread(frame.name, params_.imreadFlags);
+            } catch (const cv::Exception&) {
+                frame.image.release();   // Se reporta como fallida en read()
+            }
+            frame.decodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            lock.lock();
+            stats_.decodeMs += frame.decodeMs;
+            decoded_[index] = frame;
+            ready_.notify_all();
+        }
+    }
+
+    void readSequential() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (int64_t index = 0;; index++) {
+            if (!waitForSpace(lock, index)) {
+                return;
+            }
+            lock.unlock();
+            ImageFrame frame;
+            frame.index = index;
+            frame.name = name_ + "#" + std::to_string(index);
+            std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+            bool ok;
+            {
+                TraceZone zone("decode", "frame", index);
+                ok = kind_ == VIDEO ? readVideoFrame(frame.image) : readRawFrame(frame.image);
+            }
+            frame.decodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            lock.lock();
+            if (!ok) {
+                endIndex_ = index;
+                ready_.notify_all();
+                return;
+            }
+            stats_.decodeMs += frame.decodeMs;
+            decoded_[index] = frame;
+            ready_.notify_all();
+        }
+    }
+
+    bool readVideoFrame(cv::Mat& image) {
+        cv::Mat frame;
+        if (!capture_.read(frame) || frame.empty()) {
+            return false;
+        }
+        convertForFlags(frame, image);
+        return true;
+    }
+
+    bool readRawFrame(cv::Mat& image) {
+        int channels = rawFormat_ == "gray" ? 1 : 3;
+        cv::Mat frame(rawSize_, CV_8UC(channels));
+        size_t bytes = frame.total() * channels, done = 0;
+        while (done < bytes) {
+            // Se espera con poll junto al pipe de aviso para que close() no
+            // quede colgado en un read() de un FIFO o de stdin sin datos
+            struct pollfd fds[2] = {{rawFd_, POLLIN, 0}, {wakeFds_[0], POLLIN, 0}};
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (stopping_) {
+                    return false;
+                }
+            }
+            if (fds[0].revents == 0) {
+                continue;
+            }
+            ssize_t n = ::read(rawFd_, frame.data + done, bytes - done);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;   // Fin del flujo (un cuadro incompleto se descarta)
+            }
+            done += (size_t)n;
+        }
+        if (rawFormat_ == "rgb") {
+            cv::cvtColor(frame, frame, cv::COLOR_RGB2BGR);
+        }
+        convertForFlags(frame, image);
+        return true;
+    }
+
+    // Aplica a los cuadros de video/flujos el mismo formato que imread con los flags pedidos
+    void convertForFlags(const cv::Mat& frame, cv::Mat& image) const {
+        bool gray = params_.imreadFlags == cv::IMREAD_GRAYSCALE;
+        if (gray && frame.channels() == 3) {
+            cv::cvtColor(frame, image, cv::COLOR_BGR2GRAY);
+        } else if (!gray && params_.imreadFlags != cv::IMREAD_UNCHANGED && frame.channels() == 1) {
+            cv::cvtColor(frame, image, cv::COLOR_GRAY2BGR);
+        } else {
+            image = frame;
+        }
+    }
+
+    ImageSourceParams params_;
+    Kind kind_ = FILES;
+    std::string name_;
+    std::string error_;
+    std::vector<std::string> files_;
+    cv::VideoCapture capture_;
+    int rawFd_ = -1;
+    int wakeFds_[2] = {-1, -1};        // Pipe que close() escribe para despertar al lector crudo
+    cv::Size rawSize_;
+    std::string rawFormat_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;    // Hay una imagen nueva (o terminó la fuente)
+    std::condition_variable space_;    // El consumidor liberó lugar en la cola
+    std::vector<std::thread> threads_;
+    std::map<int64_t, ImageFrame> decoded_;
+    int64_t total_ = -1;
+    int64_t consumed_ = 0;
+    int64_t nextToDecode_ = 0;
+    int64_t endIndex_ = -1;            // Índice del fin de la fuente, -1 si aún no se sabe
+    bool stopping_ = false;
+    ImageSourceStats stats_;
+};
+
+#endif // IMAGE_SOURCE_HPP
@@ -0,0 +1,139 @@
+#ifndef IMAGE_WRITER_HPP
+#define IMAGE_WRITER_HPP
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include "opencv2/core.hpp"
+#include "opencv2/imgcodecs.hpp"
+
+#include "trace.hpp"
+
+// Escritura de imágenes en hilos de fondo (contraparte de image_source.hpp).
+//
+// write() encola la imagen y vuelve enseguida; la codificación (JPEG, PNG) y
+// la escritura ocurren en los hilos del escritor. La cola es acotada: si los
+// hilos no dan abasto write() espera, así que la memoria no crece sin límite.
+// La Mat se encola sin copiar (cuenta de referencias): quien la pasa no debe
+// modificarla después. flush() espera a que se vacíe la cola; el destructor
+// hace flush y detiene los hilos.
+
+struct ImageWriterStats {
+    int64_t written = 0;
+    int64_t failed = 0;
+    double encodeMs = 0;     // Suma del tiempo de codificación y escritura
+    double waitMs = 0;       // Tiempo que write() esperó por lugar en la cola
+};
+
+class AsyncImageWriter {
+public:
+    explicit AsyncImageWriter(int threads = 1, size_t maxQueue = 32)
+        : maxQueue_(maxQueue > 0 ? maxQueue : 1), busy_(0), stopping_(false) {
+        for (int i = 0; i < (threads > 0 ? threads : 1); i++) {
+            threads_.emplace_back([this, i]() { run(i); });
+        }
+    }
+
+    ~AsyncImageWriter() {
+        flush();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        ready_.notify_all();
+        for (size_t i = 0; i < threads_.size(); i++) {
+            threads_[i].join();
+        }
+    }
+
+    void write(const std::string& path, const cv::Mat& image) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (queue_.size() >= maxQueue_) {
+            TraceZone waitZone("wait writer");
+            std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+            space_.wait(lock, [this]() { return queue_.size() < maxQueue_; });
+            stats_.waitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        }
+        queue_.push_back(Job{path, image});
+        ready_.notify_one();
+    }
+
+    // Espera a que todas las imágenes encoladas estén escritas
+    void flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        space_.wait(lock, [this]() { return queue_.empty() && busy_ == 0; });
+    }
+
+    ImageWriterStats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+private:
+    struct Job {
+        std::string path;
+        cv::Mat image;
+    };
+
+    void run(int id) {
+        traceSetThreadName("writer #" + std::to_string(id));
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            ready_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;   // stopping_ y sin trabajo pendiente
+            }
+            Job job = queue_.front();
+            queue_.pop_front();
+            busy_++;
+            space_.notify_all();
+            lock.unlock();
+
+            std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+            bool ok = false;
+            {
+                TraceZone zone("write image");
+                try {
+                    ok = cv::imwrite(job.path, job.image);
+                } catch (const cv::Exception&) {
+                    ok = false;
+                }
+            }
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            if (!ok) {
+                fprintf(stderr, "No se pudo escribir %s\n", job.path.c_str());
+            }
+
+            lock.lock();
+            busy_--;
+            stats_.encodeMs += ms;
+            if (ok) {
+                stats_.written++;
+            } else {
+                stats_.failed++;
+            }
+            space_.notify_all();
+        }
+    }
+
+    AsyncImageWriter(const AsyncImageWriter&);
+    AsyncImageWriter& operator=(const AsyncImageWriter&);
+
+    size_t maxQueue_;
+    int busy_;
+    bool stopping_;
+    std::deque<Job> queue_;
+    std::vector<std::thread> threads_;
+    mutable std::mutex mutex_;
+    std::condition_variable ready_, space_;
+    ImageWriterStats stats_;
+};
+
+#endif // IMAGE_WRITER_HPP
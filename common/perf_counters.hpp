@@ -0,0 +1,434 @@
+#ifndef PERF_COUNTERS_HPP
+#define PERF_COUNTERS_HPP
+
+#include <stdint.h>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+
+#include "trace.hpp"
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#define PERF_COUNTERS_LINUX 1
+#endif
+
+// Contadores de hardware por etapa (perf_event_open).
+//
+// PerfCounters abre cuatro contadores del hilo llamador: ciclos,
+// instrucciones, fallos de la caché de último nivel (LLC) y fallos de
+// predicción de saltos. Se abren como un grupo (el primero que abre es el
+// líder): se habilitan y deshabilitan juntos con un ioctl al líder y se leen
+// con un solo read(), así que todos cubren exactamente el mismo intervalo y
+// el kernel los multiplexa como unidad. Un contador que no puede sumarse al
+// grupo se abre suelto y se lee aparte. Si el kernel no los ofrece (contenedores,
+// perf_event_paranoid alto, máquinas virtuales sin PMU, otro sistema
+// operativo) available() es false y las etapas se siguen midiendo con el
+// reloj; en CSV/JSON los contadores ausentes quedan vacíos / null.
+//
+// Los contadores siguen solo al hilo que los abrió: el trabajo que OpenCV
+// reparte en su pool (parallel_for_) no se cuenta. Por eso los programas
+// ponen cv::setNumThreads(1) cuando se activa --perf.
+//
+// PerfStageRecorder acumula una fila por (etiqueta, etapa); PerfScope mide
+// una etapa dentro de un bloque y no hace nada si el recorder es nulo. Cada
+// etapa es además una zona de la traza de línea de tiempo (trace.hpp).
+
+enum PerfCounterId {
+    PERF_CYCLES = 0,
+    PERF_INSTRUCTIONS,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_NUM_COUNTERS
+};
+
+struct PerfSample {
+    double wallMs = 0;
+    uint64_t values[PERF_NUM_COUNTERS] = {0, 0, 0, 0};
+    bool valid[PERF_NUM_COUNTERS] = {false, false, false, false};
+
+    bool has(PerfCounterId id) const { return valid[id]; }
+    uint64_t get(PerfCounterId id) const { return values[id]; }
+
+    double ipc() const {
+        return valid[PERF_CYCLES] && valid[PERF_INSTRUCTIONS] && values[PERF_CYCLES] > 0
+            ? (double)values[PERF_INSTRUCTIONS] / values[PERF_CYCLES] : 0;
+    }
+
+    void add(const PerfSample& o) {
+        wallMs += o.wallMs;
+        for (int i = 0; i < PERF_NUM_COUNTERS; i++) {
+            values[i] += o.values[i];
+            valid[i] = valid[i] || o.valid[i];
+        }
+    }
+};
+
+class PerfCounters {
+public:
+    PerfCounters() {
+        for (int i = 0; i < PERF_NUM_COUNTERS; i++) {
+            fds_[i] = -1;
+            inGroup_[i] = false;
+        }
+#ifdef PERF_COUNTERS_LINUX
+        add(PERF_CYCLES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        add(PERF_INSTRUCTIONS, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        // LLC: fallos de lectura del último nivel; si el PMU no expone el
+        // evento genérico de caché se usa PERF_COUNT_HW_CACHE_MISSES
+        add(PERF_LLC_MISSES, PERF_TYPE_HW_CACHE,
+            PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+        if (fds_[PERF_LLC_MISSES] < 0) {
+            add(PERF_LLC_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        }
+        add(PERF_BRANCH_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        if (!available()) {
+            error_ = std::string("perf_event_open no disponible: ") + strerror(firstErrno_);
+        }
+#else
+        error_ = "perf_event_open solo existe en Linux";
+#endif
+    }
+
+    ~PerfCounters() {
+#ifdef PERF_COUNTERS_LINUX
+        for (int i = 0; i < PERF_NUM_COUNTERS; i++) {
+            if (fds_[i] >= 0) {
+                close(fds_[i]);
+            }
+        }
+#endif
+    }
+
+    // true si al menos un contador de hardware se pudo abrir
+    bool available() const {
+        for (int i = 0; i < PERF_NUM_COUNTERS; i++) {
+            if (fds_[i] >= 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const std::string& error() const { return error_; }
+
+    void start() {
+#ifdef PERF_COUNTERS_LINUX
+        if (leader_ >= 0) {
+            ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+        for (int i = 0; i < PERF_NUM_COUNTERS; i++) {
+            if (fds_[i] >= 0 && !inGroup_[i]) {
+                ioctl(fds_[i], PERF_EVENT_IOC_RESET, 0);
+                ioctl(fds_[i], PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+        start_ = std::chrono::steady_clock::now();
+    }
+
+    PerfSample stop() {
+        PerfSample s;
+        s.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_).count();
+#ifdef PERF_COUNTERS_LINUX
+        if (leader_ >= 0) {
+            ioctl(leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        }
+        for (int i = 0; i < PERF_NUM_COUNTERS; i++) {
+            if (fds_[i] >= 0 && !inGroup_[i]) {
+                ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+        // Grupo: nr, time_enabled, time_running y un valor por miembro, en el
+        // orden en que se sumaron
+        uint64_t group[3 + PERF_NUM_COUNTERS] = {0};
+        ssize_t groupBytes = (ssize_t)((3 + groupOrder_.size()) * sizeof(uint64_t));
+        if (leader_ >= 0 && ::read(leader_, group, sizeof(group)) == groupBytes) {
+            for (size_t k = 0; k < groupOrder_.size() && k < group[0]; k++) {
+                store(s, groupOrder_[k], group[3 + k], group[1], group[2]);
+            }
+        }
+        for (int i = 0; i < PERF_NUM_COUNTERS; i++) {
+            // value, time_enabled, time_running
+            uint64_t data[3] = {0, 0, 0};
+            if (fds_[i] >= 0 && !inGroup_[i] && ::read(fds_[i], data, sizeof(data)) == (ssize_t)sizeof(data)) {
+                store(s, (PerfCounterId)i, data[0], data[1], data[2]);
+            }
+        }
+#endif
+        return s;
+    }
+
+private:
+#ifdef PERF_COUNTERS_LINUX
+    // Suma el contador al grupo (o lo vuelve líder si es el primero); si el
+    // kernel no lo acepta en el grupo, lo abre suelto
+    void add(PerfCounterId id, uint32_t type, uint64_t config) {
+        int fd = open(type, config, leader_);
+        if (fd >= 0) {
+            if (leader_ < 0) {
+                leader_ = fd;
+            }
+            fds_[id] = fd;
+            inGroup_[id] = true;
+            groupOrder_.push_back(id);
+        } else if (leader_ >= 0) {
+            fds_[id] = open(type, config, -1);
+        }
+    }
+
+    // Con grupo (groupFd >= 0) el miembro arranca habilitado y sigue al líder
+    int open(uint32_t type, uint64_t config, int groupFd) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = groupFd < 0 ? 1 : 0;
+        attr.exclude_kernel = 1;   // Permitido con perf_event_paranoid <= 2
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        if (groupFd >= 0 || leader_ < 0) {
+            attr.read_format |= PERF_FORMAT_GROUP;
+        }
+        int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+        if (fd < 0 && firstErrno_ == 0) {
+            firstErrno_ = errno;
+        }
+        return fd;
+    }
+#endif
+
+    // Si el kernel multiplexó el contador (time_running < time_enabled) se
+    // escala al tiempo total habilitado
+    static void store(PerfSample& s, PerfCounterId id, uint64_t value, uint64_t enabled, uint64_t running) {
+        if (running > 0) {
+            s.values[id] = running < enabled ? (uint64_t)((double)value * enabled / running) : value;
+            s.valid[id] = true;
+        }
+    }
+
+    int fds_[PERF_NUM_COUNTERS];
+    bool inGroup_[PERF_NUM_COUNTERS];
+    int leader_ = -1;
+    std::vector<PerfCounterId> groupOrder_;   // Miembros del grupo en orden de lectura
+    int firstErrno_ = 0;
+    std::string error_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+struct PerfStageRecord {
+    std::string label;   // Combinación, imagen...
+    std::string stage;
+    int calls = 0;
+    PerfSample total;
+};
+
+class PerfStageRecorder {
+public:
+    explicit PerfStageRecorder(const std::string& program) : program_(program) {}
+
+    bool countersAvailable() const { return counters_.available(); }
+    const std::string& countersError() const { return counters_.error(); }
+
+    // Etiqueta de las etapas siguientes (p. ej. la combinación en curso)
+    void setLabel(const std::string& label) { label_ = label; }
+
+    void begin(const std::string& stage) {
+        stage_ = stage;
+        counters_.start();
+    }
+
+    void end() {
+        PerfSample s = counters_.stop();
+        for (PerfStageRecord& r : records_) {
+            if (r.label == label_ && r.stage == stage_) {
+                r.calls++;
+                r.total.add(s);
+                return;
+            }
+        }
+        PerfStageRecord r;
+        r.label = label_;
+        r.stage = stage_;
+        r.calls = 1;
+        r.total = s;
+        records_.push_back(r);
+    }
+
+    const std::vector<PerfStageRecord>& records() const { return records_; }
+
+    void printTable(std::ostream& out) const {
+        if (!counters_.available()) {
+            out << "Contadores de hardware: " << counters_.error() << " (solo tiempo)" << std::endl;
+        }
+        out << std::left << std::setw(28) << "Etiqueta" << std::setw(16) << "Etapa" << std::right
+            << std::setw(10) << "ms" << std::setw(14) << "Ciclos" << std::setw(14) << "Instr."
+            << std::setw(7) << "IPC" << std::setw(12) << "Fallos LLC" << std::setw(12) << "Fallos br." << std::endl;
+        out << std::string(113, '-') << std::endl;
+        for (const PerfStageRecord& r : records_) {
+            const PerfSample& s = r.total;
+            out << std::left << std::setw(28) << r.label << std::setw(16) << r.stage << std::right
+                << std::fixed << std::setprecision(2) << std::setw(10) << s.wallMs
+                << std::setw(14) << counterText(s, PERF_CYCLES)
+                << std::setw(14) << counterText(s, PERF_INSTRUCTIONS)
+                << std::setw(7) << (s.ipc() > 0 ? formatDouble(s.ipc(), 2) : std::string("-"))
+                << std::setw(12) << counterText(s, PERF_LLC_MISSES)
+                << std::setw(12) << counterText(s, PERF_BRANCH_MISSES) << std::endl;
+            out.unsetf(std::ios::fixed);
+        }
+    }
+
+    // program,label,stage,calls,wall_ms,cycles,instructions,ipc,llc_misses,branch_misses
+    void writeCsv(std::ostream& out, bool header = true) const {
+        if (header) {
+            out << "program,label,stage,calls,wall_ms,cycles,instructions,ipc,llc_misses,branch_misses\n";
+        }
+        for (const PerfStageRecord& r : records_) {
+            const PerfSample& s = r.total;
+            out << csvField(program_) << ',' << csvField(r.label) << ',' << csvField(r.stage) << ','
+                << r.calls << ',' << formatDouble(s.wallMs, 3) << ','
+                << optional(s, PERF_CYCLES, "") << ',' << optional(s, PERF_INSTRUCTIONS, "") << ','
+                << (s.ipc() > 0 ? formatDouble(s.ipc(), 3) : std::string()) << ','
+                << optional(s, PERF_LLC_MISSES, "") << ',' << optional(s, PERF_BRANCH_MISSES, "") << '\n';
+        }
+    }
+
+    void writeJson(std::ostream& out) const {
+        out << "{\n  \"program\": \"" << jsonEscape(program_) << "\",\n"
+            << "  \"counters_available\": " << (counters_.available() ? "true" : "false") << ",\n";
+        if (!counters_.available()) {
+            out << "  \"counters_error\": \"" << jsonEscape(counters_.error()) << "\",\n";
+        }
+        out << "  \"stages\": [";
+        for (size_t i = 0; i < records_.size(); i++) {
+            const PerfStageRecord& r = records_[i];
+            const PerfSample& s = r.total;
+            out << (i ? ",\n" : "\n")
+                << "    {\"label\": \"" << jsonEscape(r.label) << "\", \"stage\": \"" << jsonEscape(r.stage) << "\""
+                << ", \"calls\": " << r.calls
+                << ", \"wall_ms\": " << formatDouble(s.wallMs, 3)
+                << ", \"cycles\": " << optional(s, PERF_CYCLES, "null")
+                << ", \"instructions\": " << optional(s, PERF_INSTRUCTIONS, "null")
+                << ", \"ipc\": " << (s.ipc() > 0 ? formatDouble(s.ipc(), 3) : std::string("null"))
+                << ", \"llc_misses\": " << optional(s, PERF_LLC_MISSES, "null")
+                << ", \"branch_misses\": " << optional(s, PERF_BRANCH_MISSES, "null") << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    // Tabla por stdout y, si se pidieron, los archivos CSV / JSON
+    bool report(const std::string& csvPath, const std::string& jsonPath) const {
+        std::cout << std::endl << "=== CONTADORES POR ETAPA (" << program_ << ") ===" << std::endl;
+        printTable(std::cout);
+        bool ok = true;
+        if (!csvPath.empty()) {
+            std::ofstream out(csvPath.c_str());
+            writeCsv(out);
+            ok = ok && (bool)out;
+        }
+        if (!jsonPath.empty()) {
+            std::ofstream out(jsonPath.c_str());
+            writeJson(out);
+            ok = ok && (bool)out;
+        }
+        if (!ok) {
+            std::cerr << "No se pudieron escribir los resultados de --perf" << std::endl;
+        }
+        return ok;
+    }
+
+private:
+    static std::string formatDouble(double v, int precision) {
+        std::ostringstream ss;
+        ss << std::fixed << std::setprecision(precision) << v;
+        return ss.str();
+    }
+
+    static std::string optional(const PerfSample& s, PerfCounterId id, const char* missing) {
+        if (!s.has(id)) {
+            return missing;
+        }
+        std::ostringstream ss;
+        ss << s.get(id);
+        return ss.str();
+    }
+
+    static std::string counterText(const PerfSample& s, PerfCounterId id) {
+        return s.has(id) ? optional(s, id, "") : std::string("-");
+    }
+
+    static std::string csvField(const std::string& v) {
+        if (v.find_first_of(",\"\n") == std::string::npos) {
+            return v;
+        }
+        std::string out = "\"";
+        for (char c : v) {
+            if (c == '"') out += '"';
+            out += c;
+        }
+        return out + "\"";
+    }
+
+    static std::string jsonEscape(const std::string& v) {
+        std::string out;
+        for (char c : v) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if (c == '\n') {
+                out += "\\n";
+            } else {
+                out += c;
+            }
+        }
+        return out;
+    }
+
+    std::string program_;
+    std::string label_;
+    std::string stage_;
+    PerfCounters counters_;
+    std::vector<PerfStageRecord> records_;
+};
+
+// Mide una etapa hasta stop() o hasta el fin del bloque; sin recorder solo
+// queda la zona de la traza (que a su vez no hace nada si está desactivada)
+class PerfScope {
+public:
+    PerfScope(PerfStageRecorder* recorder, const char* stage) : zone_(stage), recorder_(recorder) {
+        if (recorder_) {
+            recorder_->begin(stage);
+        }
+    }
+    ~PerfScope() {
+        stop();
+    }
+
+    void stop() {
+        if (recorder_) {
+            recorder_->end();
+            recorder_ = nullptr;
+        }
+        zone_.end();
+    }
+
+private:
+    PerfScope(const PerfScope&);
+    PerfScope& operator=(const PerfScope&);
+    TraceZone zone_;
+    PerfStageRecorder* recorder_;
+};
+
+#endif // PERF_COUNTERS_HPP
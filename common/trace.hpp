@@ -0,0 +1,294 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <set>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+
+// Trazas de línea de tiempo en formato Chrome trace (chrome://tracing,
+// https://ui.perfetto.dev).
+//
+// Cada zona (TraceZone / TRACE_ZONE) registra un evento completo ("ph":"X")
+// con inicio y duración en el buffer del hilo que la ejecuta. Los buffers
+// son por hilo y solo los escribe su dueño, así que registrar un evento no
+// toma locks: se guarda en un bloque de tamaño fijo y se publica con un
+// contador atómico. Solo el primer evento de cada hilo registra el buffer
+// bajo un mutex.
+//
+// Con la traza desactivada una zona cuesta una lectura atómica relajada y un
+// salto, así que las zonas pueden quedar en el código de producción.
+//
+// Los nombres de zona deben vivir hasta que se escriba la traza: literales,
+// o cadenas pasadas por traceIntern().
+//
+// Uso:
+//   TraceSession session("traza.json");   // Vacío = desactivada
+//   { TRACE_ZONE("bilateral"); bilateralFilter(...); }
+//   TraceZone zone("hough"); HoughCircles(...); zone.end();
+// El archivo se escribe al destruir la sesión (o con TraceSession::write).
+
+struct TraceEvent {
+    const char* name;
+    const char* argName;   // Argumento entero opcional (nulo si no hay)
+    int64_t argValue;
+    int64_t startNs;
+    int64_t durationNs;
+};
+
+class TraceThreadBuffer {
+public:
+    static const size_t CHUNK_EVENTS = 4096;
+    static const size_t MAX_CHUNKS = 1024;   // ~4M eventos por hilo
+
+    explicit TraceThreadBuffer(int tid) : tid_(tid), count_(0) {
+        for (size_t i = 0; i < MAX_CHUNKS; i++) {
+            chunks_[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    ~TraceThreadBuffer() {
+        for (size_t i = 0; i < MAX_CHUNKS; i++) {
+            delete[] chunks_[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    // Solo lo llama el hilo dueño
+    void push(const TraceEvent& e) {
+        size_t n = count_.load(std::memory_order_relaxed);
+        size_t chunk = n / CHUNK_EVENTS;
+        if (chunk >= MAX_CHUNKS) {
+            return;   // Buffer lleno: se descartan los eventos siguientes
+        }
+        TraceEvent* events = chunks_[chunk].load(std::memory_order_relaxed);
+        if (!events) {
+            events = new TraceEvent[CHUNK_EVENTS];
+            chunks_[chunk].store(events, std::memory_order_release);
+        }
+        events[n % CHUNK_EVENTS] = e;
+        count_.store(n + 1, std::memory_order_release);
+    }
+
+    // Lectura desde otro hilo: ve los eventos publicados hasta ahora
+    size_t size() const { return count_.load(std::memory_order_acquire); }
+
+    const TraceEvent& at(size_t i) const {
+        return chunks_[i / CHUNK_EVENTS].load(std::memory_order_acquire)[i % CHUNK_EVENTS];
+    }
+
+    // Solo con los hilos quietos (entre sesiones)
+    void clear() { count_.store(0, std::memory_order_release); }
+
+    int tid() const { return tid_; }
+
+    std::string threadName;   // Lo fija el hilo dueño con traceSetThreadName
+
+private:
+    int tid_;
+    std::atomic<size_t> count_;
+    std::atomic<TraceEvent*> chunks_[MAX_CHUNKS];
+};
+
+// Estado global del trazador (una instancia por proceso)
+class Tracer {
+public:
+    static Tracer& instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    void enable() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < buffers_.size(); i++) {
+            buffers_[i]->clear();
+        }
+        epoch_ = std::chrono::steady_clock::now();
+        enabled_.store(true, std::memory_order_release);
+    }
+
+    void disable() { enabled_.store(false, std::memory_order_release); }
+
+    int64_t nowNs() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch_).count();
+    }
+
+    TraceThreadBuffer& threadBuffer() {
+        static thread_local TraceThreadBuffer* buffer = nullptr;
+        if (!buffer) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            buffers_.emplace_back(new TraceThreadBuffer((int)buffers_.size() + 1));
+            buffer = buffers_.back().get();
+        }
+        return *buffer;
+    }
+
+    // Copia estable de un nombre dinámico (nombres de etapa, de imagen...)
+    const char* intern(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return names_.insert(name).first->c_str();
+    }
+
+    // Escribe los eventos publicados en formato Chrome trace JSON (después
+    // de disable(), con los hilos de trabajo ya terminados o quietos)
+    bool writeJson(const std::string& path) {
+        std::ofstream out(path.c_str());
+        if (!out) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+        for (size_t b = 0; b < buffers_.size(); b++) {
+            const TraceThreadBuffer& buffer = *buffers_[b];
+            size_t n = buffer.size();
+            if (n == 0) {
+                continue;
+            }
+            std::string threadName = buffer.threadName.empty()
+                ? (buffer.tid() == 1 ? std::string("main") : "hilo " + std::to_string(buffer.tid()))
+                : buffer.threadName;
+            out << (first ? "\n" : ",\n")
+                << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << buffer.tid()
+                << ",\"args\":{\"name\":\"" << escape(threadName) << "\"}}";
+            first = false;
+            for (size_t i = 0; i < n; i++) {
+                const TraceEvent& e = buffer.at(i);
+                char times[96];
+                snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f", e.startNs / 1000.0, e.durationNs / 1000.0);
+                out << ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.tid() << ",\"name\":\"" << escape(e.name)
+                    << "\"," << times;
+                if (e.argName) {
+                    out << ",\"args\":{\"" << escape(e.argName) << "\":" << e.argValue << "}";
+                }
+                out << "}";
+            }
+        }
+        out << "\n]}\n";
+        return (bool)out;
+    }
+
+private:
+    Tracer() : enabled_(false), epoch_(std::chrono::steady_clock::now()) {}
+
+    static std::string escape(const char* s) {
+        std::string out;
+        for (; *s; s++) {
+            if (*s == '"' || *s == '\\') {
+                out += '\\';
+                out += *s;
+            } else if ((unsigned char)*s < 0x20) {
+                out += ' ';
+            } else {
+                out += *s;
+            }
+        }
+        return out;
+    }
+
+    static std::string escape(const std::string& s) { return escape(s.c_str()); }
+
+    std::atomic<bool> enabled_;
+    std::chrono::steady_clock::time_point epoch_;
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<TraceThreadBuffer>> buffers_;
+    std::set<std::string> names_;
+};
+
+inline bool traceEnabled() {
+    return Tracer::instance().enabled();
+}
+
+inline const char* traceIntern(const std::string& name) {
+    return Tracer::instance().intern(name);
+}
+
+// Nombre del hilo actual en el visor (solo si la traza está activa)
+inline void traceSetThreadName(const std::string& name) {
+    if (traceEnabled()) {
+        Tracer::instance().threadBuffer().threadName = name;
+    }
+}
+
+class TraceZone {
+public:
+    explicit TraceZone(const char* name, const char* argName = nullptr, int64_t argValue = 0)
+        : active_(traceEnabled()) {
+        if (active_) {
+            event_.name = name;
+            event_.argName = argName;
+            event_.argValue = argValue;
+            event_.startNs = Tracer::instance().nowNs();
+        }
+    }
+
+    ~TraceZone() {
+        end();
+    }
+
+    // Cierra la zona antes del fin del bloque
+    void end() {
+        if (active_) {
+            active_ = false;
+            Tracer& tracer = Tracer::instance();
+            event_.durationNs = tracer.nowNs() - event_.startNs;
+            tracer.threadBuffer().push(event_);
+        }
+    }
+
+private:
+    TraceZone(const TraceZone&);
+    TraceZone& operator=(const TraceZone&);
+    bool active_;
+    TraceEvent event_;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+// Zona hasta el fin del bloque actual
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(traceZone_, __LINE__)(name)
+
+// Activa la traza si path no está vacío y la escribe al destruirse
+class TraceSession {
+public:
+    explicit TraceSession(const std::string& path) : path_(path) {
+        if (!path_.empty()) {
+            Tracer::instance().enable();
+            traceSetThreadName("main");
+        }
+    }
+
+    ~TraceSession() {
+        write();
+    }
+
+    // Escribe la traza (una sola vez) y la desactiva
+    bool write() {
+        if (path_.empty()) {
+            return true;
+        }
+        Tracer::instance().disable();
+        bool ok = Tracer::instance().writeJson(path_);
+        if (ok) {
+            printf("Traza escrita en %s\n", path_.c_str());
+        } else {
+            fprintf(stderr, "No se pudo escribir la traza %s\n", path_.c_str());
+        }
+        path_.clear();
+        return ok;
+    }
+
+private:
+    TraceSession(const TraceSession&);
+    TraceSession& operator=(const TraceSession&);
+    std::string path_;
+};
+
+#endif // TRACE_HPP
@@ -0,0 +1,92 @@
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+
+#include "bench_utils.hpp"
+#include "image_source.hpp"
+#include "coin_preprocess.hpp"
+#include "bilateral_grid.hpp"
+
+using namespace cv;
+using namespace std;
+
+// Compara bilateralFilter exacto con la aproximación por bilateral grid
+// (bilateral_grid.hpp) sobre la foto de monedas en escala de grises, para
+// varios diámetros. Además del tiempo reporta el error contra el filtro
+// exacto: error medio y máximo, PSNR, y el porcentaje de píxeles que cambian
+// en la máscara binaria del conteo (gamma + umbral de 50), que es lo que ve
+// el resto del pipeline.
+//
+// Uso: ./bench_bilateral [imagen] [megapíxeles] [repeticiones]
+
+int main(int argc, char** argv) {
+    string path = argc > 1 ? argv[1] : "";
+    double megapixels = argc > 2 ? atof(argv[2]) : 8.0;
+    int repetitions = argc > 3 ? max(1, atoi(argv[3])) : 3;
+
+    vector<string> candidates = {path, "koruny_black.jpg", "../koruny_black.jpg", "Data/koruny_black.jpg",
+                                 "../Data/koruny_black.jpg", "Image2.jpg", "Data/Image2.jpg"};
+    Mat original;
+    for (const string& candidate : candidates) {
+        if (!candidate.empty()) {
+            original = ImageSource::loadFirst(candidate, IMREAD_GRAYSCALE);
+            if (!original.empty()) {
+                break;
+            }
+        }
+    }
+    if (original.empty()) {
+        cout << "No se pudo cargar la imagen de monedas." << endl;
+        return -1;
+    }
+
+    double scale = sqrt(megapixels * 1e6 / ((double)original.cols * original.rows));
+    Mat gray;
+    resize(original, gray, Size(), scale, scale, scale > 1 ? INTER_CUBIC : INTER_AREA);
+    double imageMp = gray.cols * (double)gray.rows / 1e6;
+    cout << "Imagen: " << gray.cols << "x" << gray.rows << " (" << fixed << setprecision(1) << imageMp
+         << " MP), " << getNumThreads() << " hilos" << endl;
+
+    const double sigmaColor = 75, sigmaSpace = 75;
+    CoinPreprocessParams coinParams;
+    Mat binaryLut = coinBinaryLut(coinParams);
+
+    cout << "\n" << setw(6) << "d" << setw(12) << "exacto ms" << setw(12) << "grid ms" << setw(12) << "grid 1h ms"
+         << setw(10) << "speedup" << setw(10) << "MAE" << setw(8) << "max" << setw(10) << "PSNR"
+         << setw(14) << "máscara %" << endl;
+
+    const int diameters[] = {5, 9, 15, 25, 41};
+    for (int d : diameters) {
+        BilateralGrid grid(bilateralGridSigmaSpace(d, sigmaSpace), sigmaColor);
+        Mat exact, approx;
+        double exactMs = timeMs([&]() { bilateralFilter(gray, exact, d, sigmaColor, sigmaSpace); }, repetitions);
+        double gridMs = timeMs([&]() { grid.apply(gray, approx); }, repetitions);
+        int threads = getNumThreads();
+        setNumThreads(1);
+        double gridOneMs = timeMs([&]() { grid.apply(gray, approx); }, repetitions);
+        setNumThreads(threads);
+
+        Mat diff;
+        absdiff(exact, approx, diff);
+        double maxError;
+        minMaxLoc(diff, nullptr, &maxError);
+        double mae = mean(diff)[0];
+        double psnr = PSNR(exact, approx);
+
+        Mat exactMask, approxMask, maskDiff;
+        LUT(exact, binaryLut, exactMask);
+        LUT(approx, binaryLut, approxMask);
+        compare(exactMask, approxMask, maskDiff, CMP_NE);
+        double maskChanged = 100.0 * countNonZero(maskDiff) / (double)gray.total();
+
+        cout << setw(6) << d << setprecision(1) << setw(12) << exactMs << setw(12) << gridMs << setw(12) << gridOneMs
+             << setprecision(2) << setw(10) << exactMs / gridMs << setw(10) << mae << setprecision(0) << setw(8)
+             << maxError << setprecision(1) << setw(10) << psnr << setprecision(3) << setw(14) << maskChanged << endl;
+    }
+    cout << "\nsigmaSpace de la grilla = min(" << sigmaSpace << ", d / 4); sigmaColor = " << sigmaColor << endl;
+    return 0;
+}
@@ -0,0 +1,200 @@
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "bench_utils.hpp"
+#include "image_source.hpp"
+#include "coin_counter.hpp"
+
+using namespace cv;
+using namespace std;
+
+// Compara la detección de círculos original (HoughCircles sobre toda la
+// máscara y búsqueda por contornos si hay menos de 10) con la detección por
+// componentes conexas de coin_components.hpp, sobre la máscara dilatada de la
+// foto de monedas a su resolución original (los radios de Hough dependen de
+// ella).
+//
+// Primero verifica el etiquetado por bandas contra connectedComponentsWithStats
+// (misma partición de píxeles, mismas áreas y cajas, con distintos tamaños de
+// banda), después mide ambos etiquetados y ambos caminos de detección con un
+// hilo y con todos, y reporta cuántos círculos coinciden y la diferencia de
+// radio entre los dos caminos.
+//
+// Uso: ./bench_circles [imagen] [repeticiones]
+
+// Mismo camino que countCoins sin --components
+static vector<Vec3f> houghCircles(const Mat& dilated) {
+    vector<Vec3f> circles;
+    HoughCircles(dilated, circles, HOUGH_GRADIENT, 1, 40, 100, 15, 50, 120);
+    if (circles.size() < 10) {
+        vector<vector<Point>> contours;
+        findContours(dilated, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
+        for (const auto& contour : contours) {
+            double area = contourArea(contour);
+            if (area < 1000) continue;
+            Point2f center;
+            float radius;
+            minEnclosingCircle(contour, center, radius);
+            if (area / (M_PI * radius * radius) > 0.6) {
+                circles.push_back(Vec3f(center.x, center.y, radius));
+            }
+        }
+    }
+    return circles;
+}
+
+// Misma partición que connectedComponentsWithStats: biyección entre
+// etiquetas píxel a píxel y mismas áreas y cajas
+static bool sameComponents(const Mat& binary, int stripRows, string& error) {
+    Mat refLabels, refStats, refCentroids;
+    int refCount = connectedComponentsWithStats(binary, refLabels, refStats, refCentroids, 8, CV_32S) - 1;
+    vector<ComponentStats> stats;
+    Mat labels;
+    int count = StripConnectedComponents(stripRows).run(binary, stats, &labels);
+    if (count != refCount) {
+        error = to_string(count) + " componentes, connectedComponents da " + to_string(refCount);
+        return false;
+    }
+    vector<int> toRef(count + 1, -1), fromRef(count + 1, -1);
+    for (int y = 0; y < binary.rows; y++) {
+        const int* a = labels.ptr<int>(y);
+        const int* b = refLabels.ptr<int>(y);
+        for (int x = 0; x < binary.cols; x++) {
+            if (toRef[a[x]] < 0 && fromRef[b[x]] < 0) {
+                toRef[a[x]] = b[x];
+                fromRef[b[x]] = a[x];
+            } else if (toRef[a[x]] != b[x] || fromRef[b[x]] != a[x]) {
+                error = "etiquetas distintas en (" + to_string(x) + ", " + to_string(y) + ")";
+                return false;
+            }
+        }
+    }
+    for (int l = 1; l <= count; l++) {
+        const int* ref = refStats.ptr<int>(toRef[l]);
+        const ComponentStats& c = stats[l - 1];
+        Rect box = c.bbox();
+        if (c.area != ref[CC_STAT_AREA] || box.x != ref[CC_STAT_LEFT] || box.y != ref[CC_STAT_TOP] ||
+            box.width != ref[CC_STAT_WIDTH] || box.height != ref[CC_STAT_HEIGHT]) {
+            error = "estadísticas distintas en la componente " + to_string(l);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    string path = argc > 1 ? argv[1] : "";
+    int repetitions = argc > 2 ? max(1, atoi(argv[2])) : 5;
+
+    vector<string> candidates = {path, "koruny_black.jpg", "../koruny_black.jpg", "Data/koruny_black.jpg",
+                                 "../Data/koruny_black.jpg", "Image2.jpg", "Data/Image2.jpg"};
+    Mat img;
+    for (const string& candidate : candidates) {
+        if (!candidate.empty()) {
+            img = ImageSource::loadFirst(candidate, IMREAD_COLOR);
+            if (!img.empty()) {
+                break;
+            }
+        }
+    }
+    if (img.empty()) {
+        cout << "No se pudo cargar la imagen de monedas." << endl;
+        return -1;
+    }
+
+    CoinPreprocessParams preprocess;
+    CoinPreprocessResult pre;
+    preprocessCoinsFused(img, preprocess, pre, false);
+    const Mat& dilated = pre.dilated;
+    cout << "Máscara: " << dilated.cols << "x" << dilated.rows << ", " << getNumThreads() << " hilos" << endl;
+
+    // Equivalencia del etiquetado
+    bool ok = true;
+    const int stripSizes[] = {0, 1, 7, 64};
+    for (int stripRows : stripSizes) {
+        string error;
+        bool same = sameComponents(dilated, stripRows, error);
+        cout << "Etiquetado con bandas de " << (stripRows ? to_string(stripRows) : string("auto"))
+             << " filas: " << (same ? "igual a connectedComponentsWithStats" : "DISTINTO: " + error) << endl;
+        ok = ok && same;
+    }
+
+    // Tiempos
+    CoinCircleParams params;
+    vector<ComponentStats> stats;
+    Mat labels, refLabels, refStats, refCentroids;
+    vector<Vec3f> hough, components;
+    CoinCircleStats st;
+    int threads = getNumThreads();
+
+    cout << "\n" << setw(34) << "ms" << setw(12) << "1 hilo" << setw(12) << "todos" << endl;
+    cout << fixed << setprecision(2);
+    struct Row {
+        const char* name;
+        function<void()> run;
+    } rows[] = {
+        {"connectedComponentsWithStats", [&]() {
+             connectedComponentsWithStats(dilated, refLabels, refStats, refCentroids, 8, CV_32S);
+         }},
+        {"etiquetado por bandas", [&]() { StripConnectedComponents().run(dilated, stats); }},
+        {"etiquetado por bandas + mapa", [&]() { StripConnectedComponents().run(dilated, stats, &labels); }},
+        {"Hough + contornos (original)", [&]() { hough = houghCircles(dilated); }},
+        {"componentes + Hough en grupos", [&]() { components = findCoinCircles(dilated, params, &st); }},
+    };
+    double houghMs = 0, componentsMs = 0;
+    for (size_t i = 0; i < sizeof(rows) / sizeof(rows[0]); i++) {
+        Row& row = rows[i];
+        setNumThreads(1);
+        double one = timeMs(row.run, repetitions);
+        setNumThreads(threads);
+        double all = timeMs(row.run, repetitions);
+        cout << setw(34) << row.name << setw(12) << one << setw(12) << all << endl;
+        if (i == 3) {
+            houghMs = all;
+        } else if (i == 4) {
+            componentsMs = all;
+        }
+    }
+    cout << "Speedup de la detección: " << houghMs / componentsMs << "x" << endl;
+
+    // Acuerdo entre caminos: cada círculo de componentes con el círculo de
+    // Hough más cercano, si el centro está a menos de medio radio
+    cout << "\nComponentes: " << st.components << " (" << st.small << " chicas, " << st.single << " monedas sueltas, "
+         << st.touching << " grupos -> " << st.splitCircles << " círculos, " << st.fallback << " por contorno)"
+         << endl;
+    int matched = 0;
+    double radiusDiff = 0, maxRadiusDiff = 0, centerDiff = 0;
+    vector<bool> used(hough.size(), false);
+    for (const Vec3f& c : components) {
+        int best = -1;
+        double bestDist = c[2] / 2;
+        for (size_t j = 0; j < hough.size(); j++) {
+            double d = hypot(c[0] - hough[j][0], c[1] - hough[j][1]);
+            if (!used[j] && d < bestDist) {
+                best = (int)j;
+                bestDist = d;
+            }
+        }
+        if (best >= 0) {
+            used[best] = true;
+            matched++;
+            double dr = fabs(c[2] - hough[best][2]);
+            radiusDiff += dr;
+            maxRadiusDiff = max(maxRadiusDiff, dr);
+            centerDiff += bestDist;
+        }
+    }
+    cout << "Círculos: " << hough.size() << " original, " << components.size() << " por componentes, " << matched
+         << " coinciden" << endl;
+    if (matched) {
+        cout << "Diferencia de radio: media " << radiusDiff / matched << " px, máxima " << maxRadiusDiff
+             << " px; distancia media entre centros " << centerDiff / matched << " px" << endl;
+    }
+    return ok ? 0 : -1;
+}
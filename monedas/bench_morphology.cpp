@@ -0,0 +1,122 @@
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <functional>
+
+#include "bench_utils.hpp"
+#include "image_source.hpp"
+#include "coin_preprocess.hpp"
+#include "binary_morphology.hpp"
+
+using namespace cv;
+using namespace std;
+
+// Compara la morfología sobre bits (binary_morphology.hpp) con medianBlur,
+// erode y dilate de OpenCV, sobre la máscara umbralizada de la foto de
+// monedas ampliada por un factor.
+//
+// Primero verifica que las salidas sean idénticas píxel a píxel (mediana 5x5,
+// elipse 5x5, dos dilataciones, y rectángulos grandes), después mide cada
+// operación con OpenCV y sobre bits (incluyendo empaquetar y desempaquetar),
+// y la cadena completa de preprocessCoinsFused con y sin --bit-morphology.
+//
+// Uso: ./bench_morphology [imagen] [escala] [repeticiones]
+
+int main(int argc, char** argv) {
+    string path = argc > 1 ? argv[1] : "";
+    double scale = argc > 2 ? max(0.25, atof(argv[2])) : 2.0;
+    int repetitions = argc > 3 ? max(1, atoi(argv[3])) : 5;
+
+    vector<string> candidates = {path, "koruny_black.jpg", "../koruny_black.jpg", "Data/koruny_black.jpg",
+                                 "../Data/koruny_black.jpg", "Image2.jpg", "Data/Image2.jpg"};
+    Mat original;
+    for (const string& candidate : candidates) {
+        if (!candidate.empty()) {
+            original = ImageSource::loadFirst(candidate, IMREAD_COLOR);
+            if (!original.empty()) {
+                break;
+            }
+        }
+    }
+    if (original.empty()) {
+        cout << "No se pudo cargar la imagen de monedas." << endl;
+        return -1;
+    }
+    Mat img;
+    resize(original, img, Size(), scale, scale, scale > 1 ? INTER_CUBIC : INTER_AREA);
+
+    CoinPreprocessParams params;
+    CoinPreprocessResult pre;
+    preprocessCoinsReference(img, params, pre);
+    const Mat& binary = pre.binary;
+    cout << "Máscara: " << binary.cols << "x" << binary.rows << ", " << getNumThreads() << " hilos" << endl;
+
+    const Mat ellipse = getStructuringElement(MORPH_ELLIPSE, Size(params.morphSize, params.morphSize));
+    const Mat ones3 = Mat::ones(3, 3, CV_8U);
+    const Mat rect31 = getStructuringElement(MORPH_RECT, Size(31, 31));
+    const Mat rect101 = getStructuringElement(MORPH_RECT, Size(101, 101));
+
+    // Equivalencia
+    BinaryImage bits, out;
+    Mat expected, actual;
+    binaryPack(binary, bits);
+    struct Check {
+        const char* name;
+        function<void()> opencv;
+        function<void()> packed;
+    } checks[] = {
+        {"mediana 5x5", [&]() { medianBlur(binary, expected, params.medianSize); },
+         [&]() { binaryMedian(bits, out, params.medianSize); }},
+        {"erosión elipse 5x5", [&]() { erode(binary, expected, ellipse); }, [&]() { binaryErode(bits, out, ellipse); }},
+        {"dilatación elipse 5x5 x2", [&]() { dilate(binary, expected, ellipse, Point(-1, -1), 2); },
+         [&]() { binaryDilate(bits, out, ellipse, 2); }},
+        {"dilatación 3x3", [&]() { dilate(binary, expected, ones3); }, [&]() { binaryDilate(bits, out, ones3); }},
+        {"erosión rectángulo 31x31", [&]() { erode(binary, expected, rect31); },
+         [&]() { binaryErode(bits, out, rect31); }},
+        {"dilatación rectángulo 101x101", [&]() { dilate(binary, expected, rect101); },
+         [&]() { binaryDilate(bits, out, rect101); }},
+    };
+    bool ok = true;
+    for (const Check& check : checks) {
+        check.opencv();
+        check.packed();
+        binaryUnpack(out, actual);
+        bool same = countDifferent(expected, actual) == 0;
+        cout << setw(32) << check.name << ": " << (same ? "igual a OpenCV" : "DISTINTO") << endl;
+        ok = ok && same;
+    }
+
+    // Tiempos: sobre bits incluye empaquetar la entrada y desempaquetar la salida
+    cout << "\n" << setw(32) << "ms" << setw(12) << "OpenCV" << setw(12) << "bits" << setw(10) << "speedup" << endl;
+    cout << fixed << setprecision(2);
+    for (const Check& check : checks) {
+        double opencvMs = timeMs(check.opencv, repetitions);
+        double packedMs = timeMs([&]() {
+            binaryPack(binary, bits);
+            check.packed();
+            binaryUnpack(out, actual);
+        }, repetitions);
+        cout << setw(32) << check.name << setw(12) << opencvMs << setw(12) << packedMs << setw(9)
+             << opencvMs / packedMs << "x" << endl;
+    }
+    double packMs = timeMs([&]() { binaryPack(binary, bits); }, repetitions);
+    double unpackMs = timeMs([&]() { binaryUnpack(bits, actual); }, repetitions);
+    cout << setw(32) << "empaquetar / desempaquetar" << setw(12) << packMs << setw(12) << unpackMs << endl;
+
+    // Cadena completa
+    CoinPreprocessParams bitParams = params;
+    bitParams.bitMorphology = true;
+    CoinPreprocessResult fused, fusedBits;
+    preprocessCoinsFused(img, params, fused, false);
+    preprocessCoinsFused(img, bitParams, fusedBits, false);
+    bool sameChain = countDifferent(fused.dilated, fusedBits.dilated) == 0;
+    ok = ok && sameChain;
+    double chainMs = timeMs([&]() { preprocessCoinsFused(img, params, fused, false); }, repetitions);
+    double chainBitsMs = timeMs([&]() { preprocessCoinsFused(img, bitParams, fusedBits, false); }, repetitions);
+    cout << "\nPreprocesamiento por bandas: " << chainMs << " ms, con --bit-morphology " << chainBitsMs << " ms ("
+         << (sameChain ? "misma máscara" : "MÁSCARA DISTINTA") << ")" << endl;
+    return ok ? 0 : -1;
+}
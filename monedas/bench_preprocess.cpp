@@ -0,0 +1,111 @@
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+
+#include "bench_utils.hpp"
+#include "image_source.hpp"
+#include "coin_preprocess.hpp"
+
+using namespace cv;
+using namespace std;
+
+// Compara el preprocesamiento original (siete pasadas sobre la imagen
+// completa) con la cadena fusionada por bandas de coin_preprocess.hpp sobre
+// una foto de monedas reescalada a ~20 MP. Verifica que ambos caminos den las
+// mismas imágenes bit a bit y mide la escalabilidad con el número de hilos y
+// la memoria de trabajo.
+//
+// Uso: ./bench_preprocess [imagen] [megapíxeles] [repeticiones]
+
+int main(int argc, char** argv) {
+    string path = argc > 1 ? argv[1] : "";
+    double megapixels = argc > 2 ? atof(argv[2]) : 20.0;
+    int repetitions = argc > 3 ? max(1, atoi(argv[3])) : 3;
+
+    vector<string> candidates = {path, "koruny_black.jpg", "../koruny_black.jpg", "Data/koruny_black.jpg",
+                                 "../Data/koruny_black.jpg", "Image2.jpg", "Data/Image2.jpg"};
+    Mat original;
+    for (const string& candidate : candidates) {
+        if (!candidate.empty()) {
+            original = ImageSource::loadFirst(candidate, IMREAD_COLOR);
+            if (!original.empty()) {
+                break;
+            }
+        }
+    }
+    if (original.empty()) {
+        cout << "No se pudo cargar la imagen de monedas." << endl;
+        return -1;
+    }
+
+    // Reescalar a la resolución de una foto de cámara manteniendo el aspecto
+    double scale = sqrt(megapixels * 1e6 / ((double)original.cols * original.rows));
+    Mat img;
+    resize(original, img, Size(), scale, scale, scale > 1 ? INTER_CUBIC : INTER_AREA);
+    double imageMp = img.cols * (double)img.rows / 1e6;
+    cout << "Imagen: " << img.cols << "x" << img.rows << " (" << fixed << setprecision(1) << imageMp << " MP)" << endl;
+
+    CoinPreprocessParams params;
+    int maxThreads = getNumberOfCPUs();
+
+    // Equivalencia: cadena fusionada (con intermedios) contra la original
+    CoinPreprocessResult reference, fused;
+    setNumThreads(maxThreads);
+    preprocessCoinsReference(img, params, reference);
+    preprocessCoinsFused(img, params, fused, true);
+    const char* names[] = {"gamma", "umbral", "mediana", "erosión", "dilatación"};
+    const Mat* refMaps[] = {&reference.gamma, &reference.binary, &reference.median, &reference.eroded, &reference.dilated};
+    const Mat* fusedMaps[] = {&fused.gamma, &fused.binary, &fused.median, &fused.eroded, &fused.dilated};
+    bool identical = true;
+    for (int i = 0; i < 5; i++) {
+        int different = countDifferent(*refMaps[i], *fusedMaps[i]);
+        if (different != 0) {
+            identical = false;
+            cout << "  " << names[i] << ": " << different << " píxeles distintos" << endl;
+        }
+    }
+    cout << "Resultado fusionado " << (identical ? "idéntico" : "DISTINTO") << " al original" << endl;
+
+    // Memoria de trabajo: siete imágenes completas (gris, bilateral y las cinco
+    // salidas) contra la salida final más los buffers de banda por hilo
+    double imageMb = img.cols * (double)img.rows / (1024.0 * 1024.0);
+    cout << "\nMemoria intermedia original: " << setprecision(1) << 7 * imageMb << " MB" << endl;
+
+    cout << "\n" << left << setw(22) << "Camino" << right << setw(8) << "Hilos" << setw(12) << "ms"
+         << setw(10) << "MP/s" << setw(12) << "Speedup" << setw(14) << "Memoria MB" << endl;
+
+    vector<int> threadCounts;
+    for (int n = 1; n < maxThreads; n *= 2) {
+        threadCounts.push_back(n);
+    }
+    threadCounts.push_back(maxThreads);
+
+    double referenceMs = 0, fusedOneMs = 0, fusedMaxMs = 0;
+    for (int n : threadCounts) {
+        setNumThreads(n);
+        CoinPreprocessResult out;
+        double refMs = timeMs([&]() { preprocessCoinsReference(img, params, out); }, repetitions);
+        double fusedMs = timeMs([&]() { preprocessCoinsFused(img, params, out, false); }, repetitions);
+        if (n == 1) {
+            referenceMs = refMs;
+            fusedOneMs = fusedMs;
+        }
+        fusedMaxMs = fusedMs;
+        double tileMb = coinTileBytes(img.size(), params) / (1024.0 * 1024.0);
+        cout << left << setw(22) << "original" << right << setw(8) << n << setw(12) << setprecision(1) << refMs
+             << setw(10) << setprecision(2) << imageMp * 1000.0 / refMs
+             << setw(12) << referenceMs / refMs << setw(14) << setprecision(1) << 7 * imageMb << endl;
+        cout << left << setw(22) << "fusionado por bandas" << right << setw(8) << n << setw(12) << fusedMs
+             << setw(10) << setprecision(2) << imageMp * 1000.0 / fusedMs
+             << setw(12) << referenceMs / fusedMs << setw(14) << setprecision(1) << imageMb + n * tileMb << endl;
+    }
+    cout << "\nFilas por banda: " << coinTileRows(img.size(), params)
+         << ", escalado fusionado 1 -> " << maxThreads << " hilos: " << setprecision(2)
+         << fusedOneMs / fusedMaxMs << "x" << endl;
+
+    return identical ? 0 : 1;
+}
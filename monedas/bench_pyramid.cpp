@@ -0,0 +1,146 @@
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+
+#include "bench_utils.hpp"
+#include "image_source.hpp"
+#include "coin_counter.hpp"
+
+using namespace cv;
+using namespace std;
+
+// Compara la detección en dos escalas (coin_pyramid.hpp) con la detección a
+// resolución completa, sobre la foto de monedas ampliada por un factor para
+// simular una foto de alta resolución (los radios de Hough y el área mínima
+// se escalan con ella).
+//
+// Mide el tiempo por imagen de los tres caminos (Hough original, solo a
+// escala 1; componentes a resolución completa y --pyramid) y verifica la
+// exactitud contra el camino por componentes: círculos que coinciden,
+// diferencia de diámetro en mm con la misma calibración y monedas
+// clasificadas distinto. La tolerancia de diámetro es un cuarto de la menor
+// diferencia entre denominaciones.
+//
+// Uso: ./bench_pyramid [imagen] [escala] [repeticiones]
+
+int main(int argc, char** argv) {
+    string path = argc > 1 ? argv[1] : "";
+    double scale = argc > 2 ? max(1.0, atof(argv[2])) : 3.0;
+    int repetitions = argc > 3 ? max(1, atoi(argv[3])) : 3;
+
+    vector<string> candidates = {path, "koruny_black.jpg", "../koruny_black.jpg", "Data/koruny_black.jpg",
+                                 "../Data/koruny_black.jpg", "Image2.jpg", "Data/Image2.jpg"};
+    Mat original;
+    for (const string& candidate : candidates) {
+        if (!candidate.empty()) {
+            original = ImageSource::loadFirst(candidate, IMREAD_COLOR);
+            if (!original.empty()) {
+                break;
+            }
+        }
+    }
+    if (original.empty()) {
+        cout << "No se pudo cargar la imagen de monedas." << endl;
+        return -1;
+    }
+    Mat img;
+    resize(original, img, Size(), scale, scale, scale > 1 ? INTER_CUBIC : INTER_AREA);
+    cout << "Imagen: " << img.cols << "x" << img.rows << " (" << fixed << setprecision(1)
+         << img.total() / 1e6 << " MP, escala " << scale << ")" << endl;
+
+    vector<CoinInfo> coin_types = czechCoinTypes();
+    CoinOptions base;
+    base.keepIntermediates = false;
+    base.verbose = false;
+    base.circleParams.minRadius = cvRound(base.circleParams.minRadius * scale);
+    base.circleParams.maxRadius = cvRound(base.circleParams.maxRadius * scale);
+    base.circleParams.minArea = cvRound(base.circleParams.minArea * scale * scale);
+    base.circleParams.houghMinDist *= scale;
+
+    CoinOptions components = base, pyramid = base;
+    components.components = true;
+    pyramid.pyramid = true;
+    struct Path {
+        const char* name;
+        CoinOptions options;
+        CoinCountResult result;
+        double ms;
+    } paths[] = {{"Hough + contornos", base, CoinCountResult(), 0},
+                 {"componentes", components, CoinCountResult(), 0},
+                 {"pyramid 1/4 + recortes", pyramid, CoinCountResult(), 0}};
+
+    cout << "\n" << setw(24) << "camino" << setw(10) << "ms" << setw(10) << "monedas" << setw(10) << "total"
+         << setw(12) << "px/mm" << endl;
+    for (Path& p : paths) {
+        if (&p == &paths[0] && scale != 1.0) {
+            // El camino original tiene fijos los radios de la foto sin escalar
+            continue;
+        }
+        vector<double> times;
+        p.result = countCoins(img, coin_types, p.options);   // Calentamiento
+        for (int r = 0; r < repetitions; r++) {
+            int64 t0 = getTickCount();
+            p.result = countCoins(img, coin_types, p.options);
+            times.push_back((getTickCount() - t0) * 1000.0 / getTickFrequency());
+        }
+        p.ms = medianOf(times);
+        cout << setw(24) << p.name << setprecision(1) << setw(10) << p.ms << setw(10) << p.result.circles.size()
+             << setw(10) << p.result.totalValue << setprecision(3) << setw(12) << p.result.pxPerMm << endl;
+    }
+
+    const CoinCountResult& ref = paths[1].result;
+    const CoinCountResult& fast = paths[2].result;
+    const CoinPyramidStats& st = fast.pyramidStats;
+    cout << "\nSpeedup de --pyramid contra componentes: " << setprecision(2) << paths[1].ms / paths[2].ms << "x"
+         << endl;
+    cout << "Etapa gruesa " << setprecision(1) << st.coarsePreprocessMs + st.coarseDetectMs << " ms, recortes "
+         << st.refineMs << " ms (" << setprecision(0) << 100 * st.roiFraction << "% de la imagen); "
+         << st.candidates << " candidatos, " << st.refined << " refinados, " << st.kept << " sin refinar, "
+         << st.duplicates << " duplicados" << endl;
+
+    // Exactitud: diámetros de los dos caminos con la calibración de referencia
+    double minGap = INFINITY;
+    for (size_t i = 0; i < coin_types.size(); i++) {
+        for (size_t j = i + 1; j < coin_types.size(); j++) {
+            minGap = min(minGap, fabs(coin_types[i].diameter_mm - coin_types[j].diameter_mm));
+        }
+    }
+    const double tolerance = minGap / 4;
+    int matched = 0, misclassified = 0;
+    double sumError = 0, maxError = 0;
+    vector<bool> used(fast.circles.size(), false);
+    for (size_t i = 0; i < ref.circles.size(); i++) {
+        const Vec3f& c = ref.circles[i];
+        int best = -1;
+        double bestDist = c[2] / 2;
+        for (size_t j = 0; j < fast.circles.size(); j++) {
+            double d = hypot(c[0] - fast.circles[j][0], c[1] - fast.circles[j][1]);
+            if (!used[j] && d < bestDist) {
+                best = (int)j;
+                bestDist = d;
+            }
+        }
+        if (best < 0) {
+            continue;
+        }
+        used[best] = true;
+        matched++;
+        double error = 2 * fabs(c[2] - fast.circles[best][2]) / ref.pxPerMm;
+        sumError += error;
+        maxError = max(maxError, error);
+        if (ref.values[i] != fast.values[best]) {
+            misclassified++;
+        }
+    }
+    bool ok = matched == (int)ref.circles.size() && matched == (int)fast.circles.size() && maxError <= tolerance &&
+              misclassified == 0;
+    cout << setprecision(3) << "Coinciden " << matched << " de " << ref.circles.size() << " / " << fast.circles.size()
+         << " círculos; error de diámetro medio " << (matched ? sumError / matched : 0) << " mm, máximo " << maxError
+         << " mm (tolerancia " << tolerance << " mm); " << misclassified << " clasificadas distinto" << endl;
+    cout << (ok ? "Exactitud dentro de la tolerancia" : "FUERA DE TOLERANCIA") << endl;
+    return ok ? 0 : -1;
+}
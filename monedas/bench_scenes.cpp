@@ -0,0 +1,191 @@
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+
+#include "bench_utils.hpp"
+#include "coin_counter.hpp"
+#include "coin_scene.hpp"
+
+using namespace cv;
+using namespace std;
+
+// Exactitud y latencia del conteo sobre escenas sintéticas (coin_scene.hpp)
+// con la respuesta conocida.
+//
+// Para cada escala y cantidad de monedas genera --scenes escenas (semillas
+// consecutivas) de 1600x1200 x escala con 8 x escala px/mm, y las cuenta con
+// cada camino: Hough + contornos (solo a escala 1, sus radios son fijos),
+// --components y --pyramid, con los radios y el área mínima escalados. Por
+// configuración reporta precisión y exhaustividad de la detección (centro a
+// menos de medio radio de una moneda), monedas emparejadas con el valor
+// correcto, escenas con el conteo exacto por denominación, error máximo de
+// diámetro y la mediana de la latencia de cada etapa.
+//
+// Uso: ./bench_scenes [--scales 0.5,1,2] [--coins 4,8,16] [--scenes N]
+//                     [--seed S] [--overlap F] [--noise S] [--blur S]
+//                     [--csv archivo] [--dump-dir carpeta]
+// --csv guarda una fila por escena y camino; --dump-dir escribe cada escena
+// (PNG) con su respuesta (CSV con centro, radio y valor de cada moneda), que
+// sirven de entrada para monedas --batch.
+
+static vector<double> parseList(const string& text) {
+    vector<double> values;
+    stringstream in(text);
+    string item;
+    while (getline(in, item, ',')) {
+        if (!item.empty()) {
+            values.push_back(atof(item.c_str()));
+        }
+    }
+    return values;
+}
+
+static bool writeTruth(const string& path, const CoinScene& scene) {
+    ofstream out(path.c_str());
+    out << "x,y,radius,value,diameter_mm,visible\n" << fixed << setprecision(2);
+    for (const CoinSceneCoin& c : scene.coins) {
+        out << c.circle[0] << "," << c.circle[1] << "," << c.circle[2] << "," << c.value << "," << c.diameter_mm << ","
+            << c.visible << "\n";
+    }
+    return (bool)out;
+}
+
+int main(int argc, char** argv) {
+    vector<double> scales = {0.5, 1, 2};
+    vector<double> coinCounts = {4, 8, 16};
+    int scenes = 3;
+    unsigned seed = 1;
+    CoinSceneParams base;
+    string csv_path, dump_dir;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--scales" && i + 1 < argc) {
+            scales = parseList(argv[++i]);
+        } else if (arg == "--coins" && i + 1 < argc) {
+            coinCounts = parseList(argv[++i]);
+        } else if (arg == "--scenes" && i + 1 < argc) {
+            scenes = max(1, atoi(argv[++i]));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = (unsigned)atoi(argv[++i]);
+        } else if (arg == "--overlap" && i + 1 < argc) {
+            base.overlap = atof(argv[++i]);
+        } else if (arg == "--noise" && i + 1 < argc) {
+            base.noiseSigma = atof(argv[++i]);
+        } else if (arg == "--blur" && i + 1 < argc) {
+            base.blurSigma = atof(argv[++i]);
+        } else if (arg == "--csv" && i + 1 < argc) {
+            csv_path = argv[++i];
+        } else if (arg == "--dump-dir" && i + 1 < argc) {
+            dump_dir = argv[++i];
+        } else {
+            cout << "Argumento desconocido: " << arg << endl;
+            return -1;
+        }
+    }
+
+    vector<CoinInfo> coin_types = czechCoinTypes();
+    ofstream csv;
+    if (!csv_path.empty()) {
+        csv.open(csv_path.c_str());
+        csv << "scale,width,height,requested,seed,path,truth,detected,matched,correct_value,exact_counts,"
+               "truth_kc,detected_kc,max_diameter_error_mm,preprocess_ms,detect_ms,refine_ms,classify_ms,total_ms\n";
+        csv << fixed << setprecision(3);
+    }
+
+    cout << setw(6) << "escala" << setw(7) << "MP" << setw(8) << "monedas" << setw(26) << "camino" << setw(7)
+         << "prec" << setw(7) << "exh" << setw(8) << "valor" << setw(8) << "exacto" << setw(9) << "err mm"
+         << setw(9) << "preproc" << setw(9) << "detect" << setw(9) << "recorte" << setw(9) << "total" << endl;
+    bool allExact = true;
+    for (double scale : scales) {
+        CoinOptions hough;
+        hough.keepIntermediates = false;
+        hough.verbose = false;
+        hough.circleParams.minRadius = cvRound(hough.circleParams.minRadius * scale);
+        hough.circleParams.maxRadius = cvRound(hough.circleParams.maxRadius * scale);
+        hough.circleParams.minArea = cvRound(hough.circleParams.minArea * scale * scale);
+        hough.circleParams.houghMinDist *= scale;
+        CoinOptions components = hough, pyramid = hough;
+        components.components = true;
+        pyramid.pyramid = true;
+        struct Path {
+            const char* name;
+            CoinOptions options;
+        } paths[] = {{"Hough + contornos", hough}, {"componentes", components}, {"pyramid", pyramid}};
+
+        for (double count : coinCounts) {
+            CoinSceneParams params = base;
+            params.width = cvRound(base.width * scale);
+            params.height = cvRound(base.height * scale);
+            params.pxPerMm = base.pxPerMm * scale;
+            params.coins = (int)count;
+
+            // Escenas de esta configuración
+            vector<CoinScene> generated;
+            for (int s = 0; s < scenes; s++) {
+                params.seed = seed + s;
+                generated.push_back(generateCoinScene(coin_types, params));
+                if (!dump_dir.empty()) {
+                    ostringstream name;
+                    name << dump_dir << "/scene_x" << scale << "_n" << params.coins << "_s" << params.seed;
+                    imwrite(name.str() + ".png", generated.back().image);
+                    writeTruth(name.str() + ".csv", generated.back());
+                }
+            }
+
+            for (const Path& path : paths) {
+                if (&path == &paths[0] && scale != 1.0) {
+                    continue;
+                }
+                int truth = 0, detected = 0, matched = 0, correct = 0, exact = 0;
+                double maxError = 0;
+                vector<double> preprocess, detect, refine, total;
+                countCoins(generated[0].image, coin_types, path.options);   // Calentamiento
+                for (const CoinScene& scene : generated) {
+                    CoinCountResult result = countCoins(scene.image, coin_types, path.options);
+                    CoinSceneScore score = scoreCoinScene(scene, result);
+                    const CoinStageTimes& t = result.times;
+                    truth += score.truth;
+                    detected += score.detected;
+                    matched += score.matched;
+                    correct += score.correctValue;
+                    exact += score.exactCounts ? 1 : 0;
+                    maxError = max(maxError, score.maxDiameterErrorMm);
+                    double detectMs = t.houghMs + t.contoursMs + t.componentsMs;
+                    preprocess.push_back(t.preprocessMs);
+                    detect.push_back(detectMs);
+                    refine.push_back(t.refineMs);
+                    total.push_back(t.totalMs);
+                    if (csv.is_open()) {
+                        csv << scale << "," << scene.image.cols << "," << scene.image.rows << "," << scene.requested
+                            << "," << (&scene - &generated[0]) + seed << "," << path.name << "," << score.truth << ","
+                            << score.detected << "," << score.matched << "," << score.correctValue << ","
+                            << (score.exactCounts ? 1 : 0) << "," << score.truthValue << "," << score.detectedValue
+                            << "," << score.maxDiameterErrorMm << "," << t.preprocessMs << "," << detectMs << ","
+                            << t.refineMs << "," << t.classifyMs << "," << t.totalMs << "\n";
+                    }
+                }
+                allExact = allExact && exact == scenes;
+                cout << fixed << setprecision(1) << setw(6) << scale << setw(7)
+                     << params.width * params.height / 1e6 << setw(8) << truth / scenes << setw(26) << path.name
+                     << setprecision(2) << setw(7) << (detected ? matched / (double)detected : 1.0) << setw(7)
+                     << (truth ? matched / (double)truth : 1.0) << setw(8) << (matched ? correct / (double)matched : 1.0)
+                     << setw(5) << exact << "/" << setw(2) << scenes << setw(9) << maxError << setprecision(1)
+                     << setw(9) << medianOf(preprocess) << setw(9) << medianOf(detect) << setw(9) << medianOf(refine)
+                     << setw(9) << medianOf(total) << endl;
+            }
+        }
+    }
+    cout << "\nprec = detecciones que son monedas, exh = monedas detectadas, valor = detectadas con el valor "
+            "correcto,\nexacto = escenas con el conteo exacto por denominación; tiempos en ms (mediana por escena)"
+         << endl;
+    if (csv.is_open()) {
+        cout << (csv ? "Resultados CSV en " : "No se pudo escribir ") << csv_path << endl;
+    }
+    return allExact ? 0 : -1;
+}
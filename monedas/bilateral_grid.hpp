@@ -0,0 +1,300 @@
+#ifndef BILATERAL_GRID_HPP
+#define BILATERAL_GRID_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "opencv2/core.hpp"
+
+#include "trace.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BILATERAL_GRID_USE_SSE2 1
+#endif
+
+// Filtro bilateral aproximado con bilateral grid (Paris y Durand) para
+// imágenes CV_8UC1.
+//
+// Cada píxel (x, y, v) se acumula como (v, 1) en la celda más cercana de una
+// grilla 3D submuestreada cada sigmaSpace píxeles en x e y y cada sigmaColor
+// niveles en intensidad. La grilla se suaviza con un binomial [1 4 6 4 1]
+// (gaussiana de sigma una celda) en z, x e y, y cada píxel se reconstruye con
+// interpolación trilineal dividiendo suma ponderada por peso. El costo por
+// píxel no depende del tamaño del kernel espacial: un sigma mayor solo achica
+// la grilla.
+//
+// La imagen se procesa por bandas de filas repartidas entre hilos; cada banda
+// arma solo las filas de grilla que necesita (más dos de cada lado para el
+// suavizado en y). El suavizado en x e y y la interpolación en y recorren
+// filas de grilla contiguas con SSE2 (4 floats por instrucción), igual que la
+// división final. La grilla está alineada con las filas globales (yOrigin),
+// así que filtrar una banda de la imagen con su halo da las mismas filas que
+// filtrar la imagen completa.
+//
+// Para reemplazar bilateralFilter(src, dst, d, sigmaColor, sigmaSpace) con
+// d > 0 conviene sigmaSpace = min(sigmaSpace, d / 4): la ventana de OpenCV es
+// un disco de radio d / 2 y con sigmaSpace grande sus pesos espaciales son
+// casi planos (ver bilateralGridSigmaSpace).
+
+inline double bilateralGridSigmaSpace(int diameter, double sigmaSpace) {
+    if (diameter <= 0) {
+        return sigmaSpace;
+    }
+    return std::max(1.0, std::min(sigmaSpace, (diameter / 2) / 2.0));
+}
+
+class BilateralGrid {
+public:
+    enum { PAD = 2 };   // Celdas vacías a cada lado en x (radio del binomial)
+
+    BilateralGrid(double sigmaSpace, double sigmaColor, int tileRows = 64)
+        : sigmaSpace_(std::max(sigmaSpace, 0.5)), sigmaColor_(std::max(sigmaColor, 1.0)),
+          tileRows_(std::max(tileRows, 1)) {}
+
+    // Filas a cada lado de las que depende un píxel de salida: una banda
+    // filtrada con este halo coincide con la imagen completa
+    int supportRows() const {
+        return cvCeil(3.5 * sigmaSpace_) + 1;
+    }
+
+    // src y dst CV_8UC1. yOrigin es la fila global de la primera fila de src
+    // (para filtrar bandas de una imagen mayor con la grilla alineada)
+    void apply(const cv::Mat& src, cv::Mat& dst, int yOrigin = 0) const {
+        CV_Assert(src.type() == CV_8UC1);
+        dst.create(src.size(), CV_8UC1);
+        if (src.empty()) {
+            return;
+        }
+        Layout layout = makeLayout(src.cols);
+        int numTiles = (src.rows + tileRows_ - 1) / tileRows_;
+        cv::parallel_for_(cv::Range(0, numTiles), [&](const cv::Range& range) {
+            TileBuffers buffers;
+            for (int t = range.start; t < range.end; t++) {
+                TraceZone zone("bilateral grid tile", "tile", t);
+                int y0 = t * tileRows_;
+                int y1 = std::min(src.rows, y0 + tileRows_);
+                processTile(src, dst, y0, y1, yOrigin, layout, buffers);
+            }
+        });
+    }
+
+private:
+    struct Layout {
+        int nx;          // Celdas reales en x
+        int nz;          // Celdas en intensidad
+        int gw;          // Celdas por fila de grilla (con PAD a cada lado)
+        int cellFloats;  // Floats por columna x (nz celdas de (v, peso))
+        int rowFloats;   // Floats por fila de grilla
+        std::vector<int> splatX;     // Columna de grilla de cada x (ya con PAD)
+        std::vector<int> sliceX;     // Columna izquierda para interpolar (con PAD)
+        std::vector<float> weightX;  // Peso de la columna derecha
+        int splatZ[256];
+        int sliceZ[256];
+        float weightZ[256];
+    };
+
+    struct TileBuffers {
+        std::vector<float> grid, blurred, rows, line, num, den;
+    };
+
+    Layout makeLayout(int cols) const {
+        Layout l;
+        l.nx = cvFloor((cols - 1) / sigmaSpace_) + 2;
+        l.nz = cvFloor(255.0 / sigmaColor_) + 2;
+        l.gw = l.nx + 2 * PAD;
+        l.cellFloats = 2 * l.nz;
+        l.rowFloats = l.gw * l.cellFloats;
+        l.splatX.resize(cols);
+        l.sliceX.resize(cols);
+        l.weightX.resize(cols);
+        for (int x = 0; x < cols; x++) {
+            double fx = x / sigmaSpace_;
+            l.splatX[x] = cvRound(fx) + PAD;
+            l.sliceX[x] = cvFloor(fx) + PAD;
+            l.weightX[x] = (float)(fx - cvFloor(fx));
+        }
+        for (int v = 0; v < 256; v++) {
+            double fz = v / sigmaColor_;
+            l.splatZ[v] = cvRound(fz);
+            l.sliceZ[v] = cvFloor(fz);
+            l.weightZ[v] = (float)(fz - cvFloor(fz));
+        }
+        return l;
+    }
+
+    // Binomial [1 4 6 4 1] sobre arreglos contiguos: out[i] = sum w_k in[i + (k-2) stride]
+    static void blur5(const float* in, float* out, int count, int stride) {
+        int i = 0;
+#ifdef BILATERAL_GRID_USE_SSE2
+        const __m128 four = _mm_set1_ps(4.0f), six = _mm_set1_ps(6.0f);
+        for (; i + 4 <= count; i += 4) {
+            const float* p = in + i;
+            __m128 outer = _mm_add_ps(_mm_loadu_ps(p - 2 * stride), _mm_loadu_ps(p + 2 * stride));
+            __m128 inner = _mm_add_ps(_mm_loadu_ps(p - stride), _mm_loadu_ps(p + stride));
+            __m128 sum = _mm_add_ps(_mm_add_ps(outer, _mm_mul_ps(inner, four)),
+                                    _mm_mul_ps(_mm_loadu_ps(p), six));
+            _mm_storeu_ps(out + i, sum);
+        }
+#endif
+        for (; i < count; i++) {
+            const float* p = in + i;
+            float outer = p[-2 * stride] + p[2 * stride];
+            float inner = p[-stride] + p[stride];
+            out[i] = (outer + inner * 4.0f) + p[0] * 6.0f;
+        }
+    }
+
+    // Binomial en y: cinco filas distintas
+    static void blur5Rows(const float* r0, const float* r1, const float* r2, const float* r3,
+                          const float* r4, float* out, int count) {
+        int i = 0;
+#ifdef BILATERAL_GRID_USE_SSE2
+        const __m128 four = _mm_set1_ps(4.0f), six = _mm_set1_ps(6.0f);
+        for (; i + 4 <= count; i += 4) {
+            __m128 outer = _mm_add_ps(_mm_loadu_ps(r0 + i), _mm_loadu_ps(r4 + i));
+            __m128 inner = _mm_add_ps(_mm_loadu_ps(r1 + i), _mm_loadu_ps(r3 + i));
+            __m128 sum = _mm_add_ps(_mm_add_ps(outer, _mm_mul_ps(inner, four)),
+                                    _mm_mul_ps(_mm_loadu_ps(r2 + i), six));
+            _mm_storeu_ps(out + i, sum);
+        }
+#endif
+        for (; i < count; i++) {
+            float outer = r0[i] + r4[i];
+            float inner = r1[i] + r3[i];
+            out[i] = (outer + inner * 4.0f) + r2[i] * 6.0f;
+        }
+    }
+
+    // Interpolación lineal entre dos filas de grilla
+    static void lerpRows(const float* a, const float* b, float w, float* out, int count) {
+        int i = 0;
+        float wa = 1.0f - w;
+#ifdef BILATERAL_GRID_USE_SSE2
+        const __m128 va = _mm_set1_ps(wa), vb = _mm_set1_ps(w);
+        for (; i + 4 <= count; i += 4) {
+            _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(a + i), va),
+                                              _mm_mul_ps(_mm_loadu_ps(b + i), vb)));
+        }
+#endif
+        for (; i < count; i++) {
+            out[i] = a[i] * wa + b[i] * w;
+        }
+    }
+
+    // num / den redondeado a 8 bits
+    static void divideRow(const float* num, const float* den, const uchar* src, uchar* dst, int count) {
+        int i = 0;
+#ifdef BILATERAL_GRID_USE_SSE2
+        const __m128 zero = _mm_setzero_ps();
+        for (; i + 8 <= count; i += 8) {
+            __m128 d0 = _mm_loadu_ps(den + i), d1 = _mm_loadu_ps(den + i + 4);
+            if (_mm_movemask_ps(_mm_or_ps(_mm_cmple_ps(d0, zero), _mm_cmple_ps(d1, zero))) != 0) {
+                break;   // Peso nulo (no debería pasar): lo resuelve el camino escalar
+            }
+            __m128i q0 = _mm_cvtps_epi32(_mm_div_ps(_mm_loadu_ps(num + i), d0));
+            __m128i q1 = _mm_cvtps_epi32(_mm_div_ps(_mm_loadu_ps(num + i + 4), d1));
+            __m128i q = _mm_packs_epi32(q0, q1);
+            _mm_storel_epi64((__m128i*)(dst + i), _mm_packus_epi16(q, q));
+        }
+#endif
+        for (; i < count; i++) {
+            dst[i] = den[i] > 0 ? cv::saturate_cast<uchar>(num[i] / den[i]) : src[i];
+        }
+    }
+
+    void processTile(const cv::Mat& src, cv::Mat& dst, int y0, int y1, int yOrigin,
+                     const Layout& l, TileBuffers& b) const {
+        const int rowFloats = l.rowFloats;
+        // Filas de grilla que se interpolan [ja, jb] y que se suavizan [ga, gb]
+        int ja = cvFloor((y0 + yOrigin) / sigmaSpace_);
+        int jb = cvFloor((y1 - 1 + yOrigin) / sigmaSpace_) + 1;
+        int ga = ja - 2, gb = jb + 2;
+        int gridRows = gb - ga + 1;
+
+        b.grid.assign((size_t)gridRows * rowFloats, 0.0f);
+        b.blurred.assign((size_t)gridRows * rowFloats, 0.0f);
+        b.rows.resize((size_t)(jb - ja + 1) * rowFloats);
+        b.line.resize(rowFloats);
+        b.num.resize(src.cols);
+        b.den.resize(src.cols);
+
+        // Acumulación: los píxeles de src cuya fila de grilla cae en [ga, gb]
+        int ys = std::max(0, cvFloor((ga - 1) * sigmaSpace_) - yOrigin);
+        int ye = std::min(src.rows, cvCeil((gb + 1) * sigmaSpace_) - yOrigin + 1);
+        for (int y = ys; y < ye; y++) {
+            int j = cvRound((y + yOrigin) / sigmaSpace_);
+            if (j < ga || j > gb) {
+                continue;
+            }
+            float* row = &b.grid[(size_t)(j - ga) * rowFloats];
+            const uchar* s = src.ptr<uchar>(y);
+            for (int x = 0; x < src.cols; x++) {
+                int v = s[x];
+                float* cell = row + l.splatX[x] * l.cellFloats + 2 * l.splatZ[v];
+                cell[0] += (float)v;
+                cell[1] += 1.0f;
+            }
+        }
+
+        // Suavizado en z (pocas celdas por columna: escalar, bordes en cero)
+        std::vector<float> column(l.cellFloats + 8, 0.0f);
+        for (int r = 0; r < gridRows; r++) {
+            float* row = &b.grid[(size_t)r * rowFloats];
+            for (int cx = PAD; cx < PAD + l.nx; cx++) {
+                float* cell = row + cx * l.cellFloats;
+                std::memcpy(&column[4], cell, l.cellFloats * sizeof(float));
+                const float* c = &column[4];
+                for (int k = 0; k < l.cellFloats; k++) {
+                    float outer = c[k - 4] + c[k + 4];
+                    float inner = c[k - 2] + c[k + 2];
+                    cell[k] = (outer + inner * 4.0f) + c[k] * 6.0f;
+                }
+            }
+        }
+
+        // Suavizado en x (columnas reales; el PAD queda en cero)
+        for (int r = 0; r < gridRows; r++) {
+            const float* in = &b.grid[(size_t)r * rowFloats + PAD * l.cellFloats];
+            float* out = &b.blurred[(size_t)r * rowFloats + PAD * l.cellFloats];
+            blur5(in, out, l.nx * l.cellFloats, l.cellFloats);
+        }
+
+        // Suavizado en y de las filas que se interpolan
+        for (int j = ja; j <= jb; j++) {
+            const float* r = &b.blurred[(size_t)(j - ga) * rowFloats];
+            blur5Rows(r - 2 * rowFloats, r - rowFloats, r, r + rowFloats, r + 2 * rowFloats,
+                      &b.rows[(size_t)(j - ja) * rowFloats], rowFloats);
+        }
+
+        // Interpolación: primero en y (fila completa), después en x y z
+        for (int y = y0; y < y1; y++) {
+            double fy = (y + yOrigin) / sigmaSpace_;
+            int j0 = cvFloor(fy);
+            const float* a = &b.rows[(size_t)(j0 - ja) * rowFloats];
+            lerpRows(a, a + rowFloats, (float)(fy - j0), &b.line[0], rowFloats);
+
+            const uchar* s = src.ptr<uchar>(y);
+            const float* line = &b.line[0];
+            for (int x = 0; x < src.cols; x++) {
+                int v = s[x];
+                const float* c0 = line + l.sliceX[x] * l.cellFloats + 2 * l.sliceZ[v];
+                const float* c1 = c0 + l.cellFloats;
+                float wx = l.weightX[x], wz = l.weightZ[v];
+                float w00 = (1.0f - wx) * (1.0f - wz), w01 = (1.0f - wx) * wz;
+                float w10 = wx * (1.0f - wz), w11 = wx * wz;
+                b.num[x] = (c0[0] * w00 + c0[2] * w01) + (c1[0] * w10 + c1[2] * w11);
+                b.den[x] = (c0[1] * w00 + c0[3] * w01) + (c1[1] * w10 + c1[3] * w11);
+            }
+            divideRow(&b.num[0], &b.den[0], s, dst.ptr<uchar>(y), src.cols);
+        }
+    }
+
+    double sigmaSpace_;
+    double sigmaColor_;
+    int tileRows_;
+};
+
+#endif // BILATERAL_GRID_HPP
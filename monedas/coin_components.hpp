@@ -0,0 +1,130 @@
+#ifndef COIN_COMPONENTS_HPP
+#define COIN_COMPONENTS_HPP
+
+#include <vector>
+#include <cmath>
+
+#include "opencv2/core.hpp"
+#include "opencv2/imgproc.hpp"
+
+#include "connected_components.hpp"
+#include "perf_counters.hpp"
+#include "trace.hpp"
+
+// Detección de monedas por componentes conexas en lugar de HoughCircles
+// sobre toda la imagen.
+//
+// La máscara binaria (dilated) se etiqueta en una sola pasada paralela
+// (connected_components.hpp) que ya entrega área, momentos, caja envolvente y
+// perímetro de cada componente. Una moneda suelta es una componente casi
+// circular: su círculo sale directamente de la caja envolvente (centro y
+// radio medio de ancho y alto, que no cambian por los huecos del grabado).
+// Solo las componentes que no parecen un disco (circularidad 4 pi A / P^2
+// baja, elipse de inercia alargada, área menor que la del círculo de la caja
+// o radio mayor que el de cualquier moneda) son monedas que se tocan: sobre
+// su recorte se corre HoughCircles con los mismos parámetros que el camino
+// original para separarlas. Si Hough no encuentra nada y el tamaño es el de
+// una moneda se usa el mismo criterio que la búsqueda por contornos (área /
+// área del círculo envolvente > 0.6).
+
+struct CoinCircleParams {
+    int minArea = 1000;              // Igual que el filtro de contornos
+    double minCircularity = 0.85;    // 4 pi A / P^2 de una moneda suelta
+    double maxElongation = 1.15;     // Relación de ejes de la elipse de inercia
+    double minFill = 0.9;            // Área / área del círculo de la caja envolvente
+    int minRadius = 50;              // Rango de radios de HoughCircles
+    int maxRadius = 120;
+    double houghMinDist = 40;        // Resto de los parámetros de HoughCircles
+    double houghParam1 = 100;
+    double houghParam2 = 15;
+    int roiMargin = 8;               // Margen del recorte para Hough
+    double fallbackFill = 0.6;       // Criterio de la búsqueda por contornos
+    int stripRows = 0;               // Filas por banda del etiquetado (0 = automático)
+};
+
+struct CoinCircleStats {
+    int components = 0;      // Componentes en la máscara
+    int small = 0;           // Descartadas por área
+    int single = 0;          // Monedas sueltas ajustadas por momentos
+    int touching = 0;        // Componentes separadas con Hough
+    int splitCircles = 0;    // Círculos que Hough encontró en ellas
+    int fallback = 0;        // Componentes sin círculos de Hough que se aceptaron igual
+    double labelMs = 0;      // Etiquetado y estadísticas
+    double houghMs = 0;      // Hough sobre los recortes
+};
+
+inline std::vector<cv::Vec3f> findCoinCircles(const cv::Mat& binary, const CoinCircleParams& params,
+                                              CoinCircleStats* stats = nullptr,
+                                              PerfStageRecorder* perf_recorder = nullptr) {
+    CoinCircleStats local;
+    CoinCircleStats& st = stats ? *stats : local;
+    st = CoinCircleStats();
+    std::vector<cv::Vec3f> circles;
+
+    int64 t0 = cv::getTickCount();
+    PerfScope perf_label(perf_recorder, "components");
+    std::vector<ComponentStats> components;
+    {
+        TraceZone zone("label components");
+        StripConnectedComponents(params.stripRows).run(binary, components);
+    }
+    perf_label.stop();
+    int64 t1 = cv::getTickCount();
+    st.labelMs = (t1 - t0) * 1000.0 / cv::getTickFrequency();
+    st.components = (int)components.size();
+
+    PerfScope perf_split(perf_recorder, "hough");
+    for (const ComponentStats& c : components) {
+        if (c.area < params.minArea) {
+            st.small++;
+            continue;
+        }
+        cv::Rect box = c.bbox();
+        double radius = (box.width + box.height - 2) / 4.0;
+        cv::Point2f center(box.x + (box.width - 1) / 2.0f, box.y + (box.height - 1) / 2.0f);
+
+        // Tres monedas en triángulo tienen elipse redonda y circularidad
+        // cercana a 0.8, pero llenan solo el 80% del círculo de su caja
+        double fill = c.area / (M_PI * (radius + 0.5) * (radius + 0.5));
+        if (c.circularity() >= params.minCircularity && c.elongation() <= params.maxElongation &&
+            fill >= params.minFill && radius <= params.maxRadius) {
+            circles.push_back(cv::Vec3f(center.x, center.y, (float)radius));
+            st.single++;
+            continue;
+        }
+
+        // Monedas que se tocan: Hough solo sobre el recorte de la componente
+        st.touching++;
+        TraceZone zone("split component", "area", (int)c.area);
+        int m = params.roiMargin;
+        cv::Rect roi = cv::Rect(box.x - m, box.y - m, box.width + 2 * m, box.height + 2 * m) &
+                       cv::Rect(0, 0, binary.cols, binary.rows);
+        std::vector<cv::Vec3f> found;
+        cv::HoughCircles(binary(roi), found, cv::HOUGH_GRADIENT, 1, params.houghMinDist, params.houghParam1,
+                         params.houghParam2, params.minRadius, params.maxRadius);
+        int accepted = 0;
+        for (const cv::Vec3f& f : found) {
+            // El recorte puede incluir bordes de otras componentes: el centro
+            // tiene que caer dentro de esta y sobre el primer plano
+            cv::Point p(cvRound(f[0]) + roi.x, cvRound(f[1]) + roi.y);
+            if (box.contains(p) && binary.at<uchar>(p)) {
+                circles.push_back(cv::Vec3f(f[0] + roi.x, f[1] + roi.y, f[2]));
+                accepted++;
+            }
+        }
+        st.splitCircles += accepted;
+
+        if (!accepted && radius <= params.maxRadius) {
+            double enclosing = std::max(box.width, box.height) / 2.0;
+            if (c.area / (M_PI * enclosing * enclosing) > params.fallbackFill) {
+                circles.push_back(cv::Vec3f(center.x, center.y, (float)radius));
+                st.fallback++;
+            }
+        }
+    }
+    perf_split.stop();
+    st.houghMs = (cv::getTickCount() - t1) * 1000.0 / cv::getTickFrequency();
+    return circles;
+}
+
+#endif // COIN_COMPONENTS_HPP
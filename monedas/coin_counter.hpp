@@ -0,0 +1,297 @@
+#ifndef COIN_COUNTER_HPP
+#define COIN_COUNTER_HPP
+
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "opencv2/core.hpp"
+#include "opencv2/imgproc.hpp"
+
+#include "perf_counters.hpp"
+#include "trace.hpp"
+#include "coin_preprocess.hpp"
+#include "coin_components.hpp"
+#include "coin_pyramid.hpp"
+
+// Conteo de monedas sin interfaz: preprocesamiento, detección de círculos,
+// calibración de píxeles por mm y clasificación por diámetro. Lo usan el modo
+// interactivo (que además dibuja y guarda imágenes) y el modo por lotes de
+// monedas/main.cpp.
+
+// Estructura para almacenar información de las monedas
+struct CoinInfo {
+    int value;           // Valor de la moneda
+    double diameter_mm;  // Diámetro en mm
+    cv::Scalar color;    // Color para visualización
+};
+
+// Coronas checas con sus valores y diámetros
+inline std::vector<CoinInfo> czechCoinTypes() {
+    return {
+        {1, 20.0, cv::Scalar(200, 200, 200)},  // 1 Kč - diámetro 20mm
+        {2, 21.5, cv::Scalar(200, 255, 200)},  // 2 Kč - diámetro 21.5mm
+        {5, 23.0, cv::Scalar(200, 200, 255)},  // 5 Kč - diámetro 23mm
+        {10, 24.5, cv::Scalar(100, 100, 255)}, // 10 Kč - diámetro 24.5mm
+        {20, 26.0, cv::Scalar(255, 200, 100)}  // 20 Kč - diámetro 26mm
+    };
+}
+
+// Función para clasificar una moneda según su diámetro en mm
+inline int classifyCoin(double diameter_mm, const std::vector<CoinInfo>& coin_types) {
+    // Encontrar la moneda más cercana basada en el diámetro
+    int best_value = 0;
+    double min_diff = INFINITY;
+
+    for (const auto& coin : coin_types) {
+        double diff = std::abs(diameter_mm - coin.diameter_mm);
+        if (diff < min_diff) {
+            min_diff = diff;
+            best_value = coin.value;
+        }
+    }
+
+    return best_value;
+}
+
+// Opciones del conteo elegidas por línea de comandos
+struct CoinOptions {
+    bool fused = true;                   // --unfused: siete pasadas sobre la imagen completa
+    bool keepIntermediates = true;       // Imágenes intermedias (ventanas y depuración)
+    bool verbose = true;                 // Mensajes de cada paso por consola
+    bool components = false;             // --components: círculos por componentes conexas
+    bool pyramid = false;                // --pyramid: detección a 1/4 y refinado en recortes
+    CoinPreprocessParams preprocess;
+    CoinCircleParams circleParams;
+    CoinPyramidParams pyramidParams;
+};
+
+// Latencia de cada etapa de una imagen (ms)
+struct CoinStageTimes {
+    double preprocessMs = 0;
+    double houghMs = 0;          // Con --components, solo sobre las monedas que se tocan
+    double contoursMs = 0;       // Solo si Hough encontró menos de 10 círculos
+    double componentsMs = 0;     // Etiquetado con --components (o de la etapa gruesa con --pyramid)
+    double refineMs = 0;         // Recortes a resolución completa con --pyramid
+    double classifyMs = 0;       // Calibración y clasificación
+    double totalMs = 0;
+};
+
+struct CoinCountResult {
+    CoinPreprocessResult pre;
+    std::vector<cv::Vec3f> circles;   // Ordenados por radio
+    std::vector<int> values;          // Valor de cada círculo
+    double pxPerMm = 1.0;
+    std::map<int, int> counts;        // Valor -> cantidad
+    int totalValue = 0;
+    bool usedContours = false;
+    CoinCircleStats componentStats;   // Solo con --components
+    CoinPyramidStats pyramidStats;    // Solo con --pyramid
+    CoinStageTimes times;
+};
+
+class CoinStageTimer {
+public:
+    CoinStageTimer() : t0_(cv::getTickCount()) {}
+    double lap() {
+        int64 t = cv::getTickCount();
+        double ms = (t - t0_) * 1000.0 / cv::getTickFrequency();
+        t0_ = t;
+        return ms;
+    }
+private:
+    int64 t0_;
+};
+
+// Pasos 1 a 3 del conteo: preprocesamiento y detección de círculos según
+// las opciones. Llena pre, circles (sin ordenar), usedContours, las
+// estadísticas y los tiempos de esas etapas. Si Hough encuentra menos de
+// contourFallbackBelow círculos también se buscan contornos
+inline void detectCoins(const cv::Mat& img, const CoinOptions& options, CoinCountResult& result,
+                        PerfStageRecorder* perf_recorder = nullptr, int contourFallbackBelow = 10) {
+    using std::cout;
+    using std::endl;
+    CoinStageTimer timer;
+
+    std::vector<cv::Vec3f>& circles = result.circles;
+    if (options.pyramid) {
+        // PASOS 1 A 3 EN DOS ESCALAS (coin_pyramid.hpp)
+
+        // Preprocesamiento y detección a 1/4 de resolución; cada candidato se
+        // refina en un recorte a resolución completa. result.pre queda con
+        // las imágenes de la etapa gruesa
+        circles = detectCoinsCoarseToFine(img, options.preprocess, options.circleParams, options.pyramidParams,
+                                          result.pre, options.keepIntermediates, &result.pyramidStats,
+                                          perf_recorder);
+        timer.lap();
+        const CoinPyramidStats& st = result.pyramidStats;
+        result.times.preprocessMs = st.coarsePreprocessMs;
+        result.times.componentsMs = st.coarseDetectMs;
+        result.times.refineMs = st.refineMs;
+        if (options.verbose) {
+            cout << "Etapa gruesa: " << st.candidates << " candidatos; refinados " << st.refined
+                 << ", sin refinar " << st.kept << " (recortes: " << cvRound(100 * st.roiFraction)
+                 << "% de la imagen)" << endl;
+            cout << "Se detectaron " << circles.size() << " círculos" << endl;
+        }
+    } else {
+        // PASO 1 Y 2: PREPROCESAMIENTO Y UMBRAL DE 50 (coin_preprocess.hpp)
+
+        // Gris, filtro bilateral, corrección gamma para mejorar el contraste en
+        // áreas oscuras, umbral de 50 para eliminar el ruido del fondo, mediana
+        // para el ruido residual tipo sal y pimienta, erosión para eliminar
+        // pequeños puntos blancos y dos dilataciones para recuperar el tamaño y
+        // rellenar huecos. Por defecto en bandas fusionadas y en paralelo
+        if (options.fused) {
+            preprocessCoinsFused(img, options.preprocess, result.pre, options.keepIntermediates, perf_recorder);
+        } else {
+            preprocessCoinsReference(img, options.preprocess, result.pre, perf_recorder);
+        }
+        const cv::Mat& dilated = result.pre.dilated;
+        result.times.preprocessMs = timer.lap();
+
+        // PASO 3: DETECCIÓN DE CÍRCULOS
+
+        if (options.components) {
+            // Componentes conexas de la máscara; Hough solo separa las monedas
+            // que se tocan (coin_components.hpp)
+            circles = findCoinCircles(dilated, options.circleParams, &result.componentStats, perf_recorder);
+            timer.lap();
+            result.times.componentsMs = result.componentStats.labelMs;
+            result.times.houghMs = result.componentStats.houghMs;
+            if (options.verbose) {
+                const CoinCircleStats& st = result.componentStats;
+                cout << "Se encontraron " << st.components << " componentes: " << st.single << " monedas sueltas, "
+                     << st.touching << " grupos separados con Hough en " << st.splitCircles << " círculos" << endl;
+                cout << "Se detectaron " << circles.size() << " círculos" << endl;
+            }
+        } else {
+            // Aplicar transformada de Hough sobre la imagen binaria procesada
+            PerfScope perf_hough(perf_recorder, "hough");
+            cv::HoughCircles(dilated, circles, cv::HOUGH_GRADIENT, 1, 40, 100, 15, 50, 120);
+            perf_hough.stop();
+            result.times.houghMs = timer.lap();
+
+            if (options.verbose) {
+                cout << "Se detectaron " << circles.size() << " círculos" << endl;
+            }
+
+            // Si no se detectaron suficientes círculos, intentar con otro enfoque
+            if ((int)circles.size() < contourFallbackBelow) {
+                result.usedContours = true;
+                if (options.verbose) {
+                    cout << "Intentando detección alternativa..." << endl;
+                }
+
+                // Buscar contornos en la imagen binaria
+                PerfScope perf_contours(perf_recorder, "contours");
+                std::vector<std::vector<cv::Point>> contours;
+                cv::findContours(dilated, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+
+                if (options.verbose) {
+                    cout << "Se encontraron " << contours.size() << " contornos" << endl;
+                }
+
+                // Procesar cada contorno para encontrar círculos
+                for (const auto& contour : contours) {
+                    // Filtrar contornos muy pequeños
+                    double area = cv::contourArea(contour);
+                    if (area < 1000) continue;
+
+                    // Encontrar círculo mínimo que encierra el contorno
+                    cv::Point2f center;
+                    float radius;
+                    cv::minEnclosingCircle(contour, center, radius);
+
+                    // Verificar si es lo suficientemente circular
+                    double circle_area = M_PI * radius * radius;
+                    double circularity = area / circle_area;
+
+                    if (circularity > 0.6) {
+                        circles.push_back(cv::Vec3f(center.x, center.y, radius));
+                    }
+                }
+                perf_contours.stop();
+
+                if (options.verbose) {
+                    cout << "Después de buscar por contornos: " << circles.size() << " círculos" << endl;
+                }
+                result.times.contoursMs = timer.lap();
+            }
+        }
+    }
+}
+
+inline CoinCountResult countCoins(const cv::Mat& img, const std::vector<CoinInfo>& coin_types,
+                                  const CoinOptions& options, PerfStageRecorder* perf_recorder = nullptr) {
+    using std::cout;
+    using std::endl;
+    CoinCountResult result;
+    int64 start = cv::getTickCount();
+
+    detectCoins(img, options, result, perf_recorder);
+    CoinStageTimer timer;
+    std::vector<cv::Vec3f>& circles = result.circles;
+
+    // PASO 4: CALIBRACIÓN Y CLASIFICACIÓN
+
+    PerfScope perf_calibrate(perf_recorder, "calibrate");
+    double& px_per_mm = result.pxPerMm;
+
+    if (!circles.empty()) {
+        // Ordenar círculos por radio
+        std::sort(circles.begin(), circles.end(),
+                  [](const cv::Vec3f& a, const cv::Vec3f& b) {
+                      return a[2] < b[2];
+                  });
+
+        // Usar los radios extremos para calibración
+        double min_diameter = 2 * circles.front()[2];
+        double max_diameter = 2 * circles.back()[2];
+
+        // La moneda más pequeña es 1 Kč (20mm) y la más grande 20 Kč (26mm)
+        double min_scale = min_diameter / 20.0;
+        double max_scale = max_diameter / 26.0;
+
+        // Promedio ponderado
+        px_per_mm = (min_scale + max_scale) / 2.0;
+
+        if (options.verbose) {
+            cout << "Calibración: " << px_per_mm << " píxeles por mm" << endl;
+            cout << "Diámetro mínimo: " << min_diameter << " px (" << min_diameter/px_per_mm << " mm)" << endl;
+            cout << "Diámetro máximo: " << max_diameter << " px (" << max_diameter/px_per_mm << " mm)" << endl;
+
+            // Imprime información detallada sobre todos los diámetros detectados
+            cout << "\nDiámetros detectados (mm):" << endl;
+            for (const auto& circle : circles) {
+                double diameter_mm = 2 * circle[2] / px_per_mm;
+                cout << diameter_mm << " ";
+            }
+            cout << endl;
+        }
+    }
+    perf_calibrate.stop();
+
+    PerfScope perf_classify(perf_recorder, "classify");
+    for (size_t i = 0; i < circles.size(); i++) {
+        int radius = cvRound(circles[i][2]);
+
+        // Calcular diámetro en mm y clasificar según el diámetro
+        double diameter_mm = 2 * radius / px_per_mm;
+        int value = classifyCoin(diameter_mm, coin_types);
+
+        // Actualizar conteo y total
+        result.values.push_back(value);
+        result.counts[value]++;
+        result.totalValue += value;
+    }
+    perf_classify.stop();
+    result.times.classifyMs = timer.lap();
+    result.times.totalMs = (cv::getTickCount() - start) * 1000.0 / cv::getTickFrequency();
+    return result;
+}
+
+#endif // COIN_COUNTER_HPP
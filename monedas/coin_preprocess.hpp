@@ -0,0 +1,306 @@
+#ifndef COIN_PREPROCESS_HPP
+#define COIN_PREPROCESS_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+
+#include "opencv2/core.hpp"
+#include "opencv2/imgproc.hpp"
+
+#include "perf_counters.hpp"
+#include "trace.hpp"
+#include "bilateral_grid.hpp"
+#include "binary_morphology.hpp"
+
+// Preprocesamiento de la imagen de monedas antes de Hough:
+//   gris -> bilateral -> gamma -> umbral -> mediana -> erosión -> dilatación x2
+//
+// preprocessCoinsReference ejecuta las siete pasadas sobre la imagen completa,
+// con una Mat intermedia de tamaño completo por paso (el camino original).
+//
+// preprocessCoinsFused recorre la imagen por bandas de filas del tamaño de la
+// caché y ejecuta toda la cadena sobre cada banda antes de pasar a la
+// siguiente; las bandas se reparten entre hilos con parallel_for_:
+//   - la conversión a gris se hace sobre las filas de la banda (más el halo),
+//   - gamma y umbral se componen en una sola tabla binaria: como la gamma es
+//     monótona, gamma(v) > 50 equivale a v > t, y la tabla da 0/255 directo
+//     desde la salida del bilateral (la imagen gamma solo se genera si se
+//     piden los intermedios),
+//   - mediana, erosión y dilataciones trabajan sobre buffers de la banda.
+// Cada banda se extiende con un halo igual a la suma de los radios de los
+// filtros que vienen después (4 del bilateral exacto + 2 + 2 + 2 x 2 de la
+// morfología = 12 filas). Los bordes internos de los buffers dan filas
+// incorrectas, pero quedan dentro del halo y se descartan, así que el
+// resultado es idéntico bit a bit al de referencia; en los bordes de la
+// imagen el buffer empieza donde empieza la imagen y el tratamiento de bordes
+// de OpenCV coincide.
+//
+// Sin intermedios la memoria de trabajo es la salida final más unos pocos
+// buffers de banda por hilo en vez de siete imágenes completas.
+//
+// Con bilateralGrid el bilateral exacto se reemplaza por la aproximación de
+// bilateral_grid.hpp (costo independiente del diámetro). El halo usa el
+// soporte de la grilla y la grilla se alinea con las filas globales, así que
+// los dos caminos siguen dando lo mismo entre sí.
+//
+// Con bitMorphology mediana, erosión y dilataciones corren sobre la imagen
+// binaria empaquetada a un bit por píxel (binary_morphology.hpp): 64 píxeles
+// por operación y el mismo resultado que medianBlur / erode / dilate.
+
+struct CoinPreprocessParams {
+    int bilateralDiameter = 9;
+    double bilateralSigmaColor = 75;
+    double bilateralSigmaSpace = 75;
+    double gamma = 2.0;              // > 1 aclara áreas oscuras
+    int threshold = 50;              // Umbral sobre la imagen con gamma
+    int medianSize = 5;
+    int morphSize = 5;               // Elipse de erosión y dilatación
+    int dilateIterations = 2;
+    int tileRows = 0;                // Filas por banda; 0 = según el ancho (~256 KB por buffer)
+    bool bilateralGrid = false;      // Bilateral aproximado (bilateral_grid.hpp)
+    bool bitMorphology = false;      // Mediana y morfología sobre bits (binary_morphology.hpp)
+};
+
+// Imágenes de salida. dilated siempre; el resto solo con intermedios
+struct CoinPreprocessResult {
+    cv::Mat gamma;       // Bilateral con corrección gamma
+    cv::Mat binary;      // Umbral
+    cv::Mat median;      // Mediana sobre el umbral
+    cv::Mat eroded;
+    cv::Mat dilated;     // Entrada de Hough y de la búsqueda de contornos
+};
+
+// Tabla de la corrección gamma (misma fórmula que el programa original)
+inline cv::Mat coinGammaLut(double gamma) {
+    cv::Mat lut(1, 256, CV_8U);
+    for (int i = 0; i < 256; i++) {
+        lut.at<uchar>(0, i) = cv::saturate_cast<uchar>(std::pow(i / 255.0, gamma) * 255.0);
+    }
+    return lut;
+}
+
+// Gamma y umbral compuestos: 255 donde gamma(v) > threshold
+inline cv::Mat coinBinaryLut(const CoinPreprocessParams& params) {
+    cv::Mat gammaLut = coinGammaLut(params.gamma);
+    cv::Mat lut(1, 256, CV_8U);
+    for (int i = 0; i < 256; i++) {
+        lut.at<uchar>(0, i) = gammaLut.at<uchar>(0, i) > params.threshold ? 255 : 0;
+    }
+    return lut;
+}
+
+inline BilateralGrid coinBilateralGrid(const CoinPreprocessParams& params) {
+    return BilateralGrid(bilateralGridSigmaSpace(params.bilateralDiameter, params.bilateralSigmaSpace),
+                         params.bilateralSigmaColor);
+}
+
+inline int coinBilateralRadius(const CoinPreprocessParams& params) {
+    if (params.bilateralGrid) {
+        return coinBilateralGrid(params).supportRows();
+    }
+    // Mismo radio que bilateralFilter
+    return params.bilateralDiameter <= 0 ? cvRound(params.bilateralSigmaSpace * 1.5)
+                                         : params.bilateralDiameter / 2;
+}
+
+// Filas de halo que necesita la cadena binaria (mediana + morfología)
+inline int coinMorphologyHalo(const CoinPreprocessParams& params) {
+    return params.medianSize / 2 + params.morphSize / 2 * (1 + params.dilateIterations);
+}
+
+inline int coinTileRows(const cv::Size& size, const CoinPreprocessParams& params) {
+    if (params.tileRows > 0) {
+        return params.tileRows;
+    }
+    const int targetBytes = 256 * 1024;
+    int rows = std::max(32, targetBytes / std::max(size.width, 1));
+    // Al menos dos bandas por hilo para repartir la carga
+    int perThread = (size.height + 2 * cv::getNumThreads() - 1) / (2 * cv::getNumThreads());
+    return std::max(16, std::min(rows, perThread));
+}
+
+// Bytes de los buffers de una banda (por hilo activo)
+inline size_t coinTileBytes(const cv::Size& size, const CoinPreprocessParams& params) {
+    int rows = coinTileRows(size, params);
+    int morphHalo = coinMorphologyHalo(params);
+    size_t grayRows = rows + 2 * (morphHalo + coinBilateralRadius(params));
+    size_t binaryRows = rows + 2 * morphHalo;
+    // gris + bilateral, y umbral + mediana + erosión + dilatación (dos buffers alternados)
+    return (size_t)size.width * (2 * grayRows + 4 * binaryRows);
+}
+
+// yOrigin: fila global de la primera fila de gray (alinea la grilla entre bandas)
+inline void coinBilateral(const cv::Mat& gray, cv::Mat& smooth, const CoinPreprocessParams& params, int yOrigin = 0) {
+    if (params.bilateralGrid) {
+        coinBilateralGrid(params).apply(gray, smooth, yOrigin);
+    } else {
+        cv::bilateralFilter(gray, smooth, params.bilateralDiameter,
+                            params.bilateralSigmaColor, params.bilateralSigmaSpace);
+    }
+}
+
+inline void coinToGray(const cv::Mat& src, cv::Mat& gray) {
+    if (src.channels() == 3) {
+        cv::cvtColor(src, gray, cv::COLOR_BGR2GRAY);
+    } else if (src.channels() == 4) {
+        cv::cvtColor(src, gray, cv::COLOR_BGRA2GRAY);
+    } else {
+        src.copyTo(gray);
+    }
+}
+
+// Camino original: una pasada por paso sobre la imagen completa
+inline void preprocessCoinsReference(const cv::Mat& img, const CoinPreprocessParams& params,
+                                     CoinPreprocessResult& result, PerfStageRecorder* perf_recorder = nullptr) {
+    PerfScope perf_preprocess(perf_recorder, "preprocess");
+    cv::Mat gray;
+    coinToGray(img, gray);
+
+    // Filtro bilateral para suavizar el ruido conservando los bordes
+    cv::Mat bilateral;
+    TraceZone bilateralZone("bilateral");
+    coinBilateral(gray, bilateral, params);
+    bilateralZone.end();
+
+    cv::LUT(bilateral, coinGammaLut(params.gamma), result.gamma);
+    perf_preprocess.stop();
+
+    PerfScope perf_threshold(perf_recorder, "threshold");
+    cv::threshold(result.gamma, result.binary, params.threshold, 255, cv::THRESH_BINARY);
+    perf_threshold.stop();
+
+    BinaryImage bits;
+    PerfScope perf_median(perf_recorder, "median");
+    if (params.bitMorphology) {
+        binaryPack(result.binary, bits);
+        binaryMedian(bits, bits, params.medianSize);
+        binaryUnpack(bits, result.median);
+    } else {
+        cv::medianBlur(result.binary, result.median, params.medianSize);
+    }
+    perf_median.stop();
+
+    PerfScope perf_morphology(perf_recorder, "morphology");
+    cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(params.morphSize, params.morphSize));
+    if (params.bitMorphology) {
+        binaryErode(bits, bits, kernel);
+        binaryUnpack(bits, result.eroded);
+        binaryDilate(bits, bits, kernel, params.dilateIterations);
+        binaryUnpack(bits, result.dilated);
+    } else {
+        cv::erode(result.median, result.eroded, kernel);
+        cv::dilate(result.eroded, result.dilated, kernel, cv::Point(-1, -1), params.dilateIterations);
+    }
+}
+
+// Máscara final (dilated) de una región de la imagen: se preprocesa la región
+// extendida con el halo de los filtros y el halo se descarta, así que con el
+// bilateral exacto coincide con la misma región de la máscara de la imagen
+// completa. processedPixels recibe el área realmente procesada
+inline cv::Mat preprocessCoinsRoi(const cv::Mat& img, const cv::Rect& roi, const CoinPreprocessParams& params,
+                                  double* processedPixels = nullptr) {
+    const int halo = coinBilateralRadius(params) + coinMorphologyHalo(params);
+    cv::Rect ext = cv::Rect(roi.x - halo, roi.y - halo, roi.width + 2 * halo, roi.height + 2 * halo) &
+                   cv::Rect(0, 0, img.cols, img.rows);
+    if (processedPixels) {
+        *processedPixels = ext.area();
+    }
+    CoinPreprocessResult pre;
+    preprocessCoinsReference(img(ext), params, pre);
+    return pre.dilated(cv::Rect(roi.x - ext.x, roi.y - ext.y, roi.width, roi.height));
+}
+
+// Cadena fusionada por bandas. Con keepIntermediates también llena gamma,
+// binary, median y eroded (para las imágenes de depuración y las ventanas)
+inline void preprocessCoinsFused(const cv::Mat& img, const CoinPreprocessParams& params,
+                                 CoinPreprocessResult& result, bool keepIntermediates,
+                                 PerfStageRecorder* perf_recorder = nullptr) {
+    CV_Assert(img.depth() == CV_8U);
+    PerfScope perf_preprocess(perf_recorder, "preprocess");
+    const int rows = img.rows;
+    const int tileRows = coinTileRows(img.size(), params);
+    const int numTiles = (rows + tileRows - 1) / tileRows;
+    const int morphHalo = coinMorphologyHalo(params);
+    const int grayHalo = morphHalo + coinBilateralRadius(params);
+
+    const cv::Mat gammaLut = coinGammaLut(params.gamma);
+    const cv::Mat binaryLut = coinBinaryLut(params);
+    const cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(params.morphSize, params.morphSize));
+
+    result.dilated.create(img.size(), CV_8U);
+    if (keepIntermediates) {
+        result.gamma.create(img.size(), CV_8U);
+        result.binary.create(img.size(), CV_8U);
+        result.median.create(img.size(), CV_8U);
+        result.eroded.create(img.size(), CV_8U);
+    } else {
+        result.gamma.release();
+        result.binary.release();
+        result.median.release();
+        result.eroded.release();
+    }
+
+    cv::parallel_for_(cv::Range(0, numTiles), [&](const cv::Range& range) {
+        // Buffers reutilizados por las bandas de este rango
+        cv::Mat gray, smooth, binary, median, morphA, morphB;
+        BinaryImage bits;
+        for (int t = range.start; t < range.end; t++) {
+            TraceZone tileZone("preprocess tile", "tile", t);
+            int y0 = t * tileRows;
+            int y1 = std::min(rows, y0 + tileRows);
+            // Filas con gris y bilateral [ga, gb); filas de la cadena binaria [ba, bb)
+            int ga = std::max(0, y0 - grayHalo), gb = std::min(rows, y1 + grayHalo);
+            int ba = std::max(0, y0 - morphHalo), bb = std::min(rows, y1 + morphHalo);
+
+            coinToGray(img.rowRange(ga, gb), gray);
+            coinBilateral(gray, smooth, params, ga);
+
+            cv::LUT(smooth.rowRange(ba - ga, bb - ga), binaryLut, binary);
+            if (keepIntermediates) {
+                cv::Mat gammaRows = result.gamma.rowRange(y0, y1);
+                cv::LUT(smooth.rowRange(y0 - ga, y1 - ga), gammaLut, gammaRows);
+                binary.rowRange(y0 - ba, y1 - ba).copyTo(result.binary.rowRange(y0, y1));
+            }
+
+            if (params.bitMorphology) {
+                // La banda entera en bits; mediana y erosión se desempaquetan
+                // solo si se piden los intermedios
+                binaryPack(binary, bits);
+                binaryMedian(bits, bits, params.medianSize);
+                if (keepIntermediates) {
+                    binaryUnpack(bits, median);
+                    median.rowRange(y0 - ba, y1 - ba).copyTo(result.median.rowRange(y0, y1));
+                }
+                binaryErode(bits, bits, kernel);
+                if (keepIntermediates) {
+                    binaryUnpack(bits, morphA);
+                    morphA.rowRange(y0 - ba, y1 - ba).copyTo(result.eroded.rowRange(y0, y1));
+                }
+                binaryDilate(bits, bits, kernel, params.dilateIterations);
+                binaryUnpack(bits, morphA);
+                morphA.rowRange(y0 - ba, y1 - ba).copyTo(result.dilated.rowRange(y0, y1));
+                continue;
+            }
+
+            cv::medianBlur(binary, median, params.medianSize);
+            cv::erode(median, morphA, kernel);
+            if (keepIntermediates) {
+                median.rowRange(y0 - ba, y1 - ba).copyTo(result.median.rowRange(y0, y1));
+                morphA.rowRange(y0 - ba, y1 - ba).copyTo(result.eroded.rowRange(y0, y1));
+            }
+
+            // Dilataciones alternando entre los dos buffers de la banda
+            cv::Mat* dilated = &morphA;
+            for (int i = 0; i < params.dilateIterations; i++) {
+                cv::Mat* next = (dilated == &morphA) ? &morphB : &morphA;
+                cv::dilate(*dilated, *next, kernel);
+                dilated = next;
+            }
+            dilated->rowRange(y0 - ba, y1 - ba).copyTo(result.dilated.rowRange(y0, y1));
+        }
+    });
+}
+
+#endif // COIN_PREPROCESS_HPP
@@ -0,0 +1,177 @@
+#ifndef COIN_PYRAMID_HPP
+#define COIN_PYRAMID_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include "opencv2/core.hpp"
+#include "opencv2/imgproc.hpp"
+
+#include "perf_counters.hpp"
+#include "trace.hpp"
+#include "coin_preprocess.hpp"
+#include "coin_components.hpp"
+
+// Detección de monedas en dos escalas.
+//
+// Etapa gruesa: la imagen se reduce por factor (4 por defecto, 1/16 de los
+// píxeles) y se corre la cadena completa (preprocesamiento y detección por
+// componentes) con los tamaños de filtro y los radios divididos por el
+// factor. Los círculos que salen son solo candidatos.
+//
+// Etapa fina: por cada candidato se preprocesa a resolución completa un
+// recorte cuadrado de lado 2 (roiScale r + roiMargin) alrededor del círculo
+// (preprocessCoinsRoi: con el bilateral exacto la máscara del recorte es
+// idéntica a la de la imagen completa), así que el círculo refinado es el
+// mismo que daría --components sobre toda la imagen. En el recorte se busca
+// el círculo más cercano al centro del candidato; si no hay ninguno se
+// conserva el candidato escalado. Los recortes se procesan en paralelo.
+//
+// Sirve cuando las monedas ocupan una parte chica de la foto: el costo a
+// resolución completa es proporcional al área de los recortes
+// (CoinPyramidStats::roiFraction) en vez de al de la imagen.
+
+struct CoinPyramidParams {
+    int factor = 4;              // Reducción de la etapa gruesa
+    double roiScale = 1.3;       // Medio lado del recorte / radio del candidato
+    int roiMargin = 8;           // Píxeles extra del recorte a resolución completa
+};
+
+struct CoinPyramidStats {
+    int candidates = 0;          // Círculos de la etapa gruesa
+    int refined = 0;             // Confirmados en su recorte
+    int kept = 0;                // Sin círculo en el recorte: candidato escalado
+    int duplicates = 0;          // Dos candidatos que refinan a la misma moneda
+    double roiFraction = 0;      // Píxeles preprocesados a resolución completa / imagen
+    double coarsePreprocessMs = 0;
+    double coarseDetectMs = 0;
+    double refineMs = 0;
+    CoinCircleStats coarse;      // Detalle de la detección gruesa
+};
+
+// Tamaño impar >= 3 para un filtro escalado
+inline int coinScaledOddSize(int size, int factor) {
+    return std::max(3, (size / factor) | 1);
+}
+
+inline CoinPreprocessParams coinCoarseParams(const CoinPreprocessParams& params, int factor) {
+    CoinPreprocessParams coarse = params;
+    coarse.bilateralDiameter = coinScaledOddSize(params.bilateralDiameter, factor);
+    coarse.bilateralSigmaSpace = params.bilateralSigmaSpace / factor;
+    coarse.medianSize = coinScaledOddSize(params.medianSize, factor);
+    coarse.morphSize = coinScaledOddSize(params.morphSize, factor);
+    coarse.tileRows = 0;
+    return coarse;
+}
+
+inline CoinCircleParams coinCoarseCircleParams(const CoinCircleParams& params, int factor) {
+    CoinCircleParams coarse = params;
+    coarse.minArea = std::max(1, params.minArea / (factor * factor));
+    coarse.minRadius = std::max(1, params.minRadius / factor);
+    coarse.maxRadius = (params.maxRadius + factor - 1) / factor + 1;
+    coarse.roiMargin = std::max(2, params.roiMargin / factor);
+    coarse.houghMinDist = params.houghMinDist / factor;
+    // Los votos de un círculo son proporcionales a su perímetro
+    coarse.houghParam2 = std::max(4.0, params.houghParam2 / factor);
+    coarse.stripRows = 0;
+    return coarse;
+}
+
+// coarsePre recibe la máscara (y con keepIntermediates las intermedias) de la
+// etapa gruesa, a 1/factor de la resolución de img
+inline std::vector<cv::Vec3f> detectCoinsCoarseToFine(const cv::Mat& img, const CoinPreprocessParams& preprocess,
+                                                      const CoinCircleParams& circleParams,
+                                                      const CoinPyramidParams& params,
+                                                      CoinPreprocessResult& coarsePre, bool keepIntermediates,
+                                                      CoinPyramidStats* stats = nullptr,
+                                                      PerfStageRecorder* perf_recorder = nullptr) {
+    CoinPyramidStats local;
+    CoinPyramidStats& st = stats ? *stats : local;
+    st = CoinPyramidStats();
+    const int f = std::max(1, params.factor);
+    const double tick = 1000.0 / cv::getTickFrequency();
+
+    // Etapa gruesa
+    int64 t0 = cv::getTickCount();
+    cv::Mat small;
+    {
+        TraceZone zone("downscale");
+        cv::resize(img, small, cv::Size(), 1.0 / f, 1.0 / f, cv::INTER_AREA);
+    }
+    preprocessCoinsFused(small, coinCoarseParams(preprocess, f), coarsePre, keepIntermediates, perf_recorder);
+    int64 t1 = cv::getTickCount();
+    st.coarsePreprocessMs = (t1 - t0) * tick;
+
+    std::vector<cv::Vec3f> candidates =
+        findCoinCircles(coarsePre.dilated, coinCoarseCircleParams(circleParams, f), &st.coarse, perf_recorder);
+    st.candidates = (int)candidates.size();
+    int64 t2 = cv::getTickCount();
+    st.coarseDetectMs = (t2 - t1) * tick;
+
+    // Etapa fina: un recorte por candidato
+    PerfScope perf_refine(perf_recorder, "refine");
+    const cv::Rect bounds(0, 0, img.cols, img.rows);
+    std::vector<cv::Vec3f> refined(candidates.size());
+    std::vector<char> found(candidates.size(), 0);
+    std::vector<double> roiPixels(candidates.size(), 0);
+    cv::parallel_for_(cv::Range(0, (int)candidates.size()), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; i++) {
+            TraceZone zone("refine coin", "candidate", i);
+            // Centro de píxel de la imagen reducida -> imagen completa (INTER_AREA)
+            cv::Point2f center((candidates[i][0] + 0.5f) * f - 0.5f, (candidates[i][1] + 0.5f) * f - 0.5f);
+            double radius = candidates[i][2] * f;
+            refined[i] = cv::Vec3f(center.x, center.y, (float)radius);
+
+            int half = (int)std::ceil(radius * params.roiScale) + params.roiMargin;
+            cv::Rect core = cv::Rect(cvRound(center.x) - half, cvRound(center.y) - half, 2 * half + 1, 2 * half + 1) &
+                            bounds;
+            if (core.empty()) {
+                continue;
+            }
+            cv::Mat mask = preprocessCoinsRoi(img, core, preprocess, &roiPixels[i]);
+
+            std::vector<cv::Vec3f> circles = findCoinCircles(mask, circleParams);
+            double bestDist = radius / 2;
+            for (const cv::Vec3f& c : circles) {
+                double d = std::hypot(c[0] + core.x - center.x, c[1] + core.y - center.y);
+                if (d < bestDist) {
+                    bestDist = d;
+                    refined[i] = cv::Vec3f(c[0] + core.x, c[1] + core.y, c[2]);
+                    found[i] = 1;
+                }
+            }
+        }
+    });
+
+    // Dos candidatos pueden refinar a la misma moneda: se conserva el primero
+    std::vector<cv::Vec3f> circles;
+    double pixels = 0;
+    for (size_t i = 0; i < refined.size(); i++) {
+        pixels += roiPixels[i];
+        const cv::Vec3f& c = refined[i];
+        bool duplicate = false;
+        for (const cv::Vec3f& prev : circles) {
+            if (std::hypot(c[0] - prev[0], c[1] - prev[1]) < std::min(c[2], prev[2]) / 2) {
+                duplicate = true;
+                break;
+            }
+        }
+        if (duplicate) {
+            st.duplicates++;
+            continue;
+        }
+        circles.push_back(c);
+        if (found[i]) {
+            st.refined++;
+        } else {
+            st.kept++;
+        }
+    }
+    perf_refine.stop();
+    st.roiFraction = img.empty() ? 0 : pixels / img.total();
+    st.refineMs = (cv::getTickCount() - t2) * tick;
+    return circles;
+}
+
+#endif // COIN_PYRAMID_HPP
@@ -0,0 +1,296 @@
+#ifndef COIN_SCENE_HPP
+#define COIN_SCENE_HPP
+
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
+#include <cmath>
+
+#include "opencv2/core.hpp"
+#include "opencv2/imgproc.hpp"
+
+#include "coin_counter.hpp"
+
+// Escenas sintéticas de monedas con la respuesta conocida, para medir la
+// exactitud y la latencia del conteo sin depender de una sola foto.
+//
+// Cada escena es un fondo oscuro con iluminación en gradiente sobre el que se
+// dibujan monedas de las denominaciones de coinTypes, con el diámetro real
+// multiplicado por pxPerMm: disco con borde suavizado (antialias), relieve en
+// domo, reborde más claro, un brillo en la dirección de la luz y un grabado
+// más oscuro (el valor y líneas al azar). Las posiciones se eligen al azar
+// con una separación mínima entre bordes; con overlap > 0 se permite que las
+// monedas se solapen hasta esa fracción de la suma de los radios, y las que
+// se dibujan después quedan encima. Al final se suma ruido gaussiano y,
+// opcionalmente, un desenfoque.
+//
+// countCoins calibra con la moneda más chica (1 Kč) y la más grande (20 Kč)
+// de la foto; con includeExtremes cada escena tiene al menos una de cada
+// denominación extrema para que la calibración tenga sentido.
+//
+// Todo sale de un RNG con la semilla de los parámetros: la misma semilla da
+// la misma escena.
+
+struct CoinSceneParams {
+    int width = 1600;
+    int height = 1200;
+    int coins = 10;
+    double pxPerMm = 8.0;            // Radios de 80 a 104 px: dentro de los de Hough
+    double gapMm = 1.0;              // Separación mínima entre bordes sin solapamiento
+    double overlap = 0;              // Solapamiento máximo / suma de radios
+    bool includeExtremes = true;     // Al menos una moneda de 1 Kč y una de 20 Kč
+    double background = 45;          // Gris del fondo
+    double lightGradient = 0.3;      // Variación de la iluminación de un lado al otro
+    double noiseSigma = 6;           // Ruido gaussiano (niveles de gris)
+    double blurSigma = 0;            // Desenfoque gaussiano (px); 0 = sin desenfoque
+    unsigned seed = 1;
+};
+
+struct CoinSceneCoin {
+    cv::Vec3f circle;                // Centro y radio en píxeles
+    int value;
+    double diameter_mm;
+    double visible;                  // Fracción del disco que queda a la vista
+};
+
+struct CoinScene {
+    cv::Mat image;                   // BGR
+    std::vector<CoinSceneCoin> coins;
+    double pxPerMm = 0;
+    int requested = 0;               // Monedas pedidas (puede no haber lugar para todas)
+};
+
+// Color base de cada denominación: las chicas de acero niquelado, 10 Kč de
+// cobre y 20 Kč de latón
+inline cv::Vec3f coinSceneColor(int value) {
+    if (value == 10) {
+        return cv::Vec3f(95, 140, 215);
+    }
+    if (value >= 20) {
+        return cv::Vec3f(80, 175, 210);
+    }
+    return cv::Vec3f(200, 198, 192);
+}
+
+inline CoinScene generateCoinScene(const std::vector<CoinInfo>& coinTypes, const CoinSceneParams& params) {
+    CV_Assert(!coinTypes.empty() && params.width > 0 && params.height > 0);
+    CoinScene scene;
+    scene.pxPerMm = params.pxPerMm;
+    scene.requested = params.coins;
+    cv::RNG rng(params.seed);
+
+    // Denominaciones: primero las extremas (si se piden), después al azar
+    std::vector<int> types;
+    if (params.includeExtremes && params.coins >= 2) {
+        int smallest = 0, largest = 0;
+        for (size_t i = 0; i < coinTypes.size(); i++) {
+            if (coinTypes[i].diameter_mm < coinTypes[smallest].diameter_mm) smallest = (int)i;
+            if (coinTypes[i].diameter_mm > coinTypes[largest].diameter_mm) largest = (int)i;
+        }
+        types.push_back(largest);
+        types.push_back(smallest);
+    }
+    while ((int)types.size() < params.coins) {
+        types.push_back(rng.uniform(0, (int)coinTypes.size()));
+    }
+
+    // Posiciones: muestreo con rechazo; si una moneda no entra en 500
+    // intentos se descarta
+    const double gap = params.gapMm * params.pxPerMm;
+    const int margin = 4;
+    for (int type : types) {
+        const CoinInfo& info = coinTypes[type];
+        double r = info.diameter_mm / 2 * params.pxPerMm;
+        if (2 * (r + margin) > std::min(params.width, params.height)) {
+            continue;
+        }
+        for (int attempt = 0; attempt < 500; attempt++) {
+            double x = rng.uniform(r + margin, params.width - r - margin);
+            double y = rng.uniform(r + margin, params.height - r - margin);
+            bool fits = true;
+            for (const CoinSceneCoin& c : scene.coins) {
+                double minDist = (1 - params.overlap) * (r + c.circle[2]) + gap;
+                if (std::hypot(x - c.circle[0], y - c.circle[1]) < minDist) {
+                    fits = false;
+                    break;
+                }
+            }
+            if (fits) {
+                CoinSceneCoin coin = {cv::Vec3f((float)x, (float)y, (float)r), info.value, info.diameter_mm, 1.0};
+                scene.coins.push_back(coin);
+                break;
+            }
+        }
+    }
+
+    // Fondo con gradiente de iluminación en una dirección al azar
+    const double angle = rng.uniform(0.0, 2 * CV_PI);
+    const double lx = std::cos(angle), ly = std::sin(angle);
+    cv::Mat light(params.height, params.width, CV_32F);
+    for (int y = 0; y < params.height; y++) {
+        float* l = light.ptr<float>(y);
+        for (int x = 0; x < params.width; x++) {
+            double u = (x / (double)params.width - 0.5) * lx + (y / (double)params.height - 0.5) * ly;
+            l[x] = (float)(1 + params.lightGradient * u);
+        }
+    }
+    cv::Mat canvas(params.height, params.width, CV_32FC3);
+    const cv::Vec3f background((float)params.background * 1.04f, (float)params.background,
+                               (float)params.background * 0.97f);
+    for (int y = 0; y < params.height; y++) {
+        cv::Vec3f* p = canvas.ptr<cv::Vec3f>(y);
+        const float* l = light.ptr<float>(y);
+        for (int x = 0; x < params.width; x++) {
+            p[x] = background * l[x];
+        }
+    }
+
+    // Monedas, en orden: las de después tapan a las de antes. owner guarda la
+    // moneda visible de cada píxel para calcular la fracción a la vista
+    cv::Mat owner(params.height, params.width, CV_32S, cv::Scalar(-1));
+    for (size_t i = 0; i < scene.coins.size(); i++) {
+        const CoinSceneCoin& coin = scene.coins[i];
+        const float cx = coin.circle[0], cy = coin.circle[1], r = coin.circle[2];
+        cv::Rect box = cv::Rect((int)std::floor(cx - r - 1), (int)std::floor(cy - r - 1), (int)std::ceil(2 * r + 3),
+                                (int)std::ceil(2 * r + 3)) & cv::Rect(0, 0, params.width, params.height);
+
+        // Grabado en coordenadas del recorte: el valor, un anillo y trazos
+        cv::Mat engraving(box.size(), CV_8U, cv::Scalar(0));
+        cv::Point center(cvRound(cx) - box.x, cvRound(cy) - box.y);
+        cv::circle(engraving, center, cvRound(0.82 * r), cv::Scalar(255), std::max(1, cvRound(r / 30)));
+        double fontScale = r / 40.0;
+        int thickness = std::max(1, cvRound(r / 12));
+        std::string text = std::to_string(coin.value);
+        cv::putText(engraving, text, cv::Point(center.x - cvRound(r * 0.3 * text.size()), center.y + cvRound(r * 0.35)),
+                    cv::FONT_HERSHEY_SIMPLEX, fontScale, cv::Scalar(255), thickness);
+        for (int k = 0; k < 6; k++) {
+            double a0 = rng.uniform(0.0, 2 * CV_PI), a1 = a0 + rng.uniform(0.5, 2.0);
+            double d0 = rng.uniform(0.2, 0.7) * r, d1 = rng.uniform(0.2, 0.7) * r;
+            cv::line(engraving, cv::Point2f((float)(center.x + d0 * std::cos(a0)), (float)(center.y + d0 * std::sin(a0))),
+                     cv::Point2f((float)(center.x + d1 * std::cos(a1)), (float)(center.y + d1 * std::sin(a1))),
+                     cv::Scalar(255), std::max(1, cvRound(r / 40)));
+        }
+
+        const cv::Vec3f base = coinSceneColor(coin.value) * (float)rng.uniform(0.9, 1.05);
+        for (int y = box.y; y < box.y + box.height; y++) {
+            cv::Vec3f* p = canvas.ptr<cv::Vec3f>(y);
+            const float* l = light.ptr<float>(y);
+            const uchar* e = engraving.ptr<uchar>(y - box.y);
+            int* o = owner.ptr<int>(y);
+            for (int x = box.x; x < box.x + box.width; x++) {
+                float dx = x - cx, dy = y - cy;
+                float d = std::sqrt(dx * dx + dy * dy);
+                float coverage = std::min(1.f, std::max(0.f, r + 0.5f - d));
+                if (coverage <= 0) {
+                    continue;
+                }
+                float t = d / r;
+                // Domo, reborde y brillo del lado de la luz
+                float shade = 0.78f + 0.22f * (1 - t * t);
+                if (t > 0.92f) {
+                    shade *= 1.08f;
+                }
+                float facing = t > 0 ? (float)((dx * lx + dy * ly) / d) * t : 0;
+                shade += 0.12f * std::max(0.f, facing);
+                if (e[x - box.x]) {
+                    shade *= 0.8f;
+                }
+                cv::Vec3f color = base * (shade * l[x]);
+                p[x] = p[x] * (1 - coverage) + color * coverage;
+                if (coverage >= 0.5f) {
+                    o[x] = (int)i;
+                }
+            }
+        }
+    }
+
+    // Fracción visible de cada moneda
+    std::vector<int> visiblePixels(scene.coins.size(), 0);
+    for (int y = 0; y < params.height; y++) {
+        const int* o = owner.ptr<int>(y);
+        for (int x = 0; x < params.width; x++) {
+            if (o[x] >= 0) {
+                visiblePixels[o[x]]++;
+            }
+        }
+    }
+    for (size_t i = 0; i < scene.coins.size(); i++) {
+        double r = scene.coins[i].circle[2];
+        scene.coins[i].visible = std::min(1.0, visiblePixels[i] / (CV_PI * r * r));
+    }
+
+    if (params.blurSigma > 0) {
+        cv::GaussianBlur(canvas, canvas, cv::Size(), params.blurSigma);
+    }
+    if (params.noiseSigma > 0) {
+        for (int y = 0; y < params.height; y++) {
+            cv::Vec3f* p = canvas.ptr<cv::Vec3f>(y);
+            for (int x = 0; x < params.width; x++) {
+                // El mismo ruido de luminancia en los tres canales más un
+                // poco de ruido de color
+                float n = (float)rng.gaussian(params.noiseSigma);
+                for (int c = 0; c < 3; c++) {
+                    p[x][c] += n + (float)rng.gaussian(params.noiseSigma / 3);
+                }
+            }
+        }
+    }
+    canvas.convertTo(scene.image, CV_8UC3);
+    return scene;
+}
+
+// Resultado de comparar una detección con la respuesta de la escena
+struct CoinSceneScore {
+    int truth = 0;                   // Monedas de la escena
+    int detected = 0;                // Círculos detectados
+    int matched = 0;                 // Detección con centro a menos de medio radio
+    int correctValue = 0;            // Emparejadas con el valor correcto
+    int truthValue = 0;              // Total de la escena
+    int detectedValue = 0;
+    bool exactCounts = false;        // Misma cantidad de cada denominación
+    double maxDiameterErrorMm = 0;   // Con la calibración de la escena
+
+    double precision() const { return detected ? matched / (double)detected : 1.0; }
+    double recall() const { return truth ? matched / (double)truth : 1.0; }
+};
+
+inline CoinSceneScore scoreCoinScene(const CoinScene& scene, const CoinCountResult& result) {
+    CoinSceneScore score;
+    score.truth = (int)scene.coins.size();
+    score.detected = (int)result.circles.size();
+    score.detectedValue = result.totalValue;
+    std::map<int, int> truthCounts;
+    for (const CoinSceneCoin& c : scene.coins) {
+        score.truthValue += c.value;
+        truthCounts[c.value]++;
+    }
+    score.exactCounts = truthCounts == result.counts;
+
+    // Cada moneda con la detección libre más cercana
+    std::vector<bool> used(result.circles.size(), false);
+    for (const CoinSceneCoin& c : scene.coins) {
+        int best = -1;
+        double bestDist = c.circle[2] / 2;
+        for (size_t j = 0; j < result.circles.size(); j++) {
+            double d = std::hypot(c.circle[0] - result.circles[j][0], c.circle[1] - result.circles[j][1]);
+            if (!used[j] && d < bestDist) {
+                best = (int)j;
+                bestDist = d;
+            }
+        }
+        if (best < 0) {
+            continue;
+        }
+        used[best] = true;
+        score.matched++;
+        if (result.values[best] == c.value) {
+            score.correctValue++;
+        }
+        double error = 2 * std::fabs(result.circles[best][2] - c.circle[2]) / scene.pxPerMm;
+        score.maxDiameterErrorMm = std::max(score.maxDiameterErrorMm, error);
+    }
+    return score;
+}
+
+#endif // COIN_SCENE_HPP
@@ -0,0 +1,346 @@
+#ifndef COIN_VIDEO_HPP
+#define COIN_VIDEO_HPP
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "opencv2/core.hpp"
+#include "opencv2/imgproc.hpp"
+
+#include "perf_counters.hpp"
+#include "trace.hpp"
+#include "connected_components.hpp"
+#include "coin_counter.hpp"
+
+// Conteo incremental de monedas sobre video (cámara fija sobre una bandeja).
+//
+// El primer cuadro (y cada refreshInterval cuadros, si se pide) pasa por el
+// conteo completo de countCoins, que además fija la calibración px/mm; hasta
+// que haya monedas calibradas, también cualquier cuadro con cambios. En los
+// demás cuadros solo se calcula una máscara de cambios barata: diferencia
+// absoluta contra una imagen de referencia reducida por changeFactor, con
+// umbral. Las regiones que cambiaron (componentes conexas de la máscara) se
+// agrandan en el radio máximo de una moneda, se unen si se solapan y se
+// vuelven a detectar solo ahí, a resolución completa y en paralelo, con el
+// mismo detector y opciones que el conteo completo (detectCoins sobre el
+// recorte). Las monedas con centro fuera de las regiones se conservan tal
+// cual. La búsqueda por contornos, que countCoins agrega cuando Hough
+// encuentra menos de 10 círculos en toda la imagen, se usa en las regiones
+// solo si el último conteo completo la usó: un recorte casi nunca tiene 10.
+//
+// Las monedas se siguen entre cuadros: una detección nueva que cae a menos de
+// medio radio de una moneda anterior hereda su id. Todas se clasifican con la
+// calibración del último conteo completo, así que el total no cambia por un
+// cuadro con pocas monedas. La referencia se actualiza solo en las regiones
+// redetectadas: un movimiento lento termina superando el umbral en vez de
+// perderse cuadro a cuadro.
+//
+// Del resumen de cada cuadro se guardan solo los últimos historySize (para
+// los percentiles de latencia); los totales y máximos de toda la corrida se
+// acumulan en CoinVideoStats, así que la memoria no crece con el video.
+
+struct CoinVideoParams {
+    int changeFactor = 4;        // Reducción de la imagen de diferencias
+    int diffThreshold = 25;      // |gris - referencia| que cuenta como cambio
+    int minChangedPixels = 4;    // Píxeles (reducidos) mínimos de una región
+    int refreshInterval = 0;     // Conteo completo cada N cuadros (0 = solo el primero)
+    int historySize = 1000;      // Resúmenes de cuadros recientes que se guardan
+};
+
+struct CoinTrack {
+    int id;
+    cv::Vec3f circle;
+    int value;
+    int firstFrame;              // Cuadro en que apareció
+    int lastDetected;            // Último cuadro en que se volvió a detectar
+};
+
+// Resumen de un cuadro
+struct CoinVideoFrame {
+    int index = 0;
+    bool fullDetection = false;
+    int regions = 0;             // Regiones redetectadas
+    double changedFraction = 0;  // Píxeles reducidos que cambiaron
+    double roiFraction = 0;      // Píxeles preprocesados / imagen
+    int coins = 0;
+    int totalValue = 0;
+    double diffMs = 0;           // Máscara de cambios y regiones
+    double detectMs = 0;         // Conteo completo o redetección
+    double latencyMs = 0;
+};
+
+// Suma y máximo de una latencia sobre toda la corrida
+struct CoinVideoTiming {
+    double sumMs = 0;
+    double maxMs = 0;
+
+    void add(double ms) {
+        sumMs += ms;
+        maxMs = std::max(maxMs, ms);
+    }
+};
+
+// Totales de todos los cuadros procesados
+struct CoinVideoStats {
+    int frames = 0;
+    int fullDetections = 0;
+    int idleFrames = 0;          // Sin conteo completo ni regiones
+    double roiFraction = 0;      // Suma de roiFraction
+    CoinVideoTiming diff;
+    CoinVideoTiming detect;
+    CoinVideoTiming latency;
+};
+
+class CoinVideoCounter {
+public:
+    CoinVideoCounter(const std::vector<CoinInfo>& coinTypes, const CoinOptions& options,
+                     const CoinVideoParams& params = CoinVideoParams())
+        : coinTypes_(coinTypes), options_(options), params_(params), frames_(0), nextId_(1), pxPerMm_(0),
+          usedContours_(false) {
+        options_.verbose = false;
+        options_.keepIntermediates = false;
+    }
+
+    const CoinVideoFrame& process(const cv::Mat& frame, PerfStageRecorder* perf_recorder = nullptr) {
+        TraceZone zone("video frame", "frame", frames_);
+        int64 t0 = cv::getTickCount();
+        CoinVideoFrame info;
+        info.index = frames_;
+
+        PerfScope perf_diff(perf_recorder, "change mask");
+        cv::Mat gray, small;
+        coinToGray(frame, gray);
+        const int f = std::max(1, params_.changeFactor);
+        cv::resize(gray, small, cv::Size((gray.cols + f - 1) / f, (gray.rows + f - 1) / f), 0, 0, cv::INTER_AREA);
+        bool full = reference_.empty() || reference_.size() != small.size() ||
+                    (params_.refreshInterval > 0 && frames_ % params_.refreshInterval == 0);
+        std::vector<cv::Rect> regions;
+        std::vector<cv::Rect> smallRegions;
+        if (!full) {
+            changedRegions(small, frame.size(), regions, smallRegions, info.changedFraction);
+            // Sin calibración (bandeja vacía hasta ahora) cualquier cambio
+            // pasa por el conteo completo
+            full = pxPerMm_ <= 0 && !regions.empty();
+        }
+        perf_diff.stop();
+        int64 t1 = cv::getTickCount();
+        info.diffMs = (t1 - t0) * 1000.0 / cv::getTickFrequency();
+
+        if (full) {
+            fullDetection(frame, perf_recorder);
+            small.copyTo(reference_);
+            info.fullDetection = true;
+            info.roiFraction = 1;
+        } else if (!regions.empty()) {
+            PerfScope perf_redetect(perf_recorder, "redetect");
+            info.roiFraction = redetect(frame, regions);
+            for (const cv::Rect& r : smallRegions) {
+                small(r).copyTo(reference_(r));
+            }
+        }
+        info.regions = (int)regions.size();
+        int64 t2 = cv::getTickCount();
+        info.detectMs = (t2 - t1) * 1000.0 / cv::getTickFrequency();
+
+        info.coins = (int)tracks_.size();
+        info.totalValue = totalValue();
+        info.latencyMs = (t2 - t0) * 1000.0 / cv::getTickFrequency();
+        stats_.frames++;
+        stats_.fullDetections += info.fullDetection;
+        stats_.idleFrames += !info.fullDetection && info.regions == 0;
+        stats_.roiFraction += info.roiFraction;
+        stats_.diff.add(info.diffMs);
+        stats_.detect.add(info.detectMs);
+        stats_.latency.add(info.latencyMs);
+        history_.push_back(info);
+        while ((int)history_.size() > std::max(1, params_.historySize)) {
+            history_.pop_front();
+        }
+        frames_++;
+        return history_.back();
+    }
+
+    const std::vector<CoinTrack>& tracks() const { return tracks_; }
+    // Últimos historySize cuadros, del más viejo al más reciente
+    const std::deque<CoinVideoFrame>& history() const { return history_; }
+    const CoinVideoStats& stats() const { return stats_; }
+    double pxPerMm() const { return pxPerMm_; }
+
+    int totalValue() const {
+        int total = 0;
+        for (const CoinTrack& t : tracks_) {
+            total += t.value;
+        }
+        return total;
+    }
+
+    std::map<int, int> counts() const {
+        std::map<int, int> result;
+        for (const CoinTrack& t : tracks_) {
+            result[t.value]++;
+        }
+        return result;
+    }
+
+private:
+    void fullDetection(const cv::Mat& frame, PerfStageRecorder* perf_recorder) {
+        TraceZone zone("full detection");
+        CoinCountResult result = countCoins(frame, coinTypes_, options_, perf_recorder);
+        // Con menos de dos monedas la calibración por diámetros extremos no
+        // tiene sentido: se conserva la anterior
+        if (result.circles.size() >= 2 || pxPerMm_ <= 0) {
+            pxPerMm_ = result.circles.empty() ? 0 : result.pxPerMm;
+        }
+        usedContours_ = result.usedContours;
+        std::vector<CoinTrack> previous;
+        previous.swap(tracks_);
+        assign(result.circles, previous);
+    }
+
+    // Regiones de cambio a resolución completa (ya agrandadas y unidas) y su
+    // rectángulo en la imagen reducida
+    void changedRegions(const cv::Mat& small, const cv::Size& size, std::vector<cv::Rect>& regions,
+                        std::vector<cv::Rect>& smallRegions, double& changedFraction) const {
+        cv::Mat diff, mask;
+        cv::absdiff(small, reference_, diff);
+        cv::threshold(diff, mask, params_.diffThreshold, 255, cv::THRESH_BINARY);
+        std::vector<ComponentStats> components;
+        StripConnectedComponents().run(mask, components);
+
+        const int f = std::max(1, params_.changeFactor);
+        // Una moneda que toca el cambio tiene el centro a menos de maxRadius
+        const int grow = options_.circleParams.maxRadius;
+        const cv::Rect bounds(0, 0, size.width, size.height);
+        int64_t changed = 0;
+        for (const ComponentStats& c : components) {
+            changed += c.area;
+            if (c.area < params_.minChangedPixels) {
+                continue;
+            }
+            cv::Rect box = c.bbox();
+            cv::Rect r(box.x * f - grow, box.y * f - grow, box.width * f + 2 * grow, box.height * f + 2 * grow);
+            regions.push_back(r & bounds);
+        }
+        changedFraction = small.empty() ? 0 : changed / (double)small.total();
+
+        // Unir regiones que se solapan hasta que no quede ninguna
+        bool merged = true;
+        while (merged) {
+            merged = false;
+            for (size_t i = 0; i < regions.size() && !merged; i++) {
+                for (size_t j = i + 1; j < regions.size(); j++) {
+                    if (!(regions[i] & regions[j]).empty()) {
+                        regions[i] = regions[i] | regions[j];
+                        regions.erase(regions.begin() + j);
+                        merged = true;
+                        break;
+                    }
+                }
+            }
+        }
+        const cv::Rect smallBounds(0, 0, small.cols, small.rows);
+        for (const cv::Rect& r : regions) {
+            cv::Rect s(r.x / f, r.y / f, (r.x + r.width + f - 1) / f - r.x / f, (r.y + r.height + f - 1) / f - r.y / f);
+            smallRegions.push_back(s & smallBounds);
+        }
+    }
+
+    // Vuelve a detectar las monedas con centro dentro de cada región.
+    // Devuelve la fracción de la imagen preprocesada
+    double redetect(const cv::Mat& frame, const std::vector<cv::Rect>& regions) {
+        const CoinCircleParams& circleParams = options_.circleParams;
+        const int grow = circleParams.maxRadius + circleParams.roiMargin;
+        // Halo de los filtros del preprocesamiento alrededor del recorte
+        const int halo = coinBilateralRadius(options_.preprocess) + coinMorphologyHalo(options_.preprocess);
+        const int contourFallbackBelow = usedContours_ ? std::numeric_limits<int>::max() : 0;
+        const cv::Rect bounds(0, 0, frame.cols, frame.rows);
+        std::vector<std::vector<cv::Vec3f> > found(regions.size());
+        std::vector<double> pixels(regions.size(), 0);
+        cv::parallel_for_(cv::Range(0, (int)regions.size()), [&](const cv::Range& range) {
+            for (int i = range.start; i < range.end; i++) {
+                TraceZone zone("redetect region", "region", i);
+                const cv::Rect& core = regions[i];
+                // El recorte contiene entera cualquier moneda con centro en core
+                cv::Rect crop = cv::Rect(core.x - grow - halo, core.y - grow - halo, core.width + 2 * (grow + halo),
+                                         core.height + 2 * (grow + halo)) & bounds;
+                pixels[i] = crop.area();
+                CoinCountResult result;
+                detectCoins(frame(crop), options_, result, nullptr, contourFallbackBelow);
+                for (const cv::Vec3f& c : result.circles) {
+                    cv::Vec3f g(c[0] + crop.x, c[1] + crop.y, c[2]);
+                    if (core.contains(cv::Point(cvRound(g[0]), cvRound(g[1])))) {
+                        found[i].push_back(g);
+                    }
+                }
+            }
+        });
+
+        // Las monedas dentro de las regiones se reemplazan por las detectadas
+        std::vector<CoinTrack> kept, previous;
+        for (const CoinTrack& t : tracks_) {
+            cv::Point center(cvRound(t.circle[0]), cvRound(t.circle[1]));
+            bool inside = false;
+            for (const cv::Rect& r : regions) {
+                inside = inside || r.contains(center);
+            }
+            (inside ? previous : kept).push_back(t);
+        }
+        tracks_.swap(kept);
+        std::vector<cv::Vec3f> circles;
+        double total = 0;
+        for (size_t i = 0; i < regions.size(); i++) {
+            circles.insert(circles.end(), found[i].begin(), found[i].end());
+            total += pixels[i];
+        }
+        assign(circles, previous);
+        return frame.empty() ? 0 : total / frame.total();
+    }
+
+    // Agrega las detecciones a tracks_, heredando el id de la moneda anterior
+    // más cercana (a menos de medio radio)
+    void assign(const std::vector<cv::Vec3f>& circles, std::vector<CoinTrack>& previous) {
+        std::vector<bool> used(previous.size(), false);
+        for (const cv::Vec3f& c : circles) {
+            int best = -1;
+            double bestDist = c[2] / 2;
+            for (size_t j = 0; j < previous.size(); j++) {
+                double d = std::hypot(c[0] - previous[j].circle[0], c[1] - previous[j].circle[1]);
+                if (!used[j] && d < bestDist) {
+                    best = (int)j;
+                    bestDist = d;
+                }
+            }
+            CoinTrack track;
+            if (best >= 0) {
+                used[best] = true;
+                track = previous[best];
+            } else {
+                track.id = nextId_++;
+                track.firstFrame = frames_;
+            }
+            track.circle = c;
+            track.lastDetected = frames_;
+            // Misma clasificación que countCoins
+            track.value = pxPerMm_ > 0 ? classifyCoin(2 * cvRound(c[2]) / pxPerMm_, coinTypes_) : 0;
+            tracks_.push_back(track);
+        }
+    }
+
+    std::vector<CoinInfo> coinTypes_;
+    CoinOptions options_;
+    CoinVideoParams params_;
+    int frames_;
+    int nextId_;
+    double pxPerMm_;
+    bool usedContours_;                  // El último conteo completo buscó contornos
+    cv::Mat reference_;                  // Gris reducido de la última detección
+    std::vector<CoinTrack> tracks_;
+    std::deque<CoinVideoFrame> history_;
+    CoinVideoStats stats_;
+};
+
+#endif // COIN_VIDEO_HPP
@@ -1,205 +1,62 @@
 #include <opencv2/opencv.hpp>
 #include <iostream>
 #include <vector>
+#include <deque>
 #include <map>
 #include <cmath>
+#include <string>
+#include <fstream>
+#include <iomanip>
+#include <thread>
+#include <mutex>
+#include <algorithm>
+#include <memory>
+
+#include <sys/stat.h>
+
+#include "perf_counters.hpp"
+#include "trace.hpp"
+#include "image_source.hpp"
+#include "image_writer.hpp"
+#include "coin_counter.hpp"
+#include "coin_video.hpp"
 
 using namespace cv;
 using namespace std;
 
-// Estructura para almacenar información de las monedas
-struct CoinInfo {
-    int value;           // Valor de la moneda
-    double diameter_mm;  // Diámetro en mm
-    Scalar color;        // Color para visualización
-};
-
-// Función para clasificar una moneda según su diámetro en mm
-int classifyCoin(double diameter_mm, const vector<CoinInfo>& coin_types) {
-    // Encontrar la moneda más cercana basada en el diámetro
-    int best_value = 0;
-    double min_diff = INFINITY;
-
-    for (const auto& coin : coin_types) {
-        double diff = abs(diameter_mm - coin.diameter_mm);
-        if (diff < min_diff) {
-            min_diff = diff;
-            best_value = coin.value;
-        }
-    }
-
-    return best_value;
-}
-
-int main() {
-    // Definir tipos de monedas con sus valores y diámetros
-    vector<CoinInfo> coin_types = {
-        {1, 20.0, Scalar(200, 200, 200)},  // 1 Kč - diámetro 20mm
-        {2, 21.5, Scalar(200, 255, 200)},  // 2 Kč - diámetro 21.5mm
-        {5, 23.0, Scalar(200, 200, 255)},  // 5 Kč - diámetro 23mm
-        {10, 24.5, Scalar(100, 100, 255)}, // 10 Kč - diámetro 24.5mm
-        {20, 26.0, Scalar(255, 200, 100)}  // 20 Kč - diámetro 26mm
-    };
-
-    // Intentar diferentes rutas de acceso para la imagen
-    vector<string> possible_image_paths = {
-        "koruny_black.jpg",
-        "../koruny_black.jpg",
-        "../../koruny_black.jpg",
-        "Data/koruny_black.jpg",
-        "../Data/koruny_black.jpg",
-        "Image2.jpg",
-        "Data/Image2.jpg"
-    };
-
-    Mat img;
-    for (const auto& path : possible_image_paths) {
-        img = imread(path);
-        if (!img.empty()) {
-            cout << "Imagen cargada desde: " << path << endl;
-            break;
-        }
-    }
-
-    if (img.empty()) {
-        cout << "No se pudo abrir la imagen. Verifica la ruta." << endl;
-        return -1;
-    }
-
+// Cuenta las monedas de una imagen (coin_counter.hpp) y muestra y guarda la
+// visualización. Las imágenes intermedias y de resultado se guardan con el
+// prefijo indicado (vacío para una sola imagen).
+void processCoins(const Mat& img, const string& out_prefix, const vector<CoinInfo>& coin_types,
+                  const CoinOptions& options, PerfStageRecorder* perf_recorder) {
     // Crear copia para visualización
     Mat img_display = img.clone();
 
-    // PASO 1: PREPROCESAMIENTO
-
-    // Convertir a escala de grises
-    Mat gray;
-    cvtColor(img, gray, COLOR_BGR2GRAY);
-
-    // Aplicar filtro bilateral para suavizar el ruido conservando los bordes
-    Mat bilateral;
-    bilateralFilter(gray, bilateral, 9, 75, 75);
-
-    // Aplicar corrección gamma para mejorar contraste en áreas oscuras
-    Mat gamma_corrected;
-    double gamma = 2.0; // Valor gamma > 1 aclara áreas oscuras
-    Mat lookup_table(1, 256, CV_8U);
-    for (int i = 0; i < 256; i++)
-        lookup_table.at<uchar>(0, i) = saturate_cast<uchar>(pow(i / 255.0, gamma) * 255.0);
-    LUT(bilateral, lookup_table, gamma_corrected);
-
-    // Guardar imagen con corrección gamma para verificación
-    imwrite("gamma_corregida.jpg", gamma_corrected);
-
-    // PASO 2: APLICAR THRESHOLD DE 50 PARA ELIMINAR RUIDO DEL FONDO
-
-    // Aplicar umbralización con valor de 50 como solicitado
-    Mat binary;
-    threshold(gamma_corrected, binary, 50, 255, THRESH_BINARY);
-
-    // Guardar imagen binaria con threshold de 50
-    imwrite("threshold_50.jpg", binary);
-
-    // Aplicar filtro de mediana para eliminar cualquier ruido residual tipo sal y pimienta
-    Mat median_filtered;
-    medianBlur(binary, median_filtered, 5);
-
-    // Operaciones morfológicas para mejorar la segmentación
-    Mat kernel = getStructuringElement(MORPH_ELLIPSE, Size(5, 5));
-
-    // Erosión para eliminar pequeños puntos blancos (ruido)
-    Mat eroded;
-    erode(median_filtered, eroded, kernel);
-
-    // Dilatación para recuperar tamaño original y rellenar huecos
-    Mat dilated;
-    dilate(eroded, dilated, kernel, Point(-1,-1), 2); // Dilatar dos veces
-
-    // Guardar imágenes intermedias para verificación
-    imwrite("filtrada_mediana.jpg", median_filtered);
-    imwrite("erosionada.jpg", eroded);
-    imwrite("dilatada.jpg", dilated);
-
-    // PASO 3: DETECCIÓN DE CÍRCULOS
-
-    // Aplicar transformada de Hough sobre la imagen binaria procesada
-    vector<Vec3f> circles;
-    HoughCircles(dilated, circles, HOUGH_GRADIENT, 1, 40, 100, 15, 50, 120);
-
-    cout << "Se detectaron " << circles.size() << " círculos" << endl;
-
-    // Si no se detectaron suficientes círculos, intentar con otro enfoque
-    if (circles.size() < 10) {
-        cout << "Intentando detección alternativa..." << endl;
-
-        // Buscar contornos en la imagen binaria
-        vector<vector<Point>> contours;
-        findContours(dilated, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
-
-        cout << "Se encontraron " << contours.size() << " contornos" << endl;
-
-        // Procesar cada contorno para encontrar círculos
-        for (const auto& contour : contours) {
-            // Filtrar contornos muy pequeños
-            double area = contourArea(contour);
-            if (area < 1000) continue;
-
-            // Encontrar círculo mínimo que encierra el contorno
-            Point2f center;
-            float radius;
-            minEnclosingCircle(contour, center, radius);
-
-            // Verificar si es lo suficientemente circular
-            double circle_area = M_PI * radius * radius;
-            double circularity = area / circle_area;
-
-            if (circularity > 0.6) {
-                circles.push_back(Vec3f(center.x, center.y, radius));
-            }
-        }
-
-        cout << "Después de buscar por contornos: " << circles.size() << " círculos" << endl;
+    // PASOS 1 A 4: PREPROCESAMIENTO, CÍRCULOS, CALIBRACIÓN Y CLASIFICACIÓN
+    CoinCountResult result = countCoins(img, coin_types, options, perf_recorder);
+    const CoinPreprocessResult& pre = result.pre;
+    const Mat& gamma_corrected = pre.gamma;
+    const Mat& binary = pre.binary;
+    Mat dilated = pre.dilated;
+    if (dilated.size() != img.size()) {
+        // --pyramid: la máscara es la de la etapa gruesa
+        resize(pre.dilated, dilated, img.size(), 0, 0, INTER_NEAREST);
     }
+    const vector<Vec3f>& circles = result.circles;
+    double px_per_mm = result.pxPerMm;
 
-    // PASO 4: CALIBRACIÓN Y CLASIFICACIÓN
-
-    double px_per_mm = 1.0;
-
-    if (!circles.empty()) {
-        // Ordenar círculos por radio
-        sort(circles.begin(), circles.end(),
-             [](const Vec3f& a, const Vec3f& b) {
-                 return a[2] < b[2];
-             });
-
-        // Usar los radios extremos para calibración
-        double min_diameter = 2 * circles.front()[2];
-        double max_diameter = 2 * circles.back()[2];
-
-        // La moneda más pequeña es 1 Kč (20mm) y la más grande 20 Kč (26mm)
-        double min_scale = min_diameter / 20.0;
-        double max_scale = max_diameter / 26.0;
-
-        // Promedio ponderado
-        px_per_mm = (min_scale + max_scale) / 2.0;
-
-        cout << "Calibración: " << px_per_mm << " píxeles por mm" << endl;
-        cout << "Diámetro mínimo: " << min_diameter << " px (" << min_diameter/px_per_mm << " mm)" << endl;
-        cout << "Diámetro máximo: " << max_diameter << " px (" << max_diameter/px_per_mm << " mm)" << endl;
-
-        // Imprime información detallada sobre todos los diámetros detectados
-        cout << "\nDiámetros detectados (mm):" << endl;
-        for (const auto& circle : circles) {
-            double diameter_mm = 2 * circle[2] / px_per_mm;
-            cout << diameter_mm << " ";
-        }
-        cout << endl;
-    }
-
-    // PASO 5: CLASIFICACIÓN Y VISUALIZACIÓN
+    // Guardar imágenes intermedias para verificación
+    TraceZone dump_zone("debug dump");
+    imwrite(out_prefix + "gamma_corregida.jpg", pre.gamma);
+    imwrite(out_prefix + "threshold_50.jpg", pre.binary);
+    imwrite(out_prefix + "filtrada_mediana.jpg", pre.median);
+    imwrite(out_prefix + "erosionada.jpg", pre.eroded);
+    imwrite(out_prefix + "dilatada.jpg", pre.dilated);
+    dump_zone.end();
 
-    int total_value = 0;
-    map<int, int> coin_counts;
+    // PASO 5: VISUALIZACIÓN
 
+    TraceZone draw_zone("draw");
     Mat circles_img = img.clone();
     Mat contours_img = Mat::zeros(img.size(), CV_8UC3);
 
@@ -215,16 +72,8 @@ int main() {
     for (size_t i = 0; i < circles.size(); i++) {
         Point center(cvRound(circles[i][0]), cvRound(circles[i][1]));
         int radius = cvRound(circles[i][2]);
-
-        // Calcular diámetro en mm
         double diameter_mm = 2 * radius / px_per_mm;
-
-        // Clasificar según el diámetro
-        int value = classifyCoin(diameter_mm, coin_types);
-
-        // Actualizar conteo y total
-        coin_counts[value]++;
-        total_value += value;
+        int value = result.values[i];
 
         // Obtener color para esta denominación
         Scalar color = Scalar(0, 0, 255);  // Default: rojo
@@ -254,17 +103,18 @@ int main() {
         cv::circle(circles_img, center, radius, color, 2);
         cv::circle(contours_img, center, radius, color, 2);
     }
+    draw_zone.end();
 
     // Mostrar resultados
     cout << "\nMonedas detectadas:" << endl;
-    for (const auto& entry : coin_counts) {
+    for (const auto& entry : result.counts) {
         cout << entry.second << " x " << entry.first << " Kc = "
              << entry.second * entry.first << " Kc" << endl;
     }
-    cout << "\nValor total: " << total_value << " Kc" << endl;
+    cout << "\nValor total: " << result.totalValue << " Kc" << endl;
 
     // Añadir texto con el total
-    string total_text = "Total: " + to_string(total_value) + " Kc";
+    string total_text = "Total: " + to_string(result.totalValue) + " Kc";
     putText(img_display, total_text, Point(30, 30),
             FONT_HERSHEY_SIMPLEX, 1.0, Scalar(0, 0, 255), 2);
 
@@ -288,13 +138,536 @@ int main() {
     imshow("Resultado", img_display);
 
     // Guardar resultados
-    imwrite("threshold_50.jpg", binary);
-    imwrite("contornos_circulos.jpg", contours_img);
-    imwrite("circulos.jpg", circles_img);
-    imwrite("resultado.jpg", img_display);
+    TraceZone save_zone("save");
+    imwrite(out_prefix + "contornos_circulos.jpg", contours_img);
+    imwrite(out_prefix + "circulos.jpg", circles_img);
+    imwrite(out_prefix + "resultado.jpg", img_display);
+    save_zone.end();
+}
+
+// Resultado de una imagen en el modo por lotes
+struct BatchRecord {
+    int64_t index;
+    string name;
+    Size size;
+    double decodeMs;
+    CoinCountResult result;   // Sin imágenes intermedias (salvo con --dump-dir)
+};
+
+static double percentile(vector<double> values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    sort(values.begin(), values.end());
+    size_t k = (size_t)min((double)values.size() - 1, floor(p * (values.size() - 1) + 0.5));
+    return values[k];
+}
+
+static string jsonEscape(const string& text) {
+    string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            out += ' ';
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
 
-    waitKey(0);
+static bool writeBatchCsv(const string& path, const vector<BatchRecord>& records, const vector<CoinInfo>& coin_types) {
+    ofstream out(path.c_str());
+    if (!out) {
+        return false;
+    }
+    out << "index,image,width,height,coins,total_kc";
+    for (const auto& coin : coin_types) {
+        out << ",count_" << coin.value;
+    }
+    out << ",px_per_mm,contours_fallback,decode_ms,preprocess_ms,components_ms,hough_ms,contours_ms,refine_ms,classify_ms,total_ms\n";
+    out << fixed << setprecision(3);
+    for (const BatchRecord& r : records) {
+        string name = r.name;
+        replace(name.begin(), name.end(), ',', ';');
+        out << r.index << "," << name << "," << r.size.width << "," << r.size.height << ","
+            << r.result.circles.size() << "," << r.result.totalValue;
+        for (const auto& coin : coin_types) {
+            map<int, int>::const_iterator it = r.result.counts.find(coin.value);
+            out << "," << (it == r.result.counts.end() ? 0 : it->second);
+        }
+        const CoinStageTimes& t = r.result.times;
+        out << "," << r.result.pxPerMm << "," << (r.result.usedContours ? 1 : 0) << "," << r.decodeMs
+            << "," << t.preprocessMs << "," << t.componentsMs << "," << t.houghMs << "," << t.contoursMs << "," << t.refineMs << "," << t.classifyMs
+            << "," << t.totalMs << "\n";
+    }
+    return (bool)out;
+}
+
+// Latencia por etapa de todo el lote: media, p50, p95 y máximo
+struct StageSummary {
+    const char* name;
+    vector<double> ms;
+};
+
+static vector<StageSummary> summarizeStages(const vector<BatchRecord>& records) {
+    vector<StageSummary> stages = {{"decode", {}}, {"preprocess", {}}, {"components", {}}, {"hough", {}},
+                                   {"contours", {}}, {"refine", {}}, {"classify", {}}, {"total", {}}};
+    for (const BatchRecord& r : records) {
+        const CoinStageTimes& t = r.result.times;
+        double values[] = {r.decodeMs, t.preprocessMs, t.componentsMs, t.houghMs,
+                           t.contoursMs, t.refineMs, t.classifyMs, t.totalMs};
+        for (size_t i = 0; i < stages.size(); i++) {
+            stages[i].ms.push_back(values[i]);
+        }
+    }
+    return stages;
+}
+
+static bool writeBatchJson(const string& path, const vector<BatchRecord>& records, double wall_s, int workers) {
+    ofstream out(path.c_str());
+    if (!out) {
+        return false;
+    }
+    out << fixed << setprecision(3);
+    out << "{\n  \"images\": [";
+    for (size_t i = 0; i < records.size(); i++) {
+        const BatchRecord& r = records[i];
+        const CoinStageTimes& t = r.result.times;
+        out << (i ? ",\n" : "\n") << "    {\"index\": " << r.index << ", \"image\": \"" << jsonEscape(r.name)
+            << "\", \"width\": " << r.size.width << ", \"height\": " << r.size.height
+            << ", \"coins\": " << r.result.circles.size() << ", \"total_kc\": " << r.result.totalValue
+            << ", \"counts\": {";
+        bool first = true;
+        for (const auto& entry : r.result.counts) {
+            out << (first ? "" : ", ") << "\"" << entry.first << "\": " << entry.second;
+            first = false;
+        }
+        out << "}, \"px_per_mm\": " << r.result.pxPerMm
+            << ", \"contours_fallback\": " << (r.result.usedContours ? "true" : "false")
+            << ", \"stages_ms\": {\"decode\": " << r.decodeMs << ", \"preprocess\": " << t.preprocessMs
+            << ", \"components\": " << t.componentsMs << ", \"hough\": " << t.houghMs
+            << ", \"contours\": " << t.contoursMs << ", \"refine\": " << t.refineMs
+            << ", \"classify\": " << t.classifyMs << ", \"total\": " << t.totalMs << "}}";
+    }
+    out << "\n  ],\n  \"summary\": {\"images\": " << records.size() << ", \"workers\": " << workers
+        << ", \"wall_s\": " << wall_s
+        << ", \"images_per_s\": " << (wall_s > 0 ? records.size() / wall_s : 0) << ", \"stages_ms\": {";
+    vector<StageSummary> stages = summarizeStages(records);
+    for (size_t i = 0; i < stages.size(); i++) {
+        const vector<double>& ms = stages[i].ms;
+        double sum = 0;
+        for (double v : ms) {
+            sum += v;
+        }
+        out << (i ? ", " : "") << "\"" << stages[i].name << "\": {\"mean\": " << (ms.empty() ? 0 : sum / ms.size())
+            << ", \"p50\": " << percentile(ms, 0.5) << ", \"p95\": " << percentile(ms, 0.95)
+            << ", \"max\": " << percentile(ms, 1.0) << "}";
+    }
+    out << "}}\n}\n";
+    return (bool)out;
+}
+
+// Modo por lotes sin interfaz: varios hilos toman imágenes de la fuente (la
+// decodificación sigue en segundo plano), cuentan las monedas y guardan un
+// resumen por imagen. Sin ventanas ni imágenes de depuración; con dump_dir
+// las intermedias se escriben en segundo plano (image_writer.hpp).
+static int runBatch(ImageSource& source, const vector<CoinInfo>& coin_types, CoinOptions options,
+                    int workers, const string& csv_path, const string& json_path, const string& dump_dir,
+                    PerfStageRecorder* perf_recorder) {
+    options.verbose = false;
+    options.keepIntermediates = !dump_dir.empty();
+    if (perf_recorder) {
+        workers = 1;   // Los contadores siguen a un solo hilo
+    }
+    // Con varias imágenes a la vez el paralelismo es entre imágenes: cada
+    // hilo procesa la suya sin repartir bandas con los demás
+    if (workers > 1) {
+        setNumThreads(1);
+    }
+
+    unique_ptr<AsyncImageWriter> writer;
+    if (!dump_dir.empty()) {
+        mkdir(dump_dir.c_str(), 0755);   // Puede existir de antes
+        writer.reset(new AsyncImageWriter(2, 64));
+    }
+
+    vector<BatchRecord> records;
+    mutex records_mutex;
+    int64 t0 = getTickCount();
+    auto work = [&](int id) {
+        traceSetThreadName("worker #" + to_string(id));
+        ImageFrame frame;
+        while (source.read(frame)) {
+            TraceZone zone("coin image", "index", frame.index);
+            if (perf_recorder) {
+                perf_recorder->setLabel(frame.name);
+            }
+            BatchRecord record;
+            record.index = frame.index;
+            record.name = frame.name;
+            record.size = frame.image.size();
+            record.decodeMs = frame.decodeMs;
+            record.result = countCoins(frame.image, coin_types, options, perf_recorder);
+            if (writer) {
+                const CoinPreprocessResult& pre = record.result.pre;
+                string prefix = dump_dir + "/" + format("%04d_", (int)frame.index);
+                writer->write(prefix + "threshold_50.png", pre.binary);
+                writer->write(prefix + "filtrada_mediana.png", pre.median);
+                writer->write(prefix + "dilatada.png", pre.dilated);
+                record.result.pre = CoinPreprocessResult();
+            }
+
+            lock_guard<mutex> lock(records_mutex);
+            cout << frame.name << ": " << record.result.circles.size() << " monedas, " << record.result.totalValue
+                 << " Kc (" << fixed << setprecision(1) << record.result.times.totalMs << " ms)" << endl;
+            cout.unsetf(ios::fixed);
+            records.push_back(record);
+        }
+    };
+    vector<thread> threads;
+    for (int i = 1; i < workers; i++) {
+        threads.emplace_back(work, i);
+    }
+    work(0);
+    for (thread& t : threads) {
+        t.join();
+    }
+    if (writer) {
+        writer->flush();
+    }
+    double wall_s = (getTickCount() - t0) / getTickFrequency();
+
+    sort(records.begin(), records.end(), [](const BatchRecord& a, const BatchRecord& b) {
+        return a.index < b.index;
+    });
+
+    ImageSourceStats io = source.stats();
+    cout << "\nLote: " << records.size() << " imágenes en " << fixed << setprecision(2) << wall_s << " s con "
+         << workers << " hilos -> " << (wall_s > 0 ? records.size() / wall_s : 0) << " imágenes/s" << endl;
+    cout << "E/S: decodificación " << setprecision(1) << io.decodeMs << " ms en segundo plano, espera "
+         << io.waitMs << " ms";
+    if (writer) {
+        ImageWriterStats ws = writer->stats();
+        cout << "; escritura " << ws.written << " imágenes, " << ws.encodeMs << " ms en segundo plano, espera "
+             << ws.waitMs << " ms";
+    }
+    cout << endl;
+
+    cout << "\n" << left << setw(12) << "Etapa" << right << setw(10) << "media" << setw(10) << "p50"
+         << setw(10) << "p95" << setw(10) << "max" << "   (ms por imagen)" << endl;
+    for (const StageSummary& stage : summarizeStages(records)) {
+        double sum = 0;
+        for (double v : stage.ms) {
+            sum += v;
+        }
+        cout << left << setw(12) << stage.name << right << setw(10) << (stage.ms.empty() ? 0 : sum / stage.ms.size())
+             << setw(10) << percentile(stage.ms, 0.5) << setw(10) << percentile(stage.ms, 0.95)
+             << setw(10) << percentile(stage.ms, 1.0) << endl;
+    }
+    cout.unsetf(ios::fixed);
+
+    bool ok = true;
+    if (!csv_path.empty()) {
+        ok = writeBatchCsv(csv_path, records, coin_types) && ok;
+        cout << (ok ? "Resultados CSV en " : "No se pudo escribir ") << csv_path << endl;
+    }
+    if (!json_path.empty()) {
+        bool json_ok = writeBatchJson(json_path, records, wall_s, workers);
+        cout << (json_ok ? "Resultados JSON en " : "No se pudo escribir ") << json_path << endl;
+        ok = ok && json_ok;
+    }
+    return ok ? 0 : -1;
+}
+
+// Modo video: conteo incremental cuadro a cuadro (coin_video.hpp). Muestra
+// las monedas seguidas y el total acumulado (salvo con show = false), imprime
+// el total cada vez que cambia y al final la latencia por cuadro.
+static int runVideo(ImageSource& source, const vector<CoinInfo>& coin_types, const CoinOptions& options,
+                    const CoinVideoParams& params, bool show, const string& csv_path,
+                    PerfStageRecorder* perf_recorder) {
+    CoinVideoCounter counter(coin_types, options, params);
+    // El detalle de cada cuadro se escribe a medida que se procesa
+    ofstream csv;
+    if (!csv_path.empty()) {
+        csv.open(csv_path.c_str());
+        csv << "frame,full_detection,regions,changed_fraction,roi_fraction,coins,total_kc,diff_ms,detect_ms,"
+               "latency_ms\n";
+        csv << fixed << setprecision(4);
+    }
+    ImageFrame frame;
+    int last_total = -1;
+    int64 t0 = getTickCount();
+    while (source.read(frame)) {
+        const CoinVideoFrame& info = counter.process(frame.image, perf_recorder);
+        if (csv.is_open()) {
+            csv << info.index << "," << (info.fullDetection ? 1 : 0) << "," << info.regions << ","
+                << info.changedFraction << "," << info.roiFraction << "," << info.coins << "," << info.totalValue
+                << "," << info.diffMs << "," << info.detectMs << "," << info.latencyMs << "\n";
+        }
+        if (info.totalValue != last_total) {
+            cout << "Cuadro " << info.index << ": " << info.coins << " monedas, total " << info.totalValue
+                 << " Kc" << (info.fullDetection ? " (conteo completo)" : "") << endl;
+            last_total = info.totalValue;
+        }
+        if (!show) {
+            continue;
+        }
+
+        TraceZone draw_zone("draw");
+        Mat display;
+        if (frame.image.channels() == 1) {
+            cvtColor(frame.image, display, COLOR_GRAY2BGR);
+        } else {
+            display = frame.image.clone();
+        }
+        for (const CoinTrack& track : counter.tracks()) {
+            Point center(cvRound(track.circle[0]), cvRound(track.circle[1]));
+            int radius = cvRound(track.circle[2]);
+            Scalar color = Scalar(0, 0, 255);
+            for (const auto& coin_info : coin_types) {
+                if (coin_info.value == track.value) {
+                    color = coin_info.color;
+                    break;
+                }
+            }
+            // Recién redetectadas con trazo grueso
+            cv::circle(display, center, radius, color, track.lastDetected == info.index ? 3 : 1);
+            putText(display, to_string(track.value) + " Kc", Point(center.x - radius / 2, center.y),
+                    FONT_HERSHEY_SIMPLEX, 0.5, color, 2);
+        }
+        putText(display, "Total: " + to_string(info.totalValue) + " Kc", Point(30, 30), FONT_HERSHEY_SIMPLEX, 1.0,
+                Scalar(0, 0, 255), 2);
+        draw_zone.end();
+        namedWindow("Monedas", WINDOW_NORMAL);
+        imshow("Monedas", display);
+        if (waitKey(1) == 27) {
+            break;
+        }
+    }
+    if (show) {
+        destroyAllWindows();
+    }
+    double wall_s = (getTickCount() - t0) / getTickFrequency();
+
+    // Media y máximo de toda la corrida; p50 y p95 de los últimos cuadros
+    const CoinVideoStats& stats = counter.stats();
+    const deque<CoinVideoFrame>& history = counter.history();
+    vector<double> latency, diff, detect;
+    for (const CoinVideoFrame& f : history) {
+        latency.push_back(f.latencyMs);
+        diff.push_back(f.diffMs);
+        detect.push_back(f.detectMs);
+    }
+    int n = stats.frames;
+    cout << "\nVideo: " << n << " cuadros en " << fixed << setprecision(2) << wall_s << " s ("
+         << (wall_s > 0 ? n / wall_s : 0) << " cuadros/s); " << stats.fullDetections << " conteos completos, "
+         << stats.idleFrames << " cuadros sin cambios; en promedio se redetectó el " << setprecision(1)
+         << (n ? 100 * stats.roiFraction / n : 0) << "% de la imagen" << endl;
+    cout << "Calibración: " << setprecision(3) << counter.pxPerMm() << " píxeles por mm; total final "
+         << counter.totalValue() << " Kc" << endl;
+    cout << "\n" << left << setw(12) << "Etapa" << right << setw(10) << "media" << setw(10) << "p50"
+         << setw(10) << "p95" << setw(10) << "max" << "   (ms por cuadro; p50 y p95 de los últimos "
+         << history.size() << ")" << endl;
+    struct {
+        const char* name;
+        const CoinVideoTiming* timing;
+        const vector<double>* ms;
+    } stages[] = {{"cambios", &stats.diff, &diff}, {"detección", &stats.detect, &detect},
+                  {"total", &stats.latency, &latency}};
+    for (const auto& stage : stages) {
+        cout << left << setw(12) << stage.name << right << setprecision(2) << setw(10)
+             << (n ? stage.timing->sumMs / n : 0) << setw(10) << percentile(*stage.ms, 0.5) << setw(10)
+             << percentile(*stage.ms, 0.95) << setw(10) << stage.timing->maxMs << endl;
+    }
+    cout.unsetf(ios::fixed);
+
+    if (!csv_path.empty()) {
+        csv.close();
+        cout << (csv ? "Resultados CSV en " : "No se pudo escribir ") << csv_path << endl;
+        if (!csv) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Uso: ./monedas [--perf] [--perf-csv archivo] [--perf-json archivo] [--trace traza.json]
+//                [--unfused] [--tile-rows N] [--bilateral-grid] [--components]
+//                [--bit-morphology] [--pyramid]
+//                [--video [--refresh N] [--no-window] [--csv archivo]]
+//                [--batch [--workers N] [--csv archivo] [--json archivo] [--dump-dir carpeta]]
+//                [imagen | carpeta | "glob" | video | raw:WxH:formato:ruta ...]
+// Sin entradas busca koruny_black.jpg / Image2.jpg en las rutas habituales. Las
+// imágenes se decodifican en segundo plano (image_source.hpp); con varias se
+// muestra cada resultado (cualquier tecla pasa a la siguiente, ESC termina).
+// --perf mide cada etapa con los contadores de hardware (ciclos, instrucciones,
+// IPC, fallos de LLC y de predicción de saltos) y ejecuta OpenCV en un solo
+// hilo para que los contadores del hilo principal vean todo el trabajo.
+// --trace guarda la línea de tiempo de las etapas en formato Chrome trace.
+// El preprocesamiento corre por bandas fusionadas en paralelo (--tile-rows fija
+// las filas por banda); --unfused vuelve a las siete pasadas sobre la imagen
+// completa, con una etapa de --perf por paso. --bilateral-grid cambia el
+// bilateral exacto por la aproximación de bilateral_grid.hpp. --bit-morphology
+// hace mediana, erosión y dilatación sobre la máscara empaquetada a un bit
+// por píxel (binary_morphology.hpp, mismo resultado). --components
+// detecta las monedas por componentes conexas de la máscara y usa Hough solo
+// para separar las que se tocan (coin_components.hpp). --pyramid detecta a
+// 1/4 de resolución y refina cada moneda en un recorte a resolución completa
+// (coin_pyramid.hpp); las imágenes intermedias son las de la etapa gruesa.
+// --video cuenta de forma incremental (coin_video.hpp): detección completa en
+// el primer cuadro (y cada --refresh cuadros) y después solo en las regiones
+// que cambiaron; muestra el total acumulado (sin ventana con --no-window) y
+// reporta la latencia por cuadro; --csv guarda el detalle de cada cuadro.
+// --batch procesa todas las entradas sin ventanas ni imágenes de depuración,
+// con --workers imágenes a la vez (por defecto un hilo por núcleo), y reporta
+// imágenes/s y la latencia de cada etapa; --csv y --json guardan el total y
+// la cantidad de cada moneda por imagen, --dump-dir escribe las intermedias
+// en segundo plano.
+int main(int argc, char** argv) {
+    bool perf = false;
+    string perf_csv, perf_json, trace_path;
+    CoinOptions options;
+    bool batch = false;
+    bool video = false, show_window = true;
+    CoinVideoParams video_params;
+    int workers = max(1, getNumberOfCPUs());
+    string csv_path, json_path, dump_dir;
+    vector<string> inputs;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--perf") {
+            perf = true;
+        } else if (arg == "--perf-csv" && i + 1 < argc) {
+            perf = true;
+            perf_csv = argv[++i];
+        } else if (arg == "--perf-json" && i + 1 < argc) {
+            perf = true;
+            perf_json = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (arg == "--unfused") {
+            options.fused = false;
+        } else if (arg == "--bilateral-grid") {
+            options.preprocess.bilateralGrid = true;
+        } else if (arg == "--bit-morphology") {
+            options.preprocess.bitMorphology = true;
+        } else if (arg == "--components") {
+            options.components = true;
+        } else if (arg == "--pyramid") {
+            options.pyramid = true;
+        } else if (arg == "--video") {
+            video = true;
+        } else if (arg == "--refresh" && i + 1 < argc) {
+            video_params.refreshInterval = max(0, atoi(argv[++i]));
+        } else if (arg == "--no-window") {
+            show_window = false;
+        } else if (arg == "--tile-rows" && i + 1 < argc) {
+            options.preprocess.tileRows = max(0, atoi(argv[++i]));
+        } else if (arg == "--batch") {
+            batch = true;
+        } else if (arg == "--workers" && i + 1 < argc) {
+            workers = max(1, atoi(argv[++i]));
+        } else if (arg == "--csv" && i + 1 < argc) {
+            csv_path = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (arg == "--dump-dir" && i + 1 < argc) {
+            dump_dir = argv[++i];
+        } else if (arg.compare(0, 2, "--") == 0) {
+            cout << "Opción no reconocida: " << arg << endl;
+            return -1;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+
+    TraceSession trace_session(trace_path);
+    PerfStageRecorder perf_stages("monedas");
+    PerfStageRecorder* perf_recorder = perf ? &perf_stages : nullptr;
+    if (perf) {
+        setNumThreads(1);
+    }
+
+    // Definir tipos de monedas con sus valores y diámetros
+    vector<CoinInfo> coin_types = czechCoinTypes();
+
+    // Intentar diferentes rutas de acceso para la imagen
+    vector<string> possible_image_paths = {
+        "koruny_black.jpg",
+        "../koruny_black.jpg",
+        "../../koruny_black.jpg",
+        "Data/koruny_black.jpg",
+        "../Data/koruny_black.jpg",
+        "Image2.jpg",
+        "Data/Image2.jpg"
+    };
+    if (inputs.empty()) {
+        for (const auto& path : possible_image_paths) {
+            if (!ImageSource::expand(path).empty()) {
+                inputs.push_back(path);
+                break;
+            }
+        }
+    }
+
+    ImageSource source;
+    if (inputs.empty() || !source.open(inputs)) {
+        cout << "No se pudo abrir la imagen. Verifica la ruta." << endl;
+        if (!source.error().empty()) {
+            cout << source.error() << endl;
+        }
+        return -1;
+    }
+    bool single_image = source.size() == 1;
+
+    if (video) {
+        int status = runVideo(source, coin_types, options, video_params, show_window, csv_path, perf_recorder);
+        if (perf_recorder) {
+            perf_recorder->report(perf_csv, perf_json);
+        }
+        trace_session.write();
+        return status;
+    }
+
+    if (batch) {
+        int status = runBatch(source, coin_types, options, workers, csv_path, json_path, dump_dir, perf_recorder);
+        if (perf_recorder) {
+            perf_recorder->report(perf_csv, perf_json);
+        }
+        trace_session.write();
+        return status;
+    }
+
+    ImageFrame frame;
+    int processed = 0;
+    while (source.read(frame)) {
+        cout << "Imagen cargada desde: " << frame.name << endl;
+        perf_stages.setLabel(frame.name);
+
+        // Con varias imágenes los archivos de salida llevan el número de imagen
+        string out_prefix = single_image ? "" : format("%04d_", (int)frame.index);
+        processCoins(frame.image, out_prefix, coin_types, options, perf_recorder);
+        processed++;
+
+        int key = waitKey(0);
+        if (key == 27) {
+            break;
+        }
+    }
     destroyAllWindows();
 
+    ImageSourceStats io = source.stats();
+    if (processed > 1) {
+        cout << "\nImágenes procesadas: " << processed << " (decodificación " << io.decodeMs
+             << " ms en segundo plano, espera " << io.waitMs << " ms)" << endl;
+    }
+    if (perf_recorder) {
+        perf_recorder->report(perf_csv, perf_json);
+    }
+    trace_session.write();
+
     return 0;
 }
@@ -0,0 +1,158 @@
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <cstdio>
+
+#include "bench_utils.hpp"
+#include "image_source.hpp"
+#include "binary_morphology.hpp"
+#include "sharpen_binarize.hpp"
+#include "distance_transform.hpp"
+#include "connected_components.hpp"
+#include "tiled_watershed.hpp"
+#include "label_map_io.hpp"
+
+using namespace cv;
+using namespace std;
+
+// Escritura del mapa de etiquetas (label_map_io.hpp) y su coloreado, sobre la
+// segmentación de la imagen de cartas ampliada por un factor (8K por defecto).
+//
+// Compara el coloreado con tabla contra el recorrido con at<> que usaba
+// segmentacion (mismo resultado), y para cada formato (crudo uint16 y
+// uint32, por corridas, polígonos, y PNG de 16 bits como referencia) mide el
+// tiempo de escritura, el tamaño del archivo y el caudal en megapíxeles por
+// segundo, y verifica que el crudo y el de corridas se lean igual.
+//
+// Uso: ./bench_labels [imagen] [escala] [repeticiones] [carpeta]
+
+static double fileMb(const string& path) {
+    ifstream in(path.c_str(), ios::binary | ios::ate);
+    return in ? in.tellg() / 1e6 : 0;
+}
+
+// El mapa de etiquetas de segmentacion: marcadores de los picos de la
+// distancia y watershed por baldosas
+static Mat segmentLabels(const Mat& src, int& regions) {
+    Mat sharp, gray, dist;
+    vector<int> histogram;
+    sharpenToGray(src, sharp, gray, histogram);
+    threshold(gray, gray, otsuThreshold(histogram), 255, THRESH_BINARY);
+    float minDist, maxDist;
+    euclideanDistanceTransform(gray, dist, &minDist, &maxDist);
+    BinaryImage peaks;
+    normalizeDistancePeaks(dist, minDist, maxDist, 0.4f, peaks);
+    binaryDilate(peaks, peaks, Mat::ones(3, 3, CV_8U));
+    Mat peaksMask, markers;
+    binaryUnpack(peaks, peaksMask);
+    vector<ComponentStats> components;
+    regions = StripConnectedComponents().run(peaksMask, components, &markers);
+    circle(markers, Point(5, 5), 3, Scalar(regions + 1), -1);
+    tiledWatershed(sharp, markers);
+    return markers;
+}
+
+int main(int argc, char** argv) {
+    string path = argc > 1 ? argv[1] : "";
+    double scale = argc > 2 ? max(0.25, atof(argv[2])) : 0.0;
+    int repetitions = argc > 3 ? max(1, atoi(argv[3])) : 3;
+    string dir = argc > 4 ? argv[4] : ".";
+
+    vector<string> candidates = {path, "cards.png", "Data/cards.png", "../Data/cards.png"};
+    Mat original;
+    for (const string& candidate : candidates) {
+        if (!candidate.empty()) {
+            original = ImageSource::loadFirst(candidate, IMREAD_COLOR);
+            if (!original.empty()) {
+                break;
+            }
+        }
+    }
+    if (original.empty()) {
+        cout << "No se pudo cargar la imagen." << endl;
+        return -1;
+    }
+    if (scale <= 0) {
+        scale = 7680.0 / original.cols;   // 8K de ancho
+    }
+    Mat img;
+    resize(original, img, Size(), scale, scale, scale > 1 ? INTER_NEAREST : INTER_AREA);
+    int regions = 0;
+    const Mat labels = segmentLabels(img, regions);
+    const double mp = labels.total() / 1e6;
+    cout << "Mapa de etiquetas: " << labels.cols << "x" << labels.rows << ", " << regions << " regiones, "
+         << getNumThreads() << " hilos" << endl;
+
+    // Coloreado
+    vector<Vec3b> colors;
+    for (int i = 0; i < regions; i++) {
+        colors.push_back(Vec3b((uchar)theRNG().uniform(0, 256), (uchar)theRNG().uniform(0, 256),
+                               (uchar)theRNG().uniform(0, 256)));
+    }
+    Mat scalar, table;
+    auto colorizeScalar = [&]() {
+        scalar = Mat::zeros(labels.size(), CV_8UC3);
+        for (int i = 0; i < labels.rows; i++) {
+            for (int j = 0; j < labels.cols; j++) {
+                int index = labels.at<int>(i, j);
+                if (index > 0 && index <= regions) {
+                    scalar.at<Vec3b>(i, j) = colors[index - 1];
+                }
+            }
+        }
+    };
+    auto colorizeTable = [&]() { colorizeLabels(labels, colors, table); };
+    colorizeScalar();
+    colorizeTable();
+    bool ok = countDifferent(scalar, table) == 0;
+    double scalarMs = timeMs(colorizeScalar, repetitions), tableMs = timeMs(colorizeTable, repetitions);
+    cout << fixed << setprecision(2) << "Coloreado: at<> " << scalarMs << " ms, tabla " << tableMs << " ms ("
+         << scalarMs / tableMs << "x, " << (ok ? "igual" : "DISTINTO") << ")" << endl;
+
+    // Escritura
+    struct Format {
+        const char* name;
+        string file;
+        function<bool(const string&)> write;
+        function<bool(const string&, Mat&)> read;
+    } formats[] = {
+        {"crudo (auto)", dir + "/labels_bench.lbl", [&](const string& f) { return writeLabelMapRaw(f, labels); },
+         readLabelMapRaw},
+        {"crudo uint32", dir + "/labels_bench32.lbl", [&](const string& f) { return writeLabelMapRaw(f, labels, 4); },
+         readLabelMapRaw},
+        {"por corridas", dir + "/labels_bench.rle", [&](const string& f) { return writeLabelMapRle(f, labels); },
+         readLabelMapRle},
+        {"polígonos", dir + "/labels_bench.txt", [&](const string& f) { return writeLabelMapPolygons(f, labels); },
+         nullptr},
+        {"PNG 16 bits", dir + "/labels_bench.png",
+         [&](const string& f) {
+             Mat labels16;
+             labels.convertTo(labels16, CV_16U);
+             return imwrite(f, labels16);
+         },
+         nullptr},
+    };
+    cout << "\n" << setw(16) << "formato" << setw(12) << "ms" << setw(12) << "MB" << setw(12) << "MP/s" << setw(12)
+         << "lectura" << endl;
+    for (const Format& format : formats) {
+        bool written = format.write(format.file);
+        double ms = timeMs([&]() { format.write(format.file); }, repetitions);
+        string check = "-";
+        if (!written) {
+            check = "ERROR";
+        } else if (format.read) {
+            Mat back;
+            check = format.read(format.file, back) && countDifferent(back, labels) == 0 ? "igual" : "DISTINTO";
+        }
+        ok = ok && check != "ERROR" && check != "DISTINTO";
+        cout << setw(16) << format.name << setw(12) << ms << setw(12) << fileMb(format.file) << setw(12) << mp * 1000 / ms
+             << setw(12) << check << endl;
+        std::remove(format.file.c_str());
+    }
+    return ok ? 0 : -1;
+}
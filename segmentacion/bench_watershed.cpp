@@ -0,0 +1,153 @@
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include "bench_utils.hpp"
+#include "image_source.hpp"
+#include "binary_morphology.hpp"
+#include "sharpen_binarize.hpp"
+#include "distance_transform.hpp"
+#include "connected_components.hpp"
+#include "tiled_watershed.hpp"
+
+using namespace cv;
+using namespace std;
+
+// Compara el watershed por baldosas (tiled_watershed.hpp) con watershed de
+// OpenCV sobre la imagen de cartas ampliada por un factor (8K por defecto),
+// con los mismos marcadores que arma segmentacion.
+//
+// Verifica que el resultado sea idéntico con cualquier tamaño de baldosa y
+// cantidad de hilos (contra una sola baldosa, la inundación secuencial) y
+// falla si no lo es. El watershed por baldosas es una aproximación del de
+// OpenCV (ver tiled_watershed.hpp), así que de ese solo informa cuántos
+// píxeles coinciden, en total y fuera de las líneas, y cuánto se parece la
+// región que más difiere. Después mide el tiempo de cada uno con 1, 2, 4,
+// ... hilos.
+//
+// Uso: ./bench_watershed [imagen] [escala] [repeticiones] [baldosa]
+
+// Los marcadores de segmentacion: picos de la distancia etiquetados y la
+// semilla del fondo
+static Mat buildMarkers(const Mat& src, Mat& sharp) {
+    Mat gray, dist;
+    vector<int> histogram;
+    sharpenToGray(src, sharp, gray, histogram);
+    threshold(gray, gray, otsuThreshold(histogram), 255, THRESH_BINARY);
+    float minDist, maxDist;
+    euclideanDistanceTransform(gray, dist, &minDist, &maxDist);
+    BinaryImage peaks;
+    normalizeDistancePeaks(dist, minDist, maxDist, 0.4f, peaks);
+    binaryDilate(peaks, peaks, Mat::ones(3, 3, CV_8U));
+    Mat peaksMask, markers;
+    binaryUnpack(peaks, peaksMask);
+    vector<ComponentStats> regions;
+    int count = StripConnectedComponents().run(peaksMask, regions, &markers);
+    circle(markers, Point(5, 5), 3, Scalar(count + 1), -1);
+    return markers;
+}
+
+int main(int argc, char** argv) {
+    string path = argc > 1 ? argv[1] : "";
+    double scale = argc > 2 ? max(0.25, atof(argv[2])) : 0.0;
+    int repetitions = argc > 3 ? max(1, atoi(argv[3])) : 3;
+    int tileSize = argc > 4 ? atoi(argv[4]) : 0;
+
+    vector<string> candidates = {path, "cards.png", "Data/cards.png", "../Data/cards.png"};
+    Mat original;
+    for (const string& candidate : candidates) {
+        if (!candidate.empty()) {
+            original = ImageSource::loadFirst(candidate, IMREAD_COLOR);
+            if (!original.empty()) {
+                break;
+            }
+        }
+    }
+    if (original.empty()) {
+        cout << "No se pudo cargar la imagen." << endl;
+        return -1;
+    }
+    if (scale <= 0) {
+        scale = 7680.0 / original.cols;   // 8K de ancho
+    }
+    Mat img;
+    resize(original, img, Size(), scale, scale, scale > 1 ? INTER_NEAREST : INTER_AREA);
+
+    Mat sharp;
+    const Mat seeds = buildMarkers(img, sharp);
+    double maxLabel;
+    minMaxLoc(seeds, nullptr, &maxLabel);
+    cout << "Imagen: " << img.cols << "x" << img.rows << ", " << (int)maxLabel << " marcadores, "
+         << getNumThreads() << " hilos" << endl;
+
+    // Igualdad entre baldosas e hilos
+    const int maxThreads = getNumThreads();
+    Mat sequential = seeds.clone(), tiled;
+    tiledWatershed(sharp, sequential, max(img.rows, img.cols));
+    bool ok = true;
+    vector<int> sizes = {64, 256, 1024};
+    if (tileSize > 0) {
+        sizes.push_back(tileSize);
+    }
+    for (int size : sizes) {
+        tiled = seeds.clone();
+        tiledWatershed(sharp, tiled, size);
+        bool same = countDifferent(sequential, tiled) == 0;
+        cout << "Baldosas de " << size << ": "
+             << (same ? "igual a la inundación secuencial" : "DISTINTO") << endl;
+        ok = ok && same;
+    }
+    setNumThreads(1);
+    tiled = seeds.clone();
+    tiledWatershed(sharp, tiled, tileSize);
+    setNumThreads(maxThreads);
+    bool sameThreads = countDifferent(sequential, tiled) == 0;
+    cout << "Un hilo: " << (sameThreads ? "igual" : "DISTINTO") << endl;
+    ok = ok && sameThreads;
+
+    Mat reference = seeds.clone();
+    watershed(sharp, reference);
+    double agreement = 1.0 - countDifferent(reference, sequential) / (double)reference.total();
+    Mat regions = (reference != -1) & (sequential != -1);
+    Mat sameRegion = (reference == sequential) & regions;
+    double regionAgreement = countNonZero(sameRegion) / (double)max(1, countNonZero(regions));
+    double worstIoU = 1.0;
+    int worstLabel = 0;
+    for (int l = 1; l <= (int)maxLabel; l++) {
+        Mat a = reference == l, b = sequential == l;
+        int unionArea = countNonZero(a | b);
+        double iou = unionArea ? countNonZero(a & b) / (double)unionArea : 1.0;
+        if (iou < worstIoU) {
+            worstIoU = iou;
+            worstLabel = l;
+        }
+    }
+    cout << "Coincidencia con watershed de OpenCV (aproximación): " << fixed << setprecision(2) << agreement * 100
+         << "% de los píxeles, " << regionAgreement * 100 << "% fuera de las líneas; peor región " << worstLabel
+         << " con intersección sobre unión " << setprecision(3) << worstIoU << setprecision(2) << endl;
+
+    // Tiempos
+    cout << "\n" << setw(8) << "hilos" << setw(12) << "OpenCV" << setw(12) << "baldosas" << setw(10) << "speedup"
+         << setw(12) << "MP/s" << endl;
+    double opencvMs = timeMs([&]() {
+        reference = seeds.clone();
+        watershed(sharp, reference);
+    }, repetitions);
+    for (int threads = 1;; threads = min(threads * 2, maxThreads)) {
+        setNumThreads(threads);
+        double tiledMs = timeMs([&]() {
+            tiled = seeds.clone();
+            tiledWatershed(sharp, tiled, tileSize);
+        }, repetitions);
+        cout << setw(8) << threads << setw(12) << opencvMs << setw(12) << tiledMs << setw(9) << opencvMs / tiledMs
+             << "x" << setw(12) << img.total() / 1e3 / tiledMs << endl;
+        if (threads == maxThreads) {
+            break;
+        }
+    }
+    setNumThreads(maxThreads);
+    return ok ? 0 : -1;
+}
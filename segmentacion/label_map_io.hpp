@@ -0,0 +1,393 @@
+#ifndef LABEL_MAP_IO_HPP
+#define LABEL_MAP_IO_HPP
+
+#include <stdint.h>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+
+#include "opencv2/core.hpp"
+#include "opencv2/imgproc.hpp"
+
+#include "trace.hpp"
+
+// Salida del mapa de etiquetas de la segmentación (CV_32S: -1 en las líneas
+// del watershed, 0 sin región, 1..N regiones) en formatos compactos, y su
+// coloreado para mostrarlo.
+//
+// Formatos:
+//   - crudo (.lbl): cabecera de 32 bytes y las etiquetas por filas en
+//     uint16 (si la mayor etiqueta entra) o uint32, con el -1 como todos los
+//     bits en 1. Los datos empiezan en dataOffset (alineado), así que el
+//     archivo se puede mapear en memoria y usar directamente como una Mat,
+//   - por corridas (.rle): la misma cabecera, una tabla de desplazamientos
+//     por fila (uint64, rows + 1, relativos al comienzo de los datos) para
+//     leer cualquier fila sin recorrer las anteriores, y las corridas de
+//     cada fila como (etiqueta, largo) con bytesPerLabel y runLengthBytes
+//     bytes,
+//   - polígonos (.txt): una línea por contorno exterior de cada región,
+//     "etiqueta n x0 y0 x1 y1 ...", con los vértices de findContours
+//     (CHAIN_APPROX_SIMPLE) recortado a la caja de la región.
+// Los enteros van en el orden de bytes de la máquina (little-endian en x86 y
+// ARM). La conversión y la codificación son en paralelo por filas (o por
+// región) y la escritura es un fwrite por bloque.
+//
+// colorizeLabels reemplaza al recorrido con at<int>/at<Vec3b>: una tabla de
+// colores indexada por etiqueta + 1 (el -1 y el 0 en negro) y un acceso a la
+// tabla por píxel, en paralelo por filas.
+
+struct LabelMapHeader {
+    char magic[4];              // "LBLM" crudo, "LBLR" por corridas
+    uint32_t version;           // 1
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytesPerLabel;     // 2 o 4
+    uint32_t maxLabel;
+    uint32_t dataOffset;        // Desde el comienzo del archivo
+    uint32_t runLengthBytes;    // Solo por corridas: 2 o 4
+};
+
+namespace label_map_io_detail {
+
+inline LabelMapHeader makeHeader(const char* magic, const cv::Mat& labels, int bytesPerLabel, int maxLabel) {
+    LabelMapHeader header;
+    std::memcpy(header.magic, magic, 4);
+    header.version = 1;
+    header.width = (uint32_t)labels.cols;
+    header.height = (uint32_t)labels.rows;
+    header.bytesPerLabel = (uint32_t)bytesPerLabel;
+    header.maxLabel = (uint32_t)std::max(maxLabel, 0);
+    header.dataOffset = (uint32_t)sizeof(LabelMapHeader);
+    header.runLengthBytes = 0;
+    return header;
+}
+
+inline int maxLabelOf(const cv::Mat& labels) {
+    double maxValue = 0;
+    if (!labels.empty()) {
+        cv::minMaxLoc(labels, nullptr, &maxValue);
+    }
+    return (int)maxValue;
+}
+
+// Etiqueta en 2 o 4 bytes (el -1 queda con todos los bits en 1)
+inline void putValue(uchar* p, int value, int bytes) {
+    if (bytes == 2) {
+        uint16_t v = (uint16_t)value;
+        std::memcpy(p, &v, 2);
+    } else {
+        uint32_t v = (uint32_t)value;
+        std::memcpy(p, &v, 4);
+    }
+}
+
+inline int getLabel(const uchar* p, int bytes) {
+    if (bytes == 2) {
+        uint16_t v;
+        std::memcpy(&v, p, 2);
+        return v == 0xFFFF ? -1 : (int)v;
+    }
+    int32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+inline uint32_t getLength(const uchar* p, int bytes) {
+    if (bytes == 2) {
+        uint16_t v;
+        std::memcpy(&v, p, 2);
+        return v;
+    }
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+inline bool readHeader(std::FILE* f, const char* magic, LabelMapHeader& header) {
+    return std::fread(&header, sizeof(header), 1, f) == 1 && std::memcmp(header.magic, magic, 4) == 0 &&
+           header.version == 1 && (header.bytesPerLabel == 2 || header.bytesPerLabel == 4);
+}
+
+inline bool hasSuffix(const std::string& s, const std::string& suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace label_map_io_detail
+
+// Crudo: bytesPerLabel 0 elige uint16 si la mayor etiqueta es menor que
+// 65535 (ese valor queda para el -1) y si no uint32
+inline bool writeLabelMapRaw(const std::string& path, const cv::Mat& labels, int bytesPerLabel = 0) {
+    using namespace label_map_io_detail;
+    CV_Assert(labels.type() == CV_32SC1);
+    TraceZone zone("write labels raw");
+    const int maxLabel = maxLabelOf(labels);
+    if (bytesPerLabel != 2 && bytesPerLabel != 4) {
+        bytesPerLabel = maxLabel < 0xFFFF ? 2 : 4;
+    }
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+    LabelMapHeader header = makeHeader("LBLM", labels, bytesPerLabel, maxLabel);
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1;
+    const size_t rowBytes = (size_t)labels.cols * bytesPerLabel;
+    if (bytesPerLabel == 4 && labels.isContinuous()) {
+        ok = ok && std::fwrite(labels.data, rowBytes, labels.rows, f) == (size_t)labels.rows;
+    } else {
+        // Por bloques de filas: conversión en paralelo y un fwrite por bloque
+        const int blockRows = 256;
+        std::vector<uchar> block((size_t)std::min(blockRows, labels.rows) * rowBytes);
+        for (int y0 = 0; ok && y0 < labels.rows; y0 += blockRows) {
+            const int y1 = std::min(labels.rows, y0 + blockRows);
+            cv::parallel_for_(cv::Range(y0, y1), [&](const cv::Range& range) {
+                for (int y = range.start; y < range.end; y++) {
+                    const int* l = labels.ptr<int>(y);
+                    uchar* out = &block[(size_t)(y - y0) * rowBytes];
+                    if (bytesPerLabel == 4) {
+                        std::memcpy(out, l, rowBytes);
+                    } else {
+                        uint16_t* o = (uint16_t*)out;
+                        for (int x = 0; x < labels.cols; x++) {
+                            o[x] = (uint16_t)l[x];
+                        }
+                    }
+                }
+            });
+            ok = std::fwrite(&block[0], rowBytes, y1 - y0, f) == (size_t)(y1 - y0);
+        }
+    }
+    return std::fclose(f) == 0 && ok;
+}
+
+inline bool readLabelMapRaw(const std::string& path, cv::Mat& labels) {
+    using namespace label_map_io_detail;
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+    LabelMapHeader header;
+    bool ok = readHeader(f, "LBLM", header) && std::fseek(f, (long)header.dataOffset, SEEK_SET) == 0;
+    if (ok) {
+        const int bytes = (int)header.bytesPerLabel;
+        std::vector<uchar> row((size_t)header.width * bytes);
+        labels.create((int)header.height, (int)header.width, CV_32SC1);
+        for (int y = 0; ok && y < labels.rows; y++) {
+            ok = row.empty() || std::fread(&row[0], row.size(), 1, f) == 1;
+            int* l = labels.ptr<int>(y);
+            for (int x = 0; ok && x < labels.cols; x++) {
+                l[x] = getLabel(&row[(size_t)x * bytes], bytes);
+            }
+        }
+    }
+    std::fclose(f);
+    return ok;
+}
+
+// Por corridas: cada fila se codifica en paralelo en su propio buffer
+inline bool writeLabelMapRle(const std::string& path, const cv::Mat& labels) {
+    using namespace label_map_io_detail;
+    CV_Assert(labels.type() == CV_32SC1);
+    TraceZone zone("write labels rle");
+    const int maxLabel = maxLabelOf(labels);
+    const int bytesPerLabel = maxLabel < 0xFFFF ? 2 : 4;
+    const int lengthBytes = labels.cols <= 0xFFFF ? 2 : 4;
+    const int runBytes = bytesPerLabel + lengthBytes;
+    std::vector<std::vector<uchar>> rows(labels.rows);
+    cv::parallel_for_(cv::Range(0, labels.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            const int* l = labels.ptr<int>(y);
+            std::vector<uchar>& out = rows[y];
+            for (int x = 0; x < labels.cols;) {
+                int end = x + 1;
+                while (end < labels.cols && l[end] == l[x]) {
+                    end++;
+                }
+                out.resize(out.size() + runBytes);
+                uchar* p = &out[out.size() - runBytes];
+                putValue(p, l[x], bytesPerLabel);
+                putValue(p + bytesPerLabel, end - x, lengthBytes);   // Como entero sin signo
+                x = end;
+            }
+        }
+    });
+
+    std::vector<uint64_t> offsets(labels.rows + 1, 0);
+    for (int y = 0; y < labels.rows; y++) {
+        offsets[y + 1] = offsets[y] + rows[y].size();
+    }
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+    LabelMapHeader header = makeHeader("LBLR", labels, bytesPerLabel, maxLabel);
+    header.dataOffset = (uint32_t)(sizeof(header) + offsets.size() * sizeof(uint64_t));
+    header.runLengthBytes = (uint32_t)lengthBytes;
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1 &&
+              std::fwrite(&offsets[0], sizeof(uint64_t), offsets.size(), f) == offsets.size();
+    for (int y = 0; ok && y < labels.rows; y++) {
+        ok = rows[y].empty() || std::fwrite(&rows[y][0], 1, rows[y].size(), f) == rows[y].size();
+    }
+    return std::fclose(f) == 0 && ok;
+}
+
+inline bool readLabelMapRle(const std::string& path, cv::Mat& labels) {
+    using namespace label_map_io_detail;
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+    LabelMapHeader header;
+    std::vector<uint64_t> offsets;
+    std::vector<uchar> data;
+    bool ok = readHeader(f, "LBLR", header) && (header.runLengthBytes == 2 || header.runLengthBytes == 4);
+    if (ok) {
+        offsets.resize((size_t)header.height + 1);
+        ok = std::fread(&offsets[0], sizeof(uint64_t), offsets.size(), f) == offsets.size() &&
+             std::fseek(f, (long)header.dataOffset, SEEK_SET) == 0;
+    }
+    if (ok) {
+        data.resize((size_t)offsets.back());
+        ok = data.empty() || std::fread(&data[0], 1, data.size(), f) == data.size();
+    }
+    std::fclose(f);
+    if (!ok) {
+        return false;
+    }
+    const int bytes = (int)header.bytesPerLabel, lengthBytes = (int)header.runLengthBytes;
+    labels.create((int)header.height, (int)header.width, CV_32SC1);
+    for (int y = 0; y < labels.rows; y++) {
+        int* l = labels.ptr<int>(y);
+        int x = 0;
+        for (uint64_t i = offsets[y]; i + bytes + lengthBytes <= offsets[y + 1]; i += bytes + lengthBytes) {
+            int value = getLabel(&data[i], bytes);
+            uint32_t length = getLength(&data[i + bytes], lengthBytes);
+            if (length > (uint32_t)(labels.cols - x)) {
+                return false;
+            }
+            std::fill(l + x, l + x + length, value);
+            x += (int)length;
+        }
+        if (x != labels.cols) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Polígonos: caja de cada región (por bandas de filas y por corridas), y los
+// contornos exteriores de cada una en paralelo sobre su caja
+inline bool writeLabelMapPolygons(const std::string& path, const cv::Mat& labels) {
+    using namespace label_map_io_detail;
+    CV_Assert(labels.type() == CV_32SC1);
+    TraceZone zone("write labels polygons");
+    const int maxLabel = std::max(maxLabelOf(labels), 0);
+    const int bands = std::max(1, std::min(labels.rows, 4 * cv::getNumThreads()));
+    // x0, y0, x1, y1 (inclusivos) de cada etiqueta en cada banda
+    std::vector<cv::Vec4i> bandBoxes((size_t)bands * (maxLabel + 1), cv::Vec4i(INT_MAX, INT_MAX, -1, -1));
+    cv::parallel_for_(cv::Range(0, bands), [&](const cv::Range& range) {
+        for (int b = range.start; b < range.end; b++) {
+            cv::Vec4i* box = &bandBoxes[(size_t)b * (maxLabel + 1)];
+            for (int y = b * labels.rows / bands; y < (b + 1) * labels.rows / bands; y++) {
+                const int* l = labels.ptr<int>(y);
+                for (int x = 0; x < labels.cols;) {
+                    int end = x + 1;
+                    while (end < labels.cols && l[end] == l[x]) {
+                        end++;
+                    }
+                    if (l[x] > 0) {
+                        cv::Vec4i& v = box[l[x]];
+                        v = cv::Vec4i(std::min(v[0], x), std::min(v[1], y), std::max(v[2], end - 1), y);
+                    }
+                    x = end;
+                }
+            }
+        }
+    });
+    std::vector<cv::Rect> boxes(maxLabel + 1);
+    for (int label = 1; label <= maxLabel; label++) {
+        cv::Vec4i v(INT_MAX, INT_MAX, -1, -1);
+        for (int b = 0; b < bands; b++) {
+            const cv::Vec4i& u = bandBoxes[(size_t)b * (maxLabel + 1) + label];
+            v = cv::Vec4i(std::min(v[0], u[0]), std::min(v[1], u[1]), std::max(v[2], u[2]), std::max(v[3], u[3]));
+        }
+        if (v[2] >= 0) {
+            boxes[label] = cv::Rect(v[0], v[1], v[2] - v[0] + 1, v[3] - v[1] + 1);
+        }
+    }
+
+    std::vector<std::string> text(boxes.size());
+    cv::parallel_for_(cv::Range(1, (int)boxes.size()), [&](const cv::Range& range) {
+        cv::Mat mask;
+        std::vector<std::vector<cv::Point>> contours;
+        for (int label = range.start; label < range.end; label++) {
+            const cv::Rect& box = boxes[label];
+            if (box.area() == 0) {
+                continue;
+            }
+            cv::compare(labels(box), cv::Scalar(label), mask, cv::CMP_EQ);
+            cv::findContours(mask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE, box.tl());
+            std::ostringstream out;
+            for (const std::vector<cv::Point>& contour : contours) {
+                out << label << " " << contour.size();
+                for (const cv::Point& p : contour) {
+                    out << " " << p.x << " " << p.y;
+                }
+                out << "\n";
+            }
+            text[label] = out.str();
+        }
+    });
+
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+    bool ok = std::fprintf(f, "# label_map_polygons 1 %d %d %d\n", labels.cols, labels.rows, maxLabel) > 0;
+    for (size_t i = 1; ok && i < text.size(); i++) {
+        ok = text[i].empty() || std::fwrite(text[i].data(), 1, text[i].size(), f) == text[i].size();
+    }
+    return std::fclose(f) == 0 && ok;
+}
+
+// Elige el formato por la extensión: .lbl (crudo), .rle o .txt (polígonos).
+// Devuelve false sin escribir nada si la extensión es otra
+inline bool writeLabelMap(const std::string& path, const cv::Mat& labels) {
+    using namespace label_map_io_detail;
+    if (hasSuffix(path, ".lbl")) {
+        return writeLabelMapRaw(path, labels);
+    }
+    if (hasSuffix(path, ".rle")) {
+        return writeLabelMapRle(path, labels);
+    }
+    if (hasSuffix(path, ".txt")) {
+        return writeLabelMapPolygons(path, labels);
+    }
+    return false;
+}
+
+// dst (CV_8UC3): colors[i - 1] para la etiqueta i, negro para -1, 0 y las
+// etiquetas fuera de la tabla
+inline void colorizeLabels(const cv::Mat& labels, const std::vector<cv::Vec3b>& colors, cv::Mat& dst) {
+    CV_Assert(labels.type() == CV_32SC1);
+    TraceZone zone("colorize labels");
+    std::vector<cv::Vec3b> table(colors.size() + 2, cv::Vec3b(0, 0, 0));
+    std::copy(colors.begin(), colors.end(), table.begin() + 2);
+    const unsigned size = (unsigned)table.size();
+    dst.create(labels.size(), CV_8UC3);
+    cv::parallel_for_(cv::Range(0, labels.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            const int* l = labels.ptr<int>(y);
+            cv::Vec3b* out = dst.ptr<cv::Vec3b>(y);
+            for (int x = 0; x < labels.cols; x++) {
+                unsigned i = (unsigned)(l[x] + 1);
+                out[x] = table[i < size ? i : 0];
+            }
+        }
+    });
+}
+
+#endif // LABEL_MAP_IO_HPP
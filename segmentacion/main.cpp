@@ -3,109 +3,110 @@
 #include <opencv2/imgproc.hpp>
 #include <opencv2/highgui.hpp>
 #include <iostream>
+#include <cctype>
+
+#include <sys/stat.h>
+
+#include "perf_counters.hpp"
+#include "trace.hpp"
+#include "image_source.hpp"
+#include "binary_morphology.hpp"
+#include "sharpen_binarize.hpp"
+#include "distance_transform.hpp"
+#include "connected_components.hpp"
+#include "tiled_watershed.hpp"
+#include "label_map_io.hpp"
 
 using namespace std;
 using namespace cv;
 
-int main(int argc, char *argv[])
+// Segments one image: black background, Laplacian sharpening, Otsu binarization,
+// distance-transform peaks as markers and watershed. Shows the intermediate
+// images and returns the colorized segmentation. With tiled the watershed is
+// flooded by tiles in parallel (tiled_watershed.hpp), which approximates
+// cv::watershed but does not reproduce it pixel for pixel.
+// If labelsPath is given the label map is also saved there (format by
+// extension, see label_map_io.hpp).
+static Mat segmentImage( Mat src, PerfStageRecorder* perfRecorder, bool tiled, const String& labelsPath = String() )
 {
-    // Load the image
-    CommandLineParser parser( argc, argv, "{@input | ../Data/cards.png | input image}" );
-    Mat src = imread( samples::findFile( parser.get<String>( "@input" ) ) );
-    if( src.empty() )
-    {
-        cout << "Could not open or find the image!\n" << endl;
-        cout << "Usage: " << argv[0] << " <Input image>" << endl;
-        return -1;
-    }
-
     // Show the source image
     imshow("Source Image", src);
 
-    // Change the background from white to black, since that will help later to extract
-    // better results during the use of Distance Transform
-    Mat mask;
-    inRange(src, Scalar(255, 255, 255), Scalar(255, 255, 255), mask);
-    src.setTo(Scalar(0, 0, 0), mask);
-
-    // Show output image
-    imshow("Black Background Image", src);
-
-    // Create a kernel that we will use to sharpen our image
-    Mat kernel = (Mat_<float>(3,3) <<
-                  1,  1, 1,
-                  1, -8, 1,
-                  1,  1, 1); // an approximation of second derivative, a quite strong kernel
-
-    // do the laplacian filtering as it is
-    // well, we need to convert everything in something more deeper then CV_8U
-    // because the kernel has some negative values,
-    // and we can expect in general to have a Laplacian image with negative values
-    // BUT a 8bits unsigned int (the one we are working with) can contain values from 0 to 255
-    // so the possible negative number will be truncated
-    Mat imgLaplacian;
-    filter2D(src, imgLaplacian, CV_32F, kernel);
-    Mat sharp;
-    src.convertTo(sharp, CV_32F);
-    Mat imgResult = sharp - imgLaplacian;
-
-    // convert back to 8bits gray scale
-    imgResult.convertTo(imgResult, CV_8UC3);
-    imgLaplacian.convertTo(imgLaplacian, CV_8UC3);
-
-    // imshow( "Laplace Filtered Image", imgLaplacian );
+    // Change the background from white to black (that helps the Distance Transform
+    // later), sharpen with a 3x3 Laplacian, convert to gray and build the Otsu
+    // histogram, all in one banded pass without float buffers (sharpen_binarize.hpp)
+    PerfScope perfSharpen( perfRecorder, "sharpen" );
+    Mat blackBackground, imgResult, bw;
+    vector<int> histogram;
+    sharpenToGray( src, imgResult, bw, histogram, &blackBackground );
+    perfSharpen.stop();
+
+    // Show output images
+    imshow("Black Background Image", blackBackground);
     imshow( "New Sharped Image", imgResult );
 
     // Create binary image from source image
-    Mat bw;
-    cvtColor(imgResult, bw, COLOR_BGR2GRAY);
-    threshold(bw, bw, 40, 255, THRESH_BINARY | THRESH_OTSU);
+    PerfScope perfBinarize( perfRecorder, "binarize" );
+    threshold(bw, bw, otsuThreshold( histogram ), 255, THRESH_BINARY);
+    perfBinarize.stop();
     imshow("Binary Image", bw);
 
-    // Perform the distance transform algorithm
+    // Perform the distance transform algorithm: exact Euclidean distance, computed
+    // in parallel, that also returns its range (distance_transform.hpp)
+    PerfScope perfDistance( perfRecorder, "distance" );
     Mat dist;
-    distanceTransform(bw, dist, DIST_L2, 3);
-
-    // Normalize the distance image for range = {0.0, 1.0}
-    // so we can visualize and threshold it
-    normalize(dist, dist, 0, 1.0, NORM_MINMAX);
-    imshow("Distance Transform Image", dist);
+    float minDist, maxDist;
+    euclideanDistanceTransform( bw, dist, &minDist, &maxDist );
 
-    // Threshold to obtain the peaks
+    // Normalize the distance image for range = {0.0, 1.0} so we can visualize it,
+    // and threshold it at 0.4 in the same pass to obtain the peaks
     // This will be the markers for the foreground objects
-    threshold(dist, dist, 0.4, 1.0, THRESH_BINARY);
+    BinaryImage peaks;
+    normalizeDistancePeaks( dist, minDist, maxDist, 0.4f, peaks );
+    perfDistance.stop();
+    imshow("Distance Transform Image", dist);
 
-    // Dilate a bit the dist image
+    // Dilate a bit the peaks, still as a bit-packed mask, and expand them back to
+    // an 8-bit mask
+    PerfScope perfPeaks( perfRecorder, "peaks" );
     Mat kernel1 = Mat::ones(3, 3, CV_8U);
-    dilate(dist, dist, kernel1);
-    imshow("Peaks", dist);
+    binaryDilate( peaks, peaks, kernel1 );
+    Mat peaksMask;
+    binaryUnpack( peaks, peaksMask );
+    perfPeaks.stop();
+    imshow("Peaks", peaksMask);
 
-    // Create the CV_8U version of the distance image
-    // It is needed for findContours()
-    Mat dist_8u;
-    dist.convertTo(dist_8u, CV_8U);
+    // Create the marker image for the watershed algorithm: every connected peak
+    // region gets its own label 1..N, written straight into the CV_32S image by
+    // the parallel labelling (connected_components.hpp)
+    PerfScope perfMarkers( perfRecorder, "markers" );
+    int64 markersStart = getTickCount();
+    Mat markers;
+    vector<ComponentStats> peakRegions;
+    int markerCount = StripConnectedComponents().run( peaksMask, peakRegions, &markers );
 
-    // Find total markers
-    vector<vector<Point> > contours;
-    findContours(dist_8u, contours, RETR_EXTERNAL, CHAIN_APPROX_SIMPLE);
-
-    // Create the marker image for the watershed algorithm
-    Mat markers = Mat::zeros(dist.size(), CV_32S);
-
-    // Draw the foreground markers
-    for (size_t i = 0; i < contours.size(); i++)
-    {
-        drawContours(markers, contours, static_cast<int>(i), Scalar(static_cast<int>(i)+1), -1);
-    }
-
-    // Draw the background marker
-    circle(markers, Point(5,5), 3, Scalar(255), -1);
+    // Draw the background marker with its own label
+    circle( markers, Point(5,5), 3, Scalar( markerCount + 1 ), -1 );
+    double markersMs = (getTickCount() - markersStart) * 1000.0 / getTickFrequency();
+    perfMarkers.stop();
+    cout << "Markers: " << markerCount << " + background (" << markersMs << " ms)" << endl;
     Mat markers8u;
     markers.convertTo(markers8u, CV_8U, 10);
     imshow("Markers", markers8u);
 
-    // Perform the watershed algorithm
-    watershed(imgResult, markers);
+    // Perform the watershed algorithm. With --tiled it is flooded by tiles in
+    // parallel and merged along the tile borders (tiled_watershed.hpp), an
+    // approximation of cv::watershed, not the same segmentation
+    PerfScope perfWatershed( perfRecorder, "watershed" );
+    if( tiled )
+    {
+        tiledWatershed( imgResult, markers );
+    }
+    else
+    {
+        watershed( imgResult, markers );
+    }
+    perfWatershed.stop();
 
     Mat mark;
     markers.convertTo(mark, CV_8U);
@@ -114,8 +115,9 @@ int main(int argc, char *argv[])
     // image looks like at that point
 
     // Generate random colors
+    PerfScope perfColorize( perfRecorder, "colorize" );
     vector<Vec3b> colors;
-    for (size_t i = 0; i < contours.size(); i++)
+    for (int i = 0; i < markerCount; i++)
     {
         int b = theRNG().uniform(0, 256);
         int g = theRNG().uniform(0, 256);
@@ -124,25 +126,135 @@ int main(int argc, char *argv[])
         colors.push_back(Vec3b((uchar)b, (uchar)g, (uchar)r));
     }
 
-    // Create the result image
-    Mat dst = Mat::zeros(markers.size(), CV_8UC3);
+    // Fill labeled objects with random colors through a label -> color table
+    Mat dst;
+    colorizeLabels( markers, colors, dst );
+    perfColorize.stop();
 
-    // Fill labeled objects with random colors
-    for (int i = 0; i < markers.rows; i++)
+    // Save the label map
+    if( !labelsPath.empty() )
     {
-        for (int j = 0; j < markers.cols; j++)
+        PerfScope perfExport( perfRecorder, "export" );
+        if( !writeLabelMap( labelsPath, markers ) )
         {
-            int index = markers.at<int>(i,j);
-            if (index > 0 && index <= static_cast<int>(contours.size()))
-            {
-                dst.at<Vec3b>(i,j) = colors[index-1];
-            }
+            cout << "Could not write " << labelsPath << endl;
         }
     }
 
     // Visualize the final image
     imshow("Final Result", dst);
+    return dst;
+}
 
-    waitKey();
+// Label map file for a frame: <dir>/<base>_<index>.<extension>. The base is the
+// input's file name without the "#index" suffix of stream frames or the file
+// extension, with anything but letters, digits, '-', '_' and '.' replaced by '_'
+// (so "raw:640x480:gray:/dev/stdin#3" gives "stdin_000003" and "cam:0#12"
+// gives "cam_0_000012")
+static String labelMapPath( const ImageFrame& frame, const String& dir, const String& extension )
+{
+    String base = frame.name.substr( 0, frame.name.rfind( '#' ) );
+    size_t slash = base.find_last_of( "/\\" );
+    if( slash != String::npos )
+    {
+        base = base.substr( slash + 1 );
+    }
+    size_t dot = base.rfind( '.' );
+    if( dot != String::npos && dot > 0 )
+    {
+        base = base.substr( 0, dot );
+    }
+    for( size_t i = 0; i < base.size(); i++ )
+    {
+        unsigned char c = (unsigned char)base[i];
+        if( !isalnum( c ) && c != '-' && c != '_' && c != '.' )
+        {
+            base[i] = '_';
+        }
+    }
+    if( base.empty() )
+    {
+        base = "frame";
+    }
+    return dir + "/" + base + format( "_%06d.", (int)frame.index ) + extension;
+}
+
+int main(int argc, char *argv[])
+{
+    // Load the image(s): a file, a directory, a quoted glob, a video or a raw stream
+    // (see image_source.hpp), decoded in the background while the previous one is segmented
+    CommandLineParser parser( argc, argv,
+                              "{@input | ../Data/cards.png | input image, directory, glob, video or raw:WxH:format:path}"
+                              "{perf | | measure every stage with hardware counters (single-threaded OpenCV)}"
+                              "{perf-csv | | write the per-stage counters to this CSV file}"
+                              "{perf-json | | write the per-stage counters to this JSON file}"
+                              "{trace | | write a Chrome trace timeline of the stages to this file}"
+                              "{tiled | | run the tiled parallel watershed, an approximation of cv::watershed}"
+                              "{labels | | save each label map as <name>_<index> with this extension: lbl (raw uint16/uint32), rle or txt (polygons)}"
+                              "{labels-dir | . | directory for the label maps (created if missing)}" );
+    String usage = "Usage: " + String( argv[0] ) + " <Input image> [--perf] [--perf-csv=file] [--perf-json=file] [--trace=file] [--tiled] [--labels=lbl|rle|txt [--labels-dir=dir]]";
+    String input = parser.get<String>( "@input" );
+    TraceSession traceSession( parser.get<String>( "trace" ) );
+    String labelsExtension = parser.get<String>( "labels" );
+    String labelsDir = parser.get<String>( "labels-dir" );
+    if( parser.has( "labels" ) && labelsExtension != "lbl" && labelsExtension != "rle" && labelsExtension != "txt" )
+    {
+        cout << "Unknown label map format: " << labelsExtension << endl;
+        cout << usage << endl;
+        return -1;
+    }
+    if( !labelsExtension.empty() )
+    {
+        mkdir( labelsDir.c_str(), 0755 );   // May already exist
+    }
+    bool tiled = parser.has( "tiled" );
+    // Plain file names are still looked up in the OpenCV samples directories
+    if( ImageSource::expand( input ).empty() && input.compare( 0, 4, "raw:" ) != 0 &&
+        input.compare( 0, 4, "cam:" ) != 0 && !ImageSource::isVideoPath( input ) )
+    {
+        String found = samples::findFile( input, false );
+        if( !found.empty() )
+        {
+            input = found;
+        }
+    }
+    ImageSource source;
+    if( !source.open( input ) )
+    {
+        cout << "Could not open or find the image!\n" << endl;
+        cout << source.error() << endl;
+        cout << usage << endl;
+        return -1;
+    }
+
+    // Hardware counters follow the calling thread only, so OpenCV's pool is
+    // disabled while measuring
+    String perfCsv = parser.get<String>( "perf-csv" );
+    String perfJson = parser.get<String>( "perf-json" );
+    bool perf = parser.has( "perf" ) || !perfCsv.empty() || !perfJson.empty();
+    PerfStageRecorder perfStages( "segmentacion" );
+    PerfStageRecorder* perfRecorder = perf ? &perfStages : nullptr;
+    if( perf )
+    {
+        setNumThreads( 1 );
+    }
+
+    // Any key moves to the next image, ESC stops
+    ImageFrame frame;
+    while( source.read( frame ) )
+    {
+        perfStages.setLabel( frame.name );
+        segmentImage( frame.image, perfRecorder, tiled, labelsExtension.empty() ? String() : labelMapPath( frame, labelsDir, labelsExtension ) );
+        if( waitKey() == 27 )
+        {
+            break;
+        }
+    }
+
+    if( perfRecorder )
+    {
+        perfRecorder->report( perfCsv, perfJson );
+    }
+    traceSession.write();
     return 0;
 }
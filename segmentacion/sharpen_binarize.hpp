@@ -0,0 +1,202 @@
+#ifndef SHARPEN_BINARIZE_HPP
+#define SHARPEN_BINARIZE_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+#include <stdint.h>
+
+#include "opencv2/core.hpp"
+
+#include "trace.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SHARPEN_BINARIZE_USE_SSE2 1
+#endif
+
+// Entrada de la segmentación en una sola pasada por bandas de filas.
+//
+// El camino original hace inRange + setTo (fondo blanco a negro), filter2D
+// del laplaciano 3x3 a CV_32F, convertTo de la fuente a CV_32F, la resta,
+// dos convertTo de vuelta a 8 bits, cvtColor a gris y threshold con Otsu:
+// unas nueve pasadas y varios buffers float de 12 bytes por píxel.
+//
+// sharpenToGray hace todo eso por fila, en paralelo por bandas:
+//   - cada fila de la fuente se carga a int16 con el fondo blanco ya en negro
+//     y con un píxel de borde reflejado de cada lado (BORDER_REFLECT_101, el
+//     de filter2D); cada banda guarda solo tres filas así,
+//   - fuente - laplaciano = 9 c - (suma de los 8 vecinos) = 10 c - caja 3x3;
+//     la caja es la suma de las tres filas seguida de la suma de tres
+//     píxeles, en int16 con SSE2 (8 canales por instrucción) y saturación a
+//     8 bits con packus (convertTo redondea y satura igual: los valores son
+//     enteros),
+//   - el gris usa la misma aritmética fija que cvtColor(BGR2GRAY)
+//     ((1868 b + 9617 g + 4899 r + 2^13) >> 14) y se acumula el histograma
+//     de la banda.
+// otsuThreshold reproduce el umbral de THRESH_OTSU sobre el histograma, así
+// que después alcanza con un threshold común: el resultado es idéntico bit a
+// bit al del camino original, sin ningún buffer float.
+
+namespace sharpen_binarize_detail {
+
+inline int reflect101(int i, int n) {
+    if (n == 1) {
+        return 0;
+    }
+    return i < 0 ? -i : (i >= n ? 2 * n - 2 - i : i);
+}
+
+// Fila de la fuente a int16 con el fondo blanco en negro y un píxel
+// reflejado a cada lado: out tiene (cols + 2) * 3 valores
+inline void loadRow(const uchar* src, int cols, int16_t* out, uchar* background) {
+    int16_t* p = out + 3;
+    for (int x = 0; x < cols; x++) {
+        uchar b = src[3 * x], g = src[3 * x + 1], r = src[3 * x + 2];
+        if ((b & g & r) == 255) {
+            b = g = r = 0;
+        }
+        p[3 * x] = b;
+        p[3 * x + 1] = g;
+        p[3 * x + 2] = r;
+        if (background) {
+            background[3 * x] = b;
+            background[3 * x + 1] = g;
+            background[3 * x + 2] = r;
+        }
+    }
+    int left = reflect101(-1, cols), right = reflect101(cols, cols);
+    for (int c = 0; c < 3; c++) {
+        out[c] = p[3 * left + c];
+        p[3 * cols + c] = p[3 * right + c];
+    }
+}
+
+// Una fila de salida: sharp = sat(10 centro - caja 3x3) y su gris
+inline void sharpenRow(const int16_t* above, const int16_t* center, const int16_t* below, int cols,
+                       int16_t* vertical, uchar* sharp, uchar* gray, int* histogram) {
+    const int n = (cols + 2) * 3;
+    for (int i = 0; i < n; i++) {
+        vertical[i] = (int16_t)(above[i] + center[i] + below[i]);
+    }
+    const int m = cols * 3;
+    const int16_t* v = vertical + 3;
+    const int16_t* c = center + 3;
+    int i = 0;
+#ifdef SHARPEN_BINARIZE_USE_SSE2
+    const __m128i ten = _mm_set1_epi16(10);
+    for (; i + 16 <= m; i += 16) {
+        __m128i box0 = _mm_add_epi16(_mm_add_epi16(_mm_loadu_si128((const __m128i*)(v + i - 3)),
+                                                   _mm_loadu_si128((const __m128i*)(v + i))),
+                                     _mm_loadu_si128((const __m128i*)(v + i + 3)));
+        __m128i box1 = _mm_add_epi16(_mm_add_epi16(_mm_loadu_si128((const __m128i*)(v + i + 5)),
+                                                   _mm_loadu_si128((const __m128i*)(v + i + 8))),
+                                     _mm_loadu_si128((const __m128i*)(v + i + 11)));
+        __m128i r0 = _mm_sub_epi16(_mm_mullo_epi16(_mm_loadu_si128((const __m128i*)(c + i)), ten), box0);
+        __m128i r1 = _mm_sub_epi16(_mm_mullo_epi16(_mm_loadu_si128((const __m128i*)(c + i + 8)), ten), box1);
+        _mm_storeu_si128((__m128i*)(sharp + i), _mm_packus_epi16(r0, r1));
+    }
+#endif
+    for (; i < m; i++) {
+        sharp[i] = cv::saturate_cast<uchar>(10 * c[i] - (v[i - 3] + v[i] + v[i + 3]));
+    }
+    for (int x = 0; x < cols; x++) {
+        const uchar* p = sharp + 3 * x;
+        int g = (p[0] * 1868 + p[1] * 9617 + p[2] * 4899 + (1 << 13)) >> 14;
+        gray[x] = (uchar)g;
+        histogram[g]++;
+    }
+}
+
+} // namespace sharpen_binarize_detail
+
+// src CV_8UC3 (BGR). sharp: fuente con fondo negro menos el laplaciano
+// (CV_8UC3); gray: su gris; histogram: 256 cuentas del gris. background, si
+// se pasa, recibe la fuente con el fondo en negro (solo para mostrarla)
+inline void sharpenToGray(const cv::Mat& src, cv::Mat& sharp, cv::Mat& gray, std::vector<int>& histogram,
+                          cv::Mat* background = nullptr, int tileRows = 0) {
+    using namespace sharpen_binarize_detail;
+    CV_Assert(src.type() == CV_8UC3);
+    const int rows = src.rows, cols = src.cols;
+    sharp.create(src.size(), CV_8UC3);
+    gray.create(src.size(), CV_8UC1);
+    if (background) {
+        background->create(src.size(), CV_8UC3);
+    }
+    histogram.assign(256, 0);
+    if (src.empty()) {
+        return;
+    }
+    if (tileRows <= 0) {
+        tileRows = std::max(16, rows / (4 * std::max(1, cv::getNumThreads())));
+    }
+    const int numTiles = (rows + tileRows - 1) / tileRows;
+    std::vector<int> tileHistograms((size_t)numTiles * 256, 0);
+
+    cv::parallel_for_(cv::Range(0, numTiles), [&](const cv::Range& range) {
+        const int n = (cols + 2) * 3;
+        // Tres filas cargadas (arriba, centro, abajo) y la suma vertical.
+        // El relleno de 8 valores deja leer de más al final con SSE2
+        std::vector<int16_t> buffer(4 * (n + 8), 0);
+        for (int t = range.start; t < range.end; t++) {
+            TraceZone zone("sharpen tile", "tile", t);
+            int y0 = t * tileRows, y1 = std::min(rows, y0 + tileRows);
+            int16_t* loaded[3] = {&buffer[0], &buffer[n + 8], &buffer[2 * (n + 8)]};
+            int16_t* vertical = &buffer[3 * (n + 8)];
+            int* hist = &tileHistograms[(size_t)t * 256];
+            loadRow(src.ptr<uchar>(reflect101(y0 - 1, rows)), cols, loaded[0], nullptr);
+            loadRow(src.ptr<uchar>(y0), cols, loaded[1], background ? background->ptr<uchar>(y0) : nullptr);
+            for (int y = y0; y < y1; y++) {
+                int below = reflect101(y + 1, rows);
+                // La fila de abajo solo escribe el fondo si es la siguiente de la banda
+                uchar* out = (background && below == y + 1 && y + 1 < y1) ? background->ptr<uchar>(below) : nullptr;
+                loadRow(src.ptr<uchar>(below), cols, loaded[2], out);
+                sharpenRow(loaded[0], loaded[1], loaded[2], cols, vertical, sharp.ptr<uchar>(y), gray.ptr<uchar>(y),
+                           hist);
+                std::rotate(loaded, loaded + 1, loaded + 3);
+            }
+        }
+    });
+
+    for (int t = 0; t < numTiles; t++) {
+        for (int i = 0; i < 256; i++) {
+            histogram[i] += tileHistograms[(size_t)t * 256 + i];
+        }
+    }
+}
+
+// Umbral de Otsu sobre un histograma de 256 niveles, con la misma cuenta que
+// threshold(..., THRESH_OTSU) de OpenCV
+inline double otsuThreshold(const std::vector<int>& histogram) {
+    CV_Assert(histogram.size() == 256);
+    double total = 0, mu = 0;
+    for (int i = 0; i < 256; i++) {
+        total += histogram[i];
+        mu += i * (double)histogram[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    const double scale = 1. / total;
+    mu *= scale;
+    double mu1 = 0, q1 = 0, maxSigma = 0, maxVal = 0;
+    for (int i = 0; i < 256; i++) {
+        double p = histogram[i] * scale;
+        mu1 *= q1;
+        q1 += p;
+        double q2 = 1. - q1;
+        if (std::min(q1, q2) < FLT_EPSILON || std::max(q1, q2) > 1. - FLT_EPSILON) {
+            continue;
+        }
+        mu1 = (mu1 + i * p) / q1;
+        double mu2 = (mu - q1 * mu1) / q2;
+        double sigma = q1 * q2 * (mu1 - mu2) * (mu1 - mu2);
+        if (sigma > maxSigma) {
+            maxSigma = sigma;
+            maxVal = i;
+        }
+    }
+    return maxVal;
+}
+
+#endif // SHARPEN_BINARIZE_HPP
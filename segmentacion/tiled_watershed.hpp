@@ -0,0 +1,305 @@
+#ifndef TILED_WATERSHED_HPP
+#define TILED_WATERSHED_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <stdint.h>
+
+#include "opencv2/core.hpp"
+
+#include "trace.hpp"
+
+// Watershed por marcadores en paralelo, por baldosas. Es una aproximación de
+// watershed(src, markers) de OpenCV, no el mismo resultado.
+//
+// Acá se calcula el bosque de expansión mínima con raíces en los marcadores
+// (cada árbol contiene un solo marcador) con Kruskal, que se puede repartir:
+//   - aristas: los pares de vecinos 4-conexos del interior (el marco de la
+//     imagen queda en -1, como en OpenCV), con peso = diferencia de color
+//     (máximo por canal) y un orden total fijo (peso, y a igual peso el orden
+//     de barrido de la imagen), así el bosque es único y no depende de cómo
+//     se reparta,
+//   - cada baldosa inunda sus aristas internas de menor a mayor peso con 256
+//     baldes y un union-find. Una unión es segura si una de las dos partes es
+//     "cerrada" (ningún píxel con vecino en otra baldosa) y sin marcador, o si
+//     las dos son cerradas: lo que pase fuera de la baldosa no puede cambiar
+//     esa decisión. Las demás aristas se difieren a la fusión, y la baldosa
+//     las cuenta como unidas para descartar las siguientes que cierren ciclo
+//     (esas también se descartan en el resultado global),
+//   - la fusión recorre en orden solo las aristas diferidas y las que cruzan
+//     entre baldosas (del orden del perímetro de las baldosas y los
+//     marcadores, no del área) con la misma regla de Kruskal: se une salvo
+//     que ya estén conectadas o que las dos partes tengan marcador,
+//   - la etiqueta de cada píxel es la de su conjunto; los píxeles entre
+//     regiones distintas (a la derecha o abajo) quedan en -1 como líneas de
+//     watershed.
+// El resultado es idéntico para cualquier tamaño de baldosa y cantidad de
+// hilos, incluso una sola baldosa.
+//
+// La inundación de OpenCV no es este bosque, por tres motivos:
+//   - la prioridad de un píxel se fija al entrar a la cola (la diferencia con
+//     el primer vecino etiquetado que lo encola) y no se corrige si después
+//     lo alcanza otra región por una arista más barata,
+//   - un píxel que toca dos regiones queda en -1 y la inundación no sigue a
+//     través de él, mientras que acá toda arista participa,
+//   - acá las líneas se marcan al final sobre píxeles que ya tenían región,
+//     así que ocupan el borde de una de las dos regiones en lugar de los
+//     píxeles donde se frenó la inundación.
+// En Data/cards.png coincide con watershed de OpenCV en el 97.5% de los
+// píxeles (99% sin contar los de las líneas), pero alguna región puede
+// quedar bastante distinta (intersección sobre unión de 0.77 en la peor).
+
+namespace tiled_watershed_detail {
+
+inline int findRoot(std::vector<int>& parent, int i) {
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+inline int findRootConst(const std::vector<int>& parent, int i) {
+    while (parent[i] != i) {
+        i = parent[i];
+    }
+    return i;
+}
+
+// Diferencia de color como en OpenCV: máximo de las diferencias por canal
+inline int colorDiff(const uchar* a, const uchar* b) {
+    int db = std::abs(a[0] - b[0]), dg = std::abs(a[1] - b[1]), dr = std::abs(a[2] - b[2]);
+    return std::max(db, std::max(dg, dr));
+}
+
+// Clave de orden de una arista: peso y después identificador de barrido
+// (2 * píxel + 0 a la derecha, + 1 hacia abajo)
+inline uint64_t edgeKey(int weight, int64_t id) {
+    return ((uint64_t)weight << 40) | (uint64_t)id;
+}
+
+// Unión por rango de dos raíces; la que queda lleva la etiqueta del
+// marcador, si alguna de las dos partes tenía
+inline void unite(std::vector<int>& parent, std::vector<uchar>& rank, int a, int b, int* label = nullptr) {
+    if (rank[a] < rank[b]) {
+        std::swap(a, b);
+    }
+    parent[b] = a;
+    if (rank[a] == rank[b]) {
+        rank[a]++;
+    }
+    if (label && label[a] == 0) {
+        label[a] = label[b];
+    }
+}
+
+} // namespace tiled_watershed_detail
+
+// src CV_8UC3, markers CV_32SC1 con las semillas (> 0) y el resto en 0, como
+// watershed(src, markers): a la salida cada píxel tiene la etiqueta de su
+// región, -1 en las líneas entre regiones y en el marco, y 0 si no llega
+// ninguna semilla. tileSize <= 0 usa baldosas de 256x256
+inline void tiledWatershed(const cv::Mat& src, cv::Mat& markers, int tileSize = 0) {
+    using namespace tiled_watershed_detail;
+    CV_Assert(src.type() == CV_8UC3 && markers.type() == CV_32SC1 && src.size() == markers.size());
+    TraceZone zone("tiled watershed");
+    const int rows = src.rows, cols = src.cols;
+    if (tileSize <= 0) {
+        tileSize = 256;
+    }
+    const int tilesX = (cols + tileSize - 1) / tileSize, tilesY = (rows + tileSize - 1) / tileSize;
+    const int numTiles = tilesX * tilesY;
+    const int total = rows * cols;
+
+    // Bosque global: padre, rango y etiqueta del marcador (válida en las
+    // raíces). Cada baldosa lo llena para sus píxeles
+    std::vector<int> parent(total), label(total);
+    std::vector<uchar> rank(total);
+    auto interior = [&](int y, int x) { return y > 0 && x > 0 && y < rows - 1 && x < cols - 1; };
+
+    // Inundación de cada baldosa; deferred[t] recibe sus aristas diferidas y
+    // las que cruzan a la baldosa de la derecha o de abajo
+    std::vector<std::vector<uint64_t>> deferred(numTiles);
+    cv::parallel_for_(cv::Range(0, numTiles), [&](const cv::Range& range) {
+        // Dos union-find locales: el de las uniones decididas (el bosque) y
+        // el que cuenta también las diferidas, con sus marcas
+        std::vector<int> forestParent, forestLabel, localParent, edges;
+        std::vector<uchar> forestRank, localRank, flags, weights;
+        enum { OPEN = 1, SEEDED = 2 };
+        for (int t = range.start; t < range.end; t++) {
+            TraceZone tileZone("watershed tile", "tile", t);
+            const int x0 = (t % tilesX) * tileSize, x1 = std::min(cols, x0 + tileSize);
+            const int y0 = (t / tilesX) * tileSize, y1 = std::min(rows, y0 + tileSize);
+            const int w = x1 - x0, n = w * (y1 - y0);
+            std::vector<uint64_t>& out = deferred[t];
+
+            // Conjuntos de la baldosa (cuentan también las aristas diferidas):
+            // abiertos si algún píxel tiene vecino en otra baldosa, con
+            // marcador si alguno es semilla
+            forestParent.resize(n);
+            forestLabel.assign(n, 0);
+            forestRank.assign(n, 0);
+            localParent.resize(n);
+            localRank.assign(n, 0);
+            flags.assign(n, 0);
+            for (int y = y0; y < y1; y++) {
+                const int* m = markers.ptr<int>(y);
+                for (int x = x0; x < x1; x++) {
+                    int i = (y - y0) * w + (x - x0);
+                    forestParent[i] = localParent[i] = i;
+                    if (!interior(y, x)) {
+                        continue;
+                    }
+                    bool open = (x == x0 && interior(y, x - 1)) || (x == x1 - 1 && interior(y, x + 1)) ||
+                                (y == y0 && interior(y - 1, x)) || (y == y1 - 1 && interior(y + 1, x));
+                    forestLabel[i] = std::max(m[x], 0);
+                    flags[i] = (uchar)((open ? OPEN : 0) | (m[x] > 0 ? SEEDED : 0));
+                }
+            }
+
+            // Pesos de las aristas internas (derecha y abajo de cada píxel);
+            // las que cruzan de baldosa van directo a la fusión
+            weights.assign(2 * (size_t)n, 0);
+            int counts[256] = {0};
+            for (int y = y0; y < y1; y++) {
+                const uchar* p = src.ptr<uchar>(y);
+                const uchar* below = y + 1 < rows ? src.ptr<uchar>(y + 1) : nullptr;
+                for (int x = x0; x < x1; x++) {
+                    if (!interior(y, x)) {
+                        continue;
+                    }
+                    int i = (y - y0) * w + (x - x0);
+                    int64_t id = 2 * ((int64_t)y * cols + x);
+                    if (interior(y, x + 1)) {
+                        int d = colorDiff(p + 3 * x, p + 3 * x + 3);
+                        if (x + 1 < x1) {
+                            weights[2 * i] = (uchar)d;
+                            counts[d]++;
+                        } else {
+                            out.push_back(edgeKey(d, id));
+                        }
+                    }
+                    if (interior(y + 1, x)) {
+                        int d = colorDiff(p + 3 * x, below + 3 * x);
+                        if (y + 1 < y1) {
+                            weights[2 * i + 1] = (uchar)d;
+                            counts[d]++;
+                        } else {
+                            out.push_back(edgeKey(d, id + 1));
+                        }
+                    }
+                }
+            }
+            // Baldes por peso: dentro de cada uno las aristas quedan en orden
+            // de barrido, que es el desempate global
+            int start[257];
+            start[0] = 0;
+            for (int k = 0; k < 256; k++) {
+                start[k + 1] = start[k] + counts[k];
+            }
+            edges.resize(start[256]);
+            for (int y = y0; y < y1; y++) {
+                for (int x = x0; x < x1; x++) {
+                    if (!interior(y, x)) {
+                        continue;
+                    }
+                    int i = (y - y0) * w + (x - x0);
+                    if (x + 1 < x1 && interior(y, x + 1)) {
+                        edges[start[weights[2 * i]]++] = 2 * i;
+                    }
+                    if (y + 1 < y1 && interior(y + 1, x)) {
+                        edges[start[weights[2 * i + 1]]++] = 2 * i + 1;
+                    }
+                }
+            }
+
+            // Kruskal por baldes dentro de la baldosa
+            for (int e : edges) {
+                const int i = e >> 1, j = (e & 1) ? i + w : i + 1;
+                int ti = findRoot(localParent, i), tj = findRoot(localParent, j);
+                if (ti == tj) {
+                    continue;
+                }
+                const int fi = flags[ti], fj = flags[tj];
+                if ((fi & SEEDED) && (fj & SEEDED)) {
+                    continue;
+                }
+                const bool closedI = !(fi & OPEN), closedJ = !(fj & OPEN);
+                if ((closedI && !(fi & SEEDED)) || (closedJ && !(fj & SEEDED)) || (closedI && closedJ)) {
+                    unite(forestParent, forestRank, findRoot(forestParent, i), findRoot(forestParent, j),
+                          &forestLabel[0]);
+                } else {
+                    int64_t id = 2 * ((int64_t)(y0 + i / w) * cols + x0 + i % w) + (e & 1);
+                    out.push_back(edgeKey(weights[e], id));
+                }
+                unite(localParent, localRank, ti, tj);
+                flags[ti] = flags[tj] = (uchar)(fi | fj);
+            }
+
+            // Bosque de la baldosa al global, con cada píxel apuntando a su raíz
+            for (int y = y0; y < y1; y++) {
+                for (int x = x0; x < x1; x++) {
+                    int i = (y - y0) * w + (x - x0), r = findRoot(forestParent, i);
+                    int g = y * cols + x;
+                    parent[g] = r == i ? g : (y0 + r / w) * cols + x0 + r % w;
+                    label[g] = forestLabel[r];
+                    rank[g] = forestRank[r];
+                }
+            }
+        }
+    });
+
+    // Fusión: aristas diferidas y entre baldosas, en el orden global
+    {
+        TraceZone mergeZone("watershed merge");
+        std::vector<uint64_t> pending;
+        for (const std::vector<uint64_t>& tileEdges : deferred) {
+            pending.insert(pending.end(), tileEdges.begin(), tileEdges.end());
+        }
+        std::sort(pending.begin(), pending.end());
+        const uint64_t idMask = ((uint64_t)1 << 40) - 1;
+        for (uint64_t key : pending) {
+            int64_t id = (int64_t)(key & idMask);
+            int i = (int)(id >> 1), j = (id & 1) ? i + cols : i + 1;
+            int ri = findRoot(parent, i), rj = findRoot(parent, j);
+            if (ri != rj && !(label[ri] && label[rj])) {
+                unite(parent, rank, ri, rj, &label[0]);
+            }
+        }
+    }
+
+    // Etiqueta de cada píxel (solo lectura del bosque) y después las líneas
+    // entre regiones, que se arman en label (ya no hace falta) y se copian.
+    // Las líneas pisan píxeles de región, a diferencia de OpenCV
+    cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            int* m = markers.ptr<int>(y);
+            for (int x = 0; x < cols; x++) {
+                m[x] = interior(y, x) ? label[findRootConst(parent, y * cols + x)] : -1;
+            }
+        }
+    });
+    cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            const int* m = markers.ptr<int>(y);
+            const int* below = y + 1 < rows ? markers.ptr<int>(y + 1) : nullptr;
+            int* out = &label[(size_t)y * cols];
+            for (int x = 0; x < cols; x++) {
+                int l = m[x];
+                if (l > 0 && ((x + 1 < cols && m[x + 1] > 0 && m[x + 1] != l) ||
+                              (below && below[x] > 0 && below[x] != l))) {
+                    l = -1;
+                }
+                out[x] = l;
+            }
+        }
+    });
+    cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            std::copy(&label[(size_t)y * cols], &label[(size_t)y * cols] + cols, markers.ptr<int>(y));
+        }
+    });
+}
+
+#endif // TILED_WATERSHED_HPP
@@ -1,7 +1,11 @@
 #include<iostream>
 #include<vector>
+#include<string>
 #include<opencv2/opencv.hpp>
 
+#include "trace.hpp"
+#include "image_source.hpp"
+
 //variables globales
 cv::Mat src_img;
 cv::Mat img;
@@ -83,8 +87,30 @@ void mouse(int event, int x, int y, int flag, void* user_data){
     dibujar();
 }
 
-int main(){
-    src_img = cv::imread("../Data/lena.jpg");
+//uso: ./segmentacion2 [--trace traza.json] [imagen | carpeta | "glob" | video]
+//con --trace cada segmentacion queda en la linea de tiempo; ESC termina y escribe la traza
+//con varias imagenes (cargadas en segundo plano, image_source.hpp) 'n' pasa a la siguiente
+int main(int argc, char** argv){
+    std::string trace_path;
+    std::vector<std::string> entradas;
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        if(arg == "--trace" && i + 1 < argc)
+            trace_path = argv[++i];
+        else
+            entradas.push_back(arg);
+    }
+    if(entradas.empty())
+        entradas.push_back("../Data/lena.jpg");
+    TraceSession trace_session(trace_path);
+
+    ImageSource fuente;
+    ImageFrame cuadro;
+    if(!fuente.open(entradas) || !fuente.read(cuadro)){
+        std::cout << "No se pudo abrir la imagen: " << fuente.error() << std::endl;
+        return -1;
+    }
+    src_img = cuadro.image;
     cv::namedWindow("Imagen original", cv::WINDOW_NORMAL);
     cv::setMouseCallback("Imagen original", mouse, NULL);
     cv::imshow("Imagen Original", src_img);
@@ -95,13 +121,32 @@ int main(){
 
     cv::Mat bgmodel, fgmodel;
 
+    int iteracion = 0;
     while(1){
         char c = cv::waitKey();
+        if(c == 27)
+            break;
+        if(c == 'n'){
+            //siguiente imagen: se reinicia el rectangulo y los modelos de grabCut
+            if(!fuente.read(cuadro))
+                break;
+            src_img = cuadro.image;
+            rect = cv::Rect(0,0,0,0);
+            bgmodel.release();
+            fgmodel.release();
+            cv::imshow("Imagen original", src_img);
+            continue;
+        }
+        TraceZone segmentation_zone("segmentacion", "iteracion", iteracion++);
+        TraceZone grabcut_zone("grabCut");
         cv::grabCut(src_img, result, rect, bgmodel, fgmodel, 5, cv::GC_INIT_WITH_RECT);
+        grabcut_zone.end();
 
+        TraceZone mask_zone("mascara");
         cv::compare(result, cv::GC_PR_FGD, result, cv::CMP_EQ);
         cv::Mat foreground(src_img.size(), CV_8UC3, cv::Scalar(255,255,255));
         src_img.copyTo(foreground, result);
+        mask_zone.end();
         cv::namedWindow("Imagen Segmentada");
         cv::imshow("Imagen segmentada", foreground);
     }
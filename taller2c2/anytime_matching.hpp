@@ -0,0 +1,217 @@
+#ifndef ANYTIME_MATCHING_HPP
+#define ANYTIME_MATCHING_HPP
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+
+#include "opencv2/core.hpp"
+#include "opencv2/calib3d.hpp"
+#include "opencv2/features2d.hpp"
+
+#include "feature_factory.hpp"
+
+// Matching "anytime" con presupuesto de latencia.
+//
+// En lugar de describir y emparejar todos los keypoints de una vez, se procesan
+// en bloques ordenados por respuesta (los más fuertes primero). Después de cada
+// bloque se intenta verificar la homografía; se devuelve en cuanto hay
+// suficientes inliers o se agota el tiempo, indicando en qué etapa se paró.
+
+typedef std::chrono::steady_clock AnytimeClock;
+
+enum AnytimeStage {
+    STAGE_DETECT = 0,
+    STAGE_DESCRIBE,
+    STAGE_MATCH,
+    STAGE_VERIFY,
+    STAGE_DONE
+};
+
+inline const char* anytimeStageName(AnytimeStage stage) {
+    switch (stage) {
+        case STAGE_DETECT: return "detección";
+        case STAGE_DESCRIBE: return "descripción";
+        case STAGE_MATCH: return "matching";
+        case STAGE_VERIFY: return "verificación";
+        default: return "completo";
+    }
+}
+
+struct AnytimeParams {
+    int chunkSize = 100;       // Keypoints por imagen añadidos en cada bloque
+    int maxKeypoints = 500;    // Tope total de keypoints por imagen
+    int minInliers = 15;       // Inliers suficientes para terminar antes
+};
+
+struct AnytimeResult {
+    int numKeypoints1 = 0;          // Keypoints del objeto efectivamente usados
+    int numKeypoints2 = 0;          // Keypoints de la escena efectivamente usados
+    int numMatches = 0;
+    int numGoodMatches = 0;
+    int numInliers = 0;
+    int chunksProcessed = 0;
+    bool homographySuccess = false;
+    bool budgetExceeded = false;    // true si se cortó por tiempo
+    AnytimeStage stoppedStage = STAGE_DONE;
+    double processingTime = 0;      // ms
+    cv::Mat homography;
+};
+
+// Ordena por respuesta descendente (estable, para que el resultado sea reproducible)
+inline void sortByResponse(std::vector<cv::KeyPoint>& keypoints) {
+    std::stable_sort(keypoints.begin(), keypoints.end(),
+                [](const cv::KeyPoint& a, const cv::KeyPoint& b) { return a.response > b.response; });
+}
+
+// Mezcla candidatos nuevos en la lista de los dos mejores vecinos de cada consulta
+inline void mergeTopTwo(std::vector<std::vector<cv::DMatch>>& best, const std::vector<std::vector<cv::DMatch>>& candidates,
+                        int queryOffset, int trainOffset) {
+    for (size_t i = 0; i < candidates.size(); i++) {
+        std::vector<cv::DMatch>& slot = best[queryOffset + i];
+        for (const cv::DMatch& c : candidates[i]) {
+            cv::DMatch m = c;
+            m.queryIdx += queryOffset;
+            m.trainIdx += trainOffset;
+            slot.push_back(m);
+        }
+        std::sort(slot.begin(), slot.end());
+        if (slot.size() > 2) {
+            slot.resize(2);
+        }
+    }
+}
+
+// Versión con presupuesto de processCombination. El llamador pasa un deadline
+// absoluto; la función nunca empieza un bloque nuevo después de ese instante.
+inline AnytimeResult processCombinationBudgeted(const cv::Mat& img1, const cv::Mat& img2,
+                                                const std::string& detectorName,
+                                                const std::string& descriptorName,
+                                                const std::string& matcherName,
+                                                AnytimeClock::time_point deadline,
+                                                const AnytimeParams& params = AnytimeParams()) {
+    AnytimeResult result;
+    AnytimeClock::time_point start = AnytimeClock::now();
+    auto finish = [&](AnytimeStage stage, bool exceeded) {
+        result.stoppedStage = stage;
+        result.budgetExceeded = exceeded;
+        result.processingTime = std::chrono::duration<double, std::milli>(AnytimeClock::now() - start).count();
+        return result;
+    };
+    auto expired = [&]() { return AnytimeClock::now() >= deadline; };
+
+    cv::Ptr<cv::Feature2D> detector = createDetector(detectorName);
+    cv::Ptr<cv::Feature2D> descriptor = createDescriptor(descriptorName);
+    bool isBinaryDescriptor = isBinaryDescriptorName(descriptorName);
+    cv::Ptr<cv::DescriptorMatcher> matcher = createMatcher(matcherName, isBinaryDescriptor);
+    if (!detector || !descriptor || !matcher) {
+        return finish(STAGE_DETECT, false);
+    }
+
+    // Detección (no se puede interrumpir a mitad; se comprueba al terminar)
+    std::vector<cv::KeyPoint> candidates1, candidates2;
+    detector->detect(img1, candidates1);
+    detector->detect(img2, candidates2);
+    if (expired()) {
+        return finish(STAGE_DETECT, true);
+    }
+
+    sortByResponse(candidates1);
+    sortByResponse(candidates2);
+    if ((int)candidates1.size() > params.maxKeypoints) candidates1.resize(params.maxKeypoints);
+    if ((int)candidates2.size() > params.maxKeypoints) candidates2.resize(params.maxKeypoints);
+
+    const float RATIO_THRESHOLD = isBinaryDescriptor ? 0.8f : 0.75f;
+    bool convertToFloat = matcherName == "FLANN" && !isBinaryDescriptor;
+
+    std::vector<cv::KeyPoint> keypoints1, keypoints2;
+    cv::Mat descriptors1, descriptors2;
+    std::vector<std::vector<cv::DMatch>> topTwo;   // Dos mejores vecinos de cada descriptor del objeto
+    size_t next1 = 0, next2 = 0;
+
+    while (next1 < candidates1.size() || next2 < candidates2.size()) {
+        // Descripción del bloque siguiente de cada imagen
+        size_t end1 = std::min(candidates1.size(), next1 + (size_t)params.chunkSize);
+        size_t end2 = std::min(candidates2.size(), next2 + (size_t)params.chunkSize);
+        std::vector<cv::KeyPoint> chunk1(candidates1.begin() + next1, candidates1.begin() + end1);
+        std::vector<cv::KeyPoint> chunk2(candidates2.begin() + next2, candidates2.begin() + end2);
+        next1 = end1;
+        next2 = end2;
+
+        cv::Mat chunkDesc1, chunkDesc2;
+        if (!chunk1.empty()) descriptor->compute(img1, chunk1, chunkDesc1);
+        if (!chunk2.empty()) descriptor->compute(img2, chunk2, chunkDesc2);
+        if (convertToFloat) {
+            if (!chunkDesc1.empty() && chunkDesc1.type() != CV_32F) chunkDesc1.convertTo(chunkDesc1, CV_32F);
+            if (!chunkDesc2.empty() && chunkDesc2.type() != CV_32F) chunkDesc2.convertTo(chunkDesc2, CV_32F);
+        }
+        result.chunksProcessed++;
+        if (expired()) {
+            return finish(STAGE_DESCRIBE, true);
+        }
+
+        // Matching incremental: cada par (objeto, escena) se compara una sola vez.
+        // Primero los descriptores viejos del objeto contra el bloque nuevo de la
+        // escena, luego el bloque nuevo del objeto contra toda la escena.
+        int oldRows1 = descriptors1.rows;
+        int oldRows2 = descriptors2.rows;
+        if (!chunkDesc2.empty()) {
+            descriptors2.push_back(chunkDesc2);
+            keypoints2.insert(keypoints2.end(), chunk2.begin(), chunk2.end());
+        }
+        if (oldRows1 > 0 && !chunkDesc2.empty()) {
+            std::vector<std::vector<cv::DMatch>> knn;
+            matcher->knnMatch(descriptors1, chunkDesc2, knn, 2);
+            mergeTopTwo(topTwo, knn, 0, oldRows2);
+        }
+        if (!chunkDesc1.empty()) {
+            descriptors1.push_back(chunkDesc1);
+            keypoints1.insert(keypoints1.end(), chunk1.begin(), chunk1.end());
+            topTwo.resize(descriptors1.rows);
+            if (!descriptors2.empty()) {
+                std::vector<std::vector<cv::DMatch>> knn;
+                matcher->knnMatch(chunkDesc1, descriptors2, knn, 2);
+                mergeTopTwo(topTwo, knn, oldRows1, 0);
+            }
+        }
+        result.numKeypoints1 = keypoints1.size();
+        result.numKeypoints2 = keypoints2.size();
+        if (expired()) {
+            return finish(STAGE_MATCH, true);
+        }
+
+        // Verificación con los matches acumulados
+        std::vector<cv::Point2f> obj, scene;
+        result.numMatches = 0;
+        for (const std::vector<cv::DMatch>& slot : topTwo) {
+            if (slot.empty()) continue;
+            result.numMatches++;
+            if (slot.size() >= 2 && slot[0].distance < RATIO_THRESHOLD * slot[1].distance) {
+                obj.push_back(keypoints1[slot[0].queryIdx].pt);
+                scene.push_back(keypoints2[slot[0].trainIdx].pt);
+            }
+        }
+        result.numGoodMatches = obj.size();
+
+        if (obj.size() >= 4) {
+            cv::Mat inlierMask;
+            cv::Mat homography = cv::findHomography(obj, scene, cv::RANSAC, 3.0, inlierMask);
+            if (!homography.empty()) {
+                result.homography = homography;
+                result.homographySuccess = true;
+                result.numInliers = cv::countNonZero(inlierMask);
+                if (result.numInliers >= params.minInliers) {
+                    return finish(STAGE_DONE, false);
+                }
+            }
+        }
+        if (expired()) {
+            return finish(STAGE_VERIFY, true);
+        }
+    }
+
+    return finish(STAGE_DONE, false);
+}
+
+#endif // ANYTIME_MATCHING_HPP
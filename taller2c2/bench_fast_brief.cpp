@@ -0,0 +1,142 @@
+#include <stdint.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <algorithm>
+#include <cstdlib>
+
+#include "opencv2/core.hpp"
+#include "opencv2/highgui.hpp"
+#include "opencv2/imgproc.hpp"
+#include "opencv2/features2d.hpp"
+#include "opencv2/xfeatures2d.hpp"
+
+#include "bench_utils.hpp"
+#include "fast_brief_engine.hpp"
+
+using namespace cv;
+using namespace cv::xfeatures2d;
+using namespace std;
+
+// Verifica la detección del motor FAST+BRIEF fusionado (fast_brief_engine.hpp)
+// contra FastFeatureDetector (tipo 9/16) sobre la misma imagen y umbral: las
+// esquinas deben ser las mismas, con y sin supresión de no máximos, y con
+// supresión también el score (sin supresión OpenCV deja la respuesta en 0).
+// Se prueba además una imagen de ruido, que ejercita el camino SSE2 y la cola
+// escalar con muchas esquinas de score bajo.
+//
+// Con umbral 0 o 1 una esquina puede tener score 0, que FastFeatureDetector
+// no distingue de "no esquina" en la supresión (y con umbral 0 reporta -1
+// como 255); en esos umbrales solo se compara sin supresión.
+//
+// Después mide el tiempo de FAST + BRIEF de OpenCV contra el motor fusionado.
+//
+// Uso: ./bench_fast_brief [imagen] [repeticiones]
+
+typedef map<pair<int, int>, float> CornerMap;
+
+static CornerMap toCornerMap(const vector<KeyPoint>& keypoints) {
+    CornerMap corners;
+    for (const KeyPoint& k : keypoints) {
+        corners[make_pair((int)k.pt.y, (int)k.pt.x)] = k.response;
+    }
+    return corners;
+}
+
+// Cantidad de esquinas que faltan, sobran o tienen otro score respecto de la referencia
+static int countMismatches(const vector<KeyPoint>& expected, const vector<KeyPoint>& actual, bool compareScores) {
+    CornerMap a = toCornerMap(expected), b = toCornerMap(actual);
+    int mismatches = 0;
+    for (const CornerMap::value_type& corner : a) {
+        CornerMap::const_iterator it = b.find(corner.first);
+        if (it == b.end() || (compareScores && it->second != corner.second)) {
+            mismatches++;
+        }
+    }
+    for (const CornerMap::value_type& corner : b) {
+        if (!a.count(corner.first)) {
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+static bool checkDetection(const string& name, const Mat& gray) {
+    const int thresholds[] = {0, 1, 2, 5, 10, 20, 40, 80};
+    bool ok = true;
+    for (int threshold : thresholds) {
+        for (int nonmax = 0; nonmax < 2; nonmax++) {
+            if (threshold < 2 && nonmax) {
+                continue;
+            }
+            vector<KeyPoint> expected, actual;
+            FastFeatureDetector::create(threshold, nonmax != 0, FastFeatureDetector::TYPE_9_16)->detect(gray, expected);
+            FastBriefParams params;
+            params.threshold = threshold;
+            params.nonmaxSuppression = nonmax != 0;
+            FastBriefEngine(params).detect(gray, actual);
+            int mismatches = countMismatches(expected, actual, nonmax != 0);
+            cout << left << setw(10) << name << right << setw(8) << threshold << setw(10) << (nonmax ? "sí" : "no")
+                 << setw(12) << expected.size() << setw(12) << actual.size() << setw(14)
+                 << (mismatches == 0 ? "igual" : to_string(mismatches) + " distintas") << endl;
+            ok = ok && mismatches == 0;
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    string imagePath = argc > 1 ? argv[1] : "";
+    int repetitions = argc > 2 ? max(1, atoi(argv[2])) : 10;
+
+    Mat image;
+    if (!imagePath.empty()) {
+        image = imread(imagePath, IMREAD_GRAYSCALE);
+    } else {
+        const char* candidates[] = {"../Data/box_in_scene.png", "Data/box_in_scene.png"};
+        for (const char* path : candidates) {
+            image = imread(path, IMREAD_GRAYSCALE);
+            if (!image.empty()) {
+                imagePath = path;
+                break;
+            }
+        }
+    }
+    if (image.empty()) {
+        cerr << "No se pudo cargar la imagen. Verifica las rutas." << endl;
+        return -1;
+    }
+
+    // Ancho que no es múltiplo de 16 para pasar también por la cola escalar
+    Mat noise(203, 317, CV_8U);
+    RNG rng(12345);
+    rng.fill(noise, RNG::UNIFORM, 0, 256);
+
+    cout << "Imagen: " << imagePath << " (" << image.cols << "x" << image.rows << "), hilos: " << getNumThreads()
+         << endl << endl;
+    cout << left << setw(10) << "Imagen" << right << setw(8) << "Umbral" << setw(10) << "Supresión"
+         << setw(12) << "OpenCV" << setw(12) << "Motor" << setw(14) << "Resultado" << endl;
+    bool ok = checkDetection("escena", image);
+    ok = checkDetection("ruido", noise) && ok;
+
+    // Tiempos de detección + descripción (umbral 20, como fast_brief)
+    Ptr<FastFeatureDetector> fast = FastFeatureDetector::create(20);
+    Ptr<BriefDescriptorExtractor> brief = BriefDescriptorExtractor::create(32);
+    FastBriefEngine engine;
+    vector<KeyPoint> keypoints;
+    Mat descriptors;
+    double opencvMs = timeMs([&]() {
+        fast->detect(image, keypoints);
+        brief->compute(image, keypoints, descriptors);
+    }, repetitions);
+    double fusedMs = timeMs([&]() { engine.detectAndCompute(image, keypoints, descriptors); }, repetitions);
+    cout << endl << fixed << setprecision(2) << "FAST + BRIEF de OpenCV: " << opencvMs << " ms, motor fusionado: "
+         << fusedMs << " ms (" << opencvMs / fusedMs << "x)" << endl;
+
+    cout << (ok ? "Detección equivalente a FastFeatureDetector." : "La detección DIFIERE de FastFeatureDetector.")
+         << endl;
+    return ok ? 0 : -1;
+}
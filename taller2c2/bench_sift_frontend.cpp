@@ -0,0 +1,201 @@
+#include <stdint.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+#include "opencv2/core.hpp"
+#include "opencv2/calib3d.hpp"
+#include "opencv2/highgui.hpp"
+#include "opencv2/imgproc.hpp"
+#include "opencv2/features2d.hpp"
+
+#include "bench_utils.hpp"
+#include "sift_frontend.hpp"
+
+using namespace cv;
+using namespace std;
+
+// Compara el front-end SIFT en punto fijo con SIFT::create(500) sobre
+// deformaciones sintéticas de una imagen (homografía conocida):
+//  - repetibilidad: fracción de keypoints de la imagen original que, proyectados
+//    con la homografía, tienen un keypoint en la imagen deformada a menos de
+//    REPEAT_RADIUS píxeles (solo se cuentan los que caen dentro de la imagen);
+//  - latencia de detección (mediana de varias repeticiones, en ms).
+//
+// Uso: ./bench_sift_frontend [imagen] [repeticiones]
+
+struct SyntheticWarp {
+    string name;
+    Mat homography;   // 3x3 CV_64F, de la imagen original a la deformada
+};
+
+struct FrontendStats {
+    double repeatability = 0;
+    int keypointsRef = 0;
+    int keypointsWarped = 0;
+    double latencyMs = 0;
+};
+
+static const float REPEAT_RADIUS = 2.5f;
+
+// Homografía que rota y escala alrededor del centro, con un término de
+// perspectiva opcional
+static Mat makeWarp(Size size, double angleDeg, double scale, double perspective) {
+    Point2f center(size.width * 0.5f, size.height * 0.5f);
+    Mat A = getRotationMatrix2D(center, angleDeg, scale);
+    Mat H = Mat::eye(3, 3, CV_64F);
+    A.copyTo(H.rowRange(0, 2));
+    Mat P = Mat::eye(3, 3, CV_64F);
+    P.at<double>(2, 0) = perspective / size.width;
+    return P * H;
+}
+
+static double timeDetection(Ptr<Feature2D> detector, const Mat& image, int repetitions,
+                            vector<KeyPoint>& keypoints) {
+    vector<double> times;
+    for (int r = 0; r < repetitions; r++) {
+        int64 t0 = getTickCount();
+        detector->detect(image, keypoints);
+        times.push_back((getTickCount() - t0) * 1000.0 / getTickFrequency());
+    }
+    return medianOf(times);
+}
+
+static double repeatability(const vector<KeyPoint>& ref, const vector<KeyPoint>& warped,
+                            const Mat& H, Size warpedSize) {
+    if (ref.empty()) {
+        return 0;
+    }
+    vector<Point2f> pts, projected;
+    KeyPoint::convert(ref, pts);
+    perspectiveTransform(pts, projected, H);
+
+    int visible = 0, repeated = 0;
+    for (const Point2f& p : projected) {
+        if (p.x < 0 || p.y < 0 || p.x >= warpedSize.width || p.y >= warpedSize.height) {
+            continue;
+        }
+        visible++;
+        for (const KeyPoint& k : warped) {
+            float dx = k.pt.x - p.x, dy = k.pt.y - p.y;
+            if (dx * dx + dy * dy <= REPEAT_RADIUS * REPEAT_RADIUS) {
+                repeated++;
+                break;
+            }
+        }
+    }
+    return visible > 0 ? (double)repeated / visible : 0;
+}
+
+static FrontendStats evaluate(Ptr<Feature2D> detector, const Mat& image, const Mat& warpedImage,
+                              const Mat& H, int repetitions) {
+    FrontendStats stats;
+    vector<KeyPoint> ref, warped;
+    double t1 = timeDetection(detector, image, repetitions, ref);
+    double t2 = timeDetection(detector, warpedImage, repetitions, warped);
+    stats.keypointsRef = ref.size();
+    stats.keypointsWarped = warped.size();
+    stats.latencyMs = (t1 + t2) * 0.5;
+    stats.repeatability = repeatability(ref, warped, H, warpedImage.size());
+    return stats;
+}
+
+int main(int argc, char* argv[]) {
+    string imagePath = argc > 1 ? argv[1] : "";
+    int repetitions = argc > 2 ? max(1, atoi(argv[2])) : 5;
+
+    Mat image;
+    if (!imagePath.empty()) {
+        image = imread(imagePath, IMREAD_GRAYSCALE);
+    } else {
+        const char* candidates[] = {"../Data/box_in_scene.png", "Data/box_in_scene.png"};
+        for (const char* path : candidates) {
+            image = imread(path, IMREAD_GRAYSCALE);
+            if (!image.empty()) {
+                imagePath = path;
+                break;
+            }
+        }
+    }
+    if (image.empty()) {
+        cerr << "No se pudo cargar la imagen. Verifica las rutas." << endl;
+        return -1;
+    }
+
+    const int MAX_SIZE = 800;
+    if (image.cols > MAX_SIZE || image.rows > MAX_SIZE) {
+        double scale = min(double(MAX_SIZE)/image.cols, double(MAX_SIZE)/image.rows);
+        resize(image, image, Size(), scale, scale, INTER_AREA);
+    }
+
+    vector<SyntheticWarp> warps;
+    warps.push_back({"identidad", Mat::eye(3, 3, CV_64F)});
+    warps.push_back({"rot 15", makeWarp(image.size(), 15, 1.0, 0)});
+    warps.push_back({"rot 45", makeWarp(image.size(), 45, 1.0, 0)});
+    warps.push_back({"escala 0.7", makeWarp(image.size(), 0, 0.7, 0)});
+    warps.push_back({"escala 1.4", makeWarp(image.size(), 0, 1.4, 0)});
+    warps.push_back({"rot 30 + 0.8", makeWarp(image.size(), 30, 0.8, 0)});
+    warps.push_back({"perspectiva", makeWarp(image.size(), 10, 0.9, 0.25)});
+
+    Ptr<Feature2D> reference = SIFT::create(500);
+    Ptr<Feature2D> fixedPoint = FixedPointSIFT::create();
+
+    cout << "Imagen: " << imagePath << " (" << image.cols << "x" << image.rows << "), "
+         << repetitions << " repeticiones, hilos: " << getNumThreads() << endl;
+    cout << endl;
+    cout << left << setw(14) << "Deformación"
+         << right << setw(12) << "SIFT rep"
+         << setw(12) << "SIFTFP rep"
+         << setw(12) << "SIFT ms"
+         << setw(12) << "SIFTFP ms"
+         << setw(10) << "Speedup"
+         << setw(12) << "KP SIFT"
+         << setw(12) << "KP SIFTFP" << endl;
+    cout << string(96, '-') << endl;
+
+    double sumRepRef = 0, sumRepFp = 0, sumMsRef = 0, sumMsFp = 0;
+    RNG rng(12345);
+    for (const SyntheticWarp& w : warps) {
+        Mat warped;
+        warpPerspective(image, warped, w.homography, image.size(), INTER_LINEAR, BORDER_CONSTANT);
+        // Ruido gaussiano leve para que la imagen deformada no sea ideal
+        Mat noise(warped.size(), CV_16S);
+        rng.fill(noise, RNG::NORMAL, 0, 2);
+        Mat noisy;
+        warped.convertTo(noisy, CV_16S);
+        noisy += noise;
+        noisy.convertTo(warped, CV_8U);
+
+        FrontendStats ref = evaluate(reference, image, warped, w.homography, repetitions);
+        FrontendStats fp = evaluate(fixedPoint, image, warped, w.homography, repetitions);
+        sumRepRef += ref.repeatability;
+        sumRepFp += fp.repeatability;
+        sumMsRef += ref.latencyMs;
+        sumMsFp += fp.latencyMs;
+
+        cout << left << setw(14) << w.name << right << fixed << setprecision(3)
+             << setw(12) << ref.repeatability
+             << setw(12) << fp.repeatability
+             << setprecision(2)
+             << setw(12) << ref.latencyMs
+             << setw(12) << fp.latencyMs
+             << setw(10) << (fp.latencyMs > 0 ? ref.latencyMs / fp.latencyMs : 0)
+             << setw(12) << ref.keypointsWarped
+             << setw(12) << fp.keypointsWarped << endl;
+    }
+
+    double n = warps.size();
+    cout << string(96, '-') << endl;
+    cout << left << setw(14) << "Promedio" << right << fixed << setprecision(3)
+         << setw(12) << sumRepRef / n
+         << setw(12) << sumRepFp / n
+         << setprecision(2)
+         << setw(12) << sumMsRef / n
+         << setw(12) << sumMsFp / n
+         << setw(10) << (sumMsFp > 0 ? sumMsRef / sumMsFp : 0) << endl;
+
+    return 0;
+}
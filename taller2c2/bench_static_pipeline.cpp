@@ -0,0 +1,152 @@
+#include <stdint.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+#include "opencv2/core.hpp"
+#include "opencv2/highgui.hpp"
+#include "opencv2/imgproc.hpp"
+
+#include "bench_utils.hpp"
+#include "static_pipeline.hpp"
+
+using namespace cv;
+using namespace std;
+
+// Compara los pipelines especializados en tiempo de compilación
+// (static_pipeline.hpp) con el camino dinámico por strings + DescriptorMatcher
+// para todas las combinaciones registradas. Se reporta la mediana del tiempo
+// de matching (donde está el kernel inlineado) y del tiempo total, y si ambos
+// caminos obtienen los mismos buenos matches.
+//
+// Uso: ./bench_static_pipeline [objeto escena] [repeticiones]
+
+struct PipelineStats {
+    double matchMs = 0;
+    double totalMs = 0;
+    PipelineResult last;
+};
+
+static PipelineStats measure(MatchPipeline& pipeline, const Mat& img1, const Mat& img2, int repetitions) {
+    PipelineStats stats;
+    vector<double> matchTimes, totalTimes;
+    pipeline.run(img1, img2);   // Calentamiento (índices, buffers, hilos)
+    for (int r = 0; r < repetitions; r++) {
+        stats.last = pipeline.run(img1, img2);
+        matchTimes.push_back(stats.last.timings.matchMs);
+        totalTimes.push_back(stats.last.timings.totalMs());
+    }
+    stats.matchMs = medianOf(matchTimes);
+    stats.totalMs = medianOf(totalTimes);
+    return stats;
+}
+
+// Mismos pares (query, train) en ambos caminos. Las distancias L2 pueden
+// diferir en el último bit por el orden de suma, así que no se comparan (y un
+// empate casi exacto puede cambiar de vecino)
+static bool sameMatches(const PipelineResult& a, const PipelineResult& b) {
+    if (a.goodMatches.size() != b.goodMatches.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.goodMatches.size(); i++) {
+        if (a.goodMatches[i].queryIdx != b.goodMatches[i].queryIdx ||
+            a.goodMatches[i].trainIdx != b.goodMatches[i].trainIdx) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    string objectPath, scenePath;
+    int repetitions = 5;
+    if (argc >= 3) {
+        objectPath = argv[1];
+        scenePath = argv[2];
+        if (argc >= 4) {
+            repetitions = max(1, atoi(argv[3]));
+        }
+    } else {
+        if (argc == 2) {
+            repetitions = max(1, atoi(argv[1]));
+        }
+        const char* prefixes[] = {"../Data/", "Data/"};
+        for (const char* prefix : prefixes) {
+            if (!imread(string(prefix) + "box.png", IMREAD_GRAYSCALE).empty()) {
+                objectPath = string(prefix) + "box.png";
+                scenePath = string(prefix) + "box_in_scene.png";
+                break;
+            }
+        }
+    }
+
+    Mat img_object = imread(objectPath, IMREAD_GRAYSCALE);
+    Mat img_scene = imread(scenePath, IMREAD_GRAYSCALE);
+    if (img_object.empty() || img_scene.empty()) {
+        cerr << "No se pudieron cargar las imágenes. Verifica las rutas." << endl;
+        return -1;
+    }
+
+    const int MAX_SIZE = 800;
+    if (img_object.cols > MAX_SIZE || img_object.rows > MAX_SIZE) {
+        double scale = min(double(MAX_SIZE)/img_object.cols, double(MAX_SIZE)/img_object.rows);
+        resize(img_object, img_object, Size(), scale, scale, INTER_AREA);
+    }
+    if (img_scene.cols > MAX_SIZE || img_scene.rows > MAX_SIZE) {
+        double scale = min(double(MAX_SIZE)/img_scene.cols, double(MAX_SIZE)/img_scene.rows);
+        resize(img_scene, img_scene, Size(), scale, scale, INTER_AREA);
+    }
+
+    cout << "Pipelines registrados: " << staticPipelineRegistry().size()
+         << ", repeticiones: " << repetitions << endl << endl;
+    cout << left << setw(25) << "Combinación" << right
+         << setw(14) << "Match din."
+         << setw(14) << "Match est."
+         << setw(10) << "Speedup"
+         << setw(14) << "Total din."
+         << setw(14) << "Total est."
+         << setw(8) << "Good"
+         << setw(10) << "Iguales" << endl;
+    cout << string(109, '-') << endl;
+
+    double sumMatchDynamic = 0, sumMatchStatic = 0;
+    int mismatches = 0;
+    for (const PipelineEntry& entry : staticPipelineRegistry()) {
+        try {
+            DynamicPipeline dynamicPipeline(entry.detector, entry.descriptor, entry.matcher);
+            Ptr<MatchPipeline> staticPipeline = entry.create();
+
+            PipelineStats dyn = measure(dynamicPipeline, img_object, img_scene, repetitions);
+            PipelineStats sta = measure(*staticPipeline, img_object, img_scene, repetitions);
+            // FLANN es aproximado: solo se exige igualdad con fuerza bruta
+            bool same = sameMatches(dyn.last, sta.last);
+            if (!same && entry.matcher == "BF") {
+                mismatches++;
+            }
+            sumMatchDynamic += dyn.matchMs;
+            sumMatchStatic += sta.matchMs;
+
+            cout << left << setw(25) << staticPipeline->name() << right << fixed << setprecision(2)
+                 << setw(14) << dyn.matchMs
+                 << setw(14) << sta.matchMs
+                 << setw(10) << (sta.matchMs > 0 ? dyn.matchMs / sta.matchMs : 0)
+                 << setw(14) << dyn.totalMs
+                 << setw(14) << sta.totalMs
+                 << setw(8) << sta.last.numGoodMatches
+                 << setw(10) << (same ? "Sí" : "No") << endl;
+        } catch (const Exception& e) {
+            cerr << entry.detector << "_" << entry.descriptor << "_" << entry.matcher
+                 << ": error de OpenCV: " << e.what() << endl;
+        }
+    }
+
+    cout << string(109, '-') << endl;
+    cout << "Matching total: dinámico " << sumMatchDynamic << " ms, estático " << sumMatchStatic
+         << " ms (speedup " << (sumMatchStatic > 0 ? sumMatchDynamic / sumMatchStatic : 0) << "x)" << endl;
+    cout << "Combinaciones BF con matches distintos: " << mismatches << endl;
+
+    return 0;
+}
@@ -7,6 +7,14 @@
 #include <iomanip>
 #include <tuple>
 #include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 
 #include "opencv2/core.hpp"
 #include "opencv2/calib3d.hpp"
@@ -15,6 +23,16 @@
 #include "opencv2/features2d.hpp"
 #include "opencv2/xfeatures2d.hpp"
 
+#include "feature_factory.hpp"
+#include "guided_matching.hpp"
+#include "anytime_matching.hpp"
+#include "static_pipeline.hpp"
+#include "work_queue.hpp"
+#include "resolution_controller.hpp"
+#include "image_source.hpp"
+#include "perf_counters.hpp"
+#include "trace.hpp"
+
 using namespace cv;
 using namespace cv::xfeatures2d;
 using namespace std;
@@ -25,83 +43,40 @@ struct MatchResult {
     int numGoodMatches;
     double processingTime;
     bool homographySuccess;
+    int numInliers;          // Inliers de la homografía final
+    int numGuidedMatches;    // Matches de la segunda pasada guiada (0 si no se ejecutó)
+    string stoppedStage;     // Etapa en la que paró el modo con presupuesto (vacío en modo normal)
 };
 
-// Función para crear un detector
-Ptr<Feature2D> createDetector(const string& detectorName) {
-    if (detectorName == "SIFT") {
-        return SIFT::create(500);
-    } else if (detectorName == "SURF") {
-        return SURF::create(100, 3, 3, false);
-    } else if (detectorName == "ORB") {
-        return ORB::create(700);
-    } else if (detectorName == "BRISK") {
-        return BRISK::create(30, 3, 1.0f);
-    } else if (detectorName == "FAST") {
-        return FastFeatureDetector::create(20);
-    } else {
-        cerr << "Detector no reconocido: " << detectorName << endl;
-        return nullptr;
-    }
-}
-
-// Función para crear un descriptor
-Ptr<Feature2D> createDescriptor(const string& descriptorName) {
-    if (descriptorName == "SIFT") {
-        return SIFT::create(500);
-    } else if (descriptorName == "SURF") {
-        return SURF::create(100, 3, 3, false);
-    } else if (descriptorName == "ORB") {
-        return ORB::create(700);
-    } else if (descriptorName == "BRISK") {
-        return BRISK::create(30, 3, 1.0f);
-    } else if (descriptorName == "BRIEF") {
-        return BriefDescriptorExtractor::create(32);
-    } else if (descriptorName == "FREAK") {
-        return FREAK::create();
-    } else {
-        cerr << "Descriptor no reconocido: " << descriptorName << endl;
-        return nullptr;
-    }
-}
+// Contadores de hardware por etapa (--perf); nulo si no se piden
+static PerfStageRecorder* perfRecorder = nullptr;
 
-// Función para crear un matcher
-Ptr<DescriptorMatcher> createMatcher(const string& matcherName, bool isBinaryDescriptor) {
-    if (matcherName == "BF") {
-        if (isBinaryDescriptor) {
-            return DescriptorMatcher::create("BruteForce-Hamming");
-        } else {
-            return DescriptorMatcher::create("BruteForce");
-        }
-    } else if (matcherName == "FLANN") {
-        if (isBinaryDescriptor) {
-            // Para descriptores binarios en FLANN
-            Ptr<flann::IndexParams> indexParams = makePtr<flann::LshIndexParams>(6, 12, 1);
-            Ptr<flann::SearchParams> searchParams = makePtr<flann::SearchParams>(50);
-            return makePtr<FlannBasedMatcher>(indexParams, searchParams);
-        } else {
-            // Para descriptores flotantes en FLANN
-            return DescriptorMatcher::create("FlannBased");
-        }
-    } else {
-        cerr << "Matcher no reconocido: " << matcherName << endl;
-        return nullptr;
-    }
+// Nombre de la zona de traza de una combinación (solo se copia si la traza está activa)
+const char* combinationTraceName(const string& detectorName, const string& descriptorName,
+                                 const string& matcherName) {
+    return traceEnabled() ? traceIntern(detectorName + "_" + descriptorName + "_" + matcherName) : "combination";
 }
 
 // Función para procesar una combinación específica
 MatchResult processCombination(const Mat& img1, const Mat& img2, 
                                const string& detectorName, const string& descriptorName, 
                                const string& matcherName, bool saveResult = true,
-                               bool isSpecificCombination = false) {  // Añadido parámetro para saber si es combinación específica
+                               bool isSpecificCombination = false,  // Añadido parámetro para saber si es combinación específica
+                               bool guidedMatching = true) {
     MatchResult result;
     result.numMatches = 0;
     result.numGoodMatches = 0;
     result.processingTime = 0;
     result.homographySuccess = false;
+    result.numInliers = 0;
+    result.numGuidedMatches = 0;
     
     cout << "Procesando: " << detectorName << " (detector) + " 
          << descriptorName << " (descriptor) + " << matcherName << " (matcher)" << endl;
+    if (perfRecorder) {
+        perfRecorder->setLabel(detectorName + "+" + descriptorName + "+" + matcherName);
+    }
+    TraceZone combinationZone(combinationTraceName(detectorName, descriptorName, matcherName));
     
     // Iniciar cronómetro
     auto start = chrono::high_resolution_clock::now();
@@ -117,6 +92,7 @@ MatchResult processCombination(const Mat& img1, const Mat& img2,
         
         // Detectar keypoints
         vector<KeyPoint> keypoints1, keypoints2;
+        PerfScope perfDetect(perfRecorder, "detect");
         
         if (detectorName == "BRIEF" || detectorName == "FREAK") {
             // BRIEF y FREAK son solo descriptores, usar FAST como detector
@@ -127,6 +103,7 @@ MatchResult processCombination(const Mat& img1, const Mat& img2,
             detector->detect(img1, keypoints1);
             detector->detect(img2, keypoints2);
         }
+        perfDetect.stop();
         
         // Limitar keypoints
         const int MAX_KEYPOINTS = 500;
@@ -142,8 +119,10 @@ MatchResult processCombination(const Mat& img1, const Mat& img2,
         
         // Calcular descriptores
         Mat descriptors1, descriptors2;
+        PerfScope perfDescribe(perfRecorder, "describe");
         descriptor->compute(img1, keypoints1, descriptors1);
         descriptor->compute(img2, keypoints2, descriptors2);
+        perfDescribe.stop();
         
         if (descriptors1.empty() || descriptors2.empty()) {
             cerr << "No se pudieron calcular los descriptores" << endl;
@@ -151,10 +130,7 @@ MatchResult processCombination(const Mat& img1, const Mat& img2,
         }
         
         // Verificar si es descriptor binario
-        bool isBinaryDescriptor = descriptorName == "ORB" || 
-                                 descriptorName == "BRIEF" || 
-                                 descriptorName == "BRISK" || 
-                                 descriptorName == "FREAK";
+        bool isBinaryDescriptor = isBinaryDescriptorName(descriptorName);
         
         // Para algunos descriptores, convertir a CV_32F para FLANN
         if (matcherName == "FLANN" && !isBinaryDescriptor) {
@@ -174,6 +150,7 @@ MatchResult processCombination(const Mat& img1, const Mat& img2,
         
         // Matching
         vector<vector<DMatch>> knnMatches;
+        PerfScope perfMatch(perfRecorder, "match");
         try {
             matcher->knnMatch(descriptors1, descriptors2, knnMatches, 2);
         } catch (const Exception& e) {
@@ -192,12 +169,14 @@ MatchResult processCombination(const Mat& img1, const Mat& img2,
                 knnMatches[i].push_back(fictitiousMatch);
             }
         }
+        perfMatch.stop();
         
         result.numMatches = knnMatches.size();
         
         // Filtrar buenos matches
         vector<DMatch> goodMatches;
         const float RATIO_THRESHOLD = isBinaryDescriptor ? 0.8f : 0.75f;
+        PerfScope perfRatio(perfRecorder, "ratio");
         
         for (size_t i = 0; i < knnMatches.size(); i++) {
             if (knnMatches[i].size() >= 2 && 
@@ -205,6 +184,7 @@ MatchResult processCombination(const Mat& img1, const Mat& img2,
                 goodMatches.push_back(knnMatches[i][0]);
             }
         }
+        perfRatio.stop();
         
         result.numGoodMatches = goodMatches.size();
         
@@ -212,6 +192,7 @@ MatchResult processCombination(const Mat& img1, const Mat& img2,
         
         // Encontrar homografía
         Mat homography;
+        PerfScope perfHomography(perfRecorder, "homography");
         if (goodMatches.size() >= 4) {
             vector<Point2f> obj;
             vector<Point2f> scene;
@@ -225,13 +206,48 @@ MatchResult processCombination(const Mat& img1, const Mat& img2,
             }
             
             if (obj.size() >= 4 && scene.size() >= 4) {
-                homography = findHomography(obj, scene, RANSAC);
+                Mat inlierMask;
+                homography = findHomography(obj, scene, RANSAC, 3.0, inlierMask);
                 result.homographySuccess = !homography.empty();
+                if (result.homographySuccess) {
+                    result.numInliers = countNonZero(inlierMask);
+                }
             }
         }
+        perfHomography.stop();
+        
+        // Segunda pasada guiada por la homografía: recupera correspondencias que
+        // el test de ratio global descartó buscando solo cerca de la posición predicha
+        if (result.homographySuccess && guidedMatching) {
+            PerfScope perfGuided(perfRecorder, "guided");
+            GuidedMatchingParams guidedParams;
+            guidedParams.ratioThreshold = RATIO_THRESHOLD;
+            guidedParams.normType = isBinaryDescriptor ? NORM_HAMMING : NORM_L2;
+            
+            float maxGoodDistance = 0;
+            for (size_t i = 0; i < goodMatches.size(); i++) {
+                maxGoodDistance = max(maxGoodDistance, goodMatches[i].distance);
+            }
+            
+            GuidedMatchingResult guided = guidedMatchAndRefine(keypoints1, descriptors1, keypoints2, descriptors2,
+                                                               homography, result.numInliers, img2.size(),
+                                                               guidedParams, maxGoodDistance);
+            result.numGuidedMatches = guided.matches.size();
+            
+            if (guided.refined) {
+                homography = guided.homography;
+                result.numInliers = guided.numInliers;
+                goodMatches = guided.matches;
+            }
+            perfGuided.stop();
+            
+            cout << "Matches guiados: " << result.numGuidedMatches << ", Inliers: " << result.numInliers
+                 << (guided.refined ? " (homografía refinada)" : "") << endl;
+        }
         
         // Guardar y mostrar resultado visual
         if (saveResult && !goodMatches.empty()) {
+            TRACE_ZONE("draw");
             Mat imgMatches;
             drawMatches(img1, keypoints1, img2, keypoints2, goodMatches, imgMatches,
                        Scalar::all(-1), Scalar::all(-1), vector<char>(),
@@ -296,6 +312,112 @@ MatchResult processCombination(const Mat& img1, const Mat& img2,
     return result;
 }
 
+// Ejecuta una combinación en modo anytime con un presupuesto de budgetMs milisegundos
+MatchResult processCombinationWithBudget(const Mat& img1, const Mat& img2,
+                                         const string& detectorName, const string& descriptorName,
+                                         const string& matcherName, double budgetMs) {
+    cout << "Procesando (presupuesto " << budgetMs << " ms): " << detectorName << " (detector) + "
+         << descriptorName << " (descriptor) + " << matcherName << " (matcher)" << endl;
+    TraceZone combinationZone(combinationTraceName(detectorName, descriptorName, matcherName));
+    
+    AnytimeResult anytime;
+    try {
+        AnytimeClock::time_point deadline = AnytimeClock::now() +
+            chrono::duration_cast<AnytimeClock::duration>(chrono::duration<double, milli>(budgetMs));
+        anytime = processCombinationBudgeted(img1, img2, detectorName, descriptorName, matcherName, deadline);
+    } catch (const Exception& e) {
+        cerr << "Error de OpenCV: " << e.what() << endl;
+    }
+    
+    MatchResult result;
+    result.numMatches = anytime.numMatches;
+    result.numGoodMatches = anytime.numGoodMatches;
+    result.processingTime = anytime.processingTime;
+    result.homographySuccess = anytime.homographySuccess;
+    result.numInliers = anytime.numInliers;
+    result.numGuidedMatches = 0;
+    result.stoppedStage = string(anytimeStageName(anytime.stoppedStage)) +
+                          (anytime.budgetExceeded ? " (tiempo agotado)" : "");
+    
+    cout << "Keypoints usados: " << anytime.numKeypoints1 << " / " << anytime.numKeypoints2
+         << " en " << anytime.chunksProcessed << " bloques" << endl;
+    cout << "Good matches: " << result.numGoodMatches << ", Inliers: " << result.numInliers << endl;
+    cout << "Tiempo de procesamiento: " << result.processingTime << " ms, parada en: " << result.stoppedStage << endl;
+    cout << "--------------------------------" << endl;
+    
+    return result;
+}
+
+// Ejecuta una combinación con el pipeline especializado en tiempo de
+// compilación; si la combinación no está registrada usa el camino dinámico
+MatchResult processCombinationStatic(const Mat& img1, const Mat& img2,
+                                     const string& detectorName, const string& descriptorName,
+                                     const string& matcherName, bool guidedMatching) {
+    Ptr<MatchPipeline> pipeline = createStaticPipeline(detectorName, descriptorName, matcherName);
+    if (!pipeline) {
+        cout << "Sin pipeline estático para " << detectorName << "_" << descriptorName << "_"
+             << matcherName << ", se usa el camino dinámico" << endl;
+        return processCombination(img1, img2, detectorName, descriptorName, matcherName, false, false, guidedMatching);
+    }
+    
+    cout << "Procesando (estático): " << pipeline->name() << endl;
+    TraceZone combinationZone(combinationTraceName(detectorName, descriptorName, matcherName));
+    
+    MatchResult result;
+    result.numMatches = 0;
+    result.numGoodMatches = 0;
+    result.processingTime = 0;
+    result.homographySuccess = false;
+    result.numInliers = 0;
+    result.numGuidedMatches = 0;
+    
+    auto start = chrono::high_resolution_clock::now();
+    try {
+        PipelineResult r = pipeline->run(img1, img2);
+        result.numMatches = r.numMatches;
+        result.numGoodMatches = r.numGoodMatches;
+        result.homographySuccess = r.homographySuccess;
+        result.numInliers = r.numInliers;
+        cout << "Detección: " << r.timings.detectMs << " ms, descripción: " << r.timings.describeMs
+             << " ms, matching: " << r.timings.matchMs << " ms, verificación: " << r.timings.verifyMs << " ms" << endl;
+        
+        // Segunda pasada guiada, igual que en processCombination
+        if (r.homographySuccess && guidedMatching) {
+            bool isBinaryDescriptor = isBinaryDescriptorName(descriptorName);
+            GuidedMatchingParams guidedParams;
+            guidedParams.ratioThreshold = isBinaryDescriptor ? 0.8f : 0.75f;
+            guidedParams.normType = isBinaryDescriptor ? NORM_HAMMING : NORM_L2;
+            
+            float maxGoodDistance = 0;
+            for (size_t i = 0; i < r.goodMatches.size(); i++) {
+                maxGoodDistance = max(maxGoodDistance, r.goodMatches[i].distance);
+            }
+            
+            TraceZone guidedZone("guided");
+            GuidedMatchingResult guided = guidedMatchAndRefine(r.keypoints1, r.descriptors1, r.keypoints2,
+                                                               r.descriptors2, r.homography, r.numInliers,
+                                                               img2.size(), guidedParams, maxGoodDistance);
+            guidedZone.end();
+            result.numGuidedMatches = guided.matches.size();
+            if (guided.refined) {
+                result.numInliers = guided.numInliers;
+            }
+            cout << "Matches guiados: " << result.numGuidedMatches << ", Inliers: " << result.numInliers
+                 << (guided.refined ? " (homografía refinada)" : "") << endl;
+        }
+    } catch (const Exception& e) {
+        cerr << "Error de OpenCV: " << e.what() << endl;
+    }
+    auto end = chrono::high_resolution_clock::now();
+    result.processingTime = chrono::duration_cast<chrono::milliseconds>(end - start).count();
+    
+    cout << "Good matches: " << result.numGoodMatches << ", Inliers: " << result.numInliers << endl;
+    cout << "Tiempo de procesamiento: " << result.processingTime << " ms" << endl;
+    cout << "--------------------------------" << endl;
+    
+    return result;
+}
+
 // Función para verificar si una combinación es válida
 bool isCombinationValid(const string& detector, const string& descriptor) {
     // BRIEF y FREAK solo son descriptores, no detectores
@@ -306,54 +428,557 @@ bool isCombinationValid(const string& detector, const string& descriptor) {
     return true;
 }
 
+// Reduce la imagen si supera MAX_SIZE en alguna dimensión (para evitar problemas de memoria)
+void limitImageSize(Mat& img) {
+    const int MAX_SIZE = 800;
+    if (img.cols > MAX_SIZE || img.rows > MAX_SIZE) {
+        double scale = min(double(MAX_SIZE)/img.cols, double(MAX_SIZE)/img.rows);
+        resize(img, img, Size(), scale, scale, INTER_AREA);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Resolución de trabajo adaptativa (resolution_controller.hpp)
+
+struct WorkingImages {
+    Mat object, scene;
+};
+
+// Elige la resolución del par para un detector e imprime la decisión. La
+// elección depende solo del detector, así que se guarda en cache por nombre.
+const WorkingImages& selectWorkingResolution(const Mat& object, const Mat& scene, const string& detectorName,
+                                             const ResolutionParams& params, map<string, WorkingImages>& cache) {
+    map<string, WorkingImages>::iterator it = cache.find(detectorName);
+    if (it != cache.end()) {
+        return it->second;
+    }
+    TRACE_ZONE("resolution");
+    WorkingImages& w = cache[detectorName];
+    w.object = object;
+    w.scene = scene;
+    Ptr<Feature2D> detector = createUncappedDetector(detectorName);
+    if (!detector) {
+        limitImageSize(w.object);
+        limitImageSize(w.scene);
+        return w;
+    }
+
+    ResolutionController controller(detector, params);
+    ResolutionDecision od, sd;
+    try {
+        controller.choosePair(object, scene, od, sd);
+    } catch (const Exception& e) {
+        cerr << "Error de OpenCV en el controlador de resolución: " << e.what() << endl;
+        limitImageSize(w.object);
+        limitImageSize(w.scene);
+        return w;
+    }
+    ResolutionController::apply(object, w.object, od);
+    ResolutionController::apply(scene, w.scene, sd);
+
+    auto report = [](const char* label, const Mat& original, const ResolutionDecision& d) {
+        cout << "  " << label << ": " << original.cols << "x" << original.rows << " -> "
+             << d.size.width << "x" << d.size.height << " (escala " << fixed << setprecision(2) << d.scale
+             << ", limitada por " << d.limitedBy << ", keypoints previstos " << setprecision(0) << d.predictedKeypoints
+             << ", ahorro vs 800: " << setprecision(1) << d.savingsVsLegacy * 100 << "% px, controlador "
+             << d.controllerMs << " ms)" << endl;
+        cout.unsetf(ios::fixed);
+        cout << setprecision(6);
+    };
+    cout << "Resolución de trabajo para " << detectorName << ":" << endl;
+    report("objeto", object, od);
+    report("escena", scene, sd);
+    if (od.relativeScale > 0) {
+        cout << "  escala relativa estimada del objeto en la escena: " << od.relativeScale << endl;
+    }
+    return w;
+}
+
+// ---------------------------------------------------------------------------
+// Barrido distribuido (work_queue.hpp)
+//
+// El coordinador (--coordinator DIR) escribe una tarea por combinación y par
+// de imágenes en la cola compartida y espera los shards de resultados; los
+// workers (--worker DIR), en esta u otras máquinas que vean el mismo
+// directorio y las mismas rutas de imágenes, reclaman tareas, ejecutan
+// processCombination y publican el resultado. --workers N lanza N workers
+// locales como procesos hijos. Una tarea cuyo worker no renueva el lease en
+// --lease segundos vuelve a la cola; --timeout limita la duración total (con
+// resultados faltantes el programa termina con código 1). test_sweep.sh
+// comprueba que el barrido se completa aunque muera un worker.
+
+struct SweepTask {
+    string detector, descriptor, matcher;
+    string objectPath, scenePath;
+    bool guidedMatching = true;
+    bool staticPipeline = false;
+    bool adaptiveResolution = false;
+    int targetKeypoints = ResolutionParams().targetKeypoints;
+    double latencyMs = 0;
+};
+
+// Una tarea por línea, campos separados por tabuladores (las rutas pueden tener espacios)
+string serializeSweepTask(const SweepTask& t) {
+    ostringstream out;
+    out << t.detector << '\t' << t.descriptor << '\t' << t.matcher << '\t'
+        << t.objectPath << '\t' << t.scenePath << '\t'
+        << (t.guidedMatching ? 1 : 0) << '\t' << (t.staticPipeline ? 1 : 0) << '\t'
+        << (t.adaptiveResolution ? 1 : 0) << '\t' << t.targetKeypoints << '\t' << t.latencyMs;
+    return out.str();
+}
+
+vector<string> splitTabs(const string& line) {
+    vector<string> fields;
+    string field;
+    istringstream in(line);
+    while (getline(in, field, '\t')) {
+        fields.push_back(field);
+    }
+    return fields;
+}
+
+bool parseSweepTask(const string& line, SweepTask& t) {
+    vector<string> f = splitTabs(line);
+    if (f.size() < 10) {
+        return false;
+    }
+    t.detector = f[0];
+    t.descriptor = f[1];
+    t.matcher = f[2];
+    t.objectPath = f[3];
+    t.scenePath = f[4];
+    t.guidedMatching = f[5] == "1";
+    t.staticPipeline = f[6] == "1";
+    t.adaptiveResolution = f[7] == "1";
+    t.targetKeypoints = atoi(f[8].c_str());
+    t.latencyMs = atof(f[9].c_str());
+    return true;
+}
+
+// Shard: línea de la tarea + línea con el MatchResult
+string serializeSweepResult(const SweepTask& t, const MatchResult& r) {
+    ostringstream out;
+    out << serializeSweepTask(t) << '\n'
+        << r.numMatches << '\t' << r.numGoodMatches << '\t' << r.numGuidedMatches << '\t'
+        << r.numInliers << '\t' << r.processingTime << '\t' << (r.homographySuccess ? 1 : 0) << '\n';
+    return out.str();
+}
+
+bool parseSweepResult(const string& content, SweepTask& t, MatchResult& r) {
+    istringstream in(content);
+    string taskLine, resultLine;
+    if (!getline(in, taskLine) || !getline(in, resultLine) || !parseSweepTask(taskLine, t)) {
+        return false;
+    }
+    vector<string> f = splitTabs(resultLine);
+    if (f.size() < 6) {
+        return false;
+    }
+    r.numMatches = atoi(f[0].c_str());
+    r.numGoodMatches = atoi(f[1].c_str());
+    r.numGuidedMatches = atoi(f[2].c_str());
+    r.numInliers = atoi(f[3].c_str());
+    r.processingTime = atof(f[4].c_str());
+    r.homographySuccess = f[5] == "1";
+    return true;
+}
+
+// Pares "objeto escena" por línea; se ignoran líneas vacías y comentarios (#)
+vector<pair<string, string>> readImagePairs(const string& path) {
+    vector<pair<string, string>> pairs;
+    ifstream in(path.c_str());
+    string line;
+    while (getline(in, line)) {
+        istringstream fields(line);
+        string objectPath, scenePath;
+        if (!(fields >> objectPath) || objectPath[0] == '#' || !(fields >> scenePath)) {
+            continue;
+        }
+        pairs.push_back(make_pair(objectPath, scenePath));
+    }
+    return pairs;
+}
+
+int runSweepWorker(const string& queueDir) {
+    FsWorkQueue queue(queueDir);
+    if (!queue.init()) {
+        cerr << "No se pudo abrir la cola: " << queueDir << endl;
+        return -1;
+    }
+    cout << "Worker " << FsWorkQueue::workerTag() << " en " << queueDir << endl;
+
+    // Las tareas de un mismo par reutilizan las imágenes (en resolución original)
+    // y la resolución de trabajo elegida para cada detector
+    map<string, Mat> imageCache;
+    map<string, map<string, WorkingImages>> workingCache;
+    auto loadImage = [&imageCache](const string& path) {
+        map<string, Mat>::iterator it = imageCache.find(path);
+        if (it != imageCache.end()) {
+            return it->second;
+        }
+        Mat img = ImageSource::loadFirst(path, IMREAD_GRAYSCALE);
+        imageCache[path] = img;
+        return img;
+    };
+
+    int processed = 0;
+    while (true) {
+        string id, payload;
+        if (!queue.claim(id, payload)) {
+            // Mientras haya reclamos en curso se espera: si su worker muere, vuelven a pending
+            if (queue.isClosed() && queue.countPending() == 0 && queue.countClaimed() == 0) {
+                break;
+            }
+            usleep(200 * 1000);
+            continue;
+        }
+
+        // El lease se renueva mientras dure la tarea; si el proceso muere, vence
+        LeaseHeartbeat heartbeat(queue.claimedPath());
+        SweepTask task;
+        MatchResult result = MatchResult();
+        if (!parseSweepTask(payload, task)) {
+            cerr << "Tarea mal formada: " << id << endl;
+        } else {
+            Mat img1 = loadImage(task.objectPath);
+            Mat img2 = loadImage(task.scenePath);
+            if (!img1.empty() && !img2.empty()) {
+                if (task.adaptiveResolution) {
+                    ResolutionParams resolution;
+                    resolution.targetKeypoints = task.targetKeypoints;
+                    resolution.latencyBudgetMs = task.latencyMs;
+                    const WorkingImages& w = selectWorkingResolution(
+                        img1, img2, task.detector, resolution, workingCache[task.objectPath + "\t" + task.scenePath]);
+                    img1 = w.object;
+                    img2 = w.scene;
+                } else {
+                    limitImageSize(img1);
+                    limitImageSize(img2);
+                }
+            }
+            if (img1.empty() || img2.empty()) {
+                cerr << "No se pudieron cargar " << task.objectPath << " / " << task.scenePath << endl;
+            } else if (task.staticPipeline) {
+                result = processCombinationStatic(img1, img2, task.detector, task.descriptor, task.matcher,
+                                                  task.guidedMatching);
+            } else {
+                result = processCombination(img1, img2, task.detector, task.descriptor, task.matcher,
+                                            false, false, task.guidedMatching);
+            }
+        }
+        if (!queue.complete(id, serializeSweepResult(task, result))) {
+            cerr << "No se pudo escribir el resultado de " << id << endl;
+        }
+        processed++;
+    }
+
+    cout << "Worker " << FsWorkQueue::workerTag() << " terminado: " << processed << " tareas" << endl;
+    return 0;
+}
+
+// Lanza un worker local ejecutando este mismo programa con --worker
+pid_t spawnLocalWorker(const string& self, const string& queueDir) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        execl(self.c_str(), self.c_str(), "--worker", queueDir.c_str(), (char*)nullptr);
+        _exit(127);
+    }
+    return pid;
+}
+
+// Encola todas las combinaciones válidas para cada par, espera los shards y
+// los agrega por combinación (promedio sobre los pares; la homografía cuenta
+// como exitosa solo si lo fue en todos). En cada vuelta reencola los reclamos
+// con el lease vencido y repone los workers locales caídos; se rinde después
+// de timeoutSeconds (0 = sin límite). complete indica si llegaron todos los shards.
+bool runSweepCoordinator(const string& queueDir, const vector<pair<string, string>>& imagePairs,
+                         const vector<string>& detectors, const vector<string>& descriptors,
+                         const vector<string>& matchers, bool guidedMatching, bool staticPipelines,
+                         bool adaptiveResolution, const ResolutionParams& resolution, int localWorkers,
+                         int leaseSeconds, int timeoutSeconds,
+                         const string& self, map<tuple<string, string, string>, MatchResult>& results,
+                         bool& complete) {
+    FsWorkQueue queue(queueDir);
+    if (!queue.init()) {
+        cerr << "No se pudo crear la cola: " << queueDir << endl;
+        return false;
+    }
+    queue.reset();
+
+    int numTasks = 0;
+    for (const pair<string, string>& imagePair : imagePairs) {
+        for (const string& detector : detectors) {
+            for (const string& descriptor : descriptors) {
+                if (!isCombinationValid(detector, descriptor)) {
+                    continue;
+                }
+                for (const string& matcher : matchers) {
+                    if (matcher == "FLANN" && isBinaryDescriptorName(descriptor)) {
+                        continue;
+                    }
+                    SweepTask task;
+                    task.detector = detector;
+                    task.descriptor = descriptor;
+                    task.matcher = matcher;
+                    task.objectPath = imagePair.first;
+                    task.scenePath = imagePair.second;
+                    task.guidedMatching = guidedMatching;
+                    task.staticPipeline = staticPipelines;
+                    task.adaptiveResolution = adaptiveResolution;
+                    task.targetKeypoints = resolution.targetKeypoints;
+                    task.latencyMs = resolution.latencyBudgetMs;
+
+                    ostringstream id;
+                    id << "task_" << setw(6) << setfill('0') << numTasks;
+                    if (!queue.enqueue(id.str(), serializeSweepTask(task))) {
+                        cerr << "No se pudo encolar " << id.str() << endl;
+                        return false;
+                    }
+                    numTasks++;
+                }
+            }
+        }
+    }
+    queue.close();
+    cout << "Coordinador: " << numTasks << " tareas (" << imagePairs.size() << " pares) en " << queueDir << endl;
+
+    vector<pid_t> children;
+    for (int i = 0; i < localWorkers; i++) {
+        pid_t pid = spawnLocalWorker(self, queueDir);
+        if (pid > 0) {
+            children.push_back(pid);
+        }
+    }
+    if (localWorkers == 0) {
+        cout << "Esperando workers externos: ./combination_tester --worker " << queueDir << endl;
+    }
+
+    auto start = chrono::steady_clock::now();
+    size_t lastDone = 0;
+    const int maxRespawns = 3 * localWorkers;
+    int respawns = 0;
+    complete = false;
+    while (true) {
+        size_t done = queue.countResults();
+        if (done != lastDone) {
+            cout << "Progreso: " << done << "/" << numTasks << endl;
+            lastDone = done;
+        }
+        if ((int)done >= numTasks) {
+            complete = true;
+            break;
+        }
+        // Un worker local que terminó ya no va a renovar: sus reclamos vuelven
+        // a pending sin esperar a que venza el lease
+        pid_t exited;
+        while (!children.empty() && (exited = waitpid(-1, nullptr, WNOHANG)) > 0) {
+            children.erase(remove(children.begin(), children.end(), exited), children.end());
+            int requeued = queue.requeueClaimsOf(FsWorkQueue::workerTag(exited));
+            if (requeued > 0) {
+                cerr << "Reencoladas " << requeued << " tareas del worker caído " << exited << endl;
+            }
+        }
+        // Leases vencidos de cualquier worker, local o remoto. Un worker local
+        // colgado se mata para reponerlo.
+        vector<string> expiredWorkers;
+        int requeued = queue.requeueExpired(leaseSeconds, &expiredWorkers);
+        if (requeued > 0) {
+            cerr << "Reencoladas " << requeued << " tareas con el lease vencido" << endl;
+            for (pid_t child : children) {
+                if (find(expiredWorkers.begin(), expiredWorkers.end(), FsWorkQueue::workerTag(child)) !=
+                    expiredWorkers.end()) {
+                    kill(child, SIGKILL);
+                }
+            }
+        }
+        // Reponer workers locales mientras quede trabajo pendiente
+        while ((int)children.size() < localWorkers && queue.countPending() > 0 && respawns < maxRespawns) {
+            pid_t pid = spawnLocalWorker(self, queueDir);
+            if (pid <= 0) {
+                break;
+            }
+            children.push_back(pid);
+            respawns++;
+        }
+        if (localWorkers > 0 && children.empty() && respawns >= maxRespawns) {
+            cerr << "Sin workers locales; faltan " << numTasks - (int)queue.countResults() << " resultados" << endl;
+            break;
+        }
+        if (timeoutSeconds > 0 &&
+            chrono::steady_clock::now() - start >= chrono::seconds(timeoutSeconds)) {
+            cerr << "Tiempo agotado (" << timeoutSeconds << " s); faltan "
+                 << numTasks - (int)queue.countResults() << " resultados" << endl;
+            break;
+        }
+        usleep(200 * 1000);
+    }
+    // Los workers locales que queden (colgados, o esperando una cola que ya no
+    // se va a completar) se terminan
+    for (pid_t child : children) {
+        kill(child, SIGTERM);
+        waitpid(child, nullptr, 0);
+    }
+    double elapsedS = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // Agregación de shards por combinación
+    map<tuple<string, string, string>, int> counts;
+    for (const pair<string, string>& shard : queue.readResults()) {
+        SweepTask task;
+        MatchResult r;
+        if (!parseSweepResult(shard.second, task, r)) {
+            cerr << "Shard mal formado: " << shard.first << endl;
+            continue;
+        }
+        auto key = make_tuple(task.detector, task.descriptor, task.matcher);
+        int& n = counts[key];
+        if (n == 0) {
+            r.stoppedStage = "";
+            results[key] = r;
+        } else {
+            MatchResult& acc = results[key];
+            acc.numMatches += r.numMatches;
+            acc.numGoodMatches += r.numGoodMatches;
+            acc.numGuidedMatches += r.numGuidedMatches;
+            acc.numInliers += r.numInliers;
+            acc.processingTime += r.processingTime;
+            acc.homographySuccess = acc.homographySuccess && r.homographySuccess;
+        }
+        n++;
+    }
+    for (auto& entry : results) {
+        int n = counts[entry.first];
+        MatchResult& acc = entry.second;
+        acc.numMatches = (acc.numMatches + n / 2) / n;
+        acc.numGoodMatches = (acc.numGoodMatches + n / 2) / n;
+        acc.numGuidedMatches = (acc.numGuidedMatches + n / 2) / n;
+        acc.numInliers = (acc.numInliers + n / 2) / n;
+        acc.processingTime /= n;
+    }
+
+    cout << (complete ? "Barrido completo en " : "Barrido INCOMPLETO en ") << elapsedS << " s ("
+         << queue.countResults() << "/" << numTasks << " shards)" << endl;
+    return true;
+}
+
 int main(int argc, char* argv[]) {
-    // Cargar imágenes
-    string objectImagePath = "../Data/box.png";
-    string sceneImagePath = "../Data/box_in_scene.png";
+    // Separar opciones (--xxx) de los argumentos posicionales
+    vector<string> positional;
+    bool guidedMatching = true;
+    double budgetMs = 0;     // > 0 activa el modo anytime con presupuesto de latencia
+    bool staticPipelines = false;   // --static: pipelines especializados (static_pipeline.hpp)
+    string coordinatorDir, workerDir, pairsFile;
+    int localWorkers = 0;
+    int leaseSeconds = 30;            // --lease: plazo sin renovación para reencolar una tarea
+    int timeoutSeconds = 3600;        // --timeout: límite total del barrido (0 = sin límite)
+    bool sweepComplete = true;
+    bool adaptiveResolution = false;  // --adaptive: resolución por detector en lugar del reescalado fijo a 800
+    ResolutionParams resolution;      // --target-keypoints / --latency-ms del modo --adaptive
+    bool perf = false;                // --perf: contadores de hardware por etapa
+    string perfCsv, perfJson;
+    string tracePath;                 // --trace: línea de tiempo en formato Chrome trace
+    string objectSpec, sceneSpec;     // --object/--scene: archivo, carpeta, glob o video (primer cuadro)
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--no-guided") {
+            guidedMatching = false;
+        } else if (arg == "--adaptive") {
+            adaptiveResolution = true;
+        } else if (arg == "--target-keypoints" && i + 1 < argc) {
+            resolution.targetKeypoints = max(1, atoi(argv[++i]));
+        } else if (arg == "--latency-ms" && i + 1 < argc) {
+            resolution.latencyBudgetMs = max(0.0, atof(argv[++i]));
+        } else if (arg == "--static") {
+            staticPipelines = true;
+        } else if (arg == "--budget-ms" && i + 1 < argc) {
+            budgetMs = atof(argv[++i]);
+        } else if (arg == "--coordinator" && i + 1 < argc) {
+            coordinatorDir = argv[++i];
+        } else if (arg == "--worker" && i + 1 < argc) {
+            workerDir = argv[++i];
+        } else if (arg == "--workers" && i + 1 < argc) {
+            localWorkers = max(0, atoi(argv[++i]));
+        } else if (arg == "--lease" && i + 1 < argc) {
+            leaseSeconds = max(3 * WORK_QUEUE_HEARTBEAT_S, atoi(argv[++i]));
+        } else if (arg == "--timeout" && i + 1 < argc) {
+            timeoutSeconds = max(0, atoi(argv[++i]));
+        } else if (arg == "--pairs" && i + 1 < argc) {
+            pairsFile = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (arg == "--object" && i + 1 < argc) {
+            objectSpec = argv[++i];
+        } else if (arg == "--scene" && i + 1 < argc) {
+            sceneSpec = argv[++i];
+        } else if (arg == "--perf") {
+            perf = true;
+        } else if (arg == "--perf-csv" && i + 1 < argc) {
+            perf = true;
+            perfCsv = argv[++i];
+        } else if (arg == "--perf-json" && i + 1 < argc) {
+            perf = true;
+            perfJson = argv[++i];
+        } else if (arg.compare(0, 2, "--") == 0) {
+            cerr << "Opción no reconocida: " << arg << endl;
+            return -1;
+        } else {
+            positional.push_back(arg);
+        }
+    }
     
-    Mat img_object = imread(objectImagePath, IMREAD_GRAYSCALE);
-    Mat img_scene = imread(sceneImagePath, IMREAD_GRAYSCALE);
+    if (!workerDir.empty()) {
+        return runSweepWorker(workerDir);
+    }
     
-    if (img_object.empty() || img_scene.empty()) {
-        cerr << "Error al cargar las imágenes. Probando rutas alternativas..." << endl;
-        
-        // Intentar con rutas alternativas
-        objectImagePath = "../Data/ima1.png";
-        sceneImagePath = "../Data/ima21.png";
-        
-        img_object = imread(objectImagePath, IMREAD_GRAYSCALE);
-        img_scene = imread(sceneImagePath, IMREAD_GRAYSCALE);
-        
-        if (img_object.empty() || img_scene.empty()) {
-            objectImagePath = "Data/box.png";
-            sceneImagePath = "Data/box_in_scene.png";
-            
-            img_object = imread(objectImagePath, IMREAD_GRAYSCALE);
-            img_scene = imread(sceneImagePath, IMREAD_GRAYSCALE);
-            
-            if (img_object.empty() || img_scene.empty()) {
-                cerr << "No se pudieron cargar las imágenes. Verifica las rutas." << endl;
-                return -1;
-            }
-        }
+    // Los contadores siguen solo al hilo principal: sin el pool de OpenCV
+    // todo el trabajo de cada etapa queda contado
+    TraceSession traceSession(tracePath);
+    PerfStageRecorder perfStages("combination_tester");
+    if (perf) {
+        setNumThreads(1);
+        perfRecorder = &perfStages;
     }
     
-    cout << "Imágenes cargadas correctamente." << endl;
+    // Cargar imágenes
+    TraceZone loadZone("load");
+    // Sin --object/--scene se usa box.png / box_in_scene.png de Data/, desde
+    // taller2c2/ o desde la raíz del repositorio
+    const char* dataDir = access("../Data/box.png", R_OK) == 0 ? "../Data/" : "Data/";
+    string objectImagePath = objectSpec.empty() ? string(dataDir) + "box.png" : objectSpec;
+    string sceneImagePath = sceneSpec.empty() ? string(dataDir) + "box_in_scene.png" : sceneSpec;
     
-    // Redimensionar imágenes si son muy grandes
-    const int MAX_SIZE = 800;
-    if (img_object.cols > MAX_SIZE || img_object.rows > MAX_SIZE) {
-        double scale = min(double(MAX_SIZE)/img_object.cols, double(MAX_SIZE)/img_object.rows);
-        resize(img_object, img_object, Size(), scale, scale, INTER_AREA);
+    string loadError;
+    Mat img_object = ImageSource::loadFirst(objectImagePath, IMREAD_GRAYSCALE, &loadError);
+    Mat img_scene;
+    if (!img_object.empty()) {
+        img_scene = ImageSource::loadFirst(sceneImagePath, IMREAD_GRAYSCALE, &loadError);
     }
+    if (img_object.empty() || img_scene.empty()) {
+        cerr << "No se pudieron cargar las imágenes: " << loadError << endl;
+        return -1;
+    }
+    
+    loadZone.end();
+    cout << "Imágenes cargadas correctamente." << endl;
     
-    if (img_scene.cols > MAX_SIZE || img_scene.rows > MAX_SIZE) {
-        double scale = min(double(MAX_SIZE)/img_scene.cols, double(MAX_SIZE)/img_scene.rows);
-        resize(img_scene, img_scene, Size(), scale, scale, INTER_AREA);
+    // Redimensionar imágenes si son muy grandes. Con el controlador adaptativo
+    // se conservan las originales y la resolución se elige por detector.
+    map<string, WorkingImages> workingImages;
+    if (!adaptiveResolution) {
+        limitImageSize(img_object);
+        limitImageSize(img_scene);
     }
+    auto imagesFor = [&](const string& detectorName) -> const WorkingImages& {
+        if (!adaptiveResolution) {
+            WorkingImages& w = workingImages[""];
+            w.object = img_object;
+            w.scene = img_scene;
+            return w;
+        }
+        return selectWorkingResolution(img_object, img_scene, detectorName, resolution, workingImages);
+    };
     
     // Definir detectores, descriptores y matchers
-    vector<string> detectors = {"SIFT", "SURF", "ORB", "FAST", "BRISK"};
+    vector<string> detectors = {"SIFT", "SIFTFP", "SURF", "ORB", "FAST", "BRISK"};
     vector<string> descriptors = {"SIFT", "SURF", "ORB", "BRIEF", "FREAK", "BRISK"};
     vector<string> matchers = {"BF", "FLANN"};
     
@@ -361,11 +986,13 @@ int main(int argc, char* argv[]) {
     string requestedDetector, requestedDescriptor, requestedMatcher;
     bool processAll = false;
     
-    if (argc >= 4) {
+    if (!coordinatorDir.empty()) {
+        // El barrido distribuido procesa siempre todas las combinaciones válidas
+    } else if (positional.size() >= 3) {
         // Si se proporcionan argumentos, procesar la combinación específica
-        requestedDetector = argv[1];
-        requestedDescriptor = argv[2];
-        requestedMatcher = argv[3];
+        requestedDetector = positional[0];
+        requestedDescriptor = positional[1];
+        requestedMatcher = positional[2];
     } else {
         // De lo contrario, mostrar menú
         cout << "Selecciona una opción:" << endl;
@@ -437,7 +1064,23 @@ int main(int argc, char* argv[]) {
     // Mapa para almacenar resultados
     map<tuple<string, string, string>, MatchResult> results;
     
-    if (processAll) {
+    if (!coordinatorDir.empty()) {
+        vector<pair<string, string>> imagePairs;
+        if (!pairsFile.empty()) {
+            imagePairs = readImagePairs(pairsFile);
+            if (imagePairs.empty()) {
+                cerr << "No hay pares de imágenes en " << pairsFile << endl;
+                return -1;
+            }
+        } else {
+            imagePairs.push_back(make_pair(objectImagePath, sceneImagePath));
+        }
+        if (!runSweepCoordinator(coordinatorDir, imagePairs, detectors, descriptors, matchers,
+                                 guidedMatching, staticPipelines, adaptiveResolution, resolution, localWorkers,
+                                 leaseSeconds, timeoutSeconds, argv[0], results, sweepComplete)) {
+            return -1;
+        }
+    } else if (processAll) {
         cout << "Procesando todas las combinaciones válidas..." << endl;
         
         for (const string& detector : detectors) {
@@ -448,8 +1091,7 @@ int main(int argc, char* argv[]) {
                 
                 for (const string& matcher : matchers) {
                     // Para FLANN con descriptores binarios, se necesita manejo especial
-                    bool isBinaryDescriptor = descriptor == "ORB" || descriptor == "BRIEF" || 
-                                            descriptor == "BRISK" || descriptor == "FREAK";
+                    bool isBinaryDescriptor = isBinaryDescriptorName(descriptor);
                                             
                     // Omitir FLANN con descriptores binarios en versiones antiguas de OpenCV
                     if (matcher == "FLANN" && isBinaryDescriptor) {
@@ -457,7 +1099,15 @@ int main(int argc, char* argv[]) {
                     }
                     
                     auto key = make_tuple(detector, descriptor, matcher);
-                    results[key] = processCombination(img_object, img_scene, detector, descriptor, matcher, true, false);
+                    if (budgetMs > 0) {
+                        results[key] = processCombinationWithBudget(imagesFor(detector).object, imagesFor(detector).scene, detector, descriptor, matcher, budgetMs);
+                        continue;
+                    }
+                    if (staticPipelines) {
+                        results[key] = processCombinationStatic(imagesFor(detector).object, imagesFor(detector).scene, detector, descriptor, matcher, guidedMatching);
+                        continue;
+                    }
+                    results[key] = processCombination(imagesFor(detector).object, imagesFor(detector).scene, detector, descriptor, matcher, true, false, guidedMatching);
                     
                     // Liberar recursos
                     waitKey(500);
@@ -473,22 +1123,33 @@ int main(int argc, char* argv[]) {
         }
         
         auto key = make_tuple(requestedDetector, requestedDescriptor, requestedMatcher);
-        results[key] = processCombination(img_object, img_scene, requestedDetector, requestedDescriptor, requestedMatcher, true, true);
+        if (budgetMs > 0) {
+            results[key] = processCombinationWithBudget(imagesFor(requestedDetector).object, imagesFor(requestedDetector).scene, requestedDetector, requestedDescriptor, requestedMatcher, budgetMs);
+        } else if (staticPipelines) {
+            results[key] = processCombinationStatic(imagesFor(requestedDetector).object, imagesFor(requestedDetector).scene, requestedDetector, requestedDescriptor, requestedMatcher, guidedMatching);
+        } else {
+            results[key] = processCombination(imagesFor(requestedDetector).object, imagesFor(requestedDetector).scene, requestedDetector, requestedDescriptor, requestedMatcher, true, true, guidedMatching);
+        }
     }
     
     // Mostrar tabla de resultados
     cout << "\n=== RESULTADOS COMPARATIVOS ===" << endl;
     cout << setw(25) << "Combinación" << setw(12) << "Matches" << setw(12) << "Good" 
-         << setw(12) << "Tiempo (ms)" << setw(15) << "Homografía" << endl;
-    cout << string(76, '-') << endl;
+         << setw(12) << "Guiados" << setw(12) << "Inliers"
+         << setw(12) << "Tiempo (ms)" << setw(15) << "Homografía"
+         << (budgetMs > 0 ? "   Parada" : "") << endl;
+    cout << string(budgetMs > 0 ? 130 : 100, '-') << endl;
     
     for (const auto& result : results) {
         string combination = get<0>(result.first) + "_" + get<1>(result.first) + "_" + get<2>(result.first);
         cout << setw(25) << combination 
              << setw(12) << result.second.numMatches 
              << setw(12) << result.second.numGoodMatches
+             << setw(12) << result.second.numGuidedMatches
+             << setw(12) << result.second.numInliers
              << setw(12) << result.second.processingTime
              << setw(15) << (result.second.homographySuccess ? "Sí" : "No") 
+             << (budgetMs > 0 ? "   " + result.second.stoppedStage : "")
              << endl;
     }
     
@@ -518,7 +1179,7 @@ int main(int argc, char* argv[]) {
              << " con " << fastestMatch->second.processingTime << " ms" << endl;
     }
     
-    if (processAll) {
+    if (processAll && budgetMs <= 0 && !staticPipelines && coordinatorDir.empty()) {
         // Mostrar las imágenes de las mejores combinaciones
         cout << "\nMostrando resultado de la mejor combinación. Presiona cualquier tecla para cerrar..." << endl;
         
@@ -540,7 +1201,12 @@ int main(int argc, char* argv[]) {
         }
     }
     
+    if (perfRecorder) {
+        perfRecorder->report(perfCsv, perfJson);
+        perfRecorder = nullptr;
+    }
+    
     cout << "\nPrograma finalizado." << endl;
     
-    return 0;
+    return sweepComplete ? 0 : 1;
 }
@@ -11,11 +11,16 @@
 #include "opencv2/features2d.hpp"
 #include "opencv2/xfeatures2d.hpp"
 
+#include "fast_brief_engine.hpp"
+
 using namespace cv;
 using namespace cv::xfeatures2d;
 using namespace std;
 
-int main() {
+int main(int argc, char* argv[]) {
+    // --fused usa el motor FAST+BRIEF fusionado por bandas en lugar de dos pasadas
+    bool useFusedEngine = argc > 1 && string(argv[1]) == "--fused";
+    
     // Cargar imágenes
     string objectImagePath = "../Data/box.png";
     string sceneImagePath = "../Data/box_in_scene.png";
@@ -48,7 +53,8 @@ int main() {
     }
     
     cout << "Imágenes cargadas correctamente." << endl;
-    cout << "Analizando con FAST (detector) + BRIEF (descriptor) + BF (matcher)" << endl;
+    cout << "Analizando con FAST (detector) + BRIEF (descriptor) + BF (matcher)"
+         << (useFusedEngine ? " [motor fusionado]" : "") << endl;
     
     // Redimensionar imágenes si son muy grandes (para evitar problemas de memoria)
     const int MAX_SIZE = 800;
@@ -65,35 +71,51 @@ int main() {
     // Iniciar el cronómetro
     auto start = chrono::high_resolution_clock::now();
     
-    // Crear detector FAST
-    Ptr<FastFeatureDetector> fast = FastFeatureDetector::create(20); // Umbral más bajo = más puntos
-    
-    // Crear descriptor BRIEF
-    Ptr<BriefDescriptorExtractor> brief = BriefDescriptorExtractor::create(32); // 32 bytes = 256 bits
-    
-    // Detectar keypoints con FAST
-    vector<KeyPoint> keypoints_object, keypoints_scene;
-    fast->detect(img_object, keypoints_object);
-    fast->detect(img_scene, keypoints_scene);
-    
-    // Limitar el número de keypoints si hay demasiados
     const int MAX_KEYPOINTS = 1000;
-    if (keypoints_object.size() > MAX_KEYPOINTS) {
-        keypoints_object.resize(MAX_KEYPOINTS);
-    }
+    vector<KeyPoint> keypoints_object, keypoints_scene;
+    Mat descriptors_object, descriptors_scene;
     
-    if (keypoints_scene.size() > MAX_KEYPOINTS) {
-        keypoints_scene.resize(MAX_KEYPOINTS);
+    if (useFusedEngine) {
+        // Detección y descripción en una sola pasada por bandas; con más de
+        // MAX_KEYPOINTS esquinas se conservan las de mayor respuesta
+        FastBriefParams params;
+        params.threshold = 20;
+        params.maxKeypoints = MAX_KEYPOINTS;
+        FastBriefEngine engine(params);
+        
+        engine.detectAndCompute(img_object, keypoints_object, descriptors_object);
+        engine.detectAndCompute(img_scene, keypoints_scene, descriptors_scene);
+        
+        cout << "Keypoints en imagen objeto: " << keypoints_object.size() << endl;
+        cout << "Keypoints en imagen escena: " << keypoints_scene.size() << endl;
+    } else {
+        // Crear detector FAST
+        Ptr<FastFeatureDetector> fast = FastFeatureDetector::create(20); // Umbral más bajo = más puntos
+        
+        // Crear descriptor BRIEF
+        Ptr<BriefDescriptorExtractor> brief = BriefDescriptorExtractor::create(32); // 32 bytes = 256 bits
+        
+        // Detectar keypoints con FAST
+        fast->detect(img_object, keypoints_object);
+        fast->detect(img_scene, keypoints_scene);
+        
+        // Limitar el número de keypoints si hay demasiados
+        if (keypoints_object.size() > MAX_KEYPOINTS) {
+            keypoints_object.resize(MAX_KEYPOINTS);
+        }
+        
+        if (keypoints_scene.size() > MAX_KEYPOINTS) {
+            keypoints_scene.resize(MAX_KEYPOINTS);
+        }
+        
+        cout << "Keypoints en imagen objeto: " << keypoints_object.size() << endl;
+        cout << "Keypoints en imagen escena: " << keypoints_scene.size() << endl;
+        
+        // Calcular descriptores con BRIEF
+        brief->compute(img_object, keypoints_object, descriptors_object);
+        brief->compute(img_scene, keypoints_scene, descriptors_scene);
     }
     
-    cout << "Keypoints en imagen objeto: " << keypoints_object.size() << endl;
-    cout << "Keypoints en imagen escena: " << keypoints_scene.size() << endl;
-    
-    // Calcular descriptores con BRIEF
-    Mat descriptors_object, descriptors_scene;
-    brief->compute(img_object, keypoints_object, descriptors_object);
-    brief->compute(img_scene, keypoints_scene, descriptors_scene);
-    
     // Si no hay suficientes keypoints o descriptores, salir
     if (descriptors_object.empty() || descriptors_scene.empty()) {
         cerr << "No se pudieron calcular los descriptores. Verifica que hay suficientes keypoints." << endl;
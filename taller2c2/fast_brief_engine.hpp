@@ -0,0 +1,428 @@
+#ifndef FAST_BRIEF_ENGINE_HPP
+#define FAST_BRIEF_ENGINE_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+
+#include "opencv2/core.hpp"
+#include "opencv2/features2d.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FAST_BRIEF_USE_SSE2 1
+#endif
+
+// Motor FAST-9 + BRIEF fusionado.
+//
+// La imagen se divide en bandas horizontales de filas. Para cada banda se
+// ejecuta el test de segmento FAST-9/16 vectorizado (16 píxeles por
+// instrucción con SSE2), se calcula el score y la supresión de no máximos, y
+// con la banda todavía en caché se calculan los descriptores BRIEF de 32 bytes
+// sobre una imagen integral local. Las bandas se reparten entre hilos con
+// parallel_for_.
+//
+// El detector reproduce el criterio y el score de FastFeatureDetector (umbral
+// estricto, supresión 3x3); bench_fast_brief lo verifica. El patrón de pares
+// BRIEF es propio (muestreo gaussiano isotrópico con semilla fija, como en el
+// artículo original), así que los descriptores solo son comparables con otros
+// generados por este motor.
+
+struct FastBriefParams {
+    int threshold = 20;            // Umbral de FAST
+    bool nonmaxSuppression = true;
+    int bandRows = 64;             // Filas por banda (unidad de trabajo por hilo)
+    int maxKeypoints = 0;          // > 0: conserva solo los de mayor respuesta
+};
+
+class FastBriefEngine {
+public:
+    enum {
+        DESCRIPTOR_BYTES = 32,
+        PATCH_SIZE = 48,
+        KERNEL_SIZE = 9,
+        HALF_KERNEL = KERNEL_SIZE / 2,
+        BORDER = PATCH_SIZE / 2 + KERNEL_SIZE / 2   // Igual que BriefDescriptorExtractor
+    };
+
+    explicit FastBriefEngine(const FastBriefParams& params = FastBriefParams())
+        : params_(params) {
+        buildPattern();
+    }
+
+    const FastBriefParams& params() const {
+        return params_;
+    }
+
+    // Detecta esquinas y calcula sus descriptores en una sola pasada por bandas.
+    // gray debe ser CV_8UC1. descriptors queda como CV_8U de N x 32.
+    void detectAndCompute(const cv::Mat& gray, std::vector<cv::KeyPoint>& keypoints,
+                          cv::Mat& descriptors) const {
+        CV_Assert(gray.type() == CV_8UC1);
+        keypoints.clear();
+        descriptors.release();
+        if (gray.rows < 7 || gray.cols < 7) {
+            return;
+        }
+
+        std::vector<BandOutput> bands;
+        runBands(gray, true, bands);
+
+        size_t total = 0;
+        for (const BandOutput& band : bands) {
+            total += band.keypoints.size();
+        }
+        keypoints.reserve(total);
+        std::vector<uchar> packed;
+        packed.reserve(total * DESCRIPTOR_BYTES);
+        for (const BandOutput& band : bands) {
+            keypoints.insert(keypoints.end(), band.keypoints.begin(), band.keypoints.end());
+            packed.insert(packed.end(), band.descriptors.begin(), band.descriptors.end());
+        }
+
+        if (params_.maxKeypoints > 0 && (int)keypoints.size() > params_.maxKeypoints) {
+            keepStrongest(keypoints, packed, params_.maxKeypoints);
+        }
+
+        if (!keypoints.empty()) {
+            descriptors.create((int)keypoints.size(), DESCRIPTOR_BYTES, CV_8U);
+            std::memcpy(descriptors.ptr<uchar>(0), packed.data(), packed.size());
+        }
+    }
+
+    // Solo la detección, sin descriptores ni el margen que necesita el parche de
+    // BRIEF. Con maxKeypoints = 0 da las mismas esquinas que FastFeatureDetector
+    // (tipo 9/16) con el mismo umbral y supresión, y con supresión el mismo score.
+    void detect(const cv::Mat& gray, std::vector<cv::KeyPoint>& keypoints) const {
+        CV_Assert(gray.type() == CV_8UC1);
+        keypoints.clear();
+        if (gray.rows < 7 || gray.cols < 7) {
+            return;
+        }
+
+        std::vector<BandOutput> bands;
+        runBands(gray, false, bands);
+        for (const BandOutput& band : bands) {
+            keypoints.insert(keypoints.end(), band.keypoints.begin(), band.keypoints.end());
+        }
+        if (params_.maxKeypoints > 0 && (int)keypoints.size() > params_.maxKeypoints) {
+            std::vector<uchar> none;
+            keepStrongest(keypoints, none, params_.maxKeypoints);
+        }
+    }
+
+    // Score FAST de un píxel (mayor umbral con el que sigue siendo esquina).
+    // Mismo algoritmo que cornerScore<16> de OpenCV.
+    static int cornerScore(const uchar* ptr, const int pixel[25], int threshold) {
+        const int N = 25;
+        int v = ptr[0];
+        short d[N];
+        for (int k = 0; k < N; k++) {
+            d[k] = (short)(v - ptr[pixel[k]]);
+        }
+
+        int a0 = threshold;
+        for (int k = 0; k < 16; k += 2) {
+            int a = std::min((int)d[k + 1], (int)d[k + 2]);
+            a = std::min(a, (int)d[k + 3]);
+            if (a <= a0) continue;
+            a = std::min(a, (int)d[k + 4]);
+            a = std::min(a, (int)d[k + 5]);
+            a = std::min(a, (int)d[k + 6]);
+            a = std::min(a, (int)d[k + 7]);
+            a = std::min(a, (int)d[k + 8]);
+            a0 = std::max(a0, std::min(a, (int)d[k]));
+            a0 = std::max(a0, std::min(a, (int)d[k + 9]));
+        }
+
+        int b0 = -a0;
+        for (int k = 0; k < 16; k += 2) {
+            int b = std::max((int)d[k + 1], (int)d[k + 2]);
+            b = std::max(b, (int)d[k + 3]);
+            b = std::max(b, (int)d[k + 4]);
+            b = std::max(b, (int)d[k + 5]);
+            if (b >= b0) continue;
+            b = std::max(b, (int)d[k + 6]);
+            b = std::max(b, (int)d[k + 7]);
+            b = std::max(b, (int)d[k + 8]);
+            b0 = std::min(b0, std::max(b, (int)d[k]));
+            b0 = std::min(b0, std::max(b, (int)d[k + 9]));
+        }
+        return -b0 - 1;
+    }
+
+    // Test de segmento escalar: 9 píxeles contiguos del círculo más claros que
+    // centro + t o más oscuros que centro - t
+    static bool isCorner(const uchar* ptr, const int pixel[25], int threshold) {
+        int v = ptr[0];
+        int brightRun = 0, darkRun = 0;
+        for (int k = 0; k < 25; k++) {
+            int p = ptr[pixel[k]];
+            brightRun = p > v + threshold ? brightRun + 1 : 0;
+            darkRun = p < v - threshold ? darkRun + 1 : 0;
+            if (brightRun >= 9 || darkRun >= 9) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static void makeOffsets(int pixel[25], int rowStride) {
+        static const int offsets[16][2] = {
+            {0, 3}, {1, 3}, {2, 2}, {3, 1}, {3, 0}, {3, -1}, {2, -2}, {1, -3},
+            {0, -3}, {-1, -3}, {-2, -2}, {-3, -1}, {-3, 0}, {-3, 1}, {-2, 2}, {-1, 3}
+        };
+        for (int k = 0; k < 16; k++) {
+            pixel[k] = offsets[k][0] + offsets[k][1] * rowStride;
+        }
+        for (int k = 16; k < 25; k++) {
+            pixel[k] = pixel[k - 16];
+        }
+    }
+
+private:
+    struct BandOutput {
+        std::vector<cv::KeyPoint> keypoints;
+        std::vector<uchar> descriptors;
+    };
+
+    void runBands(const cv::Mat& gray, bool describe, std::vector<BandOutput>& bands) const {
+        int bandRows = std::max(params_.bandRows, 1);
+        int numBands = (gray.rows + bandRows - 1) / bandRows;
+        bands.assign(numBands, BandOutput());
+
+        cv::parallel_for_(cv::Range(0, numBands), [&](const cv::Range& range) {
+            for (int b = range.start; b < range.end; b++) {
+                int y0 = b * bandRows;
+                int y1 = std::min(gray.rows, y0 + bandRows);
+                processBand(gray, y0, y1, describe, bands[b]);
+            }
+        });
+    }
+
+    // Guarda score + 1 en cada esquina de la fila y, y 0 donde no hay esquina.
+    // Con umbral 0 o 1 una esquina real puede tener score 0 (o -1, que se
+    // lleva a 0), así que el desplazamiento evita confundirla con el fondo.
+    void scoreRow(const cv::Mat& gray, int y, const int pixel[25], uchar* scores) const {
+        const int threshold = std::min(std::max(params_.threshold, 0), 255);
+        const uchar* row = gray.ptr<uchar>(y);
+        std::memset(scores, 0, gray.cols);
+        int x = 3;
+
+#ifdef FAST_BRIEF_USE_SSE2
+        const __m128i delta = _mm_set1_epi8((char)0x80);
+        const __m128i t = _mm_set1_epi8((char)threshold);
+        const __m128i nine = _mm_set1_epi8(9);
+        for (; x <= gray.cols - 3 - 16; x += 16) {
+            const uchar* ptr = row + x;
+            __m128i v = _mm_loadu_si128((const __m128i*)ptr);
+            __m128i upper = _mm_xor_si128(_mm_adds_epu8(v, t), delta);
+            __m128i lower = _mm_xor_si128(_mm_subs_epu8(v, t), delta);
+
+            __m128i bright[16], dark[16];
+            for (int k = 0; k < 16; k += 4) {
+                __m128i p = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(ptr + pixel[k])), delta);
+                bright[k] = _mm_cmpgt_epi8(p, upper);
+                dark[k] = _mm_cmpgt_epi8(lower, p);
+            }
+
+            // Descarte rápido: 9 contiguos cubren al menos dos cardinales consecutivos
+            __m128i quick = _mm_or_si128(
+                _mm_and_si128(_mm_or_si128(bright[0], bright[8]), _mm_or_si128(bright[4], bright[12])),
+                _mm_and_si128(_mm_or_si128(dark[0], dark[8]), _mm_or_si128(dark[4], dark[12])));
+            if (_mm_movemask_epi8(quick) == 0) {
+                continue;
+            }
+
+            for (int k = 0; k < 16; k++) {
+                if ((k & 3) == 0) continue;
+                __m128i p = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(ptr + pixel[k])), delta);
+                bright[k] = _mm_cmpgt_epi8(p, upper);
+                dark[k] = _mm_cmpgt_epi8(lower, p);
+            }
+
+            // Longitud máxima de racha contigua (con vuelta) por carril
+            __m128i runBright = _mm_setzero_si128(), runDark = _mm_setzero_si128();
+            __m128i maxBright = _mm_setzero_si128(), maxDark = _mm_setzero_si128();
+            for (int k = 0; k < 25; k++) {
+                __m128i b = bright[k & 15], d = dark[k & 15];
+                runBright = _mm_and_si128(_mm_sub_epi8(runBright, b), b);
+                runDark = _mm_and_si128(_mm_sub_epi8(runDark, d), d);
+                maxBright = _mm_max_epu8(maxBright, runBright);
+                maxDark = _mm_max_epu8(maxDark, runDark);
+            }
+            __m128i best = _mm_max_epu8(maxBright, maxDark);
+            int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(best, nine), best));
+
+            while (mask) {
+                int lane = 0;
+                while (!(mask & (1 << lane))) lane++;
+                mask &= ~(1 << lane);
+                scores[x + lane] = encodeScore(cornerScore(ptr + lane, pixel, threshold));
+            }
+        }
+#endif
+
+        for (; x < gray.cols - 3; x++) {
+            const uchar* ptr = row + x;
+            if (isCorner(ptr, pixel, threshold)) {
+                scores[x] = encodeScore(cornerScore(ptr, pixel, threshold));
+            }
+        }
+    }
+
+    // El score máximo es 254 (diferencias de 8 bits), así que score + 1 entra en un uchar
+    static uchar encodeScore(int score) {
+        return (uchar)(std::max(score, 0) + 1);
+    }
+
+    void processBand(const cv::Mat& gray, int y0, int y1, bool describe, BandOutput& out) const {
+        const int cols = gray.cols;
+        int pixel[25];
+        makeOffsets(pixel, (int)gray.step[0]);
+
+        // Scores de las filas y0-1 .. y1 (una fila extra a cada lado para la supresión)
+        int firstRow = y0 - 1;
+        int numRows = (y1 - y0) + 2;
+        std::vector<uchar> scores((size_t)numRows * cols, 0);
+        for (int r = 0; r < numRows; r++) {
+            int y = firstRow + r;
+            if (y >= 3 && y < gray.rows - 3) {
+                scoreRow(gray, y, pixel, &scores[(size_t)r * cols]);
+            }
+        }
+
+        // Supresión de no máximos 3x3 (estricta, como FastFeatureDetector). El
+        // desplazamiento de los scores no cambia el orden entre esquinas.
+        std::vector<cv::KeyPoint> corners;
+        for (int y = std::max(y0, 3); y < std::min(y1, gray.rows - 3); y++) {
+            const uchar* prev = &scores[(size_t)(y - firstRow - 1) * cols];
+            const uchar* curr = prev + cols;
+            const uchar* next = curr + cols;
+            for (int x = 3; x < cols - 3; x++) {
+                int s = curr[x];
+                if (s == 0) continue;
+                if (params_.nonmaxSuppression &&
+                    !(s > prev[x - 1] && s > prev[x] && s > prev[x + 1] &&
+                      s > curr[x - 1] && s > curr[x + 1] &&
+                      s > next[x - 1] && s > next[x] && s > next[x + 1])) {
+                    continue;
+                }
+                // BRIEF necesita un parche completo alrededor del punto
+                if (describe && (x < BORDER || y < BORDER || x >= cols - BORDER || y >= gray.rows - BORDER)) {
+                    continue;
+                }
+                corners.push_back(cv::KeyPoint((float)x, (float)y, 7.f, -1, (float)(s - 1)));
+            }
+        }
+        if (corners.empty() || !describe) {
+            out.keypoints.swap(corners);
+            return;
+        }
+
+        // Imagen integral local de la banda con el halo que necesita el parche
+        int iy0 = std::max(0, y0 - BORDER);
+        int iy1 = std::min(gray.rows, y1 + BORDER);
+        int irows = iy1 - iy0;
+        std::vector<int> integral((size_t)(irows + 1) * (cols + 1), 0);
+        for (int r = 0; r < irows; r++) {
+            const uchar* src = gray.ptr<uchar>(iy0 + r);
+            const int* above = &integral[(size_t)r * (cols + 1)];
+            int* dst = &integral[(size_t)(r + 1) * (cols + 1)];
+            int rowSum = 0;
+            for (int x = 0; x < cols; x++) {
+                rowSum += src[x];
+                dst[x + 1] = above[x + 1] + rowSum;
+            }
+        }
+
+        out.keypoints = corners;
+        out.descriptors.resize(corners.size() * DESCRIPTOR_BYTES);
+        const int stride = cols + 1;
+        for (size_t i = 0; i < corners.size(); i++) {
+            int kx = (int)corners[i].pt.x;
+            int ky = (int)corners[i].pt.y - iy0;
+            uchar* desc = &out.descriptors[i * DESCRIPTOR_BYTES];
+            for (int byteIdx = 0; byteIdx < DESCRIPTOR_BYTES; byteIdx++) {
+                int value = 0;
+                for (int bit = 0; bit < 8; bit++) {
+                    const TestPair& tp = pattern_[byteIdx * 8 + bit];
+                    int s1 = boxSum(integral.data(), stride, kx + tp.x1, ky + tp.y1);
+                    int s2 = boxSum(integral.data(), stride, kx + tp.x2, ky + tp.y2);
+                    value = (value << 1) | (s1 < s2 ? 1 : 0);
+                }
+                desc[byteIdx] = (uchar)value;
+            }
+        }
+    }
+
+    // Suma de la caja KERNEL_SIZE x KERNEL_SIZE centrada en (x, y) de la integral local
+    static int boxSum(const int* integral, int stride, int x, int y) {
+        int xa = x - HALF_KERNEL, xb = x + HALF_KERNEL + 1;
+        int ya = y - HALF_KERNEL, yb = y + HALF_KERNEL + 1;
+        return integral[yb * stride + xb] - integral[yb * stride + xa]
+             - integral[ya * stride + xb] + integral[ya * stride + xa];
+    }
+
+    static void keepStrongest(std::vector<cv::KeyPoint>& keypoints, std::vector<uchar>& packed, int count) {
+        std::vector<int> order(keypoints.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = (int)i;
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+            return keypoints[a].response > keypoints[b].response;
+        });
+        order.resize(count);
+        std::sort(order.begin(), order.end());   // Mantener el orden por filas
+
+        std::vector<cv::KeyPoint> keptKeypoints;
+        std::vector<uchar> keptDescriptors;
+        keptKeypoints.reserve(count);
+        keptDescriptors.reserve((size_t)count * DESCRIPTOR_BYTES);
+        for (int idx : order) {
+            keptKeypoints.push_back(keypoints[idx]);
+            if (packed.empty()) continue;
+            keptDescriptors.insert(keptDescriptors.end(), packed.begin() + (size_t)idx * DESCRIPTOR_BYTES,
+                                   packed.begin() + (size_t)(idx + 1) * DESCRIPTOR_BYTES);
+        }
+        keypoints.swap(keptKeypoints);
+        if (!packed.empty()) {
+            packed.swap(keptDescriptors);
+        }
+    }
+
+    struct TestPair {
+        int x1, y1, x2, y2;
+    };
+
+    // Patrón G II del artículo de BRIEF: pares gaussianos con sigma = S/5,
+    // recortados al parche. Generador propio para que sea igual en cualquier plataforma.
+    void buildPattern() {
+        uint64_t state = 0x9E3779B97F4A7C15ULL;
+        auto nextUniform = [&state]() {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return ((state >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+        };
+        auto nextCoord = [&]() {
+            double u1 = nextUniform(), u2 = nextUniform();
+            double g = std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * CV_PI * u2);
+            int half = PATCH_SIZE / 2;
+            int c = (int)std::lround(g * PATCH_SIZE / 5.0);
+            return std::min(std::max(c, -half), half);
+        };
+        pattern_.resize(DESCRIPTOR_BYTES * 8);
+        for (TestPair& tp : pattern_) {
+            tp.x1 = nextCoord();
+            tp.y1 = nextCoord();
+            tp.x2 = nextCoord();
+            tp.y2 = nextCoord();
+        }
+    }
+
+    FastBriefParams params_;
+    std::vector<TestPair> pattern_;
+};
+
+#endif // FAST_BRIEF_ENGINE_HPP
@@ -0,0 +1,104 @@
+#ifndef FEATURE_FACTORY_HPP
+#define FEATURE_FACTORY_HPP
+
+#include <iostream>
+#include <string>
+
+#include "opencv2/core.hpp"
+#include "opencv2/features2d.hpp"
+#include "opencv2/xfeatures2d.hpp"
+
+#include "sift_frontend.hpp"
+
+// Fábricas de detectores, descriptores y matchers compartidas por
+// combination_tester y los modos que se construyen sobre él.
+
+// Función para crear un detector
+inline cv::Ptr<cv::Feature2D> createDetector(const std::string& detectorName) {
+    if (detectorName == "SIFT") {
+        return cv::SIFT::create(500);
+    } else if (detectorName == "SIFTFP") {
+        // Pirámide DoG en punto fijo y multihilo (sift_frontend.hpp)
+        return FixedPointSIFT::create();
+    } else if (detectorName == "SURF") {
+        return cv::xfeatures2d::SURF::create(100, 3, 3, false);
+    } else if (detectorName == "ORB") {
+        return cv::ORB::create(700);
+    } else if (detectorName == "BRISK") {
+        return cv::BRISK::create(30, 3, 1.0f);
+    } else if (detectorName == "FAST") {
+        return cv::FastFeatureDetector::create(20);
+    } else {
+        std::cerr << "Detector no reconocido: " << detectorName << std::endl;
+        return nullptr;
+    }
+}
+
+// Mismo detector que createDetector pero sin tope de keypoints (SIFT y ORB
+// se crean con 500 y 700). El controlador de resolución cuenta con este los
+// keypoints disponibles a cada escala: con el tope, el nivel grueso ya
+// llegaría al objetivo y toda escena se procesaría a la escala de ese nivel.
+inline cv::Ptr<cv::Feature2D> createUncappedDetector(const std::string& detectorName) {
+    if (detectorName == "SIFT") {
+        return cv::SIFT::create(0);
+    } else if (detectorName == "SIFTFP") {
+        SiftFrontendParams params;
+        params.maxFeatures = 0;
+        return FixedPointSIFT::create(params);
+    } else if (detectorName == "ORB") {
+        return cv::ORB::create(100000);
+    }
+    return createDetector(detectorName);
+}
+
+// Función para crear un descriptor
+inline cv::Ptr<cv::Feature2D> createDescriptor(const std::string& descriptorName) {
+    if (descriptorName == "SIFT") {
+        return cv::SIFT::create(500);
+    } else if (descriptorName == "SURF") {
+        return cv::xfeatures2d::SURF::create(100, 3, 3, false);
+    } else if (descriptorName == "ORB") {
+        return cv::ORB::create(700);
+    } else if (descriptorName == "BRISK") {
+        return cv::BRISK::create(30, 3, 1.0f);
+    } else if (descriptorName == "BRIEF") {
+        return cv::xfeatures2d::BriefDescriptorExtractor::create(32);
+    } else if (descriptorName == "FREAK") {
+        return cv::xfeatures2d::FREAK::create();
+    } else {
+        std::cerr << "Descriptor no reconocido: " << descriptorName << std::endl;
+        return nullptr;
+    }
+}
+
+// Función para crear un matcher
+inline cv::Ptr<cv::DescriptorMatcher> createMatcher(const std::string& matcherName, bool isBinaryDescriptor) {
+    if (matcherName == "BF") {
+        if (isBinaryDescriptor) {
+            return cv::DescriptorMatcher::create("BruteForce-Hamming");
+        } else {
+            return cv::DescriptorMatcher::create("BruteForce");
+        }
+    } else if (matcherName == "FLANN") {
+        if (isBinaryDescriptor) {
+            // Para descriptores binarios en FLANN
+            cv::Ptr<cv::flann::IndexParams> indexParams = cv::makePtr<cv::flann::LshIndexParams>(6, 12, 1);
+            cv::Ptr<cv::flann::SearchParams> searchParams = cv::makePtr<cv::flann::SearchParams>(50);
+            return cv::makePtr<cv::FlannBasedMatcher>(indexParams, searchParams);
+        } else {
+            // Para descriptores flotantes en FLANN
+            return cv::DescriptorMatcher::create("FlannBased");
+        }
+    } else {
+        std::cerr << "Matcher no reconocido: " << matcherName << std::endl;
+        return nullptr;
+    }
+}
+
+// Descriptores binarios (se comparan con distancia de Hamming)
+inline bool isBinaryDescriptorName(const std::string& descriptorName) {
+    return descriptorName == "ORB" || descriptorName == "BRIEF" ||
+           descriptorName == "BRISK" || descriptorName == "FREAK";
+}
+
+#endif // FEATURE_FACTORY_HPP
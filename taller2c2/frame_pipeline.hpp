@@ -0,0 +1,381 @@
+#ifndef FRAME_PIPELINE_HPP
+#define FRAME_PIPELINE_HPP
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <exception>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <algorithm>
+
+#include "trace.hpp"
+
+// Ejecutor de pipeline por etapas para flujos de imágenes.
+//
+// Cada etapa (decodificar, detectar/describir, matching, RANSAC...) tiene sus
+// propios hilos y entre dos etapas hay una cola acotada sin locks. Mientras una
+// etapa trabaja en el cuadro n, la anterior ya procesa el n+1, así que el
+// throughput se acerca al de la etapa más lenta en lugar de a la suma de
+// todas. El sink recibe los cuadros en el orden de entrada (buffer de
+// reordenamiento por número de secuencia) aunque las etapas con varios hilos
+// los terminen desordenados. Se miden la ocupación de cada cola y el tiempo
+// ocupado de cada etapa para ajustar hilos y capacidades. Con la traza activa
+// (trace.hpp) cada cuadro procesado es una zona en el hilo de su etapa.
+//
+// Si la fuente, una fábrica, una etapa o el sink lanzan una excepción (p. ej.
+// cv::Exception con un cuadro corrupto), se guarda la primera, la fuente deja
+// de producir y los cuadros que quedan en las colas se descartan sin pasar
+// por las etapas ni por el sink; run() la relanza después de unir los hilos.
+
+// Cola MPMC acotada sin locks (algoritmo de D. Vyukov): cada celda lleva un
+// número de secuencia que indica si está libre para el productor o lista
+// para el consumidor de la vuelta actual del anillo.
+template <typename T>
+class BoundedMpmcQueue {
+public:
+    explicit BoundedMpmcQueue(size_t capacity) {
+        size_t n = 2;
+        while (n < capacity) {
+            n <<= 1;
+        }
+        mask_ = n - 1;
+        cells_.reset(new Cell[n]);
+        for (size_t i = 0; i < n; i++) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueuePos_.store(0, std::memory_order_relaxed);
+        dequeuePos_.store(0, std::memory_order_relaxed);
+    }
+
+    bool tryPush(const T& value) {
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;   // Llena
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;   // Vacía
+            } else {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        value = cell->data;
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Aproximado: solo sirve para estadísticas
+    size_t sizeApprox() const {
+        size_t enq = enqueuePos_.load(std::memory_order_relaxed);
+        size_t deq = dequeuePos_.load(std::memory_order_relaxed);
+        return enq > deq ? enq - deq : 0;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    // Relleno para que productores y consumidores no compartan línea de caché
+    char pad0_[64];
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    char pad1_[64];
+    std::atomic<size_t> enqueuePos_;
+    char pad2_[64];
+    std::atomic<size_t> dequeuePos_;
+    char pad3_[64];
+};
+
+struct PipelineStageStats {
+    std::string name;
+    int threads = 0;
+    uint64_t processed = 0;
+    double busyMs = 0;            // Suma del tiempo ocupado de todos los hilos
+    double utilization = 0;       // busyMs / (hilos * tiempo total)
+    size_t queueCapacity = 0;     // Cola de entrada de la etapa
+    double meanOccupancy = 0;
+    size_t maxOccupancy = 0;
+};
+
+template <typename Frame>
+class FramePipeline {
+public:
+    typedef std::function<void(Frame&)> StageFn;
+    // Se llama una vez por hilo: cada hilo tiene su propio estado (detectores,
+    // matchers...), porque no todos los objetos de OpenCV son reentrantes
+    typedef std::function<StageFn()> StageFactory;
+
+    explicit FramePipeline(size_t queueCapacity = 8) : queueCapacity_(std::max<size_t>(queueCapacity, 2)) {}
+
+    void addStage(const std::string& name, int threads, StageFactory factory) {
+        Stage stage;
+        stage.name = name;
+        stage.threads = std::max(threads, 1);
+        stage.factory = factory;
+        stage.traceName = traceIntern(name);
+        stages_.push_back(stage);
+    }
+
+    // source rellena el cuadro siguiente y devuelve false al terminar; sink
+    // recibe los cuadros terminados en orden de entrada. Devuelve el número
+    // de cuadros procesados; relanza la primera excepción de cualquier hilo.
+    uint64_t run(std::function<bool(Frame&)> source, std::function<void(Frame&)> sink) {
+        typedef std::chrono::steady_clock Clock;
+        // Primera excepción; a partir de ahí los cuadros solo se drenan
+        std::exception_ptr error;
+        std::mutex errorMutex;
+        std::atomic<bool> failed(false);
+        auto fail = [&]() {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+            failed.store(true, std::memory_order_release);
+        };
+        size_t numStages = stages_.size();
+        // queues[i] es la entrada de la etapa i; queues[numStages] va al sink
+        std::vector<std::unique_ptr<BoundedMpmcQueue<Item>>> queues;
+        std::vector<std::unique_ptr<QueueMonitor>> monitors;
+        std::vector<std::unique_ptr<std::atomic<bool>>> inputDone;
+        std::vector<std::unique_ptr<std::atomic<int>>> alive;
+        for (size_t i = 0; i <= numStages; i++) {
+            queues.emplace_back(new BoundedMpmcQueue<Item>(queueCapacity_));
+            monitors.emplace_back(new QueueMonitor());
+            inputDone.emplace_back(new std::atomic<bool>(false));
+        }
+        for (size_t i = 0; i < numStages; i++) {
+            alive.emplace_back(new std::atomic<int>(stages_[i].threads));
+            stages_[i].processed.reset(new std::atomic<uint64_t>(0));
+            stages_[i].busyNs.reset(new std::atomic<int64_t>(0));
+        }
+
+        Clock::time_point start = Clock::now();
+        std::vector<std::thread> workers;
+        for (size_t s = 0; s < numStages; s++) {
+            for (int t = 0; t < stages_[s].threads; t++) {
+                workers.emplace_back([&, s, t]() {
+                    Stage& stage = stages_[s];
+                    traceSetThreadName(stage.name + " #" + std::to_string(t));
+                    StageFn fn;
+                    try {
+                        fn = stage.factory();
+                    } catch (...) {
+                        fail();
+                    }
+                    Item item;
+                    int64_t busy = 0;
+                    uint64_t count = 0;
+                    while (popOrFinish(*queues[s], *inputDone[s], item)) {
+                        if (!failed.load(std::memory_order_acquire)) {
+                            Clock::time_point t0 = Clock::now();
+                            try {
+                                TraceZone zone(stage.traceName, "frame", (int64_t)item.sequence);
+                                fn(*item.frame);
+                            } catch (...) {
+                                fail();
+                            }
+                            busy += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+                            count++;
+                        }
+                        // Se pasa igual a la siguiente cola para que el sink libere el cuadro
+                        push(*queues[s + 1], *monitors[s + 1], item);
+                    }
+                    stage.busyNs->fetch_add(busy);
+                    stage.processed->fetch_add(count);
+                    // El último hilo de la etapa cierra la entrada de la siguiente
+                    if (alive[s]->fetch_sub(1) == 1) {
+                        inputDone[s + 1]->store(true, std::memory_order_release);
+                    }
+                });
+            }
+        }
+
+        // Sink en su propio hilo, con buffer de reordenamiento
+        uint64_t delivered = 0;
+        auto deliver = [&](Frame* frame, uint64_t sequence) {
+            if (!failed.load(std::memory_order_acquire)) {
+                try {
+                    TraceZone zone("sink", "frame", (int64_t)sequence);
+                    sink(*frame);
+                    delivered++;
+                } catch (...) {
+                    fail();
+                }
+            }
+            delete frame;
+        };
+        std::thread sinkThread([&]() {
+            traceSetThreadName("sink");
+            std::map<uint64_t, Frame*> pending;
+            uint64_t next = 0;
+            Item item;
+            while (popOrFinish(*queues[numStages], *inputDone[numStages], item)) {
+                pending[item.sequence] = item.frame;
+                typename std::map<uint64_t, Frame*>::iterator it;
+                while ((it = pending.find(next)) != pending.end()) {
+                    deliver(it->second, next);
+                    pending.erase(it);
+                    next++;
+                }
+            }
+            // No debería quedar nada: todos los números de secuencia llegan
+            for (auto& p : pending) {
+                deliver(p.second, p.first);
+            }
+        });
+
+        // Fuente en el hilo actual
+        uint64_t sequence = 0;
+        while (!failed.load(std::memory_order_acquire)) {
+            Frame* frame = new Frame();
+            bool more = false;
+            try {
+                more = source(*frame);
+            } catch (...) {
+                fail();
+            }
+            if (!more) {
+                delete frame;
+                break;
+            }
+            Item item;
+            item.sequence = sequence++;
+            item.frame = frame;
+            push(*queues[0], *monitors[0], item);
+        }
+        inputDone[0]->store(true, std::memory_order_release);
+
+        for (std::thread& w : workers) {
+            w.join();
+        }
+        sinkThread.join();
+        double wallMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        stats_.clear();
+        for (size_t s = 0; s < numStages; s++) {
+            PipelineStageStats st;
+            st.name = stages_[s].name;
+            st.threads = stages_[s].threads;
+            st.processed = stages_[s].processed->load();
+            st.busyMs = stages_[s].busyNs->load() / 1e6;
+            st.utilization = wallMs > 0 ? st.busyMs / (st.threads * wallMs) : 0;
+            st.queueCapacity = queues[s]->capacity();
+            uint64_t samples = monitors[s]->samples.load();
+            st.meanOccupancy = samples ? (double)monitors[s]->sum.load() / samples : 0;
+            st.maxOccupancy = monitors[s]->max.load();
+            stats_.push_back(st);
+        }
+        wallMs_ = wallMs;
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return delivered;
+    }
+
+    const std::vector<PipelineStageStats>& stats() const { return stats_; }
+    double wallMs() const { return wallMs_; }
+
+private:
+    struct Item {
+        uint64_t sequence = 0;
+        Frame* frame = nullptr;
+    };
+
+    // Ocupación muestreada en cada push
+    struct QueueMonitor {
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> samples{0};
+        std::atomic<size_t> max{0};
+    };
+
+    struct Stage {
+        std::string name;
+        const char* traceName = "";
+        int threads = 1;
+        StageFactory factory;
+        std::shared_ptr<std::atomic<uint64_t>> processed;
+        std::shared_ptr<std::atomic<int64_t>> busyNs;
+    };
+
+    // Espera activa corta y luego cede el procesador / duerme: las etapas
+    // duran milisegundos, así que unos microsegundos de latencia no importan
+    static void backoff(int& spins) {
+        if (++spins < 64) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    static void push(BoundedMpmcQueue<Item>& queue, QueueMonitor& monitor, const Item& item) {
+        int spins = 0;
+        while (!queue.tryPush(item)) {
+            backoff(spins);
+        }
+        size_t occupancy = queue.sizeApprox();
+        monitor.sum.fetch_add(occupancy, std::memory_order_relaxed);
+        monitor.samples.fetch_add(1, std::memory_order_relaxed);
+        size_t prev = monitor.max.load(std::memory_order_relaxed);
+        while (occupancy > prev && !monitor.max.compare_exchange_weak(prev, occupancy)) {
+        }
+    }
+
+    // Devuelve false cuando la etapa anterior terminó y la cola quedó vacía
+    static bool popOrFinish(BoundedMpmcQueue<Item>& queue, std::atomic<bool>& done, Item& item) {
+        int spins = 0;
+        while (true) {
+            if (queue.tryPop(item)) {
+                return true;
+            }
+            if (done.load(std::memory_order_acquire)) {
+                // Un push pudo completarse justo antes de marcar el fin
+                return queue.tryPop(item);
+            }
+            backoff(spins);
+        }
+    }
+
+    size_t queueCapacity_;
+    std::vector<Stage> stages_;
+    std::vector<PipelineStageStats> stats_;
+    double wallMs_ = 0;
+};
+
+#endif // FRAME_PIPELINE_HPP
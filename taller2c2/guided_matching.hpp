@@ -0,0 +1,233 @@
+#ifndef GUIDED_MATCHING_HPP
+#define GUIDED_MATCHING_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "opencv2/core.hpp"
+#include "opencv2/calib3d.hpp"
+#include "opencv2/features2d.hpp"
+
+// Emparejamiento guiado por homografía (segunda pasada).
+//
+// Una vez que findHomography tiene una estimación inicial, cada keypoint del
+// objeto se proyecta en la escena y solo se compara con los keypoints de la
+// escena que caen dentro de un radio pequeño alrededor de la predicción. Los
+// candidatos se obtienen de una rejilla espacial (hash por celdas), así que el
+// costo es proporcional al número de vecinos y no al tamaño de la escena.
+
+// Rejilla espacial sobre los keypoints de la escena. Los índices se guardan
+// ordenados por celda (estilo CSR): cellStart[c]..cellStart[c+1] son los
+// keypoints de la celda c.
+class SpatialGrid {
+public:
+    void build(const std::vector<cv::KeyPoint>& keypoints, cv::Size imageSize, float cellSize) {
+        cellSize_ = std::max(cellSize, 1.0f);
+        gridCols_ = std::max(1, (int)std::ceil(imageSize.width / cellSize_));
+        gridRows_ = std::max(1, (int)std::ceil(imageSize.height / cellSize_));
+
+        std::vector<int> cellOf(keypoints.size());
+        cellStart_.assign(gridCols_ * gridRows_ + 1, 0);
+        for (size_t i = 0; i < keypoints.size(); i++) {
+            cellOf[i] = cellIndex(keypoints[i].pt);
+            cellStart_[cellOf[i] + 1]++;
+        }
+        for (size_t c = 1; c < cellStart_.size(); c++) {
+            cellStart_[c] += cellStart_[c - 1];
+        }
+
+        indices_.resize(keypoints.size());
+        std::vector<int> fill(cellStart_.begin(), cellStart_.end() - 1);
+        for (size_t i = 0; i < keypoints.size(); i++) {
+            indices_[fill[cellOf[i]]++] = (int)i;
+        }
+        points_.resize(keypoints.size());
+        for (size_t i = 0; i < keypoints.size(); i++) {
+            points_[i] = keypoints[i].pt;
+        }
+    }
+
+    // Devuelve los índices de los keypoints a distancia <= radius de p. Un p
+    // no finito (homografía degenerada) no tiene vecinos; las celdas se
+    // recortan a la rejilla antes de pasar a entero
+    void query(const cv::Point2f& p, float radius, std::vector<int>& out) const {
+        out.clear();
+        if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(radius)) {
+            return;
+        }
+        int cx0 = clampCell((p.x - radius) / cellSize_, gridCols_);
+        int cy0 = clampCell((p.y - radius) / cellSize_, gridRows_);
+        int cx1 = clampCell((p.x + radius) / cellSize_, gridCols_);
+        int cy1 = clampCell((p.y + radius) / cellSize_, gridRows_);
+        float r2 = radius * radius;
+
+        for (int cy = cy0; cy <= cy1; cy++) {
+            for (int cx = cx0; cx <= cx1; cx++) {
+                int c = cy * gridCols_ + cx;
+                for (int k = cellStart_[c]; k < cellStart_[c + 1]; k++) {
+                    int idx = indices_[k];
+                    float dx = points_[idx].x - p.x;
+                    float dy = points_[idx].y - p.y;
+                    if (dx * dx + dy * dy <= r2) {
+                        out.push_back(idx);
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    static int clampCell(float c, int cells) {
+        return (int)std::min(std::max(c, 0.0f), (float)(cells - 1));
+    }
+
+    int cellIndex(const cv::Point2f& p) const {
+        int cx = std::min(std::max((int)(p.x / cellSize_), 0), gridCols_ - 1);
+        int cy = std::min(std::max((int)(p.y / cellSize_), 0), gridRows_ - 1);
+        return cy * gridCols_ + cx;
+    }
+
+    float cellSize_ = 1.0f;
+    int gridCols_ = 1;
+    int gridRows_ = 1;
+    std::vector<int> cellStart_;
+    std::vector<int> indices_;
+    std::vector<cv::Point2f> points_;
+};
+
+struct GuidedMatchingParams {
+    float searchRadius = 8.0f;       // Radio de búsqueda en píxeles de la escena
+    float ratioThreshold = 0.8f;     // Test de ratio entre los candidatos locales
+    int normType = cv::NORM_L2;      // NORM_HAMMING para descriptores binarios
+    double ransacThreshold = 3.0;    // Umbral de reproyección para la homografía refinada
+};
+
+struct GuidedMatchingResult {
+    std::vector<cv::DMatch> matches;  // Matches guiados (uno a uno)
+    cv::Mat homography;               // Homografía refinada (o la inicial si no mejora)
+    int numInliers = 0;               // Inliers de la homografía devuelta
+    bool refined = false;             // true si la homografía refinada reemplazó a la inicial
+};
+
+// Empareja cada keypoint del objeto solo con los keypoints de la escena cercanos
+// a su posición predicha por la homografía. maxDistance acota la distancia de
+// descriptor aceptada cuando solo hay un candidato (sin segundo vecino no se
+// puede aplicar el test de ratio).
+inline std::vector<cv::DMatch> guidedMatch(const std::vector<cv::KeyPoint>& keypoints1,
+                                           const cv::Mat& descriptors1,
+                                           const std::vector<cv::KeyPoint>& keypoints2,
+                                           const cv::Mat& descriptors2,
+                                           const cv::Mat& homography,
+                                           const SpatialGrid& grid,
+                                           const GuidedMatchingParams& params,
+                                           float maxDistance) {
+    std::vector<cv::DMatch> matches;
+    if (keypoints1.empty() || homography.empty()) {
+        return matches;
+    }
+
+    std::vector<cv::Point2f> obj, predicted;
+    cv::KeyPoint::convert(keypoints1, obj);
+    cv::perspectiveTransform(obj, predicted, homography);
+
+    // Mejor match por keypoint de la escena para imponer unicidad
+    std::vector<int> bestForTrain(keypoints2.size(), -1);
+    std::vector<int> candidates;
+
+    for (size_t i = 0; i < keypoints1.size() && (int)i < descriptors1.rows; i++) {
+        grid.query(predicted[i], params.searchRadius, candidates);
+        if (candidates.empty()) {
+            continue;
+        }
+
+        float best = FLT_MAX, second = FLT_MAX;
+        int bestIdx = -1;
+        for (int j : candidates) {
+            if (j >= descriptors2.rows) {
+                continue;
+            }
+            float d = (float)cv::norm(descriptors1.row((int)i), descriptors2.row(j), params.normType);
+            if (d < best) {
+                second = best;
+                best = d;
+                bestIdx = j;
+            } else if (d < second) {
+                second = d;
+            }
+        }
+
+        if (bestIdx < 0) {
+            continue;
+        }
+        bool accepted = second < FLT_MAX ? best < params.ratioThreshold * second
+                                         : best <= maxDistance;
+        if (!accepted) {
+            continue;
+        }
+
+        int previous = bestForTrain[bestIdx];
+        if (previous >= 0) {
+            if (matches[previous].distance <= best) {
+                continue;
+            }
+            matches[previous].queryIdx = -1;  // Se descarta al final
+        }
+        bestForTrain[bestIdx] = (int)matches.size();
+        matches.push_back(cv::DMatch((int)i, bestIdx, best));
+    }
+
+    matches.erase(std::remove_if(matches.begin(), matches.end(),
+                                 [](const cv::DMatch& m) { return m.queryIdx < 0; }),
+                  matches.end());
+    return matches;
+}
+
+// Segunda pasada completa: matching guiado + homografía refinada con RANSAC.
+// Si la homografía refinada no tiene más inliers que la inicial se conserva la
+// inicial, de modo que esta etapa nunca empeora el resultado.
+inline GuidedMatchingResult guidedMatchAndRefine(const std::vector<cv::KeyPoint>& keypoints1,
+                                                 const cv::Mat& descriptors1,
+                                                 const std::vector<cv::KeyPoint>& keypoints2,
+                                                 const cv::Mat& descriptors2,
+                                                 const cv::Mat& initialHomography,
+                                                 int initialInliers,
+                                                 cv::Size sceneSize,
+                                                 const GuidedMatchingParams& params,
+                                                 float maxDistance) {
+    GuidedMatchingResult result;
+    result.homography = initialHomography;
+    result.numInliers = initialInliers;
+
+    SpatialGrid grid;
+    grid.build(keypoints2, sceneSize, params.searchRadius);
+
+    result.matches = guidedMatch(keypoints1, descriptors1, keypoints2, descriptors2,
+                                 initialHomography, grid, params, maxDistance);
+    if (result.matches.size() < 4) {
+        return result;
+    }
+
+    std::vector<cv::Point2f> obj, scene;
+    for (const cv::DMatch& m : result.matches) {
+        obj.push_back(keypoints1[m.queryIdx].pt);
+        scene.push_back(keypoints2[m.trainIdx].pt);
+    }
+
+    cv::Mat inlierMask;
+    cv::Mat refined = cv::findHomography(obj, scene, cv::RANSAC, params.ransacThreshold, inlierMask);
+    if (refined.empty()) {
+        return result;
+    }
+
+    int refinedInliers = cv::countNonZero(inlierMask);
+    if (refinedInliers > initialInliers) {
+        result.homography = refined;
+        result.numInliers = refinedInliers;
+        result.refined = true;
+    }
+    return result;
+}
+
+#endif // GUIDED_MATCHING_HPP
@@ -0,0 +1,258 @@
+#ifndef MULTI_OBJECT_HPP
+#define MULTI_OBJECT_HPP
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+
+#include "opencv2/core.hpp"
+#include "opencv2/calib3d.hpp"
+#include "opencv2/features2d.hpp"
+
+#include "feature_factory.hpp"
+#include "trace.hpp"
+
+// Detección de varios objetos en una misma escena.
+//
+// Los keypoints y descriptores de la escena se calculan una sola vez. Todos los
+// conjuntos de descriptores de las plantillas se añaden a un único matcher
+// (índice combinado, DMatch::imgIdx indica la plantilla), de modo que una sola
+// pasada de knnMatch empareja la escena contra todos los objetos. Después se
+// estima la homografía de cada objeto en paralelo, quitando los inliers de cada
+// instancia encontrada para buscar más instancias del mismo objeto.
+
+struct ObjectTemplate {
+    std::string name;
+    cv::Size size;
+    std::vector<cv::KeyPoint> keypoints;
+    cv::Mat descriptors;
+};
+
+struct ObjectDetection {
+    int templateIdx;
+    int instance;              // 0 para la primera instancia de cada plantilla
+    int numInliers;
+    cv::Mat homography;
+    std::vector<cv::Point2f> corners;   // Esquinas de la plantilla proyectadas en la escena
+};
+
+struct MultiObjectParams {
+    int minInliers = 12;           // Inliers mínimos para aceptar una instancia
+    int maxInstancesPerObject = 5; // Máximo de instancias del mismo objeto
+    double ransacThreshold = 3.0;
+    double minAreaRatio = 0.001;   // Área mínima proyectada respecto a la escena
+};
+
+struct MultiObjectTimings {
+    double sceneFeaturesMs = 0;
+    double matchingMs = 0;
+    double estimationMs = 0;
+};
+
+// Comprueba que las esquinas proyectadas formen un cuadrilátero convexo y no
+// degenerado; RANSAC puede devolver homografías que cumplen el umbral con pocos
+// puntos pero que no corresponden a un objeto plano visible.
+inline bool isPlausibleQuad(const std::vector<cv::Point2f>& corners, double minArea) {
+    if (corners.size() != 4) {
+        return false;
+    }
+    double area = 0;
+    int sign = 0;
+    for (int i = 0; i < 4; i++) {
+        const cv::Point2f& a = corners[i];
+        const cv::Point2f& b = corners[(i + 1) % 4];
+        const cv::Point2f& c = corners[(i + 2) % 4];
+        double cross = (double)(b.x - a.x) * (c.y - b.y) - (double)(b.y - a.y) * (c.x - b.x);
+        int s = cross > 0 ? 1 : (cross < 0 ? -1 : 0);
+        if (s == 0 || (sign != 0 && s != sign)) {
+            return false;
+        }
+        sign = s;
+        area += (double)a.x * b.y - (double)b.x * a.y;
+    }
+    return fabs(area) * 0.5 >= minArea;
+}
+
+class MultiObjectDetector {
+public:
+    MultiObjectDetector(const std::string& detectorName, const std::string& descriptorName, const std::string& matcherName) {
+        detector_ = createDetector(detectorName);
+        descriptor_ = createDescriptor(descriptorName);
+        isBinary_ = isBinaryDescriptorName(descriptorName);
+        convertToFloat_ = matcherName == "FLANN" && !isBinary_;
+        matcher_ = createMatcher(matcherName, isBinary_);
+        ratioThreshold_ = isBinary_ ? 0.8f : 0.75f;
+    }
+
+    bool isValid() const {
+        return detector_ && descriptor_ && matcher_;
+    }
+
+    // Calcula y guarda los descriptores de una plantilla. Devuelve false si la
+    // plantilla no tiene descriptores.
+    bool addTemplate(const std::string& name, const cv::Mat& image) {
+        ObjectTemplate t;
+        t.name = name;
+        t.size = image.size();
+        describe(image, t.keypoints, t.descriptors);
+        if (t.descriptors.empty()) {
+            return false;
+        }
+        templates_.push_back(t);
+        indexDirty_ = true;
+        return true;
+    }
+
+    const std::vector<ObjectTemplate>& templates() const {
+        return templates_;
+    }
+
+    std::vector<ObjectDetection> detect(const cv::Mat& scene, const MultiObjectParams& params,
+                                   MultiObjectTimings* timings = nullptr) {
+        std::vector<ObjectDetection> detections;
+        if (templates_.empty()) {
+            return detections;
+        }
+        int64 t0 = cv::getTickCount();
+
+        // 1. Escena: se describe una sola vez para todos los objetos
+        std::vector<cv::KeyPoint> sceneKeypoints;
+        cv::Mat sceneDescriptors;
+        TraceZone describeZone("describe scene");
+        describe(scene, sceneKeypoints, sceneDescriptors);
+        describeZone.end();
+        int64 t1 = cv::getTickCount();
+        if (sceneDescriptors.empty()) {
+            return detections;
+        }
+
+        // 2. Una pasada sobre el índice combinado (escena -> todas las plantillas)
+        TraceZone matchZone("match");
+        buildIndex();
+        std::vector<std::vector<cv::DMatch>> knnMatches;
+        matcher_->knnMatch(sceneDescriptors, knnMatches, 2);
+
+        std::vector<std::vector<cv::DMatch>> matchesPerObject(templates_.size());
+        for (size_t i = 0; i < knnMatches.size(); i++) {
+            const std::vector<cv::DMatch>& knn = knnMatches[i];
+            if (knn.size() >= 2 && knn[0].distance < ratioThreshold_ * knn[1].distance &&
+                knn[0].imgIdx >= 0 && knn[0].imgIdx < (int)templates_.size()) {
+                matchesPerObject[knn[0].imgIdx].push_back(knn[0]);
+            }
+        }
+        int64 t2 = cv::getTickCount();
+        matchZone.end();
+
+        // 3. Estimación robusta por objeto, en paralelo
+        std::vector<std::vector<ObjectDetection>> perObject(templates_.size());
+        double minArea = params.minAreaRatio * scene.cols * scene.rows;
+        cv::parallel_for_(cv::Range(0, (int)templates_.size()), [&](const cv::Range& range) {
+            for (int k = range.start; k < range.end; k++) {
+                TraceZone zone("estimate", "template", k);
+                perObject[k] = estimateInstances(k, matchesPerObject[k], sceneKeypoints, params, minArea);
+            }
+        });
+        for (size_t k = 0; k < perObject.size(); k++) {
+            detections.insert(detections.end(), perObject[k].begin(), perObject[k].end());
+        }
+        int64 t3 = cv::getTickCount();
+
+        if (timings) {
+            double f = 1000.0 / cv::getTickFrequency();
+            timings->sceneFeaturesMs = (t1 - t0) * f;
+            timings->matchingMs = (t2 - t1) * f;
+            timings->estimationMs = (t3 - t2) * f;
+        }
+        return detections;
+    }
+
+private:
+    void describe(const cv::Mat& image, std::vector<cv::KeyPoint>& keypoints, cv::Mat& descriptors) const {
+        detector_->detect(image, keypoints);
+        descriptor_->compute(image, keypoints, descriptors);
+        if (convertToFloat_ && !descriptors.empty() && descriptors.type() != CV_32F) {
+            descriptors.convertTo(descriptors, CV_32F);
+        }
+    }
+
+    void buildIndex() {
+        if (!indexDirty_) {
+            return;
+        }
+        std::vector<cv::Mat> all;
+        for (const ObjectTemplate& t : templates_) {
+            all.push_back(t.descriptors);
+        }
+        matcher_->clear();
+        matcher_->add(all);
+        matcher_->train();
+        indexDirty_ = false;
+    }
+
+    // Busca instancias sucesivas de una plantilla: cada homografía aceptada
+    // retira sus inliers antes de volver a ejecutar RANSAC.
+    std::vector<ObjectDetection> estimateInstances(int templateIdx, std::vector<cv::DMatch> matches,
+                                              const std::vector<cv::KeyPoint>& sceneKeypoints,
+                                              const MultiObjectParams& params, double minArea) const {
+        std::vector<ObjectDetection> found;
+        const ObjectTemplate& t = templates_[templateIdx];
+        std::vector<cv::Point2f> templateCorners(4);
+        templateCorners[0] = cv::Point2f(0, 0);
+        templateCorners[1] = cv::Point2f((float)t.size.width, 0);
+        templateCorners[2] = cv::Point2f((float)t.size.width, (float)t.size.height);
+        templateCorners[3] = cv::Point2f(0, (float)t.size.height);
+
+        while ((int)found.size() < params.maxInstancesPerObject &&
+               (int)matches.size() >= std::max(params.minInliers, 4)) {
+            std::vector<cv::Point2f> obj, scene;
+            for (const cv::DMatch& m : matches) {
+                obj.push_back(t.keypoints[m.trainIdx].pt);
+                scene.push_back(sceneKeypoints[m.queryIdx].pt);
+            }
+
+            cv::Mat inlierMask;
+            cv::Mat homography = cv::findHomography(obj, scene, cv::RANSAC, params.ransacThreshold, inlierMask);
+            if (homography.empty()) {
+                break;
+            }
+            int inliers = cv::countNonZero(inlierMask);
+            if (inliers < params.minInliers) {
+                break;
+            }
+
+            ObjectDetection detection;
+            detection.templateIdx = templateIdx;
+            detection.instance = found.size();
+            detection.numInliers = inliers;
+            detection.homography = homography;
+            cv::perspectiveTransform(templateCorners, detection.corners, homography);
+
+            // Los inliers se retiran aunque la instancia se descarte por
+            // implausible, para que la siguiente iteración no la vuelva a encontrar
+            std::vector<cv::DMatch> remaining;
+            for (size_t i = 0; i < matches.size(); i++) {
+                if (!inlierMask.at<uchar>((int)i)) {
+                    remaining.push_back(matches[i]);
+                }
+            }
+            matches.swap(remaining);
+
+            if (isPlausibleQuad(detection.corners, minArea)) {
+                found.push_back(detection);
+            }
+        }
+        return found;
+    }
+
+    cv::Ptr<cv::Feature2D> detector_;
+    cv::Ptr<cv::Feature2D> descriptor_;
+    cv::Ptr<cv::DescriptorMatcher> matcher_;
+    bool isBinary_ = false;
+    bool convertToFloat_ = false;
+    float ratioThreshold_ = 0.75f;
+    bool indexDirty_ = true;
+    std::vector<ObjectTemplate> templates_;
+};
+
+#endif // MULTI_OBJECT_HPP
@@ -0,0 +1,179 @@
+#include <stdint.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+#include "opencv2/core.hpp"
+#include "opencv2/calib3d.hpp"
+#include "opencv2/highgui.hpp"
+#include "opencv2/imgproc.hpp"
+#include "opencv2/features2d.hpp"
+#include "opencv2/xfeatures2d.hpp"
+
+#include "multi_object.hpp"
+#include "image_source.hpp"
+
+using namespace cv;
+using namespace cv::xfeatures2d;
+using namespace std;
+
+// Uso:
+//   ./multi_object_detector [--combo DET DESC MATCHER] [--max-instances N] [--min-inliers N]
+//                           [--trace traza.json] [--show] escena objeto1.png [objeto2.png ...]
+// La escena es cualquier entrada de ImageSource (imagen, carpeta, "glob", video,
+// cam:N o raw:WxH:gray:archivo); con varias escenas las plantillas se describen una
+// vez y cada cuadro se analiza al llegar. El resultado de cada escena se guarda en
+// result_multi_object*.jpg; con --show además se muestra y se espera una tecla
+// (ESC termina), así que sin --show un lote corre sin atención.
+// Sin imágenes usa Data/box_in_scene.png con Data/box.png como única plantilla.
+int main(int argc, char* argv[]) {
+    string detectorName = "SIFT", descriptorName = "SIFT", matcherName = "BF";
+    MultiObjectParams params;
+    vector<string> positional;
+    string tracePath;
+    bool show = false;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--combo" && i + 3 < argc) {
+            detectorName = argv[++i];
+            descriptorName = argv[++i];
+            matcherName = argv[++i];
+        } else if (arg == "--max-instances" && i + 1 < argc) {
+            params.maxInstancesPerObject = atoi(argv[++i]);
+        } else if (arg == "--min-inliers" && i + 1 < argc) {
+            params.minInliers = atoi(argv[++i]);
+        } else if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (arg == "--show") {
+            show = true;
+        } else if (arg.compare(0, 2, "--") == 0) {
+            cerr << "Opción no reconocida: " << arg << endl;
+            return -1;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+
+    TraceSession traceSession(tracePath);
+
+    // Cargar imágenes (escena + plantillas)
+    string scenePath;
+    vector<string> objectPaths;
+    if (positional.size() >= 2) {
+        scenePath = positional[0];
+        objectPaths.assign(positional.begin() + 1, positional.end());
+    } else {
+        const char* prefixes[] = {"../Data/", "Data/"};
+        for (const char* prefix : prefixes) {
+            Mat probe = ImageSource::loadFirst(string(prefix) + "box_in_scene.png", IMREAD_GRAYSCALE);
+            if (!probe.empty()) {
+                scenePath = string(prefix) + "box_in_scene.png";
+                objectPaths.push_back(string(prefix) + "box.png");
+                break;
+            }
+        }
+    }
+
+    ImageSourceParams sourceParams;
+    sourceParams.imreadFlags = IMREAD_GRAYSCALE;
+    ImageSource scenes(sourceParams);
+    if (scenePath.empty() || !scenes.open(scenePath)) {
+        cerr << "No se pudo cargar la escena. Verifica las rutas. " << scenes.error() << endl;
+        return -1;
+    }
+
+    MultiObjectDetector detector(detectorName, descriptorName, matcherName);
+    if (!detector.isValid()) {
+        return -1;
+    }
+
+    cout << "Analizando con " << detectorName << " (detector) + " << descriptorName
+         << " (descriptor) + " << matcherName << " (matcher)" << endl;
+
+    TraceZone templatesZone("templates");
+    for (const string& path : objectPaths) {
+        Mat img_object = imread(path, IMREAD_GRAYSCALE);
+        if (img_object.empty()) {
+            cerr << "No se pudo cargar la plantilla: " << path << endl;
+            continue;
+        }
+        if (!detector.addTemplate(path, img_object)) {
+            cerr << "La plantilla no tiene descriptores: " << path << endl;
+        }
+    }
+
+    templatesZone.end();
+
+    if (detector.templates().empty()) {
+        cerr << "No hay plantillas válidas." << endl;
+        return -1;
+    }
+    cout << "Plantillas cargadas: " << detector.templates().size() << endl;
+
+    RNG rng(12345);
+    vector<Scalar> colors;
+    for (size_t i = 0; i < detector.templates().size(); i++) {
+        colors.push_back(Scalar(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256)));
+    }
+
+    if (show) {
+        namedWindow("Multi_Object", WINDOW_NORMAL);
+    }
+    bool singleScene = scenes.size() == 1;
+    ImageFrame frame;
+    while (scenes.read(frame)) {
+        const Mat& img_scene = frame.image;
+        if (!singleScene) {
+            cout << "Escena " << frame.index << ": " << frame.name << endl;
+        }
+
+        MultiObjectTimings timings;
+        vector<ObjectDetection> detections = detector.detect(img_scene, params, &timings);
+
+        cout << "Tiempo escena (detección + descripción): " << timings.sceneFeaturesMs << " ms" << endl;
+        cout << "Tiempo matching (índice combinado): " << timings.matchingMs << " ms" << endl;
+        cout << "Tiempo estimación (paralela por objeto): " << timings.estimationMs << " ms" << endl;
+        cout << "Instancias detectadas: " << detections.size() << endl;
+
+        // Visualización: un color por plantilla
+        Mat img_result;
+        cvtColor(img_scene, img_result, COLOR_GRAY2BGR);
+
+        for (const ObjectDetection& d : detections) {
+            const ObjectTemplate& t = detector.templates()[d.templateIdx];
+            cout << "  " << t.name << " #" << d.instance << ": " << d.numInliers << " inliers" << endl;
+
+            for (int i = 0; i < 4; i++) {
+                line(img_result, d.corners[i], d.corners[(i + 1) % 4], colors[d.templateIdx], 4);
+            }
+            putText(img_result, t.name + " #" + to_string(d.instance), d.corners[0],
+                    FONT_HERSHEY_SIMPLEX, 0.5, colors[d.templateIdx], 2);
+        }
+
+        imwrite(singleScene ? string("result_multi_object.jpg")
+                            : format("result_multi_object_%04d.jpg", (int)frame.index), img_result);
+        if (show) {
+            imshow("Multi_Object", img_result);
+            if (!singleScene && (waitKey(0) & 0xff) == 27) {
+                break;
+            }
+        }
+    }
+
+    traceSession.write();
+    ImageSourceStats ioStats = scenes.stats();
+    if (!singleScene) {
+        cout << "Escenas: " << ioStats.frames << ", decodificación " << ioStats.decodeMs
+             << " ms (en segundo plano), espera " << ioStats.waitMs << " ms" << endl;
+    }
+    if (show && singleScene) {
+        cout << "Análisis completo. Presiona cualquier tecla para salir." << endl;
+        waitKey(0);
+    } else {
+        cout << "Análisis completo." << endl;
+    }
+
+    return 0;
+}
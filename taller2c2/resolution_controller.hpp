@@ -0,0 +1,268 @@
+#ifndef RESOLUTION_CONTROLLER_HPP
+#define RESOLUTION_CONTROLLER_HPP
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+#include "opencv2/core.hpp"
+#include "opencv2/imgproc.hpp"
+#include "opencv2/features2d.hpp"
+
+// Controlador adaptativo de la resolución de trabajo.
+//
+// Alternativa (--adaptive en combination_tester) al reescalado fijo a
+// MAX_SIZE = 800, que es demasiado pequeño para escenas con detalle fino
+// (texto pequeño) y demasiado grande para escenas con poca textura. Para
+// cada imagen:
+//  1. Se ejecuta el detector sobre dos niveles gruesos (lado mayor
+//     coarseMaxSide y la mitad). El número de keypoints en cada nivel da la
+//     densidad y el exponente alpha de N(s) ~ s^alpha: las escenas con
+//     detalle fino siguen ganando keypoints al subir la resolución (alpha
+//     alto), las de poca textura se saturan (alpha bajo). El detector debe
+//     ser el de createUncappedDetector: con el tope de SIFT::create(500) el
+//     nivel grueso ya satura en el objetivo y la escala queda en la suya.
+//  2. La escala se elige para que N(s) llegue a targetKeypoints y, si hay
+//     presupuesto de latencia, para que el tiempo de detección extrapolado
+//     (proporcional a los píxeles) no lo supere.
+//  3. Para un par plantilla/escena se estima además la escala relativa del
+//     objeto en la escena con un matching ORB rápido a nivel grueso (cociente
+//     de KeyPoint::size de los pares). Si el objeto quedaría mucho más chico
+//     en la escena procesada que en la plantilla procesada, se sube la
+//     resolución de la escena (o se baja la de la plantilla) para que ambas
+//     queden dentro del rango de escalas del detector.
+// Cada decisión guarda la escala, qué restricción la limitó y el ahorro de
+// píxeles respecto de la política fija de 800.
+
+struct ResolutionParams {
+    int targetKeypoints = 500;      // Keypoints deseados por imagen
+    double latencyBudgetMs = 0;     // Tiempo de detección máximo por imagen (0 = sin límite)
+    int coarseMaxSide = 320;        // Lado mayor del nivel grueso
+    int minSide = 160;              // Nunca se baja de este lado mayor
+    int maxSide = 2000;             // Tope de memoria (el MAX_SIZE fijo es 800)
+    double minRelativeScale = 0.5;  // Escala objeto-en-escena / plantilla aceptable (y su inversa)
+    int legacyMaxSize = 800;        // Solo para reportar el ahorro frente a la política fija
+};
+
+struct ResolutionDecision {
+    double scale = 1.0;             // Escala aplicada a la imagen original
+    cv::Size size;                  // Tamaño resultante
+    int coarseKeypoints = 0;        // Keypoints en el nivel grueso
+    double alpha = 2.0;             // Exponente estimado de N(s)
+    double predictedKeypoints = 0;
+    double predictedLatencyMs = 0;  // Detección extrapolada a la escala elegida
+    double relativeScale = 0;       // Objeto en escena / plantilla a resolución original (0 = desconocida)
+    std::string limitedBy;
+    double savingsVsLegacy = 0;     // 1 - píxeles elegidos / píxeles con MAX_SIZE fijo
+    double controllerMs = 0;        // Costo del propio controlador
+};
+
+class ResolutionController {
+public:
+    ResolutionController(cv::Ptr<cv::Feature2D> detector, const ResolutionParams& params = ResolutionParams())
+        : detector_(detector), params_(params) {}
+
+    // Decide la escala de una imagen aislada
+    ResolutionDecision choose(const cv::Mat& image) {
+        int64 t0 = cv::getTickCount();
+        ResolutionDecision d;
+        int maxSideIn = std::max(image.cols, image.rows);
+        if (maxSideIn <= 0) {
+            return d;
+        }
+
+        // Niveles gruesos con el detector real
+        double c = std::min(1.0, (double)params_.coarseMaxSide / maxSideIn);
+        double coarseMs = 0;
+        int n1 = countAtScale(image, c, &coarseMs);
+        int n2 = countAtScale(image, c * 0.5, nullptr);
+        d.coarseKeypoints = n1;
+        if (n1 > 0 && n2 > 0 && n1 != n2) {
+            d.alpha = std::log((double)n1 / n2) / std::log(2.0);
+        }
+        d.alpha = std::min(3.0, std::max(0.5, d.alpha));
+
+        double minScale = std::min(1.0, (double)params_.minSide / maxSideIn);
+        double maxScale = std::min(1.0, (double)params_.maxSide / maxSideIn);
+
+        // Escala para llegar a los keypoints deseados
+        double sKeypoints = n1 > 0 ? c * std::pow((double)params_.targetKeypoints / n1, 1.0 / d.alpha) : maxScale;
+        double s = sKeypoints;
+        d.limitedBy = "keypoints";
+
+        // Escala máxima permitida por el presupuesto de latencia
+        if (params_.latencyBudgetMs > 0 && coarseMs > 0) {
+            double sLatency = c * std::sqrt(params_.latencyBudgetMs / coarseMs);
+            if (sLatency < s) {
+                s = sLatency;
+                d.limitedBy = "latencia";
+            }
+        }
+        if (s > maxScale) {
+            s = maxScale;
+            d.limitedBy = maxScale < 1.0 ? "tamaño máximo" : "resolución original";
+        }
+        if (s < minScale) {
+            s = minScale;
+            d.limitedBy = "tamaño mínimo";
+        }
+
+        d.predictedLatencyMs = coarseMs * (s / c) * (s / c);
+        finish(image.size(), s, n1, c, d);
+        d.controllerMs = (cv::getTickCount() - t0) * 1000.0 / cv::getTickFrequency();
+        return d;
+    }
+
+    // Decide las escalas de una plantilla y una escena, corrigiendo la escala
+    // relativa del objeto si se conoce
+    void choosePair(const cv::Mat& object, const cv::Mat& scene,
+                    ResolutionDecision& objectDecision, ResolutionDecision& sceneDecision) {
+        objectDecision = choose(object);
+        sceneDecision = choose(scene);
+
+        int64 t0 = cv::getTickCount();
+        double r = estimateRelativeScale(object, scene);
+        double pairMs = (cv::getTickCount() - t0) * 1000.0 / cv::getTickFrequency();
+        objectDecision.controllerMs += pairMs * 0.5;
+        sceneDecision.controllerMs += pairMs * 0.5;
+        objectDecision.relativeScale = r;
+        sceneDecision.relativeScale = r;
+        if (r <= 0) {
+            return;
+        }
+
+        double so = objectDecision.scale, ss = sceneDecision.scale;
+        double maxScene = std::min(1.0, (double)params_.maxSide / std::max(scene.cols, scene.rows));
+        double maxObject = std::min(1.0, (double)params_.maxSide / std::max(object.cols, object.rows));
+        double minObject = std::min(1.0, (double)params_.minSide / std::max(object.cols, object.rows));
+        double minScene = std::min(1.0, (double)params_.minSide / std::max(scene.cols, scene.rows));
+        double lo = params_.minRelativeScale, hi = 1.0 / params_.minRelativeScale;
+
+        // Tamaño del objeto en la escena procesada respecto de la plantilla procesada
+        double ratio = r * ss / so;
+        if (ratio < lo) {
+            // El objeto quedaría demasiado chico: más resolución en la escena,
+            // y si no alcanza, menos en la plantilla
+            double wanted = lo * so / r;
+            if (wanted <= maxScene) {
+                ss = wanted;
+                sceneDecision.limitedBy = "escala del objeto";
+            } else {
+                ss = maxScene;
+                so = std::max(minObject, r * ss / lo);
+                sceneDecision.limitedBy = "escala del objeto";
+                objectDecision.limitedBy = "escala del objeto";
+            }
+        } else if (ratio > hi) {
+            // El objeto aparece mucho más grande en la escena: se baja la escena
+            // o se sube la plantilla
+            double wanted = hi * so / r;
+            if (wanted >= minScene) {
+                ss = wanted;
+                sceneDecision.limitedBy = "escala del objeto";
+            } else {
+                ss = minScene;
+                so = std::min(maxObject, r * ss / hi);
+                sceneDecision.limitedBy = "escala del objeto";
+                objectDecision.limitedBy = "escala del objeto";
+            }
+        }
+        rescale(object.size(), so, objectDecision);
+        rescale(scene.size(), ss, sceneDecision);
+    }
+
+    // Aplica la decisión (INTER_AREA al reducir, lineal al ampliar)
+    static void apply(const cv::Mat& src, cv::Mat& dst, const ResolutionDecision& d) {
+        if (d.size == src.size() || d.size.area() == 0) {
+            dst = src;
+            return;
+        }
+        cv::resize(src, dst, d.size, 0, 0, d.scale < 1.0 ? cv::INTER_AREA : cv::INTER_LINEAR);
+    }
+
+private:
+    int countAtScale(const cv::Mat& image, double scale, double* ms) {
+        cv::Mat level;
+        if (scale < 1.0) {
+            cv::resize(image, level, cv::Size(), scale, scale, cv::INTER_AREA);
+        } else {
+            level = image;
+        }
+        std::vector<cv::KeyPoint> keypoints;
+        int64 t0 = cv::getTickCount();
+        detector_->detect(level, keypoints);
+        if (ms) {
+            *ms = (cv::getTickCount() - t0) * 1000.0 / cv::getTickFrequency();
+        }
+        return (int)keypoints.size();
+    }
+
+    void finish(cv::Size original, double s, int coarseCount, double coarseScale, ResolutionDecision& d) const {
+        d.predictedKeypoints = coarseCount * std::pow(s / coarseScale, d.alpha);
+        d.scale = s;
+        rescale(original, s, d);
+    }
+
+    // Fija la escala final; las predicciones se corrigen si cambió respecto de la anterior
+    void rescale(cv::Size original, double s, ResolutionDecision& d) const {
+        double previous = d.scale;
+        d.scale = s;
+        d.size = cv::Size(std::max(1, (int)std::lround(original.width * s)),
+                          std::max(1, (int)std::lround(original.height * s)));
+        if (previous > 0 && previous != s) {
+            double k = s / previous;
+            d.predictedLatencyMs *= k * k;
+            d.predictedKeypoints *= std::pow(k, d.alpha);
+        }
+        int maxSideIn = std::max(original.width, original.height);
+        double legacy = maxSideIn > params_.legacyMaxSize ? (double)params_.legacyMaxSize / maxSideIn : 1.0;
+        double legacyPixels = original.width * legacy * original.height * legacy;
+        d.savingsVsLegacy = legacyPixels > 0 ? 1.0 - (double)d.size.area() / legacyPixels : 0;
+    }
+
+    // Escala relativa del objeto en la escena (mediana de size_escena/size_plantilla
+    // en los matches ORB a nivel grueso); 0 si no hay matches suficientes
+    double estimateRelativeScale(const cv::Mat& object, const cv::Mat& scene) const {
+        const int MIN_MATCHES = 8;
+        double co = std::min(1.0, 2.0 * params_.coarseMaxSide / std::max(object.cols, object.rows));
+        double cs = std::min(1.0, 2.0 * params_.coarseMaxSide / std::max(scene.cols, scene.rows));
+        cv::Mat o, s;
+        cv::resize(object, o, cv::Size(), co, co, cv::INTER_AREA);
+        cv::resize(scene, s, cv::Size(), cs, cs, cv::INTER_AREA);
+
+        cv::Ptr<cv::ORB> orb = cv::ORB::create(500);
+        std::vector<cv::KeyPoint> ko, ks;
+        cv::Mat dob, ds;
+        orb->detectAndCompute(o, cv::noArray(), ko, dob);
+        orb->detectAndCompute(s, cv::noArray(), ks, ds);
+        if (dob.rows < MIN_MATCHES || ds.rows < 2) {
+            return 0;
+        }
+
+        cv::BFMatcher matcher(cv::NORM_HAMMING);
+        std::vector<std::vector<cv::DMatch>> knn;
+        matcher.knnMatch(dob, ds, knn, 2);
+        std::vector<double> ratios;
+        for (size_t i = 0; i < knn.size(); i++) {
+            if (knn[i].size() >= 2 && knn[i][0].distance < 0.8f * knn[i][1].distance) {
+                const cv::KeyPoint& a = ko[knn[i][0].queryIdx];
+                const cv::KeyPoint& b = ks[knn[i][0].trainIdx];
+                if (a.size > 0) {
+                    ratios.push_back((b.size / cs) / (a.size / co));
+                }
+            }
+        }
+        if ((int)ratios.size() < MIN_MATCHES) {
+            return 0;
+        }
+        std::nth_element(ratios.begin(), ratios.begin() + ratios.size() / 2, ratios.end());
+        return ratios[ratios.size() / 2];
+    }
+
+    cv::Ptr<cv::Feature2D> detector_;
+    ResolutionParams params_;
+};
+
+#endif // RESOLUTION_CONTROLLER_HPP
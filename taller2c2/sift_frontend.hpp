@@ -0,0 +1,534 @@
+#ifndef SIFT_FRONTEND_HPP
+#define SIFT_FRONTEND_HPP
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+#include <cstring>
+#include <stdint.h>
+
+#include "opencv2/core.hpp"
+#include "opencv2/imgproc.hpp"
+#include "opencv2/features2d.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIFT_FRONTEND_USE_SSE2 1
+#endif
+
+// Front-end SIFT con pirámide DoG en punto fijo.
+//
+// SIFT::create(500) gasta la mayor parte del tiempo construyendo el espacio de
+// escalas gaussiano en float. Esta versión:
+//  - guarda los niveles como int16 (píxel * 64) y aplica filtros gaussianos
+//    separables en punto fijo (8 píxeles por instrucción con SSE2);
+//  - obtiene la base de cada octava directamente de la imagen (INTER_AREA), de
+//    modo que las octavas no dependen entre sí y se procesan en paralelo junto
+//    con franjas de filas;
+//  - reutiliza los buffers de cada octava entre llamadas.
+// La detección de extremos, el refinamiento subpíxel, el filtro de bordes y la
+// orientación siguen el algoritmo de OpenCV. No se duplica la imagen de
+// entrada (primera octava 0), así que los keypoints de escala más fina se
+// pierden a cambio de un costo 4 veces menor. Los descriptores se calculan con
+// cv::SIFT sobre estos keypoints; como el campo octave está empaquetado igual
+// que en OpenCV, SIFT::compute tampoco construye la octava duplicada.
+
+struct SiftFrontendParams {
+    int maxFeatures = 500;
+    int octaveLayers = 3;
+    double contrastThreshold = 0.04;
+    double edgeThreshold = 10;
+    double sigma = 1.6;
+    int minOctaveSize = 16;     // No se crean octavas con lado menor que esto
+    int stripeRows = 64;        // Filas por tarea en los filtros
+};
+
+class FixedPointSIFT : public cv::Feature2D {
+public:
+    enum {
+        FIXPT_SHIFT = 6,            // Nivel = píxel * 64 (cabe en int16 hasta 255)
+        IMG_BORDER = 5,
+        MAX_INTERP_STEPS = 5,
+        ORI_HIST_BINS = 36
+    };
+
+    explicit FixedPointSIFT(const SiftFrontendParams& params = SiftFrontendParams())
+        : params_(params) {
+        descriptorExtractor_ = cv::SIFT::create(params.maxFeatures, params.octaveLayers,
+                                                params.contrastThreshold, params.edgeThreshold,
+                                                params.sigma);
+    }
+
+    static cv::Ptr<FixedPointSIFT> create(const SiftFrontendParams& params = SiftFrontendParams()) {
+        return cv::makePtr<FixedPointSIFT>(params);
+    }
+
+    void detectAndCompute(cv::InputArray image, cv::InputArray mask,
+                          std::vector<cv::KeyPoint>& keypoints,
+                          cv::OutputArray descriptors,
+                          bool useProvidedKeypoints = false) override {
+        cv::Mat img = image.getMat();
+        if (!useProvidedKeypoints) {
+            cv::Mat gray;
+            if (img.channels() == 1) {
+                gray = img;
+            } else {
+                cv::cvtColor(img, gray, cv::COLOR_BGR2GRAY);
+            }
+            CV_Assert(gray.depth() == CV_8U);
+            detectKeypoints(gray, keypoints);
+
+            cv::Mat m = mask.getMat();
+            if (!m.empty()) {
+                keypoints.erase(std::remove_if(keypoints.begin(), keypoints.end(),
+                    [&m](const cv::KeyPoint& k) {
+                        return m.at<uchar>(cvRound(k.pt.y), cvRound(k.pt.x)) == 0;
+                    }), keypoints.end());
+            }
+        }
+        if (descriptors.needed()) {
+            descriptorExtractor_->compute(img, keypoints, descriptors);
+        }
+    }
+
+    int descriptorSize() const override { return 128; }
+    int descriptorType() const override { return CV_32F; }
+    int defaultNorm() const override { return cv::NORM_L2; }
+    cv::String getDefaultName() const override { return "FixedPointSIFT"; }
+
+private:
+    struct Octave {
+        std::vector<cv::Mat> gauss;   // octaveLayers + 3 niveles CV_16S
+        std::vector<cv::Mat> dog;     // octaveLayers + 2 niveles CV_16S
+        cv::Mat base8u;
+    };
+
+    // Kernel gaussiano en punto fijo: pesos * 65536 con suma exacta 65536
+    struct FixedKernel {
+        std::vector<short> weights;
+        int radius = 0;
+    };
+
+    static FixedKernel makeKernel(double sigma) {
+        FixedKernel k;
+        k.radius = std::max(1, cvRound(sigma * 4));
+        int n = 2 * k.radius + 1;
+        std::vector<double> w(n);
+        double sum = 0;
+        for (int i = 0; i < n; i++) {
+            double x = i - k.radius;
+            w[i] = std::exp(-x * x / (2 * sigma * sigma));
+            sum += w[i];
+        }
+        k.weights.resize(n);
+        int total = 0;
+        for (int i = 0; i < n; i++) {
+            k.weights[i] = (short)cvRound(w[i] / sum * 65536.0);
+            total += k.weights[i];
+        }
+        // El centro absorbe el error de redondeo; con sigma >= 0.8 sigue < 0.5
+        int center = k.weights[k.radius] + (65536 - total);
+        CV_Assert(center > 0 && center < 32768);
+        k.weights[k.radius] = (short)center;
+        return k;
+    }
+
+    static inline int reflect101(int p, int len) {
+        if (len == 1) return 0;
+        while (p < 0 || p >= len) {
+            p = p < 0 ? -p : 2 * len - p - 2;
+        }
+        return p;
+    }
+
+    // Suma ponderada de taps int16 con mulhi (producto >> 16). El sesgo por
+    // truncamiento (medio LSB por tap) se compensa al final.
+    static void convolveRow(const short* const* rows, int tapStride, const FixedKernel& k,
+                            short* dst, int width) {
+        const int n = (int)k.weights.size();
+        const short bias = (short)(n / 2);
+        int x = 0;
+#ifdef SIFT_FRONTEND_USE_SSE2
+        const __m128i vbias = _mm_set1_epi16(bias);
+        for (; x <= width - 8; x += 8) {
+            __m128i acc = vbias;
+            for (int t = 0; t < n; t++) {
+                const short* src = tapStride ? rows[0] + t : rows[t];
+                __m128i v = _mm_loadu_si128((const __m128i*)(src + x));
+                acc = _mm_add_epi16(acc, _mm_mulhi_epi16(v, _mm_set1_epi16(k.weights[t])));
+            }
+            _mm_storeu_si128((__m128i*)(dst + x), acc);
+        }
+#endif
+        for (; x < width; x++) {
+            int acc = bias;
+            for (int t = 0; t < n; t++) {
+                const short* src = tapStride ? rows[0] + t : rows[t];
+                acc += ((int)src[x] * k.weights[t]) >> 16;
+            }
+            dst[x] = (short)acc;
+        }
+    }
+
+    // Filtro gaussiano separable sobre las filas [y0, y1) de dst
+    static void gaussianStripe(const cv::Mat& src, cv::Mat& dst, const FixedKernel& k, int y0, int y1) {
+        const int r = k.radius;
+        const int cols = src.cols;
+        std::vector<short> padded(cols + 2 * r);
+        int hrows = (y1 - y0) + 2 * r;
+        std::vector<short> horizontal((size_t)hrows * cols);
+
+        // Pasada horizontal de las filas y0-r .. y1+r (con reflexión en bordes)
+        for (int i = 0; i < hrows; i++) {
+            const short* srow = src.ptr<short>(reflect101(y0 - r + i, src.rows));
+            std::memcpy(&padded[r], srow, cols * sizeof(short));
+            for (int j = 1; j <= r; j++) {
+                padded[r - j] = srow[reflect101(-j, cols)];
+                padded[r + cols - 1 + j] = srow[reflect101(cols - 1 + j, cols)];
+            }
+            const short* base = padded.data();
+            convolveRow(&base, 1, k, &horizontal[(size_t)i * cols], cols);
+        }
+
+        // Pasada vertical
+        std::vector<const short*> taps(2 * r + 1);
+        for (int y = y0; y < y1; y++) {
+            for (int t = 0; t <= 2 * r; t++) {
+                taps[t] = &horizontal[(size_t)(y - y0 + t) * cols];
+            }
+            convolveRow(taps.data(), 0, k, dst.ptr<short>(y), cols);
+        }
+    }
+
+    void buildPyramid(const cv::Mat& gray) {
+        const int layers = params_.octaveLayers;
+        int numOctaves = 0;
+        for (int side = std::min(gray.cols, gray.rows); side >= params_.minOctaveSize; side /= 2) {
+            numOctaves++;
+        }
+        numOctaves = std::max(numOctaves, 1);
+        octaves_.resize(numOctaves);
+
+        // Sigmas incrementales entre niveles; la base se supone con sigma 0.5
+        std::vector<FixedKernel> kernels(layers + 3);
+        double k = std::pow(2.0, 1.0 / layers);
+        kernels[0] = makeKernel(std::sqrt(std::max(params_.sigma * params_.sigma - 0.25, 0.01)));
+        for (int i = 1; i < layers + 3; i++) {
+            double prev = std::pow(k, i - 1) * params_.sigma;
+            double total = prev * k;
+            kernels[i] = makeKernel(std::sqrt(total * total - prev * prev));
+        }
+
+        // Bases de cada octava directamente desde la imagen: octavas independientes
+        cv::parallel_for_(cv::Range(0, numOctaves), [&](const cv::Range& range) {
+            for (int o = range.start; o < range.end; o++) {
+                Octave& oct = octaves_[o];
+                cv::Size size(gray.cols >> o, gray.rows >> o);
+                if (o == 0) {
+                    oct.base8u = gray;
+                } else {
+                    cv::resize(gray, oct.base8u, size, 0, 0, cv::INTER_AREA);
+                }
+                oct.gauss.resize(layers + 3);
+                oct.dog.resize(layers + 2);
+                for (int i = 0; i < layers + 3; i++) oct.gauss[i].create(size, CV_16S);
+                for (int i = 0; i < layers + 2; i++) oct.dog[i].create(size, CV_16S);
+                // Nivel "-1": la imagen en punto fijo, guardada temporalmente en dog[0]
+                oct.base8u.convertTo(oct.dog[0], CV_16S, 1 << FIXPT_SHIFT);
+            }
+        });
+
+        // Cada nivel depende del anterior de su octava, pero todas las octavas y
+        // franjas de un mismo nivel se calculan a la vez
+        struct Task { int octave, y0, y1; };
+        std::vector<Task> tasks;
+        for (int o = 0; o < numOctaves; o++) {
+            int rows = octaves_[o].gauss[0].rows;
+            for (int y = 0; y < rows; y += params_.stripeRows) {
+                Task t = {o, y, std::min(rows, y + params_.stripeRows)};
+                tasks.push_back(t);
+            }
+        }
+        for (int level = 0; level < layers + 3; level++) {
+            cv::parallel_for_(cv::Range(0, (int)tasks.size()), [&](const cv::Range& range) {
+                for (int i = range.start; i < range.end; i++) {
+                    const Task& t = tasks[i];
+                    Octave& oct = octaves_[t.octave];
+                    const cv::Mat& src = level == 0 ? oct.dog[0] : oct.gauss[level - 1];
+                    gaussianStripe(src, oct.gauss[level], kernels[level], t.y0, t.y1);
+                }
+            });
+        }
+
+        // Diferencias de gaussianas
+        cv::parallel_for_(cv::Range(0, (int)tasks.size()), [&](const cv::Range& range) {
+            for (int i = range.start; i < range.end; i++) {
+                const Task& t = tasks[i];
+                Octave& oct = octaves_[t.octave];
+                for (int l = 0; l < layers + 2; l++) {
+                    for (int y = t.y0; y < t.y1; y++) {
+                        const short* a = oct.gauss[l].ptr<short>(y);
+                        const short* b = oct.gauss[l + 1].ptr<short>(y);
+                        short* d = oct.dog[l].ptr<short>(y);
+                        int x = 0;
+#ifdef SIFT_FRONTEND_USE_SSE2
+                        for (; x <= oct.dog[l].cols - 8; x += 8) {
+                            __m128i va = _mm_loadu_si128((const __m128i*)(a + x));
+                            __m128i vb = _mm_loadu_si128((const __m128i*)(b + x));
+                            _mm_storeu_si128((__m128i*)(d + x), _mm_sub_epi16(vb, va));
+                        }
+#endif
+                        for (; x < oct.dog[l].cols; x++) {
+                            d[x] = (short)(b[x] - a[x]);
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+    // Refinamiento subpíxel + filtro de contraste y de bordes (adjustLocalExtrema)
+    bool adjustLocalExtrema(const Octave& oct, int octave, int& layer, int& r, int& c,
+                            cv::KeyPoint& kpt) const {
+        const float imgScale = 1.f / (255 << FIXPT_SHIFT);
+        const float derivScale = imgScale * 0.5f;
+        const float secondDerivScale = imgScale;
+        const float crossDerivScale = imgScale * 0.25f;
+        const int layers = params_.octaveLayers;
+
+        float xi = 0, xr = 0, xc = 0, contr = 0;
+        int i = 0;
+        for (; i < MAX_INTERP_STEPS; i++) {
+            const cv::Mat& img = oct.dog[layer];
+            const cv::Mat& prev = oct.dog[layer - 1];
+            const cv::Mat& next = oct.dog[layer + 1];
+
+            float dD[3] = {
+                (img.at<short>(r, c + 1) - img.at<short>(r, c - 1)) * derivScale,
+                (img.at<short>(r + 1, c) - img.at<short>(r - 1, c)) * derivScale,
+                (next.at<short>(r, c) - prev.at<short>(r, c)) * derivScale
+            };
+            float v2 = (float)img.at<short>(r, c) * 2;
+            float dxx = (img.at<short>(r, c + 1) + img.at<short>(r, c - 1) - v2) * secondDerivScale;
+            float dyy = (img.at<short>(r + 1, c) + img.at<short>(r - 1, c) - v2) * secondDerivScale;
+            float dss = (next.at<short>(r, c) + prev.at<short>(r, c) - v2) * secondDerivScale;
+            float dxy = (img.at<short>(r + 1, c + 1) - img.at<short>(r + 1, c - 1) -
+                         img.at<short>(r - 1, c + 1) + img.at<short>(r - 1, c - 1)) * crossDerivScale;
+            float dxs = (next.at<short>(r, c + 1) - next.at<short>(r, c - 1) -
+                         prev.at<short>(r, c + 1) + prev.at<short>(r, c - 1)) * crossDerivScale;
+            float dys = (next.at<short>(r + 1, c) - next.at<short>(r - 1, c) -
+                         prev.at<short>(r + 1, c) + prev.at<short>(r - 1, c)) * crossDerivScale;
+
+            float H[3][3] = {{dxx, dxy, dxs}, {dxy, dyy, dys}, {dxs, dys, dss}};
+            float X[3];
+            if (!solve3x3(H, dD, X)) {
+                return false;
+            }
+            xc = -X[0];
+            xr = -X[1];
+            xi = -X[2];
+
+            if (std::abs(xi) < 0.5f && std::abs(xr) < 0.5f && std::abs(xc) < 0.5f) {
+                contr = img.at<short>(r, c) * imgScale + (dD[0] * xc + dD[1] * xr + dD[2] * xi) * 0.5f;
+                break;
+            }
+            if (std::abs(xi) > (float)(INT32_MAX / 3) || std::abs(xr) > (float)(INT32_MAX / 3) ||
+                std::abs(xc) > (float)(INT32_MAX / 3)) {
+                return false;
+            }
+            c += cvRound(xc);
+            r += cvRound(xr);
+            layer += cvRound(xi);
+            if (layer < 1 || layer > layers || c < IMG_BORDER || c >= img.cols - IMG_BORDER ||
+                r < IMG_BORDER || r >= img.rows - IMG_BORDER) {
+                return false;
+            }
+        }
+        if (i >= MAX_INTERP_STEPS) {
+            return false;
+        }
+        if (std::abs(contr) * layers < params_.contrastThreshold) {
+            return false;
+        }
+
+        // Respuesta de borde: razón de curvaturas principales del hessiano 2D
+        const cv::Mat& img = oct.dog[layer];
+        float v2 = (float)img.at<short>(r, c) * 2;
+        float dxx = (img.at<short>(r, c + 1) + img.at<short>(r, c - 1) - v2) * secondDerivScale;
+        float dyy = (img.at<short>(r + 1, c) + img.at<short>(r - 1, c) - v2) * secondDerivScale;
+        float dxy = (img.at<short>(r + 1, c + 1) - img.at<short>(r + 1, c - 1) -
+                     img.at<short>(r - 1, c + 1) + img.at<short>(r - 1, c - 1)) * crossDerivScale;
+        float tr = dxx + dyy;
+        float det = dxx * dyy - dxy * dxy;
+        double edge = params_.edgeThreshold;
+        if (det <= 0 || tr * tr * edge >= (edge + 1) * (edge + 1) * det) {
+            return false;
+        }
+
+        kpt.pt.x = (c + xc) * (1 << octave);
+        kpt.pt.y = (r + xr) * (1 << octave);
+        kpt.octave = octave + (layer << 8) + (cvRound((xi + 0.5) * 255) << 16);
+        kpt.size = (float)(params_.sigma * std::pow(2.0, (layer + xi) / layers) * (1 << octave) * 2);
+        kpt.response = std::abs(contr);
+        return true;
+    }
+
+    static bool solve3x3(const float H[3][3], const float b[3], float x[3]) {
+        float det = H[0][0] * (H[1][1] * H[2][2] - H[1][2] * H[2][1])
+                  - H[0][1] * (H[1][0] * H[2][2] - H[1][2] * H[2][0])
+                  + H[0][2] * (H[1][0] * H[2][1] - H[1][1] * H[2][0]);
+        if (std::abs(det) < 1e-12f) {
+            return false;
+        }
+        float inv = 1.f / det;
+        for (int col = 0; col < 3; col++) {
+            float M[3][3];
+            for (int i = 0; i < 3; i++) {
+                for (int j = 0; j < 3; j++) {
+                    M[i][j] = j == col ? b[i] : H[i][j];
+                }
+            }
+            x[col] = (M[0][0] * (M[1][1] * M[2][2] - M[1][2] * M[2][1])
+                    - M[0][1] * (M[1][0] * M[2][2] - M[1][2] * M[2][0])
+                    + M[0][2] * (M[1][0] * M[2][1] - M[1][1] * M[2][0])) * inv;
+        }
+        return true;
+    }
+
+    // Histograma de orientaciones (36 bins) sobre el nivel gaussiano del keypoint;
+    // genera una copia del keypoint por cada pico >= 80% del máximo
+    void assignOrientations(const Octave& oct, int octave, int layer, const cv::KeyPoint& kpt,
+                            std::vector<cv::KeyPoint>& out) const {
+        const cv::Mat& img = oct.gauss[layer];
+        float scaleOctave = kpt.size * 0.5f / (1 << octave);
+        int radius = cvRound(3 * 1.5f * scaleOctave);
+        float sigma = 1.5f * scaleOctave;
+        float expScale = -1.f / (2.f * sigma * sigma);
+        int px = cvRound(kpt.pt.x / (1 << octave));
+        int py = cvRound(kpt.pt.y / (1 << octave));
+
+        float hist[ORI_HIST_BINS] = {0};
+        for (int dy = -radius; dy <= radius; dy++) {
+            int y = py + dy;
+            if (y <= 0 || y >= img.rows - 1) continue;
+            const short* row = img.ptr<short>(y);
+            const short* up = img.ptr<short>(y - 1);
+            const short* down = img.ptr<short>(y + 1);
+            for (int dx = -radius; dx <= radius; dx++) {
+                int x = px + dx;
+                if (x <= 0 || x >= img.cols - 1) continue;
+                float gx = (float)(row[x + 1] - row[x - 1]);
+                float gy = (float)(up[x] - down[x]);
+                float weight = std::exp((dx * dx + dy * dy) * expScale);
+                float magnitude = std::sqrt(gx * gx + gy * gy);
+                float angle = (float)(std::atan2(gy, gx) * 180.0 / CV_PI);
+                if (angle < 0) angle += 360.f;
+                int bin = cvRound(angle * ORI_HIST_BINS / 360.f);
+                if (bin >= ORI_HIST_BINS) bin -= ORI_HIST_BINS;
+                hist[bin] += weight * magnitude;
+            }
+        }
+
+        // Suavizado circular [1 4 6 4 1] / 16
+        float smooth[ORI_HIST_BINS];
+        for (int i = 0; i < ORI_HIST_BINS; i++) {
+            int n = ORI_HIST_BINS;
+            smooth[i] = (hist[(i + n - 2) % n] + hist[(i + 2) % n]) * (1.f / 16) +
+                        (hist[(i + n - 1) % n] + hist[(i + 1) % n]) * (4.f / 16) +
+                        hist[i] * (6.f / 16);
+        }
+        float maxValue = *std::max_element(smooth, smooth + ORI_HIST_BINS);
+        float threshold = maxValue * 0.8f;
+
+        for (int j = 0; j < ORI_HIST_BINS; j++) {
+            int l = j > 0 ? j - 1 : ORI_HIST_BINS - 1;
+            int r2 = j < ORI_HIST_BINS - 1 ? j + 1 : 0;
+            if (smooth[j] > smooth[l] && smooth[j] > smooth[r2] && smooth[j] >= threshold) {
+                float bin = j + 0.5f * (smooth[l] - smooth[r2]) / (smooth[l] - 2 * smooth[j] + smooth[r2]);
+                bin = bin < 0 ? ORI_HIST_BINS + bin : bin >= ORI_HIST_BINS ? bin - ORI_HIST_BINS : bin;
+                cv::KeyPoint oriented = kpt;
+                oriented.angle = 360.f - (360.f / ORI_HIST_BINS) * bin;
+                if (std::abs(oriented.angle - 360.f) < FLT_EPSILON) {
+                    oriented.angle = 0.f;
+                }
+                out.push_back(oriented);
+            }
+        }
+    }
+
+    void detectKeypoints(const cv::Mat& gray, std::vector<cv::KeyPoint>& keypoints) {
+        keypoints.clear();
+        buildPyramid(gray);
+
+        const int layers = params_.octaveLayers;
+        const int threshold = cvFloor(0.5 * params_.contrastThreshold / layers * (255 << FIXPT_SHIFT));
+
+        struct Task { int octave, layer, y0, y1; };
+        std::vector<Task> tasks;
+        for (int o = 0; o < (int)octaves_.size(); o++) {
+            int rows = octaves_[o].dog[0].rows;
+            for (int l = 1; l <= layers; l++) {
+                for (int y = IMG_BORDER; y < rows - IMG_BORDER; y += params_.stripeRows) {
+                    Task t = {o, l, y, std::min(rows - IMG_BORDER, y + params_.stripeRows)};
+                    tasks.push_back(t);
+                }
+            }
+        }
+
+        std::vector<std::vector<cv::KeyPoint>> found(tasks.size());
+        cv::parallel_for_(cv::Range(0, (int)tasks.size()), [&](const cv::Range& range) {
+            for (int ti = range.start; ti < range.end; ti++) {
+                const Task& t = tasks[ti];
+                const Octave& oct = octaves_[t.octave];
+                const cv::Mat& prev = oct.dog[t.layer - 1];
+                const cv::Mat& curr = oct.dog[t.layer];
+                const cv::Mat& next = oct.dog[t.layer + 1];
+                for (int r = t.y0; r < t.y1; r++) {
+                    const short* rows[3][3] = {
+                        {prev.ptr<short>(r - 1), prev.ptr<short>(r), prev.ptr<short>(r + 1)},
+                        {curr.ptr<short>(r - 1), curr.ptr<short>(r), curr.ptr<short>(r + 1)},
+                        {next.ptr<short>(r - 1), next.ptr<short>(r), next.ptr<short>(r + 1)}
+                    };
+                    for (int c = IMG_BORDER; c < curr.cols - IMG_BORDER; c++) {
+                        int v = rows[1][1][c];
+                        if (std::abs(v) <= threshold) continue;
+                        bool isMax = v > 0, isMin = v < 0;
+                        for (int s = 0; s < 3 && (isMax || isMin); s++) {
+                            for (int dy = 0; dy < 3; dy++) {
+                                const short* p = rows[s][dy];
+                                for (int dx = -1; dx <= 1; dx++) {
+                                    if (s == 1 && dy == 1 && dx == 0) continue;
+                                    int n = p[c + dx];
+                                    isMax = isMax && v >= n;
+                                    isMin = isMin && v <= n;
+                                }
+                            }
+                        }
+                        if (!isMax && !isMin) continue;
+
+                        int layer = t.layer, rr = r, cc = c;
+                        cv::KeyPoint kpt;
+                        if (adjustLocalExtrema(oct, t.octave, layer, rr, cc, kpt)) {
+                            assignOrientations(oct, t.octave, layer, kpt, found[ti]);
+                        }
+                    }
+                }
+            }
+        });
+
+        for (const std::vector<cv::KeyPoint>& f : found) {
+            keypoints.insert(keypoints.end(), f.begin(), f.end());
+        }
+        cv::KeyPointsFilter::removeDuplicated(keypoints);
+        if (params_.maxFeatures > 0) {
+            cv::KeyPointsFilter::retainBest(keypoints, params_.maxFeatures);
+        }
+    }
+
+    SiftFrontendParams params_;
+    cv::Ptr<cv::SIFT> descriptorExtractor_;
+    std::vector<Octave> octaves_;   // Buffers reutilizados entre llamadas
+};
+
+#endif // SIFT_FRONTEND_HPP
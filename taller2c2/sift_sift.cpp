@@ -11,11 +11,16 @@
 #include "opencv2/features2d.hpp"
 #include "opencv2/xfeatures2d.hpp"
 
+#include "sift_frontend.hpp"
+
 using namespace cv;
 using namespace cv::xfeatures2d;
 using namespace std;
 
-int main() {
+int main(int argc, char* argv[]) {
+    // --fixed-point detecta con la pirámide DoG en punto fijo (sift_frontend.hpp)
+    bool useFixedPoint = argc > 1 && string(argv[1]) == "--fixed-point";
+    
     // Cargar imágenes
     string objectImagePath = "../Data/box.png";
     string sceneImagePath = "../Data/box_in_scene.png";
@@ -48,7 +53,8 @@ int main() {
     }
     
     cout << "Imágenes cargadas correctamente." << endl;
-    cout << "Analizando con SIFT (detector) + SIFT (descriptor) + BF (matcher)" << endl;
+    cout << "Analizando con SIFT (detector) + SIFT (descriptor) + BF (matcher)"
+         << (useFixedPoint ? " [pirámide en punto fijo]" : "") << endl;
     
     // Redimensionar imágenes si son muy grandes (para evitar problemas de memoria)
     const int MAX_SIZE = 800;
@@ -67,7 +73,14 @@ int main() {
     
     // Crear detector y descriptor SIFT con límite de características
     const int MAX_FEATURES = 500;
-    Ptr<SIFT> sift = SIFT::create(MAX_FEATURES);
+    Ptr<Feature2D> sift;
+    if (useFixedPoint) {
+        SiftFrontendParams params;
+        params.maxFeatures = MAX_FEATURES;
+        sift = FixedPointSIFT::create(params);
+    } else {
+        sift = SIFT::create(MAX_FEATURES);
+    }
     
     // Detectar keypoints
     vector<KeyPoint> keypoints_object, keypoints_scene;
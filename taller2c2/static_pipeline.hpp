@@ -0,0 +1,530 @@
+#ifndef STATIC_PIPELINE_HPP
+#define STATIC_PIPELINE_HPP
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+
+#include "opencv2/core.hpp"
+#include "opencv2/calib3d.hpp"
+#include "opencv2/features2d.hpp"
+#include "opencv2/xfeatures2d.hpp"
+
+#include "feature_factory.hpp"
+#include "sift_frontend.hpp"
+#include "trace.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define STATIC_PIPELINE_USE_SSE2 1
+#endif
+
+// Pipelines de matching especializados en tiempo de compilación.
+//
+// El camino dinámico (processCombination) decide por strings qué detector,
+// descriptor y matcher usar, y cada distancia pasa por llamadas virtuales de
+// DescriptorMatcher. Aquí detector, descriptor y matcher son parámetros de
+// plantilla con traits: el tamaño del descriptor, la métrica y el umbral del
+// test de ratio son constexpr, de modo que el kernel de distancia tiene tamaño
+// fijo y queda completamente inlineado en el bucle de fuerza bruta. Un
+// registro en tiempo de ejecución asocia los nombres de siempre ("SIFT",
+// "ORB", "BF", ...) con las combinaciones ya instanciadas.
+
+// ---------------------------------------------------------------------------
+// Métricas de distancia de tamaño fijo
+
+inline int descriptorPopcount64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// Distancia de Hamming sobre BYTES bytes (múltiplo de 8)
+template <int BYTES>
+struct HammingMetric {
+    static_assert(BYTES % 8 == 0, "HammingMetric requiere un múltiplo de 8 bytes");
+    typedef uchar Element;
+    typedef int Accumulator;
+    static constexpr int kBytes = BYTES;
+    static constexpr int kLength = BYTES;
+    static constexpr int kCvType = CV_8U;
+    static constexpr bool kBinary = true;
+
+    static inline int distance(const uchar* a, const uchar* b) {
+        int d = 0;
+        for (int k = 0; k < BYTES; k += 8) {
+            uint64_t x, y;
+            memcpy(&x, a + k, 8);
+            memcpy(&y, b + k, 8);
+            d += descriptorPopcount64(x ^ y);
+        }
+        return d;
+    }
+
+    // Valor reportado en DMatch::distance (igual que NORM_HAMMING)
+    static inline float finish(int d) { return (float)d; }
+};
+
+// Distancia euclídea sobre N floats (múltiplo de 4). Se acumula el cuadrado y
+// la raíz se toma solo para los dos mejores vecinos.
+template <int N>
+struct L2Metric {
+    static_assert(N % 4 == 0, "L2Metric requiere un múltiplo de 4 elementos");
+    typedef float Element;
+    typedef float Accumulator;
+    static constexpr int kBytes = N * 4;
+    static constexpr int kLength = N;
+    static constexpr int kCvType = CV_32F;
+    static constexpr bool kBinary = false;
+
+    static inline float distance(const float* a, const float* b) {
+#ifdef STATIC_PIPELINE_USE_SSE2
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+        int k = 0;
+        for (; k + 8 <= N; k += 8) {
+            __m128 d0 = _mm_sub_ps(_mm_loadu_ps(a + k), _mm_loadu_ps(b + k));
+            __m128 d1 = _mm_sub_ps(_mm_loadu_ps(a + k + 4), _mm_loadu_ps(b + k + 4));
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(d0, d0));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(d1, d1));
+        }
+        for (; k < N; k += 4) {
+            __m128 d0 = _mm_sub_ps(_mm_loadu_ps(a + k), _mm_loadu_ps(b + k));
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(d0, d0));
+        }
+        float lanes[4];
+        _mm_storeu_ps(lanes, _mm_add_ps(acc0, acc1));
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#else
+        float acc[4] = {0, 0, 0, 0};
+        for (int k = 0; k < N; k += 4) {
+            for (int j = 0; j < 4; j++) {
+                float d = a[k + j] - b[k + j];
+                acc[j] += d * d;
+            }
+        }
+        return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+#endif
+    }
+
+    static inline float finish(float d) { return std::sqrt(d); }
+};
+
+// ---------------------------------------------------------------------------
+// Traits de detectores (mismos parámetros que feature_factory.hpp)
+
+struct SiftDetectorTraits {
+    static const char* name() { return "SIFT"; }
+    static cv::Ptr<cv::Feature2D> create() { return cv::SIFT::create(500); }
+};
+
+struct SiftFpDetectorTraits {
+    static const char* name() { return "SIFTFP"; }
+    static cv::Ptr<cv::Feature2D> create() { return FixedPointSIFT::create(); }
+};
+
+struct SurfDetectorTraits {
+    static const char* name() { return "SURF"; }
+    static cv::Ptr<cv::Feature2D> create() { return cv::xfeatures2d::SURF::create(100, 3, 3, false); }
+};
+
+struct OrbDetectorTraits {
+    static const char* name() { return "ORB"; }
+    static cv::Ptr<cv::Feature2D> create() { return cv::ORB::create(700); }
+};
+
+struct FastDetectorTraits {
+    static const char* name() { return "FAST"; }
+    static cv::Ptr<cv::Feature2D> create() { return cv::FastFeatureDetector::create(20); }
+};
+
+struct BriskDetectorTraits {
+    static const char* name() { return "BRISK"; }
+    static cv::Ptr<cv::Feature2D> create() { return cv::BRISK::create(30, 3, 1.0f); }
+};
+
+// ---------------------------------------------------------------------------
+// Traits de descriptores: métrica de tamaño fijo y umbral del test de ratio
+
+struct SiftDescriptorTraits {
+    typedef L2Metric<128> Metric;
+    static constexpr float kRatio = 0.75f;
+    static const char* name() { return "SIFT"; }
+    static cv::Ptr<cv::Feature2D> create() { return cv::SIFT::create(500); }
+};
+
+struct SurfDescriptorTraits {
+    typedef L2Metric<64> Metric;     // extended = false
+    static constexpr float kRatio = 0.75f;
+    static const char* name() { return "SURF"; }
+    static cv::Ptr<cv::Feature2D> create() { return cv::xfeatures2d::SURF::create(100, 3, 3, false); }
+};
+
+struct OrbDescriptorTraits {
+    typedef HammingMetric<32> Metric;
+    static constexpr float kRatio = 0.8f;
+    static const char* name() { return "ORB"; }
+    static cv::Ptr<cv::Feature2D> create() { return cv::ORB::create(700); }
+};
+
+struct BriefDescriptorTraits {
+    typedef HammingMetric<32> Metric;
+    static constexpr float kRatio = 0.8f;
+    static const char* name() { return "BRIEF"; }
+    static cv::Ptr<cv::Feature2D> create() { return cv::xfeatures2d::BriefDescriptorExtractor::create(32); }
+};
+
+struct FreakDescriptorTraits {
+    typedef HammingMetric<64> Metric;
+    static constexpr float kRatio = 0.8f;
+    static const char* name() { return "FREAK"; }
+    static cv::Ptr<cv::Feature2D> create() { return cv::xfeatures2d::FREAK::create(); }
+};
+
+struct BriskDescriptorTraits {
+    typedef HammingMetric<64> Metric;
+    static constexpr float kRatio = 0.8f;
+    static const char* name() { return "BRISK"; }
+    static cv::Ptr<cv::Feature2D> create() { return cv::BRISK::create(30, 3, 1.0f); }
+};
+
+// ---------------------------------------------------------------------------
+// Traits de matchers. knnMatch2 devuelve, para cada descriptor de consulta, el
+// mejor vecino y la distancia al segundo (FLT_MAX si no hay segundo).
+
+struct BruteForceMatcherTraits {
+    static const char* name() { return "BF"; }
+
+    template <class Metric>
+    static void knnMatch2(const cv::Mat& query, const cv::Mat& train,
+                          std::vector<cv::DMatch>& best, std::vector<float>& second) {
+        typedef typename Metric::Element Element;
+        typedef typename Metric::Accumulator Accumulator;
+        best.assign(query.rows, cv::DMatch());
+        second.assign(query.rows, FLT_MAX);
+        if (train.rows == 0) {
+            return;
+        }
+        cv::parallel_for_(cv::Range(0, query.rows), [&](const cv::Range& range) {
+            for (int i = range.start; i < range.end; i++) {
+                const Element* q = query.ptr<Element>(i);
+                Accumulator d0 = 0, d1 = 0;
+                int j0 = -1;
+                bool haveSecond = false;
+                for (int j = 0; j < train.rows; j++) {
+                    Accumulator d = Metric::distance(q, train.ptr<Element>(j));
+                    if (j0 < 0 || d < d0) {
+                        if (j0 >= 0) {
+                            d1 = d0;
+                            haveSecond = true;
+                        }
+                        d0 = d;
+                        j0 = j;
+                    } else if (!haveSecond || d < d1) {
+                        d1 = d;
+                        haveSecond = true;
+                    }
+                }
+                best[i] = cv::DMatch(i, j0, Metric::finish(d0));
+                second[i] = haveSecond ? Metric::finish(d1) : FLT_MAX;
+            }
+        });
+    }
+};
+
+// FLANN es aproximado y su índice no se especializa; se mantiene el matcher
+// de OpenCV para que los resultados coincidan con el camino dinámico.
+struct FlannMatcherTraits {
+    static const char* name() { return "FLANN"; }
+
+    template <class Metric>
+    static void knnMatch2(const cv::Mat& query, const cv::Mat& train,
+                          std::vector<cv::DMatch>& best, std::vector<float>& second) {
+        best.assign(query.rows, cv::DMatch());
+        second.assign(query.rows, FLT_MAX);
+        cv::Ptr<cv::DescriptorMatcher> matcher = createMatcher("FLANN", Metric::kBinary);
+        std::vector<std::vector<cv::DMatch>> knn;
+        matcher->knnMatch(query, train, knn, 2);
+        for (size_t i = 0; i < knn.size(); i++) {
+            if (!knn[i].empty()) best[i] = knn[i][0];
+            if (knn[i].size() >= 2) second[i] = knn[i][1].distance;
+        }
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Pipeline común (estático o dinámico)
+
+struct PipelineTimings {
+    double detectMs = 0;
+    double describeMs = 0;
+    double matchMs = 0;
+    double verifyMs = 0;
+
+    double totalMs() const { return detectMs + describeMs + matchMs + verifyMs; }
+};
+
+struct PipelineResult {
+    int numKeypoints1 = 0;
+    int numKeypoints2 = 0;
+    int numMatches = 0;
+    int numGoodMatches = 0;
+    int numInliers = 0;
+    bool homographySuccess = false;
+    cv::Mat homography;
+    std::vector<cv::KeyPoint> keypoints1, keypoints2;
+    cv::Mat descriptors1, descriptors2;   // Para la segunda pasada guiada del llamador
+    std::vector<cv::DMatch> goodMatches;
+    PipelineTimings timings;
+};
+
+class MatchPipeline {
+public:
+    virtual ~MatchPipeline() {}
+    virtual PipelineResult run(const cv::Mat& img1, const cv::Mat& img2) = 0;
+    virtual std::string name() const = 0;
+};
+
+const int PIPELINE_MAX_KEYPOINTS = 500;   // Igual que processCombination
+
+inline double pipelineElapsedMs(int64 t0) {
+    return (cv::getTickCount() - t0) * 1000.0 / cv::getTickFrequency();
+}
+
+// Homografía RANSAC sobre los buenos matches (común a ambos caminos)
+inline void verifyHomography(PipelineResult& result) {
+    if (result.goodMatches.size() < 4) {
+        return;
+    }
+    std::vector<cv::Point2f> obj, scene;
+    for (const cv::DMatch& m : result.goodMatches) {
+        obj.push_back(result.keypoints1[m.queryIdx].pt);
+        scene.push_back(result.keypoints2[m.trainIdx].pt);
+    }
+    cv::Mat inlierMask;
+    result.homography = cv::findHomography(obj, scene, cv::RANSAC, 3.0, inlierMask);
+    result.homographySuccess = !result.homography.empty();
+    if (result.homographySuccess) {
+        result.numInliers = cv::countNonZero(inlierMask);
+    }
+}
+
+template <class DetectorT, class DescriptorT, class MatcherT>
+class StaticPipeline : public MatchPipeline {
+public:
+    typedef typename DescriptorT::Metric Metric;
+    static constexpr float kRatio = DescriptorT::kRatio;
+
+    StaticPipeline()
+        : detector_(DetectorT::create()), descriptor_(DescriptorT::create()) {}
+
+    std::string name() const override {
+        return std::string(DetectorT::name()) + "_" + DescriptorT::name() + "_" + MatcherT::name();
+    }
+
+    PipelineResult run(const cv::Mat& img1, const cv::Mat& img2) override {
+        PipelineResult result;
+
+        int64 t0 = cv::getTickCount();
+        TraceZone detectZone("detect");
+        detector_->detect(img1, result.keypoints1);
+        detector_->detect(img2, result.keypoints2);
+        if (result.keypoints1.size() > (size_t)PIPELINE_MAX_KEYPOINTS) result.keypoints1.resize(PIPELINE_MAX_KEYPOINTS);
+        if (result.keypoints2.size() > (size_t)PIPELINE_MAX_KEYPOINTS) result.keypoints2.resize(PIPELINE_MAX_KEYPOINTS);
+        result.timings.detectMs = pipelineElapsedMs(t0);
+        detectZone.end();
+
+        t0 = cv::getTickCount();
+        TraceZone describeZone("describe");
+        cv::Mat& descriptors1 = result.descriptors1;
+        cv::Mat& descriptors2 = result.descriptors2;
+        descriptor_->compute(img1, result.keypoints1, descriptors1);
+        descriptor_->compute(img2, result.keypoints2, descriptors2);
+        result.numKeypoints1 = result.keypoints1.size();
+        result.numKeypoints2 = result.keypoints2.size();
+        result.timings.describeMs = pipelineElapsedMs(t0);
+        describeZone.end();
+        if (descriptors1.empty() || descriptors2.empty()) {
+            return result;
+        }
+        // El kernel asume el formato fijado por los traits
+        CV_Assert(descriptors1.type() == Metric::kCvType && descriptors1.cols == Metric::kLength);
+        CV_Assert(descriptors2.type() == Metric::kCvType && descriptors2.cols == Metric::kLength);
+
+        t0 = cv::getTickCount();
+        TraceZone matchZone("match");
+        std::vector<cv::DMatch> best;
+        std::vector<float> second;
+        MatcherT::template knnMatch2<Metric>(descriptors1, descriptors2, best, second);
+        result.numMatches = best.size();
+        for (size_t i = 0; i < best.size(); i++) {
+            if (second[i] != FLT_MAX && best[i].distance < kRatio * second[i]) {
+                result.goodMatches.push_back(best[i]);
+            }
+        }
+        result.numGoodMatches = result.goodMatches.size();
+        result.timings.matchMs = pipelineElapsedMs(t0);
+        matchZone.end();
+
+        t0 = cv::getTickCount();
+        TraceZone verifyZone("verify");
+        verifyHomography(result);
+        result.timings.verifyMs = pipelineElapsedMs(t0);
+        return result;
+    }
+
+private:
+    cv::Ptr<cv::Feature2D> detector_;
+    cv::Ptr<cv::Feature2D> descriptor_;
+};
+
+// Camino dinámico equivalente (fábricas por nombre + DescriptorMatcher), usado
+// como referencia en el benchmark y para combinaciones no registradas
+class DynamicPipeline : public MatchPipeline {
+public:
+    DynamicPipeline(const std::string& detectorName, const std::string& descriptorName,
+                    const std::string& matcherName)
+        : detectorName_(detectorName), descriptorName_(descriptorName), matcherName_(matcherName) {
+        detector_ = createDetector(detectorName);
+        descriptor_ = createDescriptor(descriptorName);
+        isBinary_ = isBinaryDescriptorName(descriptorName);
+        matcher_ = createMatcher(matcherName, isBinary_);
+        CV_Assert(detector_ && descriptor_ && matcher_);
+    }
+
+    std::string name() const override {
+        return detectorName_ + "_" + descriptorName_ + "_" + matcherName_;
+    }
+
+    PipelineResult run(const cv::Mat& img1, const cv::Mat& img2) override {
+        PipelineResult result;
+
+        int64 t0 = cv::getTickCount();
+        TraceZone detectZone("detect");
+        detector_->detect(img1, result.keypoints1);
+        detector_->detect(img2, result.keypoints2);
+        if (result.keypoints1.size() > (size_t)PIPELINE_MAX_KEYPOINTS) result.keypoints1.resize(PIPELINE_MAX_KEYPOINTS);
+        if (result.keypoints2.size() > (size_t)PIPELINE_MAX_KEYPOINTS) result.keypoints2.resize(PIPELINE_MAX_KEYPOINTS);
+        result.timings.detectMs = pipelineElapsedMs(t0);
+        detectZone.end();
+
+        t0 = cv::getTickCount();
+        TraceZone describeZone("describe");
+        cv::Mat& descriptors1 = result.descriptors1;
+        cv::Mat& descriptors2 = result.descriptors2;
+        descriptor_->compute(img1, result.keypoints1, descriptors1);
+        descriptor_->compute(img2, result.keypoints2, descriptors2);
+        result.numKeypoints1 = result.keypoints1.size();
+        result.numKeypoints2 = result.keypoints2.size();
+        result.timings.describeMs = pipelineElapsedMs(t0);
+        describeZone.end();
+        if (descriptors1.empty() || descriptors2.empty()) {
+            return result;
+        }
+
+        t0 = cv::getTickCount();
+        TraceZone matchZone("match");
+        if (matcherName_ == "FLANN" && !isBinary_) {
+            if (descriptors1.type() != CV_32F) descriptors1.convertTo(descriptors1, CV_32F);
+            if (descriptors2.type() != CV_32F) descriptors2.convertTo(descriptors2, CV_32F);
+        }
+        std::vector<std::vector<cv::DMatch>> knn;
+        matcher_->knnMatch(descriptors1, descriptors2, knn, 2);
+        result.numMatches = knn.size();
+        const float ratio = isBinary_ ? 0.8f : 0.75f;
+        for (size_t i = 0; i < knn.size(); i++) {
+            if (knn[i].size() >= 2 && knn[i][0].distance < ratio * knn[i][1].distance) {
+                result.goodMatches.push_back(knn[i][0]);
+            }
+        }
+        result.numGoodMatches = result.goodMatches.size();
+        result.timings.matchMs = pipelineElapsedMs(t0);
+        matchZone.end();
+
+        t0 = cv::getTickCount();
+        TraceZone verifyZone("verify");
+        verifyHomography(result);
+        result.timings.verifyMs = pipelineElapsedMs(t0);
+        return result;
+    }
+
+private:
+    std::string detectorName_, descriptorName_, matcherName_;
+    cv::Ptr<cv::Feature2D> detector_;
+    cv::Ptr<cv::Feature2D> descriptor_;
+    cv::Ptr<cv::DescriptorMatcher> matcher_;
+    bool isBinary_ = false;
+};
+
+// ---------------------------------------------------------------------------
+// Registro nombre -> combinación instanciada
+
+typedef cv::Ptr<MatchPipeline> (*PipelineFactory)();
+
+struct PipelineEntry {
+    std::string detector;
+    std::string descriptor;
+    std::string matcher;
+    PipelineFactory create;
+};
+
+template <class DetectorT, class DescriptorT, class MatcherT>
+cv::Ptr<MatchPipeline> makeStaticPipeline() {
+    return cv::makePtr<StaticPipeline<DetectorT, DescriptorT, MatcherT>>();
+}
+
+template <class DetectorT, class DescriptorT>
+void registerMatchers(std::vector<PipelineEntry>& registry) {
+    registry.push_back({DetectorT::name(), DescriptorT::name(), BruteForceMatcherTraits::name(),
+                        &makeStaticPipeline<DetectorT, DescriptorT, BruteForceMatcherTraits>});
+    // FLANN con descriptores binarios se omite, igual que en combination_tester
+    if (!DescriptorT::Metric::kBinary) {
+        registry.push_back({DetectorT::name(), DescriptorT::name(), FlannMatcherTraits::name(),
+                            &makeStaticPipeline<DetectorT, DescriptorT, FlannMatcherTraits>});
+    }
+}
+
+template <class DetectorT>
+void registerDescriptors(std::vector<PipelineEntry>& registry) {
+    registerMatchers<DetectorT, SiftDescriptorTraits>(registry);
+    registerMatchers<DetectorT, SurfDescriptorTraits>(registry);
+    registerMatchers<DetectorT, OrbDescriptorTraits>(registry);
+    registerMatchers<DetectorT, BriefDescriptorTraits>(registry);
+    registerMatchers<DetectorT, FreakDescriptorTraits>(registry);
+    registerMatchers<DetectorT, BriskDescriptorTraits>(registry);
+}
+
+inline const std::vector<PipelineEntry>& staticPipelineRegistry() {
+    static const std::vector<PipelineEntry> registry = [] {
+        std::vector<PipelineEntry> r;
+        registerDescriptors<SiftDetectorTraits>(r);
+        registerDescriptors<SiftFpDetectorTraits>(r);
+        registerDescriptors<SurfDetectorTraits>(r);
+        registerDescriptors<OrbDetectorTraits>(r);
+        registerDescriptors<FastDetectorTraits>(r);
+        registerDescriptors<BriskDetectorTraits>(r);
+        return r;
+    }();
+    return registry;
+}
+
+// Devuelve el pipeline estático registrado o un puntero vacío
+inline cv::Ptr<MatchPipeline> createStaticPipeline(const std::string& detectorName,
+                                                   const std::string& descriptorName,
+                                                   const std::string& matcherName) {
+    for (const PipelineEntry& e : staticPipelineRegistry()) {
+        if (e.detector == detectorName && e.descriptor == descriptorName && e.matcher == matcherName) {
+            return e.create();
+        }
+    }
+    return cv::Ptr<MatchPipeline>();
+}
+
+#endif // STATIC_PIPELINE_HPP
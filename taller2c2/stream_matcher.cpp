@@ -0,0 +1,430 @@
+#include <stdint.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <cstdlib>
+
+#include "opencv2/core.hpp"
+#include "opencv2/calib3d.hpp"
+#include "opencv2/highgui.hpp"
+#include "opencv2/imgproc.hpp"
+#include "opencv2/features2d.hpp"
+#include "opencv2/xfeatures2d.hpp"
+
+#include "feature_factory.hpp"
+#include "frame_pipeline.hpp"
+#include "trace.hpp"
+#include "image_source.hpp"
+
+using namespace cv;
+using namespace std;
+
+// Busca un objeto en un flujo de imágenes con el pipeline por etapas
+// (frame_pipeline.hpp): decodificación -> detección/descripción -> matching ->
+// RANSAC -> sink. Primero procesa el flujo en serie (una etapa tras otra por
+// cuadro) y después con el pipeline, e imprime el throughput de ambos y las
+// estadísticas de cada etapa.
+//
+// Uso:
+//   ./stream_matcher [--combo DET DESC MATCHER] [--threads D,F,M,V] [--queue N]
+//                    [--repeat N] [--no-serial] [--trace traza.json] objeto.png escenas [escenas ...]
+// Las escenas pueden ser archivos, carpetas, globs entre comillas, un video o un
+// flujo crudo (image_source.hpp).
+// Con --trace cada etapa de cada cuadro queda como zona en el hilo que la
+// ejecutó (chrome://tracing o ui.perfetto.dev).
+// Sin imágenes usa Data/box.png y repite Data/box_in_scene.png.
+
+struct StreamFrame {
+    uint64_t index = 0;     // Orden de entrada
+    string path;
+    Mat image;              // Vacía hasta la etapa de decodificación (salvo video/flujo crudo)
+    vector<KeyPoint> keypoints;
+    Mat descriptors;
+    vector<DMatch> goodMatches;
+    Mat homography;
+    int numInliers = 0;
+    chrono::steady_clock::time_point created;
+};
+
+struct ObjectModel {
+    vector<KeyPoint> keypoints;
+    Mat descriptors;
+};
+
+const int MAX_SIZE = 800;
+const int MAX_KEYPOINTS = 500;
+
+void limitImageSize(Mat& img) {
+    if (img.cols > MAX_SIZE || img.rows > MAX_SIZE) {
+        double scale = min(double(MAX_SIZE)/img.cols, double(MAX_SIZE)/img.rows);
+        resize(img, img, Size(), scale, scale, INTER_AREA);
+    }
+}
+
+// Entrega las escenas en orden, repitiendo la secuencia `repeat` veces. Las
+// listas de archivos solo aportan la ruta: la etapa de decodificación del
+// pipeline las lee en paralelo. Los videos y flujos crudos se leen con
+// ImageSource, que los decodifica en segundo plano.
+class SceneFeed {
+public:
+    SceneFeed(const vector<string>& specs, int repeat) : specs_(specs), repeat_(max(repeat, 1)) {
+        for (const string& spec : specs) {
+            if (spec.compare(0, 4, "raw:") == 0 || spec.compare(0, 4, "cam:") == 0 || ImageSource::isVideoPath(spec)) {
+                streamed_ = true;
+            }
+        }
+        if (!streamed_) {
+            for (const string& spec : specs) {
+                vector<string> files = ImageSource::expand(spec);
+                paths_.insert(paths_.end(), files.begin(), files.end());
+            }
+        }
+    }
+
+    bool ok() {
+        if (streamed_) {
+            return openStream();
+        }
+        return !paths_.empty();
+    }
+
+    // Cuadros totales si se conocen de antemano (listas de archivos)
+    int64_t knownTotal() const {
+        return streamed_ ? -1 : (int64_t)(paths_.size() * repeat_);
+    }
+
+    bool next(StreamFrame& f) {
+        f.index = delivered_;
+        if (!streamed_) {
+            if (delivered_ >= paths_.size() * repeat_) {
+                return false;
+            }
+            f.path = paths_[delivered_ % paths_.size()];
+            delivered_++;
+            return true;
+        }
+        ImageFrame frame;
+        while (!source_.read(frame)) {
+            // Fin de una pasada: se reabre el video para la repetición siguiente
+            if (++round_ >= repeat_ || !openStream()) {
+                return false;
+            }
+        }
+        f.path = frame.name;
+        f.image = frame.image;
+        delivered_++;
+        return true;
+    }
+
+private:
+    bool openStream() {
+        if (!source_.open(specs_)) {
+            cerr << source_.error() << endl;
+            return false;
+        }
+        return true;
+    }
+
+    vector<string> specs_;
+    int repeat_;
+    bool streamed_ = false;
+    vector<string> paths_;
+    ImageSource source_{grayscaleParams()};
+    int round_ = 0;
+    size_t delivered_ = 0;
+
+    static ImageSourceParams grayscaleParams() {
+        ImageSourceParams params;
+        params.imreadFlags = IMREAD_GRAYSCALE;
+        return params;
+    }
+};
+
+// Fábricas de las etapas: cada hilo crea sus propios objetos de OpenCV
+FramePipeline<StreamFrame>::StageFactory decodeStage() {
+    return []() {
+        return [](StreamFrame& f) {
+            if (f.image.empty()) {
+                f.image = imread(f.path, IMREAD_GRAYSCALE);
+            }
+            if (!f.image.empty()) {
+                limitImageSize(f.image);
+            }
+        };
+    };
+}
+
+FramePipeline<StreamFrame>::StageFactory featureStage(const string& detectorName, const string& descriptorName,
+                                                      bool convertToFloat) {
+    return [=]() {
+        Ptr<Feature2D> detector = createDetector(detectorName);
+        Ptr<Feature2D> descriptor = createDescriptor(descriptorName);
+        return [=](StreamFrame& f) {
+            if (f.image.empty()) {
+                return;
+            }
+            detector->detect(f.image, f.keypoints);
+            if (f.keypoints.size() > (size_t)MAX_KEYPOINTS) {
+                f.keypoints.resize(MAX_KEYPOINTS);
+            }
+            descriptor->compute(f.image, f.keypoints, f.descriptors);
+            if (convertToFloat && !f.descriptors.empty() && f.descriptors.type() != CV_32F) {
+                f.descriptors.convertTo(f.descriptors, CV_32F);
+            }
+        };
+    };
+}
+
+FramePipeline<StreamFrame>::StageFactory matchStage(const ObjectModel& object, const string& matcherName,
+                                                    bool isBinary) {
+    const ObjectModel* model = &object;
+    return [=]() {
+        Ptr<DescriptorMatcher> matcher = createMatcher(matcherName, isBinary);
+        const float RATIO_THRESHOLD = isBinary ? 0.8f : 0.75f;
+        return [=](StreamFrame& f) {
+            if (f.descriptors.empty() || model->descriptors.empty()) {
+                return;
+            }
+            vector<vector<DMatch>> knnMatches;
+            matcher->knnMatch(model->descriptors, f.descriptors, knnMatches, 2);
+            for (size_t i = 0; i < knnMatches.size(); i++) {
+                if (knnMatches[i].size() >= 2 &&
+                    knnMatches[i][0].distance < RATIO_THRESHOLD * knnMatches[i][1].distance) {
+                    f.goodMatches.push_back(knnMatches[i][0]);
+                }
+            }
+        };
+    };
+}
+
+FramePipeline<StreamFrame>::StageFactory verifyStage(const ObjectModel& object) {
+    const ObjectModel* model = &object;
+    return [=]() {
+        return [=](StreamFrame& f) {
+            if (f.goodMatches.size() < 4) {
+                return;
+            }
+            vector<Point2f> obj, scene;
+            for (const DMatch& m : f.goodMatches) {
+                obj.push_back(model->keypoints[m.queryIdx].pt);
+                scene.push_back(f.keypoints[m.trainIdx].pt);
+            }
+            Mat inlierMask;
+            f.homography = findHomography(obj, scene, RANSAC, 3.0, inlierMask);
+            if (!f.homography.empty()) {
+                f.numInliers = countNonZero(inlierMask);
+            }
+        };
+    };
+}
+
+vector<int> parseThreadCounts(const string& spec) {
+    vector<int> counts;
+    stringstream ss(spec);
+    string item;
+    while (getline(ss, item, ',')) {
+        counts.push_back(max(1, atoi(item.c_str())));
+    }
+    while (counts.size() < 4) {
+        counts.push_back(1);
+    }
+    return counts;
+}
+
+int main(int argc, char* argv[]) {
+    string detectorName = "ORB", descriptorName = "ORB", matcherName = "BF";
+    vector<int> threads = parseThreadCounts("2,2,1,1");
+    int queueCapacity = 8;
+    int repeat = 0;
+    bool runSerial = true;
+    string tracePath;
+    vector<string> positional;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--combo" && i + 3 < argc) {
+            detectorName = argv[++i];
+            descriptorName = argv[++i];
+            matcherName = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = parseThreadCounts(argv[++i]);
+        } else if (arg == "--queue" && i + 1 < argc) {
+            queueCapacity = max(2, atoi(argv[++i]));
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = max(1, atoi(argv[++i]));
+        } else if (arg == "--no-serial") {
+            runSerial = false;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (arg.compare(0, 2, "--") == 0) {
+            cerr << "Opción no reconocida: " << arg << endl;
+            return -1;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+
+    string objectPath;
+    vector<string> scenePaths;   // Especificaciones de ImageSource
+    if (positional.size() >= 2) {
+        objectPath = positional[0];
+        scenePaths.assign(positional.begin() + 1, positional.end());
+    } else {
+        const char* prefixes[] = {"../Data/", "Data/"};
+        for (const char* prefix : prefixes) {
+            if (!imread(string(prefix) + "box.png", IMREAD_GRAYSCALE).empty()) {
+                objectPath = string(prefix) + "box.png";
+                scenePaths.push_back(string(prefix) + "box_in_scene.png");
+                break;
+            }
+        }
+        if (repeat == 0) {
+            repeat = 50;
+        }
+    }
+    repeat = max(repeat, 1);
+
+    TraceSession traceSession(tracePath);
+    Mat img_object = objectPath.empty() ? Mat() : ImageSource::loadFirst(objectPath, IMREAD_GRAYSCALE);
+    if (img_object.empty() || scenePaths.empty() || !SceneFeed(scenePaths, 1).ok()) {
+        cerr << "No se pudieron cargar las imágenes. Verifica las rutas." << endl;
+        return -1;
+    }
+    limitImageSize(img_object);
+
+    bool isBinary = isBinaryDescriptorName(descriptorName);
+    bool convertToFloat = matcherName == "FLANN" && !isBinary;
+
+    // El objeto se describe una sola vez
+    ObjectModel object;
+    {
+        Ptr<Feature2D> detector = createDetector(detectorName);
+        Ptr<Feature2D> descriptor = createDescriptor(descriptorName);
+        if (!detector || !descriptor || !createMatcher(matcherName, isBinary)) {
+            return -1;
+        }
+        detector->detect(img_object, object.keypoints);
+        if (object.keypoints.size() > (size_t)MAX_KEYPOINTS) {
+            object.keypoints.resize(MAX_KEYPOINTS);
+        }
+        descriptor->compute(img_object, object.keypoints, object.descriptors);
+        if (convertToFloat && !object.descriptors.empty() && object.descriptors.type() != CV_32F) {
+            object.descriptors.convertTo(object.descriptors, CV_32F);
+        }
+    }
+
+    SceneFeed probe(scenePaths, repeat);
+    cout << "Analizando con " << detectorName << " (detector) + " << descriptorName
+         << " (descriptor) + " << matcherName << " (matcher)";
+    if (probe.knownTotal() >= 0) {
+        cout << ", " << probe.knownTotal() << " cuadros";
+    }
+    cout << endl;
+
+    vector<FramePipeline<StreamFrame>::StageFactory> factories;
+    factories.push_back(decodeStage());
+    factories.push_back(featureStage(detectorName, descriptorName, convertToFloat));
+    factories.push_back(matchStage(object, matcherName, isBinary));
+    factories.push_back(verifyStage(object));
+    const char* stageNames[] = {"decodificación", "detección", "matching", "RANSAC"};
+
+    // Referencia en serie: las cuatro etapas una tras otra por cuadro
+    double serialMs = 0;
+    if (runSerial) {
+        vector<FramePipeline<StreamFrame>::StageFn> fns;
+        for (size_t s = 0; s < factories.size(); s++) {
+            fns.push_back(factories[s]());
+        }
+        SceneFeed feed(scenePaths, repeat);
+        feed.ok();
+        size_t serialFrames = 0;
+        int64 t0 = getTickCount();
+        while (true) {
+            StreamFrame f;
+            if (!feed.next(f)) {
+                break;
+            }
+            TraceZone frameZone("serial frame", "frame", (int64_t)f.index);
+            for (size_t s = 0; s < fns.size(); s++) {
+                TraceZone stageZone(stageNames[s]);
+                fns[s](f);
+            }
+            serialFrames++;
+        }
+        serialMs = (getTickCount() - t0) * 1000.0 / getTickFrequency();
+        cout << "Serie: " << serialMs << " ms, " << fixed << setprecision(2)
+             << serialFrames * 1000.0 / serialMs << " cuadros/s" << endl;
+        cout.unsetf(ios::fixed);
+    }
+
+    // Pipeline por etapas
+    FramePipeline<StreamFrame> pipeline(queueCapacity);
+    for (size_t s = 0; s < factories.size(); s++) {
+        pipeline.addStage(stageNames[s], threads[s], factories[s]);
+    }
+
+    SceneFeed feed(scenePaths, repeat);
+    feed.ok();
+    int found = 0;
+    bool inOrder = true;
+    uint64_t expected = 0;
+    double latencySumMs = 0, latencyMaxMs = 0;
+    uint64_t delivered = 0;
+    try {
+        delivered = pipeline.run(
+            [&](StreamFrame& f) {
+                if (!feed.next(f)) {
+                    return false;
+                }
+                f.created = chrono::steady_clock::now();
+                return true;
+            },
+            [&](StreamFrame& f) {
+                // Se verifica que el sink reciba los cuadros en el orden de entrada
+                if (f.index != expected) {
+                    inOrder = false;
+                }
+                expected++;
+                if (f.numInliers >= 10) {
+                    found++;
+                }
+                double latency = chrono::duration<double, milli>(chrono::steady_clock::now() - f.created).count();
+                latencySumMs += latency;
+                latencyMaxMs = max(latencyMaxMs, latency);
+            });
+    } catch (const Exception& e) {
+        cerr << "Error de OpenCV en el pipeline: " << e.what() << endl;
+        return -1;
+    } catch (const exception& e) {
+        cerr << "Error en el pipeline: " << e.what() << endl;
+        return -1;
+    }
+
+    double wallMs = pipeline.wallMs();
+    cout << "Pipeline: " << wallMs << " ms, " << fixed << setprecision(2)
+         << delivered * 1000.0 / wallMs << " cuadros/s";
+    if (serialMs > 0) {
+        cout << " (speedup " << serialMs / wallMs << "x)";
+    }
+    cout << endl;
+    cout << "Objeto encontrado en " << found << "/" << delivered << " cuadros, orden "
+         << (inOrder ? "preservado" : "NO preservado") << endl;
+    cout << "Latencia por cuadro: media " << (delivered ? latencySumMs / delivered : 0)
+         << " ms, máxima " << latencyMaxMs << " ms" << endl;
+
+    cout << endl << left << setw(16) << "Etapa" << right << setw(8) << "Hilos"
+         << setw(12) << "Cuadros" << setw(14) << "Ocupado ms" << setw(12) << "Uso %"
+         << setw(14) << "Cola media" << setw(12) << "Cola máx" << setw(8) << "Cap." << endl;
+    cout << string(96, '-') << endl;
+    for (const PipelineStageStats& st : pipeline.stats()) {
+        cout << left << setw(16) << st.name << right << setw(8) << st.threads
+             << setw(12) << st.processed << setw(14) << st.busyMs
+             << setw(12) << st.utilization * 100
+             << setw(14) << st.meanOccupancy << setw(12) << st.maxOccupancy
+             << setw(8) << st.queueCapacity << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,50 @@
+#!/bin/bash
+
+# Prueba de tolerancia a fallos del barrido distribuido: lanza el coordinador
+# con dos workers locales, mata (SIGKILL) a un worker mientras procesa una
+# tarea y verifica que el barrido termina igual con todos los shards y la
+# tabla de resultados completa.
+#
+# Uso: ./test_sweep.sh [directorio de la cola]   (desde taller2c2, tras make)
+
+QUEUE=${1:-sweep_test_queue}
+LOG=$(mktemp)
+trap 'rm -f "$LOG"' EXIT
+
+if [ ! -x ./combination_tester ]; then
+    echo "Falta ./combination_tester (ejecuta make)"
+    exit 1
+fi
+
+./combination_tester --coordinator "$QUEUE" --workers 2 --lease 15 --timeout 900 > "$LOG" 2>&1 &
+COORDINATOR=$!
+
+# Esperar a que un worker reclame una tarea (claimed/<id>@<host>.<pid>) y matarlo
+VICTIM=""
+for i in $(seq 1 600); do
+    CLAIM=$(ls "$QUEUE/claimed" 2>/dev/null | grep -v '\.tmp' | head -n 1)
+    if [ -n "$CLAIM" ] && kill -9 "${CLAIM##*.}" 2>/dev/null; then
+        VICTIM=${CLAIM##*.}
+        break
+    fi
+    sleep 0.1
+done
+
+wait $COORDINATOR
+STATUS=$?
+
+TASKS=$(sed -n 's/^Coordinador: \([0-9]*\) tareas.*/\1/p' "$LOG")
+SHARDS=$(ls "$QUEUE/results" 2>/dev/null | grep -vc '\.tmp')
+ROWS=$(awk '/=== RESULTADOS COMPARATIVOS ===/ { table = 1; next }
+            table && /^-+$/ { rows = 1; next }
+            rows && NF == 0 { exit }
+            rows { n++ }
+            END { print n + 0 }' "$LOG")
+
+echo "Worker matado: ${VICTIM:-ninguno}; tareas: ${TASKS:-?}, shards: $SHARDS, filas: $ROWS, código: $STATUS"
+if [ -z "$VICTIM" ] || [ -z "$TASKS" ] || [ "$STATUS" -ne 0 ] || [ "$SHARDS" -ne "$TASKS" ] || [ "$ROWS" -ne "$TASKS" ]; then
+    echo "FALLA: el barrido no se completó"
+    cat "$LOG"
+    exit 1
+fi
+echo "OK: barrido completo a pesar del worker caído"
@@ -0,0 +1,318 @@
+#ifndef WORK_QUEUE_HPP
+#define WORK_QUEUE_HPP
+
+#include <cstdio>
+#include <cerrno>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+
+// Cola de trabajo sobre un directorio compartido (NFS, SSHFS, disco local...).
+//
+// Estructura del directorio:
+//   pending/<id>     tareas sin reclamar (una línea de texto por tarea)
+//   claimed/<id>@<host>.<pid>
+//                    tareas en curso; el sufijo identifica al worker
+//   results/<id>     resultados (shards) escritos por los workers
+//   closed           lo crea el coordinador cuando terminó de encolar
+//   clock            archivo que el coordinador toca para leer la hora
+//
+// Reclamar una tarea es un rename() de pending/ a claimed/: en POSIX el
+// rename dentro de un mismo sistema de archivos es atómico, así que si dos
+// workers intentan la misma tarea solo uno lo consigue y el otro recibe
+// ENOENT. Los archivos se escriben primero con un nombre temporal (.tmp) y se
+// publican con rename, para que nunca se lea un archivo a medio escribir.
+//
+// Cada reclamo es un lease: el worker lo renueva tocando su archivo de
+// claimed/ (LeaseHeartbeat) y el coordinador devuelve a pending/ los que no se
+// renovaron en el plazo (requeueExpired), sea el worker local o remoto. La
+// hora se compara contra el mtime de un archivo recién tocado en la propia
+// cola, así que no importa si los relojes de las máquinas difieren. Un worker
+// colgado deja de renovar a los WORK_QUEUE_MAX_TASK_S segundos de la misma
+// tarea, de modo que su lease también vence.
+
+const int WORK_QUEUE_HEARTBEAT_S = 5;    // Intervalo de renovación del lease
+const int WORK_QUEUE_MAX_TASK_S = 600;   // Tope de renovación de una misma tarea
+
+class FsWorkQueue {
+public:
+    explicit FsWorkQueue(const std::string& dir) : dir_(dir) {}
+
+    const std::string& dir() const { return dir_; }
+
+    // Crea los subdirectorios (no falla si ya existen)
+    bool init() const {
+        return makeDir(dir_) && makeDir(path("pending")) && makeDir(path("claimed")) &&
+               makeDir(path("results"));
+    }
+
+    // Borra tareas, reclamos, resultados y la marca de cierre de una corrida anterior
+    void reset() const {
+        const char* subdirs[] = {"pending", "claimed", "results"};
+        for (const char* sub : subdirs) {
+            for (const std::string& name : listDir(path(sub))) {
+                std::remove((path(sub) + "/" + name).c_str());
+            }
+        }
+        std::remove(path("closed").c_str());
+    }
+
+    bool enqueue(const std::string& id, const std::string& payload) const {
+        return publish(path("pending") + "/" + id, payload);
+    }
+
+    void close() const {
+        publish(path("closed"), "");
+    }
+
+    bool isClosed() const {
+        struct stat st;
+        return stat(path("closed").c_str(), &st) == 0;
+    }
+
+    // Intenta reclamar una tarea pendiente. Devuelve false si no quedó ninguna.
+    bool claim(std::string& id, std::string& payload) {
+        std::vector<std::string> pending = listDir(path("pending"));
+        // Cada worker empieza en un punto distinto para no competir siempre por la misma
+        size_t offset = pending.empty() ? 0 : (size_t)getpid() % pending.size();
+        for (size_t k = 0; k < pending.size(); k++) {
+            const std::string& name = pending[(offset + k) % pending.size()];
+            std::string pendingPath = path("pending") + "/" + name;
+            std::string claimedPath = path("claimed") + "/" + name + "@" + workerTag();
+            // El rename conserva el mtime: se renueva antes para que el reclamo
+            // nazca con el lease vigente y requeueExpired no lo devuelva a
+            // pending/ antes del primer latido. Si falla (ENOENT), otro worker
+            // la reclamó primero
+            if (!touch(pendingPath)) {
+                continue;
+            }
+            if (std::rename(pendingPath.c_str(), claimedPath.c_str()) == 0) {
+                if (readFile(claimedPath, payload)) {
+                    id = name;
+                    claimedPath_ = claimedPath;
+                    return true;
+                }
+                // Error de E/S (p. ej. NFS): se devuelve la tarea en lugar de dejarla en claimed/
+                std::rename(claimedPath.c_str(), pendingPath.c_str());
+                continue;
+            }
+            // ENOENT: otro worker la reclamó primero; se prueba la siguiente
+        }
+        return false;
+    }
+
+    // Publica el resultado de la tarea reclamada y libera el reclamo
+    bool complete(const std::string& id, const std::string& result) {
+        bool ok = publish(path("results") + "/" + id, result);
+        if (ok && !claimedPath_.empty()) {
+            std::remove(claimedPath_.c_str());
+            claimedPath_.clear();
+        }
+        return ok;
+    }
+
+    // Archivo del reclamo en curso (vacío si no hay ninguno)
+    const std::string& claimedPath() const { return claimedPath_; }
+
+    // Devuelve a pending/ los reclamos sin resultado cuyo lease no se renovó en
+    // leaseSeconds. Agrega a expiredWorkers (si no es nulo) el workerTag() de
+    // cada reclamo vencido.
+    int requeueExpired(int leaseSeconds, std::vector<std::string>* expiredWorkers = nullptr) const {
+        time_t now;
+        if (!fsNow(now)) {
+            return 0;
+        }
+        return requeueIf([&](const std::string& claimed, const std::string& worker) {
+            struct stat st;
+            if (stat(claimed.c_str(), &st) != 0 || now - st.st_mtime < leaseSeconds) {
+                return false;
+            }
+            if (expiredWorkers) {
+                expiredWorkers->push_back(worker);
+            }
+            return true;
+        });
+    }
+
+    // Devuelve a pending/ los reclamos de un worker que se sabe muerto
+    int requeueClaimsOf(const std::string& worker) const {
+        return requeueIf([&](const std::string&, const std::string& owner) { return owner == worker; });
+    }
+
+    size_t countPending() const { return listDir(path("pending")).size(); }
+    size_t countClaimed() const { return listDir(path("claimed")).size(); }
+    size_t countResults() const { return listDir(path("results")).size(); }
+
+    // Lee todos los shards de resultados (id, contenido)
+    std::vector<std::pair<std::string, std::string>> readResults() const {
+        std::vector<std::pair<std::string, std::string>> out;
+        for (const std::string& name : listDir(path("results"))) {
+            std::string content;
+            if (readFile(path("results") + "/" + name, content)) {
+                out.push_back(std::make_pair(name, content));
+            }
+        }
+        return out;
+    }
+
+    static std::string workerTag(pid_t pid = getpid()) {
+        char host[256] = "localhost";
+        gethostname(host, sizeof(host) - 1);
+        std::ostringstream tag;
+        tag << host << "." << pid;
+        return tag.str();
+    }
+
+    // Renueva el mtime de un archivo (la marca del lease)
+    static bool touch(const std::string& p) {
+        return utimes(p.c_str(), nullptr) == 0;
+    }
+
+private:
+    std::string path(const char* sub) const {
+        return dir_ + "/" + sub;
+    }
+
+    // Recorre claimed/: borra los reclamos que ya tienen resultado y devuelve a
+    // pending/ los que cumplen expire(archivo, worker)
+    int requeueIf(const std::function<bool(const std::string&, const std::string&)>& expire) const {
+        int requeued = 0;
+        for (const std::string& name : listDir(path("claimed"))) {
+            size_t at = name.find('@');
+            std::string id = name.substr(0, at);
+            std::string worker = at == std::string::npos ? "" : name.substr(at + 1);
+            std::string claimed = path("claimed") + "/" + name;
+            struct stat st;
+            if (stat((path("results") + "/" + id).c_str(), &st) == 0) {
+                std::remove(claimed.c_str());
+            } else if (expire(claimed, worker) &&
+                       std::rename(claimed.c_str(), (path("pending") + "/" + id).c_str()) == 0) {
+                requeued++;
+            }
+        }
+        return requeued;
+    }
+
+    // Hora actual según el sistema de archivos de la cola
+    bool fsNow(time_t& now) const {
+        std::string clock = path("clock");
+        if (!touch(clock) && !publish(clock, "")) {
+            return false;
+        }
+        struct stat st;
+        if (stat(clock.c_str(), &st) != 0) {
+            return false;
+        }
+        now = st.st_mtime;
+        return true;
+    }
+
+    static bool makeDir(const std::string& p) {
+        return mkdir(p.c_str(), 0775) == 0 || errno == EEXIST;
+    }
+
+    // Archivos publicados del directorio (sin ".", ".." ni temporales), ordenados
+    static std::vector<std::string> listDir(const std::string& p) {
+        std::vector<std::string> names;
+        DIR* d = opendir(p.c_str());
+        if (!d) {
+            return names;
+        }
+        while (struct dirent* e = readdir(d)) {
+            std::string name = e->d_name;
+            if (name == "." || name == ".." || name.find(".tmp") != std::string::npos) {
+                continue;
+            }
+            names.push_back(name);
+        }
+        closedir(d);
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    // Escribe en <destino>.<host>.<pid>.tmp y publica con rename atómico
+    static bool publish(const std::string& dest, const std::string& content) {
+        std::string tmp = dest + "." + workerTag() + ".tmp";
+        {
+            std::ofstream out(tmp.c_str(), std::ios::binary);
+            if (!out) {
+                return false;
+            }
+            out << content;
+            if (!out) {
+                return false;
+            }
+        }
+        if (std::rename(tmp.c_str(), dest.c_str()) != 0) {
+            std::remove(tmp.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    static bool readFile(const std::string& p, std::string& content) {
+        std::ifstream in(p.c_str(), std::ios::binary);
+        if (!in) {
+            return false;
+        }
+        std::ostringstream ss;
+        ss << in.rdbuf();
+        content = ss.str();
+        return true;
+    }
+
+    std::string dir_;
+    std::string claimedPath_;
+};
+
+// Renueva el lease de la tarea reclamada desde un hilo aparte mientras el
+// objeto existe, como máximo WORK_QUEUE_MAX_TASK_S segundos
+class LeaseHeartbeat {
+public:
+    explicit LeaseHeartbeat(const std::string& claimedPath)
+        : path_(claimedPath), stop_(false), thread_(&LeaseHeartbeat::run, this) {}
+
+    ~LeaseHeartbeat() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        thread_.join();
+    }
+
+private:
+    void run() {
+        std::chrono::steady_clock::time_point limit =
+            std::chrono::steady_clock::now() + std::chrono::seconds(WORK_QUEUE_MAX_TASK_S);
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!wake_.wait_for(lock, std::chrono::seconds(WORK_QUEUE_HEARTBEAT_S), [this]() { return stop_; })) {
+            if (std::chrono::steady_clock::now() >= limit) {
+                break;
+            }
+            FsWorkQueue::touch(path_);
+        }
+    }
+
+    std::string path_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_;
+    std::thread thread_;   // Último: arranca con los demás miembros ya construidos
+};
+
+#endif // WORK_QUEUE_HPP